@@ -0,0 +1,570 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+// upper bound on the number of getaddrinfo calls running at the same time
+#define DNS_RESOLVER_MAX_WORKERS            4
+// a worker with nothing to resolve for this long exits
+#define DNS_RESOLVER_WORKER_IDLE_SECONDS    30
+
+// getaddrinfo does not report the record TTL, so cached results live for a fixed time
+#ifndef DNS_CACHE_TTL_SECONDS
+#define DNS_CACHE_TTL_SECONDS               60
+#endif
+// failed lookups are remembered for a shorter time so a reconnect loop does not hammer the resolver
+#ifndef DNS_CACHE_NEGATIVE_TTL_SECONDS
+#define DNS_CACHE_NEGATIVE_TTL_SECONDS      5
+#endif
+
+typedef enum DNS_LOOKUP_STATE_TAG
+{
+    DNS_LOOKUP_STATE_QUEUED,
+    DNS_LOOKUP_STATE_RESOLVING,
+    DNS_LOOKUP_STATE_COMPLETE
+} DNS_LOOKUP_STATE;
+
+/* one lookup of hostname:port, shared by every resolver asking for it while it is cached */
+typedef struct DNS_CACHE_ENTRY_TAG
+{
+    char* hostname;
+    char port[16];
+    DNS_LOOKUP_STATE state;
+    struct addrinfo* addrInfo;
+    time_t expiry_time;
+    /* held by the cache, by the queue or worker while the lookup is pending, and by each resolver */
+    size_t ref_count;
+    struct DNS_CACHE_ENTRY_TAG* next_cached;
+    struct DNS_CACHE_ENTRY_TAG* next_queued;
+} DNS_CACHE_ENTRY;
+
+typedef struct DNS_RESOLVER_INSTANCE_TAG
+{
+    DNS_CACHE_ENTRY* entry;
+} DNS_RESOLVER_INSTANCE;
+
+typedef struct DNS_PREWARM_HOST_TAG
+{
+    char* hostname;
+    int port;
+    struct DNS_PREWARM_HOST_TAG* next;
+} DNS_PREWARM_HOST;
+
+/* everything below is process wide and protected by dns_resolver_lock */
+static pthread_mutex_t dns_resolver_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dns_resolver_queue_signal = PTHREAD_COND_INITIALIZER;
+static DNS_CACHE_ENTRY* cache_head = NULL;
+static DNS_CACHE_ENTRY* queue_head = NULL;
+static DNS_CACHE_ENTRY* queue_tail = NULL;
+static size_t queue_length = 0;
+static size_t worker_count = 0;
+static size_t idle_worker_count = 0;
+static DNS_PREWARM_HOST* prewarm_hosts = NULL;
+
+static time_t get_monotonic_seconds(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+static void release_cache_entry(DNS_CACHE_ENTRY* entry)
+{
+    entry->ref_count--;
+    if (entry->ref_count == 0)
+    {
+        if (entry->addrInfo != NULL)
+        {
+            freeaddrinfo(entry->addrInfo);
+        }
+
+        free(entry->hostname);
+        free(entry);
+    }
+}
+
+static void remove_from_cache(DNS_CACHE_ENTRY* entry)
+{
+    DNS_CACHE_ENTRY** current = &cache_head;
+
+    while ((*current != NULL) && (*current != entry))
+    {
+        current = &(*current)->next_cached;
+    }
+
+    if (*current != NULL)
+    {
+        *current = entry->next_cached;
+        entry->next_cached = NULL;
+        release_cache_entry(entry);
+    }
+}
+
+static void remove_from_queue(DNS_CACHE_ENTRY* entry)
+{
+    DNS_CACHE_ENTRY* previous = NULL;
+    DNS_CACHE_ENTRY* current = queue_head;
+
+    while ((current != NULL) && (current != entry))
+    {
+        previous = current;
+        current = current->next_queued;
+    }
+
+    if (current != NULL)
+    {
+        if (previous == NULL)
+        {
+            queue_head = current->next_queued;
+        }
+        else
+        {
+            previous->next_queued = current->next_queued;
+        }
+
+        if (queue_tail == current)
+        {
+            queue_tail = previous;
+        }
+
+        current->next_queued = NULL;
+        queue_length--;
+        release_cache_entry(current);
+    }
+}
+
+/* drops expired results, entries still handed out to resolvers survive until released */
+static void remove_expired_entries(time_t now)
+{
+    DNS_CACHE_ENTRY* entry = cache_head;
+
+    while (entry != NULL)
+    {
+        DNS_CACHE_ENTRY* next = entry->next_cached;
+        if ((entry->state == DNS_LOOKUP_STATE_COMPLETE) && (now >= entry->expiry_time))
+        {
+            remove_from_cache(entry);
+        }
+
+        entry = next;
+    }
+}
+
+static DNS_CACHE_ENTRY* find_cache_entry(const char* hostname, const char* port)
+{
+    DNS_CACHE_ENTRY* entry = cache_head;
+
+    while ((entry != NULL) &&
+        ((strcmp(entry->hostname, hostname) != 0) || (strcmp(entry->port, port) != 0)))
+    {
+        entry = entry->next_cached;
+    }
+
+    return entry;
+}
+
+static DNS_CACHE_ENTRY* wait_for_queued_lookup(void)
+{
+    DNS_CACHE_ENTRY* result = NULL;
+    bool is_idle_timeout = false;
+
+    while ((queue_head == NULL) && !is_idle_timeout)
+    {
+        struct timespec deadline;
+        int wait_result;
+
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += DNS_RESOLVER_WORKER_IDLE_SECONDS;
+
+        idle_worker_count++;
+        wait_result = pthread_cond_timedwait(&dns_resolver_queue_signal, &dns_resolver_lock, &deadline);
+        idle_worker_count--;
+
+        is_idle_timeout = (wait_result == ETIMEDOUT);
+    }
+
+    if (queue_head != NULL)
+    {
+        /* the reference held by the queue moves to the worker */
+        result = queue_head;
+        queue_head = result->next_queued;
+        if (queue_head == NULL)
+        {
+            queue_tail = NULL;
+        }
+
+        result->next_queued = NULL;
+        queue_length--;
+    }
+
+    return result;
+}
+
+static void* dns_resolver_worker(void* context)
+{
+    DNS_CACHE_ENTRY* entry;
+    (void)context;
+
+    (void)pthread_mutex_lock(&dns_resolver_lock);
+
+    while ((entry = wait_for_queued_lookup()) != NULL)
+    {
+        struct addrinfo addrHint = { 0 };
+        struct addrinfo* addrInfo = NULL;
+        int err;
+
+        entry->state = DNS_LOOKUP_STATE_RESOLVING;
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+
+        /* both address families, the caller races them */
+        addrHint.ai_family = AF_UNSPEC;
+        addrHint.ai_socktype = SOCK_STREAM;
+        addrHint.ai_protocol = 0;
+
+        /* Codes_SRS_DNS_RESOLVER_30_020: [ The lookup shall be performed by calling `getaddrinfo` on a resolver worker thread. ]*/
+        err = getaddrinfo(entry->hostname, entry->port, &addrHint, &addrInfo);
+        if (err != 0)
+        {
+            /* Codes_SRS_DNS_RESOLVER_30_021: [ If `getaddrinfo` fails the lookup shall complete without any addresses. ]*/
+            LogError("Failure: getaddrinfo failure %d for %s.", err, entry->hostname);
+            addrInfo = NULL;
+        }
+
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+
+        /* Codes_SRS_DNS_RESOLVER_30_051: [ A successful lookup shall be cached for `DNS_CACHE_TTL_SECONDS`. ]*/
+        /* Codes_SRS_DNS_RESOLVER_30_052: [ A failed lookup shall be cached for `DNS_CACHE_NEGATIVE_TTL_SECONDS`. ]*/
+        entry->addrInfo = addrInfo;
+        entry->expiry_time = get_monotonic_seconds() + ((addrInfo != NULL) ? DNS_CACHE_TTL_SECONDS : DNS_CACHE_NEGATIVE_TTL_SECONDS);
+        entry->state = DNS_LOOKUP_STATE_COMPLETE;
+
+        /* Codes_SRS_DNS_RESOLVER_30_042: [ If the lookup is still running, the resources shall be released by the resolver worker once `getaddrinfo` returns. ]*/
+        release_cache_entry(entry);
+    }
+
+    worker_count--;
+    (void)pthread_mutex_unlock(&dns_resolver_lock);
+
+    return NULL;
+}
+
+static int start_worker(void)
+{
+    int result;
+    pthread_attr_t attributes;
+
+    if (pthread_attr_init(&attributes) != 0)
+    {
+        LogError("Failure: pthread_attr_init failed.");
+        result = __FAILURE__;
+    }
+    else
+    {
+        pthread_t worker;
+
+        /* workers are never joined, they exit on their own after being idle */
+        if ((pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED) != 0) ||
+            (pthread_create(&worker, &attributes, dns_resolver_worker, NULL) != 0))
+        {
+            LogError("Failure: unable to start a resolver worker.");
+            result = __FAILURE__;
+        }
+        else
+        {
+            worker_count++;
+            result = 0;
+        }
+
+        (void)pthread_attr_destroy(&attributes);
+    }
+
+    return result;
+}
+
+/* returns a referenced cache entry for hostname:port, queuing a lookup when there is no usable one; call with the lock held */
+static DNS_CACHE_ENTRY* get_cache_entry(const char* hostname, int port)
+{
+    DNS_CACHE_ENTRY* result;
+    char port_string[16];
+
+    (void)sprintf(port_string, "%u", (unsigned int)port);
+    remove_expired_entries(get_monotonic_seconds());
+
+    if ((result = find_cache_entry(hostname, port_string)) != NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_050: [ If a lookup of the same `hostname` and `port` is cached or in progress, `dns_resolver_create` shall share it instead of queuing a new one. ]*/
+        result->ref_count++;
+    }
+    else if ((result = (DNS_CACHE_ENTRY*)malloc(sizeof(DNS_CACHE_ENTRY))) == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_002: [ If any resource cannot be allocated, `dns_resolver_create` shall fail and return NULL. ]*/
+        LogError("Allocation Failure: DNS_CACHE_ENTRY");
+    }
+    else if (mallocAndStrcpy_s(&result->hostname, hostname) != 0)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_002: [ If any resource cannot be allocated, `dns_resolver_create` shall fail and return NULL. ]*/
+        LogError("Failure: unable to copy hostname");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        (void)strcpy(result->port, port_string);
+        result->state = DNS_LOOKUP_STATE_QUEUED;
+        result->addrInfo = NULL;
+        result->expiry_time = 0;
+        result->next_queued = NULL;
+        /* one for the cache, one for the queue and one for the caller */
+        result->ref_count = 3;
+
+        result->next_cached = cache_head;
+        cache_head = result;
+
+        /* Codes_SRS_DNS_RESOLVER_30_003: [ `dns_resolver_create` shall queue the lookup of `hostname` and return without waiting for it. ]*/
+        if (queue_tail == NULL)
+        {
+            queue_head = result;
+        }
+        else
+        {
+            queue_tail->next_queued = result;
+        }
+        queue_tail = result;
+        queue_length++;
+
+        /* Codes_SRS_DNS_RESOLVER_30_004: [ A new resolver worker shall be started when no idle worker is available and fewer than `DNS_RESOLVER_MAX_WORKERS` are running. ]*/
+        if ((queue_length > idle_worker_count) &&
+            (worker_count < DNS_RESOLVER_MAX_WORKERS) &&
+            (start_worker() != 0) &&
+            (worker_count == 0))
+        {
+            /* Codes_SRS_DNS_RESOLVER_30_005: [ If no resolver worker is running and none can be started, `dns_resolver_create` shall fail and return NULL. ]*/
+            remove_from_queue(result);
+            remove_from_cache(result);
+            release_cache_entry(result);
+            result = NULL;
+        }
+        else
+        {
+            (void)pthread_cond_signal(&dns_resolver_queue_signal);
+        }
+    }
+
+    return result;
+}
+
+DNS_RESOLVER_HANDLE dns_resolver_create(const char* hostname, int port)
+{
+    DNS_RESOLVER_INSTANCE* result;
+
+    if (hostname == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_001: [ If `hostname` is NULL, `dns_resolver_create` shall fail and return NULL. ]*/
+        LogError("Invalid argument: hostname is NULL");
+        result = NULL;
+    }
+    else if ((result = (DNS_RESOLVER_INSTANCE*)malloc(sizeof(DNS_RESOLVER_INSTANCE))) == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_002: [ If any resource cannot be allocated, `dns_resolver_create` shall fail and return NULL. ]*/
+        LogError("Allocation Failure: DNS_RESOLVER_INSTANCE");
+    }
+    else if (pthread_mutex_lock(&dns_resolver_lock) != 0)
+    {
+        LogError("Failure: unable to lock the resolver cache");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->entry = get_cache_entry(hostname, port);
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+
+        if (result->entry == NULL)
+        {
+            free(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+bool dns_resolver_is_lookup_complete(DNS_RESOLVER_HANDLE dns)
+{
+    bool result;
+
+    if (dns == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_010: [ If `dns` is NULL, `dns_resolver_is_lookup_complete` shall return false. ]*/
+        LogError("Invalid argument: dns is NULL");
+        result = false;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_011: [ `dns_resolver_is_lookup_complete` shall return true once the lookup has finished, whether it found addresses or not. ]*/
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+        result = (dns->entry->state == DNS_LOOKUP_STATE_COMPLETE);
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+    }
+
+    return result;
+}
+
+struct addrinfo* dns_resolver_get_addrInfo(DNS_RESOLVER_HANDLE dns)
+{
+    struct addrinfo* result;
+
+    if (dns == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_030: [ If `dns` is NULL, `dns_resolver_get_addrInfo` shall return NULL. ]*/
+        LogError("Invalid argument: dns is NULL");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_031: [ `dns_resolver_get_addrInfo` shall return the addresses found by a completed lookup, or NULL if the lookup is not complete or failed. ]*/
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+        result = (dns->entry->state == DNS_LOOKUP_STATE_COMPLETE) ? dns->entry->addrInfo : NULL;
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+    }
+
+    return result;
+}
+
+void dns_resolver_destroy(DNS_RESOLVER_HANDLE dns)
+{
+    if (dns == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_040: [ If `dns` is NULL, `dns_resolver_destroy` shall do nothing. ]*/
+        LogError("Invalid argument: dns is NULL");
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_041: [ `dns_resolver_destroy` shall release all resources associated with the resolver without waiting for a running lookup. ]*/
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+        release_cache_entry(dns->entry);
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+
+        free(dns);
+    }
+}
+
+void dns_resolver_invalidate(DNS_RESOLVER_HANDLE dns)
+{
+    if (dns == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_080: [ If `dns` is NULL, `dns_resolver_invalidate` shall do nothing. ]*/
+        LogError("Invalid argument: dns is NULL");
+    }
+    else
+    {
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+
+        /* Codes_SRS_DNS_RESOLVER_30_081: [ If the lookup of `dns` is complete, `dns_resolver_invalidate` shall drop it from the cache; the resolver keeps its addresses until it is destroyed. ]*/
+        if (dns->entry->state == DNS_LOOKUP_STATE_COMPLETE)
+        {
+            remove_from_cache(dns->entry);
+        }
+
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+    }
+}
+
+int dns_resolver_add_prewarm_host(const char* hostname, int port)
+{
+    int result;
+    DNS_PREWARM_HOST* prewarm_host;
+
+    if (hostname == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_060: [ If `hostname` is NULL, `dns_resolver_add_prewarm_host` shall fail and return a non-zero value. ]*/
+        LogError("Invalid argument: hostname is NULL");
+        result = __FAILURE__;
+    }
+    else if ((prewarm_host = (DNS_PREWARM_HOST*)malloc(sizeof(DNS_PREWARM_HOST))) == NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_061: [ If any resource cannot be allocated, `dns_resolver_add_prewarm_host` shall fail and return a non-zero value. ]*/
+        LogError("Allocation Failure: DNS_PREWARM_HOST");
+        result = __FAILURE__;
+    }
+    else if (mallocAndStrcpy_s(&prewarm_host->hostname, hostname) != 0)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_061: [ If any resource cannot be allocated, `dns_resolver_add_prewarm_host` shall fail and return a non-zero value. ]*/
+        LogError("Failure: unable to copy hostname");
+        free(prewarm_host);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_062: [ `dns_resolver_add_prewarm_host` shall remember `hostname` and `port` for `dns_resolver_prewarm` and return 0. ]*/
+        prewarm_host->port = port;
+
+        (void)pthread_mutex_lock(&dns_resolver_lock);
+        prewarm_host->next = prewarm_hosts;
+        prewarm_hosts = prewarm_host;
+        (void)pthread_mutex_unlock(&dns_resolver_lock);
+
+        result = 0;
+    }
+
+    return result;
+}
+
+void dns_resolver_prewarm(void)
+{
+    DNS_PREWARM_HOST* prewarm_host;
+
+    (void)pthread_mutex_lock(&dns_resolver_lock);
+
+    for (prewarm_host = prewarm_hosts; prewarm_host != NULL; prewarm_host = prewarm_host->next)
+    {
+        /* Codes_SRS_DNS_RESOLVER_30_063: [ `dns_resolver_prewarm` shall queue a lookup into the cache for every host added with `dns_resolver_add_prewarm_host`. ]*/
+        DNS_CACHE_ENTRY* entry = get_cache_entry(prewarm_host->hostname, prewarm_host->port);
+        if (entry == NULL)
+        {
+            LogError("Failure: unable to prewarm %s.", prewarm_host->hostname);
+        }
+        else
+        {
+            /* only the cache keeps it */
+            release_cache_entry(entry);
+        }
+    }
+
+    (void)pthread_mutex_unlock(&dns_resolver_lock);
+}
+
+void dns_resolver_clear_cache(void)
+{
+    (void)pthread_mutex_lock(&dns_resolver_lock);
+
+    /* Codes_SRS_DNS_RESOLVER_30_070: [ `dns_resolver_clear_cache` shall drop every cached lookup; lookups still used by a resolver or a worker are freed when released. ]*/
+    while (cache_head != NULL)
+    {
+        remove_from_cache(cache_head);
+    }
+
+    /* Codes_SRS_DNS_RESOLVER_30_071: [ `dns_resolver_clear_cache` shall forget the hosts added with `dns_resolver_add_prewarm_host`. ]*/
+    while (prewarm_hosts != NULL)
+    {
+        DNS_PREWARM_HOST* next = prewarm_hosts->next;
+        free(prewarm_hosts->hostname);
+        free(prewarm_hosts);
+        prewarm_hosts = next;
+    }
+
+    (void)pthread_mutex_unlock(&dns_resolver_lock);
+}
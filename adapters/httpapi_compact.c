@@ -20,6 +20,7 @@
 /*Codes_SRS_HTTPAPI_COMPACT_21_002: [ The httpapi_compact shall support the http requests. ]*/
 /*Codes_SRS_HTTPAPI_COMPACT_21_003: [ The httpapi_compact shall return error codes defined by HTTPAPI_RESULT. ]*/
 #include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/httpapi_stream.h"
 
 #define MAX_HOSTNAME     64
 #define TEMP_BUFFER_SIZE 1024
@@ -885,6 +886,35 @@ static HTTPAPI_RESULT SendContentToXIO(HTTP_HANDLE_DATA* http_instance, const un
     return result;
 }
 
+static HTTPAPI_RESULT SendStreamedContentToXIO(HTTP_HANDLE_DATA* http_instance, size_t contentLength, ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead, void* onRequestContentReadContext)
+{
+    HTTPAPI_RESULT result = HTTPAPI_OK;
+    unsigned char buf[TEMP_BUFFER_SIZE];
+
+    /*Codes_SRS_HTTPAPI_COMPACT_01_003: [ The HTTPAPI_ExecuteRequestStream shall send the content in pieces of at most 1024 bytes read from onRequestContentRead, never asking for more than what is left of the contentLength bytes. ]*/
+    while ((contentLength > 0) && (result == HTTPAPI_OK))
+    {
+        size_t bytesToRead = (contentLength < sizeof(buf)) ? contentLength : sizeof(buf);
+        size_t bytesRead = 0;
+
+        if ((onRequestContentRead(onRequestContentReadContext, buf, bytesToRead, &bytesRead) != 0) ||
+            (bytesRead == 0) ||
+            (bytesRead > bytesToRead))
+        {
+            /*Codes_SRS_HTTPAPI_COMPACT_01_004: [ If onRequestContentRead fails or does not provide between 1 and the requested number of bytes, the HTTPAPI_ExecuteRequestStream shall return HTTPAPI_SEND_REQUEST_FAILED. ]*/
+            LogError("the request content could not be read");
+            result = HTTPAPI_SEND_REQUEST_FAILED;
+        }
+        else
+        {
+            result = conn_send_all(http_instance, buf, bytesRead);
+            contentLength -= bytesRead;
+        }
+    }
+
+    return result;
+}
+
 /*Codes_SRS_HTTPAPI_COMPACT_21_030: [ At the end of the transmission, the HTTPAPI_ExecuteRequest shall receive the response from the host. ]*/
 static HTTPAPI_RESULT RecieveHeaderFromXIO(HTTP_HANDLE_DATA* http_instance, unsigned int* statusCode)
 {
@@ -1003,7 +1033,37 @@ static HTTPAPI_RESULT RecieveContentInfoFromXIO(HTTP_HANDLE_DATA* http_instance,
     return result;
 }
 
-static HTTPAPI_RESULT ReadHTTPResponseBodyFromXIO(HTTP_HANDLE_DATA* http_instance, size_t bodyLength, bool chunked, BUFFER_HANDLE responseContent)
+static HTTPAPI_RESULT WriteResponseContentFromXIO(HTTP_HANDLE_DATA* http_instance, size_t length, ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
+{
+    HTTPAPI_RESULT result = HTTPAPI_OK;
+    char    buf[TEMP_BUFFER_SIZE];
+
+    /*Codes_SRS_HTTPAPI_COMPACT_01_005: [ The HTTPAPI_ExecuteRequestStream shall pass the response content to onResponseContentWrite in pieces of at most 1024 bytes as it is received. ]*/
+    while ((length > 0) && (result == HTTPAPI_OK))
+    {
+        size_t size = (length < sizeof(buf)) ? length : sizeof(buf);
+
+        if (readChunk(http_instance, buf, size) < 0)
+        {
+            /*Codes_SRS_HTTPAPI_COMPACT_21_032: [ If the HTTPAPI_ExecuteRequest cannot read the message with the request result, it shall return HTTPAPI_READ_DATA_FAILED. ]*/
+            result = HTTPAPI_READ_DATA_FAILED;
+        }
+        else if (onResponseContentWrite(onResponseContentWriteContext, (const unsigned char*)buf, size) != 0)
+        {
+            /*Codes_SRS_HTTPAPI_COMPACT_01_006: [ If onResponseContentWrite fails, the HTTPAPI_ExecuteRequestStream shall return HTTPAPI_READ_DATA_FAILED. ]*/
+            LogError("the response content could not be written");
+            result = HTTPAPI_READ_DATA_FAILED;
+        }
+        else
+        {
+            length -= size;
+        }
+    }
+
+    return result;
+}
+
+static HTTPAPI_RESULT ReadHTTPResponseBodyFromXIO(HTTP_HANDLE_DATA* http_instance, size_t bodyLength, bool chunked, BUFFER_HANDLE responseContent, ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
 {
     HTTPAPI_RESULT result;
     char    buf[TEMP_BUFFER_SIZE];
@@ -1041,6 +1101,10 @@ static HTTPAPI_RESULT ReadHTTPResponseBodyFromXIO(HTTP_HANDLE_DATA* http_instanc
                     result = HTTPAPI_OK;
                 }
             }
+            else if (onResponseContentWrite != NULL)
+            {
+                result = WriteResponseContentFromXIO(http_instance, bodyLength, onResponseContentWrite, onResponseContentWriteContext);
+            }
             else
             {
                 /*Codes_SRS_HTTPAPI_COMPACT_21_051: [ If the responseContent is NULL, the HTTPAPI_ExecuteRequest shall ignore any content in the response. ]*/
@@ -1116,6 +1180,10 @@ static HTTPAPI_RESULT ReadHTTPResponseBodyFromXIO(HTTP_HANDLE_DATA* http_instanc
                         result = HTTPAPI_READ_DATA_FAILED;
                     }
                 }
+                else if (onResponseContentWrite != NULL)
+                {
+                    result = WriteResponseContentFromXIO(http_instance, chunkSize, onResponseContentWrite, onResponseContentWriteContext);
+                }
                 else
                 {
                     /*Codes_SRS_HTTPAPI_COMPACT_21_051: [ If the responseContent is NULL, the HTTPAPI_ExecuteRequest shall ignore any content in the response. ]*/
@@ -1168,10 +1236,13 @@ static bool validRequestType(HTTPAPI_REQUEST_TYPE requestType)
 /*Codes_SRS_HTTPAPI_COMPACT_21_050: [ If there is a content in the response, the HTTPAPI_ExecuteRequest shall copy it in the responseContent buffer. ]*/
 //Note: This function assumes that "Host:" and "Content-Length:" headers are setup
 //      by the caller of HTTPAPI_ExecuteRequest() (which is true for httptransport.c).
-HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+//      The content is either in content or read from onRequestContentRead, the response
+//      content is either copied to responseContent or passed to onResponseContentWrite.
+static HTTPAPI_RESULT ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
     HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
-    size_t contentLength, unsigned int* statusCode,
-    HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent)
+    size_t contentLength, ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead, void* onRequestContentReadContext,
+    unsigned int* statusCode, HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent,
+    ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
 {
     HTTPAPI_RESULT result = HTTPAPI_ERROR;
     size_t  headersCount;
@@ -1206,7 +1277,9 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
         LogError("Send heads to HTTP failed (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
     }
     /*Codes_SRS_HTTPAPI_COMPACT_21_042: [ The request can contain the a content message, provided in content parameter. ]*/
-    else if ((result = SendContentToXIO(http_instance, content, contentLength)) != HTTPAPI_OK)
+    else if ((result = ((onRequestContentRead != NULL) ?
+        SendStreamedContentToXIO(http_instance, contentLength, onRequestContentRead, onRequestContentReadContext) :
+        SendContentToXIO(http_instance, content, contentLength))) != HTTPAPI_OK)
     {
         LogError("Send content to HTTP failed (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
     }
@@ -1222,7 +1295,7 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
         LogError("Receive content information from HTTP failed (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
     }
     /*Codes_SRS_HTTPAPI_COMPACT_21_075: [ The message recieved by the HTTPAPI_ExecuteRequest can contain a body with the message content. ]*/
-    else if ((result = ReadHTTPResponseBodyFromXIO(http_instance, bodyLength, chunked, responseContent)) != HTTPAPI_OK)
+    else if ((result = ReadHTTPResponseBodyFromXIO(http_instance, bodyLength, chunked, responseContent, onResponseContentWrite, onResponseContentWriteContext)) != HTTPAPI_OK)
     {
         LogError("Read HTTP response body from HTTP failed (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
     }
@@ -1233,6 +1306,40 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
     return result;
 }
 
+HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+    HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
+    size_t contentLength, unsigned int* statusCode,
+    HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent)
+{
+    return ExecuteRequest(handle, requestType, relativePath, httpHeadersHandle, content, contentLength, NULL, NULL,
+        statusCode, responseHeadersHandle, responseContent, NULL, NULL);
+}
+
+/*Codes_SRS_HTTPAPI_COMPACT_01_001: [ The HTTPAPI_ExecuteRequestStream shall execute the request the same way as HTTPAPI_ExecuteRequest, reading the content from onRequestContentRead and passing the response content to onResponseContentWrite. ]*/
+HTTPAPI_RESULT HTTPAPI_ExecuteRequestStream(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+    HTTP_HEADERS_HANDLE httpHeadersHandle, size_t contentLength,
+    ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead, void* onRequestContentReadContext,
+    unsigned int* statusCode, HTTP_HEADERS_HANDLE responseHeadersHandle,
+    ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
+{
+    HTTPAPI_RESULT result;
+
+    if ((onRequestContentRead == NULL) && (contentLength > 0))
+    {
+        /*Codes_SRS_HTTPAPI_COMPACT_01_002: [ If onRequestContentRead is NULL and contentLength is not 0, the HTTPAPI_ExecuteRequestStream shall return HTTPAPI_INVALID_ARG. ]*/
+        result = HTTPAPI_INVALID_ARG;
+        LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else
+    {
+        /*Codes_SRS_HTTPAPI_COMPACT_01_007: [ If onResponseContentWrite is NULL, the HTTPAPI_ExecuteRequestStream shall ignore any content in the response. ]*/
+        result = ExecuteRequest(handle, requestType, relativePath, httpHeadersHandle, NULL, contentLength, onRequestContentRead, onRequestContentReadContext,
+            statusCode, responseHeadersHandle, NULL, onResponseContentWrite, onResponseContentWriteContext);
+    }
+
+    return result;
+}
+
 /*Codes_SRS_HTTPAPI_COMPACT_21_056: [ The HTTPAPI_SetOption shall change the HTTP options. ]*/
 /*Codes_SRS_HTTPAPI_COMPACT_21_057: [ The HTTPAPI_SetOption shall recieve a handle that identiry the HTTP connection. ]*/
 /*Codes_SRS_HTTPAPI_COMPACT_21_058: [ The HTTPAPI_SetOption shall recieve the option as a pair optionName/value. ]*/
@@ -9,8 +9,11 @@
 
 #include "azure_c_shared_utility/strings.h"
 #include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/httpapi_async.h"
+#include "azure_c_shared_utility/httpapi_stream.h"
 #include "azure_c_shared_utility/httpheaders.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/lock.h"
 #include "curl/curl.h"
 #include <openssl/x509_vfy.h>
 #include <openssl/pem.h>
@@ -24,6 +27,14 @@
 
 DEFINE_ENUM_STRINGS(HTTPAPI_RESULT, HTTPAPI_RESULT_VALUES);
 
+typedef struct HTTP_RESPONSE_CONTENT_BUFFER_TAG
+{
+    unsigned char* buffer;
+    size_t bufferSize;
+    size_t bufferCapacity;
+    unsigned char error;
+} HTTP_RESPONSE_CONTENT_BUFFER;
+
 typedef struct HTTP_HANDLE_DATA_TAG
 {
     CURL* curl;
@@ -34,19 +45,136 @@ typedef struct HTTP_HANDLE_DATA_TAG
     long forbidReuse;
     long freshConnect;
     long verbose;
+    long httpVersion;
+    unsigned char isTLSConfigurationPrivate; /*CAs or a client certificate added in ssl_ctx_callback, which curl does not know about when it reuses a connection or TLS session*/
     const char* x509privatekey;
     const char* x509certificate;
     const char* certificates; /*a list of CA certificates*/
+    struct curl_slist* requestHeaders;
+    HTTP_RESPONSE_CONTENT_BUFFER responseContentBuffer;
+    /*what an asynchronous request needs until it completes*/
+    unsigned char isRequestPending;
+    BUFFER_HANDLE responseContent;
+    ON_HTTPAPI_REQUEST_COMPLETE onRequestComplete;
+    void* onRequestCompleteContext;
+    /*where a streamed request reads its content from and writes the response content to*/
+    ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead;
+    void* onRequestContentReadContext;
+    size_t requestContentRemaining;
+    ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite;
+    void* onResponseContentWriteContext;
+    unsigned char isRequestContentReadFailed;
 } HTTP_HANDLE_DATA;
 
-typedef struct HTTP_RESPONSE_CONTENT_BUFFER_TAG
+static size_t nUsersOfHTTPAPI = 0; /*used for reference counting (a weak one)*/
+static CURLM* multiHandle = NULL; /*drives the asynchronous requests of all the connections, created by the first one*/
+static size_t pendingRequestCount = 0;
+static CURLSH* shareHandle = NULL; /*DNS cache, TLS sessions and connections shared by the connections*/
+static LOCK_HANDLE shareLocks[CURL_LOCK_DATA_LAST];
+static unsigned char areShareLocksLeaked = 0; /*a share handle still in use when it was cleaned up keeps calling ShareLockFunction*/
+
+static void ShareLockFunction(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
 {
-    unsigned char* buffer;
-    size_t bufferSize;
-    unsigned char error;
-} HTTP_RESPONSE_CONTENT_BUFFER;
+    (void)handle;
+    (void)access;
+    (void)userptr;
 
-static size_t nUsersOfHTTPAPI = 0; /*used for reference counting (a weak one)*/
+    if ((data < 0) ||
+        (data >= CURL_LOCK_DATA_LAST) ||
+        (Lock(shareLocks[data]) != LOCK_OK))
+    {
+        LogError("unable to lock the shared curl data %d", (int)data);
+    }
+}
+
+static void ShareUnlockFunction(CURL* handle, curl_lock_data data, void* userptr)
+{
+    (void)handle;
+    (void)userptr;
+
+    if ((data < 0) ||
+        (data >= CURL_LOCK_DATA_LAST) ||
+        (Unlock(shareLocks[data]) != LOCK_OK))
+    {
+        LogError("unable to unlock the shared curl data %d", (int)data);
+    }
+}
+
+static void DestroyShareHandle(void)
+{
+    size_t i;
+
+    if (shareHandle != NULL)
+    {
+        if (curl_share_cleanup(shareHandle) != CURLSHE_OK)
+        {
+            /*the connections still attached to it lock it through shareLocks, so the locks are never freed*/
+            LogError("curl_share_cleanup failed, a connection has not been closed");
+            areShareLocksLeaked = 1;
+        }
+
+        shareHandle = NULL;
+    }
+
+    if (!areShareLocksLeaked)
+    {
+        for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        {
+            if (shareLocks[i] != NULL)
+            {
+                (void)Lock_Deinit(shareLocks[i]);
+                shareLocks[i] = NULL;
+            }
+        }
+    }
+}
+
+static int CreateShareHandle(void)
+{
+    int result;
+    size_t i;
+
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        if ((shareLocks[i] == NULL) &&
+            ((shareLocks[i] = Lock_Init()) == NULL))
+        {
+            break;
+        }
+    }
+
+    if (i < CURL_LOCK_DATA_LAST)
+    {
+        LogError("Lock_Init failed");
+        DestroyShareHandle();
+        result = __FAILURE__;
+    }
+    else if ((shareHandle = curl_share_init()) == NULL)
+    {
+        LogError("curl_share_init failed");
+        DestroyShareHandle();
+        result = __FAILURE__;
+    }
+    else if ((curl_share_setopt(shareHandle, CURLSHOPT_LOCKFUNC, ShareLockFunction) != CURLSHE_OK) ||
+        (curl_share_setopt(shareHandle, CURLSHOPT_UNLOCKFUNC, ShareUnlockFunction) != CURLSHE_OK) ||
+        (curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) != CURLSHE_OK) ||
+        (curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) != CURLSHE_OK)
+#if LIBCURL_VERSION_NUM >= 0x073900
+        || (curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT) != CURLSHE_OK)
+#endif
+        )
+    {
+        LogError("unable to set up the curl share handle");
+        DestroyShareHandle();
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
 
 HTTPAPI_RESULT HTTPAPI_Init(void)
 {
@@ -58,6 +186,12 @@ HTTPAPI_RESULT HTTPAPI_Init(void)
             result = HTTPAPI_INIT_FAILED;
             LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
         }
+        else if (CreateShareHandle() != 0)
+        {
+            curl_global_cleanup();
+            result = HTTPAPI_INIT_FAILED;
+            LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+        }
         else
         {
             nUsersOfHTTPAPI++;
@@ -80,6 +214,14 @@ void HTTPAPI_Deinit(void)
         nUsersOfHTTPAPI--;
         if (nUsersOfHTTPAPI == 0)
         {
+            if (multiHandle != NULL)
+            {
+                (void)curl_multi_cleanup(multiHandle);
+                multiHandle = NULL;
+            }
+
+            DestroyShareHandle();
+
             curl_global_cleanup();
         }
     }
@@ -119,6 +261,16 @@ HTTP_HANDLE HTTPAPI_CreateConnection(const char* hostName)
                         free(httpHandleData);
                         httpHandleData = NULL;
                     }
+                    /*connections to the same host reuse the DNS entries, TLS sessions and open connections of each other*/
+                    else if ((shareHandle != NULL) &&
+                        (curl_easy_setopt(httpHandleData->curl, CURLOPT_SHARE, shareHandle) != CURLE_OK))
+                    {
+                        LogError("failed to set CURLOPT_SHARE");
+                        curl_easy_cleanup(httpHandleData->curl);
+                        free(httpHandleData->hostURL);
+                        free(httpHandleData);
+                        httpHandleData = NULL;
+                    }
                     else
                     {
                         httpHandleData->timeout = 242 * 1000; /*242 seconds seems like a nice enough time. Reasone for 242:
@@ -129,9 +281,14 @@ HTTP_HANDLE HTTPAPI_CreateConnection(const char* hostName)
                         httpHandleData->forbidReuse = 0;
                         httpHandleData->freshConnect = 0;
                         httpHandleData->verbose = 0;
+                        httpHandleData->httpVersion = CURL_HTTP_VERSION_1_1;
+                        httpHandleData->isTLSConfigurationPrivate = 0;
                         httpHandleData->x509certificate = NULL;
                         httpHandleData->x509privatekey = NULL;
                         httpHandleData->certificates = NULL;
+                        httpHandleData->requestHeaders = NULL;
+                        httpHandleData->responseContentBuffer.buffer = NULL;
+                        httpHandleData->isRequestPending = 0;
                     }
                 }
                 else
@@ -147,11 +304,19 @@ HTTP_HANDLE HTTPAPI_CreateConnection(const char* hostName)
     return (HTTP_HANDLE)httpHandleData;
 }
 
+static void IndicateRequestComplete(HTTP_HANDLE_DATA* httpHandleData, CURLcode curlRes, int isCancelled);
+
 void HTTPAPI_CloseConnection(HTTP_HANDLE handle)
 {
     HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)handle;
     if (httpHandleData != NULL)
     {
+        if (httpHandleData->isRequestPending)
+        {
+            /*a request that did not complete yet is cancelled*/
+            IndicateRequestComplete(httpHandleData, CURLE_OK, 1);
+        }
+
         free(httpHandleData->hostURL);
         curl_easy_cleanup(httpHandleData->curl);
         free(httpHandleData);
@@ -192,29 +357,101 @@ static size_t ContentWriteFunction(void *ptr, size_t size, size_t nmemb, void *u
     HTTP_RESPONSE_CONTENT_BUFFER* responseContentBuffer = (HTTP_RESPONSE_CONTENT_BUFFER*)userdata;
     if ((userdata != NULL) &&
         (ptr != NULL) &&
-        (size * nmemb > 0))
+        (size * nmemb > 0) &&
+        (!responseContentBuffer->error))
     {
-        void* newBuffer = realloc(responseContentBuffer->buffer, responseContentBuffer->bufferSize + (size * nmemb));
-        if (newBuffer != NULL)
-        {
-            responseContentBuffer->buffer = newBuffer;
-            memcpy(responseContentBuffer->buffer + responseContentBuffer->bufferSize, ptr, size * nmemb);
-            responseContentBuffer->bufferSize += size * nmemb;
-        }
-        else
+        size_t neededSize = responseContentBuffer->bufferSize + (size * nmemb);
+        if (neededSize > responseContentBuffer->bufferCapacity)
         {
-            LogError("Could not allocate buffer of size %zu", (size_t)(responseContentBuffer->bufferSize + (size * nmemb)));
-            responseContentBuffer->error = 1;
-            if (responseContentBuffer->buffer != NULL)
+            /*the buffer at least doubles, so a response of many chunks is not copied at each chunk*/
+            size_t newCapacity = responseContentBuffer->bufferCapacity * 2;
+            void* newBuffer;
+            if (newCapacity < neededSize)
+            {
+                newCapacity = neededSize;
+            }
+
+            newBuffer = realloc(responseContentBuffer->buffer, newCapacity);
+            if (newBuffer == NULL)
             {
+                LogError("Could not allocate buffer of size %zu", newCapacity);
+                responseContentBuffer->error = 1;
                 free(responseContentBuffer->buffer);
+                responseContentBuffer->buffer = NULL;
+                responseContentBuffer->bufferSize = 0;
+                responseContentBuffer->bufferCapacity = 0;
             }
+            else
+            {
+                responseContentBuffer->buffer = newBuffer;
+                responseContentBuffer->bufferCapacity = newCapacity;
+            }
+        }
+
+        if (!responseContentBuffer->error)
+        {
+            memcpy(responseContentBuffer->buffer + responseContentBuffer->bufferSize, ptr, size * nmemb);
+            responseContentBuffer->bufferSize = neededSize;
         }
     }
 
     return size * nmemb;
 }
 
+static size_t StreamContentWriteFunction(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)userdata;
+    size_t result;
+
+    if (httpHandleData->onResponseContentWrite(httpHandleData->onResponseContentWriteContext, (const unsigned char*)ptr, size * nmemb) != 0)
+    {
+        /*returning less than what was received makes curl abort the transfer*/
+        LogError("the response content could not be written");
+        httpHandleData->responseContentBuffer.error = 1;
+        result = 0;
+    }
+    else
+    {
+        result = size * nmemb;
+    }
+
+    return result;
+}
+
+static size_t StreamContentReadFunction(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)userdata;
+    size_t result;
+    size_t bytesRead = 0;
+    size_t bufferSize = size * nitems;
+
+    /*the callback is not asked for more than what is left of the content*/
+    if (bufferSize > httpHandleData->requestContentRemaining)
+    {
+        bufferSize = httpHandleData->requestContentRemaining;
+    }
+
+    if (bufferSize == 0)
+    {
+        result = 0;
+    }
+    else if ((httpHandleData->onRequestContentRead(httpHandleData->onRequestContentReadContext, (unsigned char*)buffer, bufferSize, &bytesRead) != 0) ||
+        (bytesRead == 0) ||
+        (bytesRead > bufferSize))
+    {
+        LogError("the request content could not be read");
+        httpHandleData->isRequestContentReadFailed = 1;
+        result = CURL_READFUNC_ABORT;
+    }
+    else
+    {
+        httpHandleData->requestContentRemaining -= bytesRead;
+        result = bytesRead;
+    }
+
+    return result;
+}
+
 static CURLcode ssl_ctx_callback(CURL *curl, void *ssl_ctx, void *userptr)
 {
     CURLcode result;
@@ -260,20 +497,32 @@ static CURLcode ssl_ctx_callback(CURL *curl, void *ssl_ctx, void *userptr)
     return result;
 }
 
-HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
-                                      HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
-                                      size_t contentLength, unsigned int* statusCode,
-                                      HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent)
+static void ReleaseRequest(HTTP_HANDLE_DATA* httpHandleData)
+{
+    curl_slist_free_all(httpHandleData->requestHeaders);
+    httpHandleData->requestHeaders = NULL;
+
+    if (httpHandleData->responseContentBuffer.buffer != NULL)
+    {
+        free(httpHandleData->responseContentBuffer.buffer);
+        httpHandleData->responseContentBuffer.buffer = NULL;
+    }
+}
+
+/*sets up the easy handle of the connection for one request, the same way for a synchronous and an asynchronous request*/
+/*the content is either in content or read from onRequestContentRead, the response content is either kept to be copied to a BUFFER or passed to onResponseContentWrite*/
+static HTTPAPI_RESULT SetupRequest(HTTP_HANDLE_DATA* httpHandleData, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+                                   HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
+                                   size_t contentLength, ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead, void* onRequestContentReadContext,
+                                   HTTP_HEADERS_HANDLE responseHeadersHandle, ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
 {
     HTTPAPI_RESULT result;
-    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)handle;
     size_t headersCount;
-    HTTP_RESPONSE_CONTENT_BUFFER responseContentBuffer;
 
     if ((httpHandleData == NULL) ||
         (relativePath == NULL) ||
         (httpHeadersHandle == NULL) ||
-        ((content == NULL) && (contentLength > 0))
+        ((content == NULL) && (onRequestContentRead == NULL) && (contentLength > 0))
     )
     {
         result = HTTPAPI_INVALID_ARG;
@@ -338,11 +587,19 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
                 result = HTTPAPI_SET_OPTION_FAILED;
                 LogError("failed to set CURLOPT_FORBID_REUSE (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
             }
-            else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1) != CURLE_OK)
+            else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTP_VERSION, httpHandleData->httpVersion) != CURLE_OK)
             {
                 result = HTTPAPI_SET_OPTION_FAILED;
                 LogError("failed to set CURLOPT_HTTP_VERSION (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
             }
+#if LIBCURL_VERSION_NUM >= 0x072B00
+            /*with HTTP/2 an asynchronous request waits for a connection to the same host to be able to take one more stream instead of opening a new connection*/
+            else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_PIPEWAIT, (httpHandleData->httpVersion == CURL_HTTP_VERSION_1_1) ? 0L : 1L) != CURLE_OK)
+            {
+                result = HTTPAPI_SET_OPTION_FAILED;
+                LogError("failed to set CURLOPT_PIPEWAIT (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+            }
+#endif
             else
             {
                 result = HTTPAPI_OK;
@@ -441,7 +698,6 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
                 if (result == HTTPAPI_OK)
                 {
                     /* add headers */
-                    struct curl_slist* headers = NULL;
                     size_t i;
 
                     for (i = 0; i < headersCount; i++)
@@ -456,7 +712,7 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
                         }
                         else
                         {
-                            struct curl_slist* newHeaders = curl_slist_append(headers, tempBuffer);
+                            struct curl_slist* newHeaders = curl_slist_append(httpHandleData->requestHeaders, tempBuffer);
                             if (newHeaders == NULL)
                             {
                                 result = HTTPAPI_ALLOC_FAILED;
@@ -467,22 +723,40 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
                             else
                             {
                                 free(tempBuffer);
-                                headers = newHeaders;
+                                httpHandleData->requestHeaders = newHeaders;
                             }
                         }
                     }
 
                     if (result == HTTPAPI_OK)
                     {
-                        if (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTPHEADER, headers) != CURLE_OK)
+                        if (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTPHEADER, httpHandleData->requestHeaders) != CURLE_OK)
                         {
                             result = HTTPAPI_SET_OPTION_FAILED;
                             LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
                         }
                         else
                         {
+                            httpHandleData->onRequestContentRead = onRequestContentRead;
+                            httpHandleData->onRequestContentReadContext = onRequestContentReadContext;
+                            httpHandleData->requestContentRemaining = contentLength;
+                            httpHandleData->isRequestContentReadFailed = 0;
+
                             /* add content */
-                            if ((content != NULL) &&
+                            if ((onRequestContentRead != NULL) &&
+                                (contentLength > 0))
+                            {
+                                /*without POSTFIELDS curl reads the content from the read callback*/
+                                if ((curl_easy_setopt(httpHandleData->curl, CURLOPT_POSTFIELDS, (void*)NULL) != CURLE_OK) ||
+                                    (curl_easy_setopt(httpHandleData->curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)contentLength) != CURLE_OK) ||
+                                    (curl_easy_setopt(httpHandleData->curl, CURLOPT_READFUNCTION, StreamContentReadFunction) != CURLE_OK) ||
+                                    (curl_easy_setopt(httpHandleData->curl, CURLOPT_READDATA, httpHandleData) != CURLE_OK))
+                                {
+                                    result = HTTPAPI_SET_OPTION_FAILED;
+                                    LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+                                }
+                            }
+                            else if ((content != NULL) &&
                                 (contentLength > 0))
                             {
                                 if ((curl_easy_setopt(httpHandleData->curl, CURLOPT_POSTFIELDS, (void*)content) != CURLE_OK) ||
@@ -513,7 +787,7 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
                             {
                                 if ((curl_easy_setopt(httpHandleData->curl, CURLOPT_WRITEHEADER, NULL) != CURLE_OK) ||
                                     (curl_easy_setopt(httpHandleData->curl, CURLOPT_HEADERFUNCTION, NULL) != CURLE_OK) ||
-                                    (curl_easy_setopt(httpHandleData->curl, CURLOPT_WRITEFUNCTION, ContentWriteFunction) != CURLE_OK))
+                                    (curl_easy_setopt(httpHandleData->curl, CURLOPT_WRITEFUNCTION, (onResponseContentWrite != NULL) ? StreamContentWriteFunction : ContentWriteFunction) != CURLE_OK))
                                 {
                                     result = HTTPAPI_SET_OPTION_FAILED;
                                     LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
@@ -533,86 +807,28 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
 
                                     if (result == HTTPAPI_OK)
                                     {
-                                        responseContentBuffer.buffer = NULL;
-                                        responseContentBuffer.bufferSize = 0;
-                                        responseContentBuffer.error = 0;
+                                        httpHandleData->responseContentBuffer.buffer = NULL;
+                                        httpHandleData->responseContentBuffer.bufferSize = 0;
+                                        httpHandleData->responseContentBuffer.bufferCapacity = 0;
+                                        httpHandleData->responseContentBuffer.error = 0;
+                                        httpHandleData->onResponseContentWrite = onResponseContentWrite;
+                                        httpHandleData->onResponseContentWriteContext = onResponseContentWriteContext;
 
-                                        if (curl_easy_setopt(httpHandleData->curl, CURLOPT_WRITEDATA, &responseContentBuffer) != CURLE_OK)
+                                        if (curl_easy_setopt(httpHandleData->curl, CURLOPT_WRITEDATA, (onResponseContentWrite != NULL) ? (void*)httpHandleData : (void*)&httpHandleData->responseContentBuffer) != CURLE_OK)
                                         {
                                             result = HTTPAPI_SET_OPTION_FAILED;
                                             LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
                                         }
-
-                                        if (result == HTTPAPI_OK)
-                                        {
-                                            /* Execute request */
-                                            CURLcode curlRes = curl_easy_perform(httpHandleData->curl);
-                                            if (curlRes != CURLE_OK)
-                                            {
-                                                LogError("curl_easy_perform() failed: %s\n", curl_easy_strerror(curlRes));
-                                                result = HTTPAPI_OPEN_REQUEST_FAILED;
-                                                LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
-                                            }
-                                            else
-                                            {
-                                                long httpCode;
-
-                                                /* get the status code */
-                                                if (curl_easy_getinfo(httpHandleData->curl, CURLINFO_RESPONSE_CODE, &httpCode) != CURLE_OK)
-                                                {
-                                                    result = HTTPAPI_QUERY_HEADERS_FAILED;
-                                                    LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
-                                                }
-                                                else if (responseContentBuffer.error)
-                                                {
-                                                    result = HTTPAPI_READ_DATA_FAILED;
-                                                    LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
-                                                }
-                                                else
-                                                {
-                                                    if (statusCode != NULL)
-                                                    {
-                                                        *statusCode = httpCode;
-                                                    }
-
-                                                    /* fill response content length */
-                                                    if (responseContent != NULL)
-                                                    {
-                                                        if ((responseContentBuffer.bufferSize > 0) && (BUFFER_build(responseContent, responseContentBuffer.buffer, responseContentBuffer.bufferSize) != 0))
-                                                        {
-                                                            result = HTTPAPI_INSUFFICIENT_RESPONSE_BUFFER;
-                                                            LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
-                                                        }
-                                                        else
-                                                        {
-                                                            /*all nice*/
-                                                        }
-                                                    }
-
-                                                    if (httpCode >= 300)
-                                                    {
-                                                        LogError("Failure in HTTP communication: server reply code is %ld", httpCode);
-                                                        LogInfo("HTTP Response:%*.*s", (int)responseContentBuffer.bufferSize,
-                                                            (int)responseContentBuffer.bufferSize, responseContentBuffer.buffer);
-                                                    }
-                                                    else
-                                                    {
-                                                        result = HTTPAPI_OK;
-                                                    }
-                                                }
-                                            }
-                                        }
-
-                                        if (responseContentBuffer.buffer != NULL)
-                                        {
-                                            free(responseContentBuffer.buffer);
-                                        }
                                     }
                                 }
                             }
                         }
                     }
-                    curl_slist_free_all(headers);
+
+                    if (result != HTTPAPI_OK)
+                    {
+                        ReleaseRequest(httpHandleData);
+                    }
                 }
             }
             free(tempHostURL);
@@ -622,6 +838,296 @@ HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE r
     return result;
 }
 
+/*reads the outcome of a request that has been performed and releases what SetupRequest allocated for it*/
+static HTTPAPI_RESULT CompleteRequest(HTTP_HANDLE_DATA* httpHandleData, CURLcode curlRes, unsigned int* statusCode, BUFFER_HANDLE responseContent)
+{
+    HTTPAPI_RESULT result;
+
+    if ((curlRes != CURLE_OK) &&
+        (httpHandleData->onRequestContentRead != NULL) &&
+        (httpHandleData->isRequestContentReadFailed))
+    {
+        result = HTTPAPI_SEND_REQUEST_FAILED;
+        LogError("the request content could not be read (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else if ((curlRes != CURLE_OK) &&
+        (httpHandleData->responseContentBuffer.error))
+    {
+        result = HTTPAPI_READ_DATA_FAILED;
+        LogError("the response content could not be written (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else if (curlRes != CURLE_OK)
+    {
+        LogError("curl_easy_perform() failed: %s\n", curl_easy_strerror(curlRes));
+        result = HTTPAPI_OPEN_REQUEST_FAILED;
+        LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else
+    {
+        long httpCode;
+
+        /* get the status code */
+        if (curl_easy_getinfo(httpHandleData->curl, CURLINFO_RESPONSE_CODE, &httpCode) != CURLE_OK)
+        {
+            result = HTTPAPI_QUERY_HEADERS_FAILED;
+            LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+        }
+        else if (httpHandleData->responseContentBuffer.error)
+        {
+            result = HTTPAPI_READ_DATA_FAILED;
+            LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+        }
+        else
+        {
+            result = HTTPAPI_OK;
+
+            if (statusCode != NULL)
+            {
+                *statusCode = httpCode;
+            }
+
+            /* fill response content length */
+            if (responseContent != NULL)
+            {
+                if ((httpHandleData->responseContentBuffer.bufferSize > 0) && (BUFFER_build(responseContent, httpHandleData->responseContentBuffer.buffer, httpHandleData->responseContentBuffer.bufferSize) != 0))
+                {
+                    result = HTTPAPI_INSUFFICIENT_RESPONSE_BUFFER;
+                    LogError("(result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+                }
+                else
+                {
+                    /*all nice*/
+                }
+            }
+
+            if (httpCode >= 300)
+            {
+                LogError("Failure in HTTP communication: server reply code is %ld", httpCode);
+                LogInfo("HTTP Response:%*.*s", (int)httpHandleData->responseContentBuffer.bufferSize,
+                    (int)httpHandleData->responseContentBuffer.bufferSize, httpHandleData->responseContentBuffer.buffer);
+            }
+            else
+            {
+                result = HTTPAPI_OK;
+            }
+        }
+    }
+
+    ReleaseRequest(httpHandleData);
+
+    return result;
+}
+
+HTTPAPI_RESULT HTTPAPI_ExecuteRequest(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+                                      HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
+                                      size_t contentLength, unsigned int* statusCode,
+                                      HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent)
+{
+    HTTPAPI_RESULT result;
+    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)handle;
+
+    if ((httpHandleData != NULL) &&
+        (httpHandleData->isRequestPending))
+    {
+        result = HTTPAPI_ERROR;
+        LogError("an asynchronous request is pending on the connection (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else
+    {
+        result = SetupRequest(httpHandleData, requestType, relativePath, httpHeadersHandle, content, contentLength, NULL, NULL, responseHeadersHandle, NULL, NULL);
+        if (result == HTTPAPI_OK)
+        {
+            /* Execute request */
+            result = CompleteRequest(httpHandleData, curl_easy_perform(httpHandleData->curl), statusCode, responseContent);
+        }
+    }
+
+    return result;
+}
+
+static int DiscardResponseContent(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    (void)buffer;
+    (void)size;
+    return 0;
+}
+
+HTTPAPI_RESULT HTTPAPI_ExecuteRequestStream(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+                                            HTTP_HEADERS_HANDLE httpHeadersHandle, size_t contentLength,
+                                            ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead, void* onRequestContentReadContext,
+                                            unsigned int* statusCode, HTTP_HEADERS_HANDLE responseHeadersHandle,
+                                            ON_HTTPAPI_RESPONSE_CONTENT_WRITE onResponseContentWrite, void* onResponseContentWriteContext)
+{
+    HTTPAPI_RESULT result;
+    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)handle;
+
+    if ((httpHandleData == NULL) ||
+        ((onRequestContentRead == NULL) && (contentLength > 0)))
+    {
+        result = HTTPAPI_INVALID_ARG;
+        LogError("invalid arg HTTP_HANDLE handle=%p, size_t contentLength=%zu, ON_HTTPAPI_REQUEST_CONTENT_READ onRequestContentRead=%p", handle, contentLength, onRequestContentRead);
+    }
+    else if (httpHandleData->isRequestPending)
+    {
+        result = HTTPAPI_ERROR;
+        LogError("an asynchronous request is pending on the connection (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else
+    {
+        /*without a callback the response content is dropped as it is received instead of being kept in the handle*/
+        result = SetupRequest(httpHandleData, requestType, relativePath, httpHeadersHandle, NULL, contentLength, onRequestContentRead, onRequestContentReadContext, responseHeadersHandle,
+            (onResponseContentWrite != NULL) ? onResponseContentWrite : DiscardResponseContent, onResponseContentWriteContext);
+        if (result == HTTPAPI_OK)
+        {
+            result = CompleteRequest(httpHandleData, curl_easy_perform(httpHandleData->curl), statusCode, NULL);
+        }
+    }
+
+    return result;
+}
+
+static CURLM* CreateMultiHandle(void)
+{
+    CURLM* result = curl_multi_init();
+    if (result == NULL)
+    {
+        LogError("curl_multi_init failed");
+    }
+#if LIBCURL_VERSION_NUM >= 0x072B00
+    /*HTTP/2 requests of all the connections to one host are multiplexed as streams of one connection*/
+    else if (curl_multi_setopt(result, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX) != CURLM_OK)
+    {
+        LogError("failed to set CURLMOPT_PIPELINING");
+        (void)curl_multi_cleanup(result);
+        result = NULL;
+    }
+#endif
+
+    return result;
+}
+
+HTTPAPI_RESULT HTTPAPI_ExecuteRequestAsync(HTTP_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
+                                           HTTP_HEADERS_HANDLE httpHeadersHandle, const unsigned char* content,
+                                           size_t contentLength, HTTP_HEADERS_HANDLE responseHeadersHandle, BUFFER_HANDLE responseContent,
+                                           ON_HTTPAPI_REQUEST_COMPLETE onRequestComplete, void* onRequestCompleteContext)
+{
+    HTTPAPI_RESULT result;
+    HTTP_HANDLE_DATA* httpHandleData = (HTTP_HANDLE_DATA*)handle;
+
+    if ((httpHandleData == NULL) ||
+        (onRequestComplete == NULL))
+    {
+        result = HTTPAPI_INVALID_ARG;
+        LogError("invalid arg HTTP_HANDLE handle=%p, ON_HTTPAPI_REQUEST_COMPLETE onRequestComplete=%p", handle, onRequestComplete);
+    }
+    else if (httpHandleData->isRequestPending)
+    {
+        result = HTTPAPI_ERROR;
+        LogError("an asynchronous request is already pending on the connection (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else if ((multiHandle == NULL) &&
+        ((multiHandle = CreateMultiHandle()) == NULL))
+    {
+        result = HTTPAPI_INIT_FAILED;
+        LogError("unable to create the curl multi handle (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+    }
+    else
+    {
+        result = SetupRequest(httpHandleData, requestType, relativePath, httpHeadersHandle, content, contentLength, NULL, NULL, responseHeadersHandle, NULL, NULL);
+        if (result == HTTPAPI_OK)
+        {
+            /*the multi handle keeps its own connection cache, a connection verified against other CAs or authenticated with a client certificate is not left in it for the other connections*/
+            if ((httpHandleData->isTLSConfigurationPrivate) &&
+                ((curl_easy_setopt(httpHandleData->curl, CURLOPT_FRESH_CONNECT, 1L) != CURLE_OK) ||
+                (curl_easy_setopt(httpHandleData->curl, CURLOPT_FORBID_REUSE, 1L) != CURLE_OK) ||
+                (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1) != CURLE_OK)))
+            {
+                result = HTTPAPI_SET_OPTION_FAILED;
+                LogError("unable to isolate the connection of a private TLS configuration (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+                ReleaseRequest(httpHandleData);
+            }
+            else if ((curl_easy_setopt(httpHandleData->curl, CURLOPT_PRIVATE, httpHandleData) != CURLE_OK) ||
+                (curl_multi_add_handle(multiHandle, httpHandleData->curl) != CURLM_OK))
+            {
+                result = HTTPAPI_SEND_REQUEST_FAILED;
+                LogError("curl_multi_add_handle failed (result = %s)", ENUM_TO_STRING(HTTPAPI_RESULT, result));
+                ReleaseRequest(httpHandleData);
+            }
+            else
+            {
+                httpHandleData->responseContent = responseContent;
+                httpHandleData->onRequestComplete = onRequestComplete;
+                httpHandleData->onRequestCompleteContext = onRequestCompleteContext;
+                httpHandleData->isRequestPending = 1;
+                pendingRequestCount++;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*takes the request of a connection out of the multi handle and tells its owner how it ended*/
+static void IndicateRequestComplete(HTTP_HANDLE_DATA* httpHandleData, CURLcode curlRes, int isCancelled)
+{
+    HTTPAPI_RESULT result;
+    unsigned int statusCode = 0;
+
+    (void)curl_multi_remove_handle(multiHandle, httpHandleData->curl);
+    httpHandleData->isRequestPending = 0;
+    pendingRequestCount--;
+
+    if (isCancelled)
+    {
+        ReleaseRequest(httpHandleData);
+        result = HTTPAPI_ERROR;
+    }
+    else
+    {
+        result = CompleteRequest(httpHandleData, curlRes, &statusCode, httpHandleData->responseContent);
+    }
+
+    httpHandleData->onRequestComplete(httpHandleData->onRequestCompleteContext, result, statusCode);
+}
+
+void HTTPAPI_DoWork(void)
+{
+    if (pendingRequestCount > 0)
+    {
+        int runningCount;
+        CURLMcode multiRes = curl_multi_perform(multiHandle, &runningCount);
+        if (multiRes != CURLM_OK)
+        {
+            LogError("curl_multi_perform failed: %s", curl_multi_strerror(multiRes));
+        }
+        else
+        {
+            CURLMsg* message;
+            int messagesLeft;
+
+            /*the completion callbacks are free to submit or close connections, so each finished transfer is read again from the multi handle*/
+            while ((message = curl_multi_info_read(multiHandle, &messagesLeft)) != NULL)
+            {
+                if (message->msg == CURLMSG_DONE)
+                {
+                    HTTP_HANDLE_DATA* httpHandleData;
+                    if ((curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&httpHandleData) != CURLE_OK) ||
+                        (httpHandleData == NULL))
+                    {
+                        LogError("unable to find the connection of a finished transfer");
+                        (void)curl_multi_remove_handle(multiHandle, message->easy_handle);
+                    }
+                    else
+                    {
+                        IndicateRequestComplete(httpHandleData, message->data.result, 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
 HTTPAPI_RESULT HTTPAPI_SetOption(HTTP_HANDLE handle, const char* optionName, const void* value)
 {
     HTTPAPI_RESULT result;
@@ -668,6 +1174,20 @@ HTTPAPI_RESULT HTTPAPI_SetOption(HTTP_HANDLE handle, const char* optionName, con
             httpHandleData->verbose = *(const long*)value;
             result = HTTPAPI_OK;
         }
+        else if (strcmp(OPTION_CURL_HTTP_VERSION, optionName) == 0)
+        {
+            /*curl refuses the HTTP versions it was built without, which makes the option fail here rather than every request*/
+            if (curl_easy_setopt(httpHandleData->curl, CURLOPT_HTTP_VERSION, *(const long*)value) != CURLE_OK)
+            {
+                result = HTTPAPI_SET_OPTION_FAILED;
+                LogError("unsupported HTTP version %ld", *(const long*)value);
+            }
+            else
+            {
+                httpHandleData->httpVersion = *(const long*)value;
+                result = HTTPAPI_OK;
+            }
+        }
         else if (strcmp(SU_OPTION_X509_PRIVATE_KEY, optionName) == 0)
         {
             httpHandleData->x509privatekey = value;
@@ -685,8 +1205,15 @@ HTTPAPI_RESULT HTTPAPI_SetOption(HTTP_HANDLE handle, const char* optionName, con
                         LogError("unable to curl_easy_setopt");
                         result = HTTPAPI_ERROR;
                     }
+                    /*curl does not know about the certificate added in ssl_ctx_callback, so the connections and TLS sessions authenticated with it are kept out of the shared caches*/
+                    else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_SHARE, NULL) != CURLE_OK)
+                    {
+                        LogError("unable to curl_easy_setopt");
+                        result = HTTPAPI_ERROR;
+                    }
                     else
                     {
+                        httpHandleData->isTLSConfigurationPrivate = 1;
                         result = HTTPAPI_OK;
                     }
                 }
@@ -714,8 +1241,15 @@ HTTPAPI_RESULT HTTPAPI_SetOption(HTTP_HANDLE handle, const char* optionName, con
                         LogError("unable to curl_easy_setopt");
                         result = HTTPAPI_ERROR;
                     }
+                    /*curl does not know about the certificate added in ssl_ctx_callback, so the connections and TLS sessions authenticated with it are kept out of the shared caches*/
+                    else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_SHARE, NULL) != CURLE_OK)
+                    {
+                        LogError("unable to curl_easy_setopt");
+                        result = HTTPAPI_ERROR;
+                    }
                     else
                     {
+                        httpHandleData->isTLSConfigurationPrivate = 1;
                         result = HTTPAPI_OK;
                     }
                 }
@@ -801,9 +1335,16 @@ HTTPAPI_RESULT HTTPAPI_SetOption(HTTP_HANDLE handle, const char* optionName, con
                     LogError("failure in curl_easy_setopt - CURLOPT_SSL_CTX_DATA");
                     result = HTTPAPI_ERROR;
                 }
+                /*the CAs are not known to curl either, so a connection or TLS session verified against them is not shared, nor is one verified against the default CAs reused*/
+                else if (curl_easy_setopt(httpHandleData->curl, CURLOPT_SHARE, NULL) != CURLE_OK)
+                {
+                    LogError("failure in curl_easy_setopt - CURLOPT_SHARE");
+                    result = HTTPAPI_ERROR;
+                }
                 else
                 {
                     httpHandleData->certificates = (const char*)value;
+                    httpHandleData->isTLSConfigurationPrivate = 1;
                     result = HTTPAPI_OK;
                 }
             }
@@ -915,7 +1456,8 @@ HTTPAPI_RESULT HTTPAPI_CloneOption(const char* optionName, const void* value, co
             (strcmp(OPTION_CURL_LOW_SPEED_TIME, optionName) == 0) ||
             (strcmp(OPTION_CURL_FRESH_CONNECT, optionName) == 0) ||
             (strcmp(OPTION_CURL_FORBID_REUSE, optionName) == 0) ||
-            (strcmp(OPTION_CURL_VERBOSE, optionName) == 0)
+            (strcmp(OPTION_CURL_VERBOSE, optionName) == 0) ||
+            (strcmp(OPTION_CURL_HTTP_VERSION, optionName) == 0)
             )
         {
             /*by convention value is pointing to an long */
@@ -4,6 +4,7 @@
 #include "azure_c_shared_utility/platform.h"
 #include "azure_c_shared_utility/xio.h"
 #include "azure_c_shared_utility/tlsio_openssl.h"
+#include "azure_c_shared_utility/dns_resolver.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -94,6 +95,9 @@ static int local_system(const char *command, const char *outFile)
 
 int platform_init(void)
 {
+    /* the lookups run in the background, a failure shows up when the host is connected to */
+    dns_resolver_prewarm();
+
     return tlsio_openssl_init();
 }
 
@@ -131,4 +135,5 @@ STRING_HANDLE platform_get_platform_info(void)
 void platform_deinit(void)
 {
 	tlsio_openssl_deinit();
+	dns_resolver_clear_cache();
 }
@@ -6,10 +6,13 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include "azure_c_shared_utility/socketio.h"
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <limits.h>
 #ifdef TIZENRT
 #include <net/lwip/tcp.h>
 #else
@@ -21,34 +24,111 @@
 #include <fcntl.h>
 #include <errno.h>
 #include "azure_c_shared_utility/singlylinkedlist.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#include "azure_c_shared_utility/tickcounter.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/optimize_size.h"
 #include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+
+#ifdef __linux__
+/* the shared readiness reactor is built on epoll, which only exists on Linux */
+#define SOCKETIO_USE_EPOLL_REACTOR
+#endif
+
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/threadapi.h"
+#endif
 
 #define SOCKET_SUCCESS          0
 #define INVALID_SOCKET          -1
 
-// connect timeout in seconds
-#define CONNECT_TIMEOUT         10
+// connect timeout in milliseconds, counted from the first connection attempt
+#define CONNECT_TIMEOUT_MS      10000
+
+// delay before racing the next resolved address against the ones still connecting (RFC 8305 section 5)
+#define CONNECTION_ATTEMPT_DELAY_MS 250
+
+// maximum number of readiness events collected by one epoll_wait of the reactor thread
+#define REACTOR_MAX_EVENTS      64
+
+// maximum number of pending IOs handed to one sendmsg call
+#if defined(IOV_MAX) && (IOV_MAX < 64)
+#define SEND_MAX_IOVEC          IOV_MAX
+#else
+#define SEND_MAX_IOVEC          64
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS              MSG_NOSIGNAL
+#else
+#define SEND_FLAGS              0
+#endif
 
 typedef enum IO_STATE_TAG
 {
     IO_STATE_CLOSED,
     IO_STATE_OPENING,
+    IO_STATE_CONNECTING,
     IO_STATE_OPEN,
     IO_STATE_CLOSING,
     IO_STATE_ERROR
 } IO_STATE;
 
+typedef struct CONNECT_ATTEMPT_TAG
+{
+    const struct addrinfo* address;
+    int socket;
+} CONNECT_ATTEMPT;
+
 typedef struct PENDING_SOCKET_IO_TAG
 {
     unsigned char* bytes;
     size_t size;
+    /* number of bytes at the front of bytes that already went out */
+    size_t consumed;
     ON_SEND_COMPLETE on_send_complete;
     void* callback_context;
     SINGLYLINKEDLIST_HANDLE pending_io_list;
 } PENDING_SOCKET_IO;
 
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+struct SOCKET_REACTOR_TAG;
+
+typedef struct SOCKET_REACTOR_ENTRY_TAG
+{
+    struct SOCKET_REACTOR_TAG* reactor;
+    int socket;
+    int readable;
+    int writable;
+    int removed;
+    struct SOCKET_REACTOR_ENTRY_TAG* next_retired;
+} SOCKET_REACTOR_ENTRY;
+
+typedef struct SOCKET_REACTOR_TAG
+{
+    int epoll_fd;
+    int wake_fd;
+    int stop;
+    int failed;
+    size_t registration_count;
+    LOCK_HANDLE lock;
+    THREAD_HANDLE thread;
+    /* entries removed from epoll, freed by the reactor thread once no epoll_wait result can reference them */
+    SOCKET_REACTOR_ENTRY* retired_entries;
+    /* entries removed from epoll while the reactor lock could not be taken, freed once the thread is joined; protected by socket_reactor_guard */
+    SOCKET_REACTOR_ENTRY* orphaned_entries;
+} SOCKET_REACTOR;
+
+/* one reactor is shared by all the instances that opted in; it lives as long as it has registrations */
+static pthread_mutex_t socket_reactor_guard = PTHREAD_MUTEX_INITIALIZER;
+static SOCKET_REACTOR* socket_reactor = NULL;
+#endif
+
 typedef struct SOCKET_IO_INSTANCE_TAG
 {
     int socket;
@@ -60,37 +140,121 @@ typedef struct SOCKET_IO_INSTANCE_TAG
     int port;
     IO_STATE io_state;
     SINGLYLINKEDLIST_HANDLE pending_io_list;
+    ON_IO_OPEN_COMPLETE on_io_open_complete;
+    void* on_io_open_complete_context;
+    DNS_RESOLVER_HANDLE dns_resolver;
+    /* resolved addresses in the order they are raced; they point into the resolver's list */
+    CONNECT_ATTEMPT* connect_attempts;
+    size_t connect_attempt_count;
+    size_t next_connect_attempt;
+    TICK_COUNTER_HANDLE connect_tick_counter;
+    tickcounter_ms_t connect_start_time;
+    tickcounter_ms_t last_connect_attempt_time;
+    int use_reactor;
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+    SOCKET_REACTOR_ENTRY* reactor_entry;
+#endif
+    /* reused by every recv; (re)allocated by dowork when receive_buffer_size changes */
+    unsigned char* receive_buffer;
+    size_t receive_buffer_allocated;
+    size_t receive_buffer_size;
+    /* while lent the socket is read and written by the borrower only, socketio still closes it */
+    bool socket_lent;
 } SOCKET_IO_INSTANCE;
 
 /*this function will clone an option given by name and value*/
 static void* socketio_CloneOption(const char* name, const void* value)
 {
-    (void)name;
-    (void)value;
-    return NULL;
+    void* result;
+
+    if ((name == NULL) || (value == NULL))
+    {
+        LogError("invalid parameter detected: const char* name=%p, const void* value=%p", name, value);
+        result = NULL;
+    }
+    else if (strcmp(name, OPTION_SOCKETIO_USE_REACTOR) == 0)
+    {
+        int* value_copy = (int*)malloc(sizeof(int));
+        if (value_copy == NULL)
+        {
+            LogError("unable to allocate %s value", name);
+        }
+        else
+        {
+            *value_copy = *(const int*)value;
+        }
+
+        result = value_copy;
+    }
+    else if (strcmp(name, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE) == 0)
+    {
+        size_t* value_copy = (size_t*)malloc(sizeof(size_t));
+        if (value_copy == NULL)
+        {
+            LogError("unable to allocate %s value", name);
+        }
+        else
+        {
+            *value_copy = *(const size_t*)value;
+        }
+
+        result = value_copy;
+    }
+    else
+    {
+        result = NULL;
+    }
+
+    return result;
 }
 
 /*this function destroys an option previously created*/
 static void socketio_DestroyOption(const char* name, const void* value)
 {
-    (void)name;
-    (void)value;
+    if ((name != NULL) && (value != NULL) &&
+        ((strcmp(name, OPTION_SOCKETIO_USE_REACTOR) == 0) || (strcmp(name, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE) == 0)))
+    {
+        free((void*)value);
+    }
 }
 
 static OPTIONHANDLER_HANDLE socketio_retrieveoptions(CONCRETE_IO_HANDLE handle)
 {
     OPTIONHANDLER_HANDLE result;
-    (void)handle;
-    result = OptionHandler_Create(socketio_CloneOption, socketio_DestroyOption, socketio_setoption);
-    if (result == NULL)
+
+    if (handle == NULL)
     {
-        LogError("unable to OptionHandler_Create");
-        /*return as is*/
+        LogError("invalid parameter detected: CONCRETE_IO_HANDLE handle=%p", handle);
+        result = NULL;
     }
     else
     {
-        /*insert here work to add the options to "result" handle*/
+        result = OptionHandler_Create(socketio_CloneOption, socketio_DestroyOption, socketio_setoption);
+        if (result == NULL)
+        {
+            LogError("unable to OptionHandler_Create");
+            /*return as is*/
+        }
+        else
+        {
+            SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)handle;
+            if ((socket_io_instance->use_reactor != 0) &&
+                (OptionHandler_AddOption(result, OPTION_SOCKETIO_USE_REACTOR, &socket_io_instance->use_reactor) != 0))
+            {
+                LogError("unable to save %s option", OPTION_SOCKETIO_USE_REACTOR);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if ((socket_io_instance->receive_buffer_size != RECEIVE_BYTES_VALUE) &&
+                (OptionHandler_AddOption(result, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE, &socket_io_instance->receive_buffer_size) != 0))
+            {
+                LogError("unable to save %s option", OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+        }
     }
+
     return result;
 }
 
@@ -106,11 +270,625 @@ static const IO_INTERFACE_DESCRIPTION socket_io_interface_description =
     socketio_setoption
 };
 
-static void indicate_error(SOCKET_IO_INSTANCE* socket_io_instance)
-{
-    if (socket_io_instance->on_io_error != NULL)
-    {
-        socket_io_instance->on_io_error(socket_io_instance->on_io_error_context);
+static void indicate_error(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (socket_io_instance->on_io_error != NULL)
+    {
+        socket_io_instance->on_io_error(socket_io_instance->on_io_error_context);
+    }
+}
+
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+static void free_reactor_entries(SOCKET_REACTOR_ENTRY** entries)
+{
+    while (*entries != NULL)
+    {
+        SOCKET_REACTOR_ENTRY* entry = *entries;
+        *entries = entry->next_retired;
+        free(entry);
+    }
+}
+
+static int socket_reactor_thread(void* context)
+{
+    SOCKET_REACTOR* reactor = (SOCKET_REACTOR*)context;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int stop = 0;
+
+    while (stop == 0)
+    {
+        int event_count = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if ((event_count < 0) && (errno != EINTR))
+        {
+            LogError("Failure: epoll_wait failed. errno=%d (%s).", errno, strerror(errno));
+
+            /* registered instances fall back to trying their sockets on every dowork */
+            (void)Lock(reactor->lock);
+            reactor->failed = 1;
+            (void)Unlock(reactor->lock);
+            break;
+        }
+
+        if (Lock(reactor->lock) != LOCK_OK)
+        {
+            LogError("Failure: unable to lock the reactor.");
+        }
+        else
+        {
+            int i;
+            for (i = 0; i < event_count; i++)
+            {
+                SOCKET_REACTOR_ENTRY* entry = (SOCKET_REACTOR_ENTRY*)events[i].data.ptr;
+                if (entry == NULL)
+                {
+                    uint64_t wake_count;
+                    (void)read(reactor->wake_fd, &wake_count, sizeof(wake_count));
+                }
+                else if (entry->removed == 0)
+                {
+                    if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+                    {
+                        entry->readable = 1;
+                    }
+                    if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0)
+                    {
+                        entry->writable = 1;
+                    }
+                }
+            }
+
+            /* every retired entry was removed from epoll before this point, so no later epoll_wait can return it */
+            free_reactor_entries(&reactor->retired_entries);
+            stop = reactor->stop;
+            (void)Unlock(reactor->lock);
+        }
+    }
+
+    return 0;
+}
+
+static void socket_reactor_destroy(SOCKET_REACTOR* reactor)
+{
+    if (reactor->thread != NULL)
+    {
+        uint64_t wake = 1;
+        int thread_result;
+
+        (void)Lock(reactor->lock);
+        reactor->stop = 1;
+        (void)Unlock(reactor->lock);
+
+        if (write(reactor->wake_fd, &wake, sizeof(wake)) != sizeof(wake))
+        {
+            LogError("Failure: unable to wake the reactor thread. errno=%d (%s).", errno, strerror(errno));
+        }
+
+        (void)ThreadAPI_Join(reactor->thread, &thread_result);
+    }
+
+    /* the thread is gone, so nothing references the entries anymore */
+    free_reactor_entries(&reactor->retired_entries);
+    free_reactor_entries(&reactor->orphaned_entries);
+    (void)Lock_Deinit(reactor->lock);
+    close(reactor->wake_fd);
+    close(reactor->epoll_fd);
+    free(reactor);
+}
+
+static SOCKET_REACTOR* socket_reactor_create(void)
+{
+    SOCKET_REACTOR* result = (SOCKET_REACTOR*)malloc(sizeof(SOCKET_REACTOR));
+    if (result == NULL)
+    {
+        LogError("Allocation Failure: SOCKET_REACTOR");
+    }
+    else
+    {
+        result->stop = 0;
+        result->failed = 0;
+        result->registration_count = 0;
+        result->retired_entries = NULL;
+        result->orphaned_entries = NULL;
+        result->thread = NULL;
+
+        if ((result->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        {
+            LogError("Failure: epoll_create1 failed. errno=%d (%s).", errno, strerror(errno));
+            free(result);
+            result = NULL;
+        }
+        else if ((result->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        {
+            LogError("Failure: eventfd failed. errno=%d (%s).", errno, strerror(errno));
+            close(result->epoll_fd);
+            free(result);
+            result = NULL;
+        }
+        else if ((result->lock = Lock_Init()) == NULL)
+        {
+            LogError("Failure: unable to create the reactor lock.");
+            close(result->wake_fd);
+            close(result->epoll_fd);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            struct epoll_event wake_event;
+            wake_event.events = EPOLLIN;
+            wake_event.data.ptr = NULL;
+
+            if (epoll_ctl(result->epoll_fd, EPOLL_CTL_ADD, result->wake_fd, &wake_event) != 0)
+            {
+                LogError("Failure: unable to add the wake descriptor to epoll. errno=%d (%s).", errno, strerror(errno));
+                socket_reactor_destroy(result);
+                result = NULL;
+            }
+            else if (ThreadAPI_Create(&result->thread, socket_reactor_thread, result) != THREADAPI_OK)
+            {
+                LogError("Failure: unable to start the reactor thread.");
+                result->thread = NULL;
+                socket_reactor_destroy(result);
+                result = NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+static SOCKET_REACTOR_ENTRY* socket_reactor_register(int socket)
+{
+    SOCKET_REACTOR_ENTRY* result;
+
+    if (pthread_mutex_lock(&socket_reactor_guard) != 0)
+    {
+        LogError("Failure: unable to lock the reactor guard.");
+        result = NULL;
+    }
+    else
+    {
+        if (socket_reactor == NULL)
+        {
+            socket_reactor = socket_reactor_create();
+        }
+
+        if (socket_reactor == NULL)
+        {
+            result = NULL;
+        }
+        else if ((result = (SOCKET_REACTOR_ENTRY*)malloc(sizeof(SOCKET_REACTOR_ENTRY))) == NULL)
+        {
+            LogError("Allocation Failure: SOCKET_REACTOR_ENTRY");
+        }
+        else
+        {
+            struct epoll_event socket_event;
+
+            /* start out ready so that the first dowork finds out the actual state of the socket */
+            result->reactor = socket_reactor;
+            result->socket = socket;
+            result->readable = 1;
+            result->writable = 1;
+            result->removed = 0;
+            result->next_retired = NULL;
+
+            /* edge triggered: the reactor thread only wakes up on state changes, the dowork drains until EAGAIN */
+            socket_event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            socket_event.data.ptr = result;
+
+            if (epoll_ctl(socket_reactor->epoll_fd, EPOLL_CTL_ADD, socket, &socket_event) != 0)
+            {
+                LogError("Failure: unable to add socket to epoll. errno=%d (%s).", errno, strerror(errno));
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                socket_reactor->registration_count++;
+            }
+        }
+
+        if ((socket_reactor != NULL) && (socket_reactor->registration_count == 0))
+        {
+            socket_reactor_destroy(socket_reactor);
+            socket_reactor = NULL;
+        }
+
+        (void)pthread_mutex_unlock(&socket_reactor_guard);
+    }
+
+    return result;
+}
+
+static void socket_reactor_unregister(SOCKET_REACTOR_ENTRY* entry)
+{
+    if (pthread_mutex_lock(&socket_reactor_guard) != 0)
+    {
+        LogError("Failure: unable to lock the reactor guard.");
+    }
+    else
+    {
+        SOCKET_REACTOR* reactor = entry->reactor;
+
+        /* the socket is about to be closed, its descriptor must leave the epoll set even if the reactor lock fails */
+        (void)epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, entry->socket, NULL);
+
+        if (Lock(reactor->lock) != LOCK_OK)
+        {
+            /* an epoll_wait result may still point at the entry, so it is kept until the reactor thread is joined */
+            LogError("Failure: unable to lock the reactor.");
+            entry->next_retired = reactor->orphaned_entries;
+            reactor->orphaned_entries = entry;
+        }
+        else
+        {
+            entry->removed = 1;
+            entry->next_retired = reactor->retired_entries;
+            reactor->retired_entries = entry;
+            (void)Unlock(reactor->lock);
+        }
+
+        reactor->registration_count--;
+        if (reactor->registration_count == 0)
+        {
+            socket_reactor_destroy(reactor);
+            socket_reactor = NULL;
+        }
+
+        (void)pthread_mutex_unlock(&socket_reactor_guard);
+    }
+}
+
+static int socket_reactor_take_readiness(SOCKET_REACTOR_ENTRY* entry, int* flag)
+{
+    int result;
+
+    if (Lock(entry->reactor->lock) != LOCK_OK)
+    {
+        LogError("Failure: unable to lock the reactor.");
+        result = 1;
+    }
+    else
+    {
+        result = (entry->reactor->failed != 0) ? 1 : *flag;
+        *flag = 0;
+        (void)Unlock(entry->reactor->lock);
+    }
+
+    return result;
+}
+
+static void socket_reactor_set_writable(SOCKET_REACTOR_ENTRY* entry)
+{
+    if (Lock(entry->reactor->lock) != LOCK_OK)
+    {
+        LogError("Failure: unable to lock the reactor.");
+    }
+    else
+    {
+        entry->writable = 1;
+        (void)Unlock(entry->reactor->lock);
+    }
+}
+#endif
+
+static void register_with_reactor(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+    if ((socket_io_instance->use_reactor != 0) &&
+        (socket_io_instance->reactor_entry == NULL) &&
+        (socket_io_instance->socket != INVALID_SOCKET) &&
+        !socket_io_instance->socket_lent)
+    {
+        socket_io_instance->reactor_entry = socket_reactor_register(socket_io_instance->socket);
+        if (socket_io_instance->reactor_entry == NULL)
+        {
+            /* not fatal, the instance keeps polling its socket on every dowork */
+            LogError("Failure: unable to register socket with the reactor, falling back to polling.");
+        }
+    }
+#else
+    (void)socket_io_instance;
+#endif
+}
+
+static void unregister_from_reactor(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+    if (socket_io_instance->reactor_entry != NULL)
+    {
+        socket_reactor_unregister(socket_io_instance->reactor_entry);
+        socket_io_instance->reactor_entry = NULL;
+    }
+#else
+    (void)socket_io_instance;
+#endif
+}
+
+static void indicate_open_complete(SOCKET_IO_INSTANCE* socket_io_instance, IO_OPEN_RESULT open_result)
+{
+    if (socket_io_instance->on_io_open_complete != NULL)
+    {
+        socket_io_instance->on_io_open_complete(socket_io_instance->on_io_open_complete_context, open_result);
+    }
+}
+
+static void release_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    size_t i;
+
+    for (i = 0; i < socket_io_instance->connect_attempt_count; i++)
+    {
+        if (socket_io_instance->connect_attempts[i].socket != INVALID_SOCKET)
+        {
+            close(socket_io_instance->connect_attempts[i].socket);
+        }
+    }
+
+    free(socket_io_instance->connect_attempts);
+    socket_io_instance->connect_attempts = NULL;
+    socket_io_instance->connect_attempt_count = 0;
+    socket_io_instance->next_connect_attempt = 0;
+
+    if (socket_io_instance->connect_tick_counter != NULL)
+    {
+        tickcounter_destroy(socket_io_instance->connect_tick_counter);
+        socket_io_instance->connect_tick_counter = NULL;
+    }
+
+    /* the attempts point into the resolved address list, so the resolver goes last */
+    if (socket_io_instance->dns_resolver != NULL)
+    {
+        dns_resolver_destroy(socket_io_instance->dns_resolver);
+        socket_io_instance->dns_resolver = NULL;
+    }
+}
+
+static void indicate_open_failed(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    release_connect_attempts(socket_io_instance);
+
+    if (socket_io_instance->socket != INVALID_SOCKET)
+    {
+        close(socket_io_instance->socket);
+        socket_io_instance->socket = INVALID_SOCKET;
+    }
+
+    socket_io_instance->io_state = IO_STATE_CLOSED;
+    indicate_open_complete(socket_io_instance, IO_OPEN_ERROR);
+}
+
+static const struct addrinfo* find_address(const struct addrinfo* address, int family, bool is_same_family)
+{
+    while ((address != NULL) && ((address->ai_family == family) != is_same_family))
+    {
+        address = address->ai_next;
+    }
+
+    return address;
+}
+
+/* orders the resolved addresses as RFC 8305 section 4 asks: alternate address families, starting with the first one returned */
+static int create_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance, const struct addrinfo* addrInfo)
+{
+    int result;
+    size_t count = 0;
+    const struct addrinfo* current;
+
+    for (current = addrInfo; current != NULL; current = current->ai_next)
+    {
+        count++;
+    }
+
+    if ((socket_io_instance->connect_attempts = (CONNECT_ATTEMPT*)malloc(count * sizeof(CONNECT_ATTEMPT))) == NULL)
+    {
+        LogError("Allocation Failure: connect attempts.");
+        result = __FAILURE__;
+    }
+    else
+    {
+        int preferred_family = addrInfo->ai_family;
+        const struct addrinfo* preferred = addrInfo;
+        const struct addrinfo* other = find_address(addrInfo, preferred_family, false);
+        size_t i = 0;
+
+        while ((preferred != NULL) || (other != NULL))
+        {
+            if (preferred != NULL)
+            {
+                socket_io_instance->connect_attempts[i].address = preferred;
+                socket_io_instance->connect_attempts[i].socket = INVALID_SOCKET;
+                i++;
+                preferred = find_address(preferred->ai_next, preferred_family, true);
+            }
+
+            if (other != NULL)
+            {
+                socket_io_instance->connect_attempts[i].address = other;
+                socket_io_instance->connect_attempts[i].socket = INVALID_SOCKET;
+                i++;
+                other = find_address(other->ai_next, preferred_family, false);
+            }
+        }
+
+        socket_io_instance->connect_attempt_count = count;
+        socket_io_instance->next_connect_attempt = 0;
+        result = 0;
+    }
+
+    return result;
+}
+
+static int start_connect_attempt(CONNECT_ATTEMPT* connect_attempt)
+{
+    int result;
+    int flags;
+
+    connect_attempt->socket = socket(connect_attempt->address->ai_family, SOCK_STREAM, 0);
+    if (connect_attempt->socket < SOCKET_SUCCESS)
+    {
+        LogError("Failure: socket create failure %d.", errno);
+        connect_attempt->socket = INVALID_SOCKET;
+        result = __FAILURE__;
+    }
+    else if ((-1 == (flags = fcntl(connect_attempt->socket, F_GETFL, 0))) ||
+        (fcntl(connect_attempt->socket, F_SETFL, flags | O_NONBLOCK) == -1))
+    {
+        LogError("Failure: fcntl failure.");
+        close(connect_attempt->socket);
+        connect_attempt->socket = INVALID_SOCKET;
+        result = __FAILURE__;
+    }
+    else if ((connect(connect_attempt->socket, connect_attempt->address->ai_addr, connect_attempt->address->ai_addrlen) != 0) &&
+        (errno != EINPROGRESS))
+    {
+        LogError("Failure: connect failure %d.", errno);
+        close(connect_attempt->socket);
+        connect_attempt->socket = INVALID_SOCKET;
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* even a connect that completed right away is picked up by the writability check in dowork */
+        result = 0;
+    }
+
+    return result;
+}
+
+static void dowork_resolve(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (dns_resolver_is_lookup_complete(socket_io_instance->dns_resolver))
+    {
+        struct addrinfo* addrInfo = dns_resolver_get_addrInfo(socket_io_instance->dns_resolver);
+        if (addrInfo == NULL)
+        {
+            LogError("Failure: unable to resolve %s.", socket_io_instance->hostname);
+            indicate_open_failed(socket_io_instance);
+        }
+        else if ((socket_io_instance->connect_tick_counter = tickcounter_create()) == NULL)
+        {
+            LogError("Failure: unable to create tick counter.");
+            indicate_open_failed(socket_io_instance);
+        }
+        else if ((tickcounter_get_current_ms(socket_io_instance->connect_tick_counter, &socket_io_instance->connect_start_time) != 0) ||
+            (create_connect_attempts(socket_io_instance, addrInfo) != 0))
+        {
+            indicate_open_failed(socket_io_instance);
+        }
+        else
+        {
+            /* the resolver stays alive until the race is over, the attempts point into its address list */
+            socket_io_instance->io_state = IO_STATE_CONNECTING;
+        }
+    }
+}
+
+/* Happy Eyeballs (RFC 8305): a new address joins the race every CONNECTION_ATTEMPT_DELAY_MS, or right away when
+   every attempt in flight failed, and the first connection to complete wins */
+static void dowork_connect(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    tickcounter_ms_t now;
+
+    if (tickcounter_get_current_ms(socket_io_instance->connect_tick_counter, &now) != 0)
+    {
+        LogError("Failure: unable to get the current time.");
+        indicate_open_failed(socket_io_instance);
+    }
+    else
+    {
+        size_t in_flight = 0;
+        size_t i;
+        int winner = INVALID_SOCKET;
+
+        for (i = 0; i < socket_io_instance->next_connect_attempt; i++)
+        {
+            CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[i];
+            if (connect_attempt->socket != INVALID_SOCKET)
+            {
+                struct pollfd connect_poll;
+                int poll_result;
+
+                connect_poll.fd = connect_attempt->socket;
+                connect_poll.events = POLLOUT;
+                connect_poll.revents = 0;
+
+                poll_result = poll(&connect_poll, 1, 0);
+                if (poll_result > 0)
+                {
+                    int so_error = 0;
+                    socklen_t len = sizeof(so_error);
+                    if (getsockopt(connect_attempt->socket, SOL_SOCKET, SO_ERROR, &so_error, &len) != 0)
+                    {
+                        so_error = errno;
+                    }
+
+                    if (so_error != 0)
+                    {
+                        LogError("Failure: connect failure %d.", so_error);
+                        close(connect_attempt->socket);
+                        connect_attempt->socket = INVALID_SOCKET;
+                    }
+                    else
+                    {
+                        winner = connect_attempt->socket;
+                        connect_attempt->socket = INVALID_SOCKET;
+                        break;
+                    }
+                }
+                else if ((poll_result < 0) && (errno != EINTR))
+                {
+                    LogError("Failure: poll failure %d.", errno);
+                    close(connect_attempt->socket);
+                    connect_attempt->socket = INVALID_SOCKET;
+                }
+                else
+                {
+                    in_flight++;
+                }
+            }
+        }
+
+        if (winner != INVALID_SOCKET)
+        {
+            /* the losers are closed along with the resolver */
+            release_connect_attempts(socket_io_instance);
+            socket_io_instance->socket = winner;
+            socket_io_instance->io_state = IO_STATE_OPEN;
+            register_with_reactor(socket_io_instance);
+            indicate_open_complete(socket_io_instance, IO_OPEN_OK);
+        }
+        else if ((now - socket_io_instance->connect_start_time) >= CONNECT_TIMEOUT_MS)
+        {
+            LogError("Failure: connect timed out.");
+            dns_resolver_invalidate(socket_io_instance->dns_resolver);
+            indicate_open_failed(socket_io_instance);
+        }
+        else
+        {
+            while ((socket_io_instance->next_connect_attempt < socket_io_instance->connect_attempt_count) &&
+                ((in_flight == 0) || ((now - socket_io_instance->last_connect_attempt_time) >= CONNECTION_ATTEMPT_DELAY_MS)))
+            {
+                CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[socket_io_instance->next_connect_attempt];
+                socket_io_instance->next_connect_attempt++;
+
+                if (start_connect_attempt(connect_attempt) == 0)
+                {
+                    socket_io_instance->last_connect_attempt_time = now;
+                    in_flight++;
+                    break;
+                }
+            }
+
+            if (in_flight == 0)
+            {
+                /* every resolved address failed, so the next open resolves the host again instead of reusing the cached lookup */
+                LogError("Failure: unable to connect to %s.", socket_io_instance->hostname);
+                dns_resolver_invalidate(socket_io_instance->dns_resolver);
+                indicate_open_failed(socket_io_instance);
+            }
+        }
     }
 }
 
@@ -134,6 +912,7 @@ static int add_pending_io(SOCKET_IO_INSTANCE* socket_io_instance, const unsigned
         else
         {
             pending_socket_io->size = size;
+            pending_socket_io->consumed = 0;
             pending_socket_io->on_send_complete = on_send_complete;
             pending_socket_io->callback_context = callback_context;
             pending_socket_io->pending_io_list = socket_io_instance->pending_io_list;
@@ -156,6 +935,136 @@ static int add_pending_io(SOCKET_IO_INSTANCE* socket_io_instance, const unsigned
     return result;
 }
 
+static void remove_sent_pending_io(SOCKET_IO_INSTANCE* socket_io_instance, LIST_ITEM_HANDLE pending_io_item, PENDING_SOCKET_IO* pending_socket_io)
+{
+    if (singlylinkedlist_remove(socket_io_instance->pending_io_list, pending_io_item) != 0)
+    {
+        socket_io_instance->io_state = IO_STATE_ERROR;
+        indicate_error(socket_io_instance);
+        LogError("Failure: unable to remove socket from list");
+    }
+
+    if (pending_socket_io->on_send_complete != NULL)
+    {
+        pending_socket_io->on_send_complete(pending_socket_io->callback_context, IO_SEND_OK);
+    }
+
+    free(pending_socket_io->bytes);
+    free(pending_socket_io);
+}
+
+/* drains the pending queue with one sendmsg per SEND_MAX_IOVEC pending IOs until the socket stops taking data */
+static void send_pending_ios(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    LIST_ITEM_HANDLE pending_io_item = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
+
+    while ((pending_io_item != NULL) && (socket_io_instance->io_state == IO_STATE_OPEN))
+    {
+        struct iovec iov[SEND_MAX_IOVEC];
+        struct msghdr message;
+        size_t iov_count = 0;
+        size_t batch_size = 0;
+        LIST_ITEM_HANDLE batch_item = pending_io_item;
+        ssize_t send_result;
+
+        while ((batch_item != NULL) && (iov_count < SEND_MAX_IOVEC))
+        {
+            PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)singlylinkedlist_item_get_value(batch_item);
+            if (pending_socket_io == NULL)
+            {
+                break;
+            }
+
+            iov[iov_count].iov_base = pending_socket_io->bytes + pending_socket_io->consumed;
+            iov[iov_count].iov_len = pending_socket_io->size - pending_socket_io->consumed;
+            batch_size += iov[iov_count].iov_len;
+            iov_count++;
+
+            batch_item = singlylinkedlist_get_next_item(batch_item);
+        }
+
+        if (iov_count == 0)
+        {
+            socket_io_instance->io_state = IO_STATE_ERROR;
+            indicate_error(socket_io_instance);
+            LogError("Failure: retrieving socket from list");
+            break;
+        }
+
+        (void)memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+
+        send_result = sendmsg(socket_io_instance->socket, &message, SEND_FLAGS);
+        if (send_result < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
+            {
+                /*do nothing until next dowork */
+            }
+            else
+            {
+                LogError("Failure: sending Socket information. errno=%d (%s).", errno, strerror(errno));
+                socket_io_instance->io_state = IO_STATE_ERROR;
+                indicate_error(socket_io_instance);
+            }
+            break;
+        }
+        else
+        {
+            size_t sent = (size_t)send_result;
+
+            /* complete the pending IOs that went out entirely; a partially sent one only moves its consumed offset */
+            while ((sent > 0) && (pending_io_item != NULL))
+            {
+                PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)singlylinkedlist_item_get_value(pending_io_item);
+                size_t remaining = pending_socket_io->size - pending_socket_io->consumed;
+
+                if (sent < remaining)
+                {
+                    pending_socket_io->consumed += sent;
+                    sent = 0;
+                }
+                else
+                {
+                    sent -= remaining;
+                    remove_sent_pending_io(socket_io_instance, pending_io_item, pending_socket_io);
+                    pending_io_item = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
+                }
+            }
+
+            if ((size_t)send_result < batch_size)
+            {
+                /* the socket buffer is full, simply wait until next dowork */
+                break;
+            }
+        }
+
+        pending_io_item = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
+    }
+}
+
+static int ensure_receive_buffer(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    int result;
+
+    /* the size only changes here so a buffer handed to on_bytes_received is never freed under the callback */
+    unsigned char* new_buffer = (unsigned char*)malloc(socket_io_instance->receive_buffer_size);
+    if (new_buffer == NULL)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        free(socket_io_instance->receive_buffer);
+        socket_io_instance->receive_buffer = new_buffer;
+        socket_io_instance->receive_buffer_allocated = socket_io_instance->receive_buffer_size;
+        result = 0;
+    }
+
+    return result;
+}
+
 static void signal_callback(int signum)
 {
     LogError("Socket received signal %d.", signum);
@@ -215,7 +1124,24 @@ CONCRETE_IO_HANDLE socketio_create(void* io_create_parameters)
                     result->on_io_error = NULL;
                     result->on_bytes_received_context = NULL;
                     result->on_io_error_context = NULL;
+                    result->on_io_open_complete = NULL;
+                    result->on_io_open_complete_context = NULL;
+                    result->dns_resolver = NULL;
+                    result->connect_attempts = NULL;
+                    result->connect_attempt_count = 0;
+                    result->next_connect_attempt = 0;
+                    result->connect_tick_counter = NULL;
+                    result->connect_start_time = 0;
+                    result->last_connect_attempt_time = 0;
                     result->io_state = IO_STATE_CLOSED;
+                    result->use_reactor = 0;
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+                    result->reactor_entry = NULL;
+#endif
+                    result->receive_buffer = NULL;
+                    result->receive_buffer_allocated = 0;
+                    result->receive_buffer_size = RECEIVE_BYTES_VALUE;
+                    result->socket_lent = false;
                 }
             }
         }
@@ -233,6 +1159,9 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
     if (socket_io != NULL)
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+        unregister_from_reactor(socket_io_instance);
+        release_connect_attempts(socket_io_instance);
+
         /* we cannot do much if the close fails, so just ignore the result */
         if (socket_io_instance->socket != INVALID_SOCKET)
         {
@@ -255,6 +1184,7 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
         }
 
         singlylinkedlist_destroy(socket_io_instance->pending_io_list);
+        free(socket_io_instance->receive_buffer);
         free(socket_io_instance->hostname);
         free(socket_io);
     }
@@ -263,8 +1193,6 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
 int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context)
 {
     int result;
-	int retval = -1;
-	int select_errno = 0;
 
     SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
     if (socket_io == NULL)
@@ -272,145 +1200,46 @@ int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_c
         LogError("Invalid argument: SOCKET_IO_INSTANCE is NULL");
         result = __FAILURE__;
     }
+    else if (socket_io_instance->io_state != IO_STATE_CLOSED)
+    {
+        LogError("Failure: socket state is not closed.");
+        result = __FAILURE__;
+    }
     else
     {
-        if (socket_io_instance->io_state != IO_STATE_CLOSED)
-        {
-            LogError("Failure: socket state is not closed.");
-            result = __FAILURE__;
-        }
-        else if (socket_io_instance->socket != INVALID_SOCKET)
+        socket_io_instance->on_bytes_received = on_bytes_received;
+        socket_io_instance->on_bytes_received_context = on_bytes_received_context;
+
+        socket_io_instance->on_io_error = on_io_error;
+        socket_io_instance->on_io_error_context = on_io_error_context;
+
+        socket_io_instance->on_io_open_complete = on_io_open_complete;
+        socket_io_instance->on_io_open_complete_context = on_io_open_complete_context;
+
+        if (socket_io_instance->socket != INVALID_SOCKET)
         {
             // Opening an accepted socket
-            socket_io_instance->on_bytes_received_context = on_bytes_received_context;
-            socket_io_instance->on_bytes_received = on_bytes_received;
-            socket_io_instance->on_io_error = on_io_error;
-            socket_io_instance->on_io_error_context = on_io_error_context;
-
             socket_io_instance->io_state = IO_STATE_OPEN;
+            register_with_reactor(socket_io_instance);
 
             result = 0;
         }
+        else if ((socket_io_instance->dns_resolver = dns_resolver_create(socket_io_instance->hostname, socket_io_instance->port)) == NULL)
+        {
+            LogError("Failure: unable to start resolving %s.", socket_io_instance->hostname);
+            result = __FAILURE__;
+        }
         else
         {
-            struct addrinfo* addrInfo;
-            char portString[16];
-
-            socket_io_instance->socket = socket(AF_INET, SOCK_STREAM, 0);
-            if (socket_io_instance->socket < SOCKET_SUCCESS)
-            {
-                LogError("Failure: socket create failure %d.", socket_io_instance->socket);
-                result = __FAILURE__;
-            }
-            else
-            {
-                struct addrinfo addrHint = { 0 };
-                addrHint.ai_family = AF_INET;
-                addrHint.ai_socktype = SOCK_STREAM;
-                addrHint.ai_protocol = 0;
+            /* the lookup and the connect are finished from socketio_dowork, which reports the open result */
+            socket_io_instance->io_state = IO_STATE_OPENING;
 
-                sprintf(portString, "%u", socket_io_instance->port);
-                int err = getaddrinfo(socket_io_instance->hostname, portString, &addrHint, &addrInfo);
-                if (err != 0)
-                {
-                    LogError("Failure: getaddrinfo failure %d.", err);
-                    close(socket_io_instance->socket);
-                    socket_io_instance->socket = INVALID_SOCKET;
-                    result = __FAILURE__;
-                }
-                else
-                {
-                    int flags;
-                    if ((-1 == (flags = fcntl(socket_io_instance->socket, F_GETFL, 0))) ||
-                        (fcntl(socket_io_instance->socket, F_SETFL, flags | O_NONBLOCK) == -1))
-                    {
-                        LogError("Failure: fcntl failure.");
-                        close(socket_io_instance->socket);
-                        socket_io_instance->socket = INVALID_SOCKET;
-                        result = __FAILURE__;
-                    }
-                    else
-                    {
-                        err = connect(socket_io_instance->socket, addrInfo->ai_addr, sizeof(*addrInfo->ai_addr));
-                        if ((err != 0) && (errno != EINPROGRESS))
-                        {
-                            LogError("Failure: connect failure %d.", errno);
-                            close(socket_io_instance->socket);
-                            socket_io_instance->socket = INVALID_SOCKET;
-                            result = __FAILURE__;
-                        }
-                        else
-                        {
-                            if (err != 0)
-                            {
-                                fd_set fdset;
-                                struct timeval tv;
-
-                                FD_ZERO(&fdset);
-                                FD_SET(socket_io_instance->socket, &fdset);
-                                tv.tv_sec = CONNECT_TIMEOUT;
-                                tv.tv_usec = 0;
-
-								do
-								{
-									retval = select(socket_io_instance->socket + 1, NULL, &fdset, NULL, &tv);
-
-									if (retval < 0)
-									{
-										select_errno = errno;
-									}
-								} while (retval < 0 && select_errno == EINTR);
-								
-                                if (retval != 1)
-                                {
-                                    LogError("Failure: select failure.");
-                                    close(socket_io_instance->socket);
-                                    socket_io_instance->socket = INVALID_SOCKET;
-                                    result = __FAILURE__;
-                                }
-                                else
-                                {
-                                    int so_error = 0;
-                                    socklen_t len = sizeof(so_error);
-                                    err = getsockopt(socket_io_instance->socket, SOL_SOCKET, SO_ERROR, &so_error, &len);
-                                    if (err != 0)
-                                    {
-                                        LogError("Failure: getsockopt failure %d.", errno);
-                                        close(socket_io_instance->socket);
-                                        socket_io_instance->socket = INVALID_SOCKET;
-                                        result = __FAILURE__;
-                                    }
-                                    else if (so_error != 0)
-                                    {
-                                        err = so_error;
-                                        LogError("Failure: connect failure %d.", so_error);
-                                        close(socket_io_instance->socket);
-                                        socket_io_instance->socket = INVALID_SOCKET;
-                                        result = __FAILURE__;
-                                    }
-                                }
-                            }
-                            if (err == 0)
-                            {
-                                socket_io_instance->on_bytes_received = on_bytes_received;
-                                socket_io_instance->on_bytes_received_context = on_bytes_received_context;
-
-                                socket_io_instance->on_io_error = on_io_error;
-                                socket_io_instance->on_io_error_context = on_io_error_context;
-
-                                socket_io_instance->io_state = IO_STATE_OPEN;
-
-                                result = 0;
-                            }
-                        }
-                    }
-                    freeaddrinfo(addrInfo);
-                }
-            }
+            result = 0;
         }
     }
 
-    if (on_io_open_complete != NULL)
+    if ((on_io_open_complete != NULL) &&
+        ((result != 0) || (socket_io_instance->io_state == IO_STATE_OPEN)))
     {
         on_io_open_complete(on_io_open_complete_context, result == 0 ? IO_OPEN_OK : IO_OPEN_ERROR);
     }
@@ -432,10 +1261,29 @@ int socketio_close(CONCRETE_IO_HANDLE socket_io, ON_IO_CLOSE_COMPLETE on_io_clos
         if ((socket_io_instance->io_state != IO_STATE_CLOSED) && (socket_io_instance->io_state != IO_STATE_CLOSING))
         {
             // Only close if the socket isn't already in the closed or closing state
-            (void)shutdown(socket_io_instance->socket, SHUT_RDWR);
-            close(socket_io_instance->socket);
-            socket_io_instance->socket = INVALID_SOCKET;
+            IO_STATE previous_state = socket_io_instance->io_state;
+
+            /* the socket leaves the epoll set before it is closed, so its descriptor cannot be reported once reused */
+            unregister_from_reactor(socket_io_instance);
+
+            /* closing while the lookup or the connect is running simply abandons it */
+            release_connect_attempts(socket_io_instance);
+
+            if (socket_io_instance->socket != INVALID_SOCKET)
+            {
+                (void)shutdown(socket_io_instance->socket, SHUT_RDWR);
+                close(socket_io_instance->socket);
+                socket_io_instance->socket = INVALID_SOCKET;
+            }
+
+            socket_io_instance->socket_lent = false;
             socket_io_instance->io_state = IO_STATE_CLOSED;
+
+            if ((previous_state == IO_STATE_OPENING) || (previous_state == IO_STATE_CONNECTING))
+            {
+                /* the open started by socketio_open never reported its result */
+                indicate_open_complete(socket_io_instance, IO_OPEN_CANCELLED);
+            }
         }
 
         if (on_io_close_complete != NULL)
@@ -469,6 +1317,11 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
             LogError("Failure: socket state is not opened.");
             result = __FAILURE__;
         }
+        else if (socket_io_instance->socket_lent)
+        {
+            LogError("Failure: the socket is lent out.");
+            result = __FAILURE__;
+        }
         else
         {
             LIST_ITEM_HANDLE first_pending_io = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
@@ -488,15 +1341,23 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
             {
                 signal(SIGPIPE, signal_callback);
 
-                int send_result = send(socket_io_instance->socket, buffer, size, 0);
+                int send_result = send(socket_io_instance->socket, buffer, size, SEND_FLAGS);
                 if (send_result != size)
                 {
                     if (send_result == INVALID_SOCKET)
                     {
-                        if (errno == EAGAIN) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
+                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
                         {
-                            /*do nothing*/
-                            result = 0;
+                            /* queue all of it, dowork sends it once the socket drains */
+                            if (add_pending_io(socket_io_instance, buffer, size, on_send_complete, callback_context) != 0)
+                            {
+                                LogError("Failure: add_pending_io failed.");
+                                result = __FAILURE__;
+                            }
+                            else
+                            {
+                                result = 0;
+                            }
                         }
                         else
                         {
@@ -540,91 +1401,71 @@ void socketio_dowork(CONCRETE_IO_HANDLE socket_io)
     if (socket_io != NULL)
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
-        if (socket_io_instance->io_state == IO_STATE_OPEN)
+
+        if (socket_io_instance->io_state == IO_STATE_OPENING)
         {
-            int received = 1;
+            dowork_resolve(socket_io_instance);
+        }
+
+        if (socket_io_instance->io_state == IO_STATE_CONNECTING)
+        {
+            dowork_connect(socket_io_instance);
+        }
 
+        if ((socket_io_instance->io_state == IO_STATE_OPEN) &&
+            !socket_io_instance->socket_lent)
+        {
+            int received = 1;
             LIST_ITEM_HANDLE first_pending_io = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
-            while (first_pending_io != NULL)
+
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+            SOCKET_REACTOR_ENTRY* reactor_entry = socket_io_instance->reactor_entry;
+            if (reactor_entry != NULL)
             {
-                PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)singlylinkedlist_item_get_value(first_pending_io);
-                if (pending_socket_io == NULL)
+                /* readiness flags are cleared before the syscalls, the reactor sets them again on the next edge */
+                if ((first_pending_io != NULL) &&
+                    (socket_reactor_take_readiness(reactor_entry, &reactor_entry->writable) == 0))
                 {
-                    socket_io_instance->io_state = IO_STATE_ERROR;
-                    indicate_error(socket_io_instance);
-                    LogError("Failure: retrieving socket from list");
-                    break;
+                    first_pending_io = NULL;
                 }
 
-                int send_result = send(socket_io_instance->socket, pending_socket_io->bytes, pending_socket_io->size, 0);
-                if (send_result != pending_socket_io->size)
-                {
-                    if (send_result == INVALID_SOCKET)
-                    {
-                        if (errno == EAGAIN) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
-                        {
-                            /*do nothing until next dowork */
-                            break;
-                        }
-                        else
-                        {
-                            free(pending_socket_io->bytes);
-                            free(pending_socket_io);
-                            (void)singlylinkedlist_remove(socket_io_instance->pending_io_list, first_pending_io);
-
-                            LogError("Failure: sending Socket information. errno=%d (%s).", errno, strerror(errno));
-                            socket_io_instance->io_state = IO_STATE_ERROR;
-                            indicate_error(socket_io_instance);
-                        }
-                    }
-                    else
-                    {
-                        /* simply wait until next dowork */
-                        (void)memmove(pending_socket_io->bytes, pending_socket_io->bytes + send_result, pending_socket_io->size - send_result);
-                        pending_socket_io->size -= send_result;
-                        break;
-                    }
-                }
-                else
-                {
-                    if (pending_socket_io->on_send_complete != NULL)
-                    {
-                        pending_socket_io->on_send_complete(pending_socket_io->callback_context, IO_SEND_OK);
-                    }
+                received = socket_reactor_take_readiness(reactor_entry, &reactor_entry->readable);
+            }
+#endif
 
-                    free(pending_socket_io->bytes);
-                    free(pending_socket_io);
-                    if (singlylinkedlist_remove(socket_io_instance->pending_io_list, first_pending_io) != 0)
-                    {
-                        socket_io_instance->io_state = IO_STATE_ERROR;
-                        indicate_error(socket_io_instance);
-                        LogError("Failure: unable to remove socket from list");
-                    }
-                }
+            if (first_pending_io != NULL)
+            {
+                send_pending_ios(socket_io_instance);
+            }
 
-                first_pending_io = singlylinkedlist_get_head_item(socket_io_instance->pending_io_list);
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+            if ((reactor_entry != NULL) &&
+                (socket_io_instance->io_state == IO_STATE_OPEN) &&
+                (singlylinkedlist_get_head_item(socket_io_instance->pending_io_list) == NULL))
+            {
+                /* everything went out without EAGAIN, so no edge is coming; the socket is still writable */
+                socket_reactor_set_writable(reactor_entry);
             }
+#endif
 
             while (received > 0)
             {
-                unsigned char* recv_bytes = malloc(RECEIVE_BYTES_VALUE);
-                if (recv_bytes == NULL)
+                if ((socket_io_instance->receive_buffer_allocated != socket_io_instance->receive_buffer_size) &&
+                    (ensure_receive_buffer(socket_io_instance) != 0))
                 {
                     LogError("Socketio_Failure: NULL allocating input buffer.");
                     indicate_error(socket_io_instance);
+                    break;
                 }
-                else
+
+                received = recv(socket_io_instance->socket, socket_io_instance->receive_buffer, socket_io_instance->receive_buffer_allocated, 0);
+                if (received > 0)
                 {
-                    received = recv(socket_io_instance->socket, recv_bytes, RECEIVE_BYTES_VALUE, 0);
-                    if (received > 0)
+                    if (socket_io_instance->on_bytes_received != NULL)
                     {
-                        if (socket_io_instance->on_bytes_received != NULL)
-                        {
-                            /* explictly ignoring here the result of the callback */
-                            (void)socket_io_instance->on_bytes_received(socket_io_instance->on_bytes_received_context, recv_bytes, received);
-                        }
+                        /* explictly ignoring here the result of the callback */
+                        (void)socket_io_instance->on_bytes_received(socket_io_instance->on_bytes_received_context, socket_io_instance->receive_buffer, received);
                     }
-                    free(recv_bytes);
                 }
             }
         }
@@ -669,10 +1510,115 @@ int socketio_setoption(CONCRETE_IO_HANDLE socket_io, const char* optionName, con
             result = setsockopt(socket_io_instance->socket, SOL_TCP, TCP_KEEPINTVL, value, sizeof(int));
             if (result == -1) result = errno;
         }
+        else if (strcmp(optionName, OPTION_SOCKETIO_USE_REACTOR) == 0)
+        {
+#ifdef SOCKETIO_USE_EPOLL_REACTOR
+            socket_io_instance->use_reactor = *(const int*)value;
+            if (socket_io_instance->io_state == IO_STATE_OPEN)
+            {
+                if (socket_io_instance->use_reactor != 0)
+                {
+                    register_with_reactor(socket_io_instance);
+                }
+                else
+                {
+                    unregister_from_reactor(socket_io_instance);
+                }
+            }
+
+            result = 0;
+#else
+            LogError("Failure: %s is not supported on this platform.", optionName);
+            result = __FAILURE__;
+#endif
+        }
+        else if (strcmp(optionName, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE) == 0)
+        {
+            size_t receive_buffer_size = *(const size_t*)value;
+            if (receive_buffer_size == 0)
+            {
+                LogError("Failure: %s cannot be 0.", optionName);
+                result = __FAILURE__;
+            }
+            else
+            {
+                /* applied by the next dowork */
+                socket_io_instance->receive_buffer_size = receive_buffer_size;
+                result = 0;
+            }
+        }
+        else
+        {
+            result = __FAILURE__;
+        }
+    }
+
+    return result;
+}
+
+int socketio_lend_socket(CONCRETE_IO_HANDLE socket_io, int* lent_socket)
+{
+    int result;
+
+    if ((socket_io == NULL) || (lent_socket == NULL))
+    {
+        /* Codes_SRS_SOCKETIO_BERKELEY_01_001: [ If `socket_io` or `lent_socket` is NULL, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+        LogError("Invalid argument: socket_io=%p, lent_socket=%p", socket_io, lent_socket);
+        result = __FAILURE__;
+    }
+    else
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+
+        /* queued bytes would end up behind whatever the borrower writes, so only an idle socket is lent */
+        if ((socket_io_instance->io_state != IO_STATE_OPEN) ||
+            socket_io_instance->socket_lent ||
+            (singlylinkedlist_get_head_item(socket_io_instance->pending_io_list) != NULL))
+        {
+            /* Codes_SRS_SOCKETIO_BERKELEY_01_002: [ If the instance is not open, its socket is already lent or sends are still queued, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+            LogError("Failure: the socket can only be lent while open and idle.");
+            result = __FAILURE__;
+        }
         else
         {
+            /* Codes_SRS_SOCKETIO_BERKELEY_01_003: [ Otherwise `socketio_lend_socket` shall remove the socket from the reactor, stop reading and writing it from `socketio_dowork` and `socketio_send`, store it in `lent_socket` and return 0. ]*/
+            unregister_from_reactor(socket_io_instance);
+            socket_io_instance->socket_lent = true;
+            *lent_socket = socket_io_instance->socket;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int socketio_reclaim_socket(CONCRETE_IO_HANDLE socket_io)
+{
+    int result;
+
+    if (socket_io == NULL)
+    {
+        /* Codes_SRS_SOCKETIO_BERKELEY_01_004: [ If `socket_io` is NULL, `socketio_reclaim_socket` shall fail and return a non-zero value. ]*/
+        LogError("Invalid argument: socket_io is NULL");
+        result = __FAILURE__;
+    }
+    else
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+
+        if (!socket_io_instance->socket_lent)
+        {
+            /* Codes_SRS_SOCKETIO_BERKELEY_01_005: [ If the socket is not lent, `socketio_reclaim_socket` shall fail and return a non-zero value. ]*/
+            LogError("Failure: the socket is not lent.");
             result = __FAILURE__;
         }
+        else
+        {
+            /* Codes_SRS_SOCKETIO_BERKELEY_01_006: [ Otherwise `socketio_reclaim_socket` shall let `socketio_dowork` and `socketio_send` use the socket again, register it with the reactor again when the reactor is used, and return 0. ]*/
+            socket_io_instance->socket_lent = false;
+            register_with_reactor(socket_io_instance);
+            result = 0;
+        }
     }
 
     return result;
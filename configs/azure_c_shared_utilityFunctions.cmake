@@ -511,6 +511,8 @@ function(set_platform_files c_shared_dir)
         endif()
         set(LOCK_C_FILE ${c_shared_dir}/adapters/lock_pthreads.c PARENT_SCOPE)
         set(PLATFORM_C_FILE ${c_shared_dir}/adapters/platform_linux.c PARENT_SCOPE)
+        # platform_linux.c prewarms and clears the DNS cache, so the resolver is built even without socketio
+        set(DNS_RESOLVER_C_FILE ${c_shared_dir}/adapters/dns_resolver_berkeley.c PARENT_SCOPE)
         if (${use_socketio})
             set(SOCKETIO_C_FILE ${c_shared_dir}/adapters/socketio_berkeley.c PARENT_SCOPE)
         endif()
@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file dns_resolver.h
+ *	@brief	 Resolves host names without blocking the caller.
+ *
+ *	@details The lookup is handed to a resolver worker thread when the resolver
+ *			 is created; the caller polls ::dns_resolver_is_lookup_complete
+ *			 from its dowork and picks up the result once it is available.
+ *			 Results are kept in a process wide cache, so reconnecting to the
+ *			 same host and port does not go back to the resolver until the
+ *			 cached result expires. Failed lookups are cached too, for a
+ *			 shorter time. Only socketio_berkeley resolves through this
+ *			 module, so only the connections it opens use the cache.
+ */
+
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#ifdef __cplusplus
+#include <cstdbool>
+extern "C" {
+#else
+#include <stdbool.h>
+#endif /* __cplusplus */
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+struct addrinfo;
+
+typedef struct DNS_RESOLVER_INSTANCE_TAG* DNS_RESOLVER_HANDLE;
+
+/**
+ * @brief	Queues the lookup of @p hostname and returns right away.
+ *
+ * @param	hostname	The host name to resolve. It is copied.
+ * @param	port		The port placed in the resolved addresses.
+ *
+ * @return	A valid @c DNS_RESOLVER_HANDLE or @c NULL if the lookup could not be queued.
+ */
+MOCKABLE_FUNCTION(, DNS_RESOLVER_HANDLE, dns_resolver_create, const char*, hostname, int, port);
+
+/**
+ * @brief	Tells whether the lookup has finished, successfully or not.
+ */
+MOCKABLE_FUNCTION(, bool, dns_resolver_is_lookup_complete, DNS_RESOLVER_HANDLE, dns);
+
+/**
+ * @brief	Returns the resolved addresses, or @c NULL while the lookup is still
+ * 			running or when it failed. The list is owned by the resolver.
+ */
+MOCKABLE_FUNCTION(, struct addrinfo*, dns_resolver_get_addrInfo, DNS_RESOLVER_HANDLE, dns);
+
+/**
+ * @brief	Releases the resolver. A lookup still in progress is abandoned
+ * 			without blocking the caller.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_destroy, DNS_RESOLVER_HANDLE, dns);
+
+/**
+ * @brief	Drops the completed lookup of the resolver from the cache, so the
+ * 			next ::dns_resolver_create for the host resolves it again. Used
+ * 			when none of the resolved addresses could be connected to.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_invalidate, DNS_RESOLVER_HANDLE, dns);
+
+/**
+ * @brief	Adds a host whose lookup ::dns_resolver_prewarm starts, so the cache
+ * 			is warm before the first connection. Call it before @c platform_init.
+ *
+ * @return	@c 0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, dns_resolver_add_prewarm_host, const char*, hostname, int, port);
+
+/**
+ * @brief	Queues a lookup into the cache for every host added with
+ * 			::dns_resolver_add_prewarm_host. Called by @c platform_init.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_prewarm);
+
+/**
+ * @brief	Drops every cached lookup and forgets the prewarm hosts. Results still
+ * 			held by a resolver are freed when it is destroyed. Called by
+ * 			@c platform_deinit.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_clear_cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DNS_RESOLVER_H */
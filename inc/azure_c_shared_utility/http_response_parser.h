@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#define HTTP_RESPONSE_PARSER_RESULT_VALUES \
+    HTTP_RESPONSE_PARSER_INCOMPLETE, \
+    HTTP_RESPONSE_PARSER_COMPLETE, \
+    HTTP_RESPONSE_PARSER_ERROR
+
+DEFINE_ENUM(HTTP_RESPONSE_PARSER_RESULT, HTTP_RESPONSE_PARSER_RESULT_VALUES);
+
+/* State of an HTTP/1.1 status line and headers being parsed as they are received.
+   It is meant to be embedded in the instance of the module receiving the response, so that no memory has to be allocated. */
+typedef struct HTTP_RESPONSE_PARSER_TAG
+{
+    int state;
+    size_t match_index;
+    /* Status code of the response, valid once the status line has been parsed */
+    int status_code;
+    /* Number of bytes of the status line and headers, including the empty line that ends them */
+    size_t response_length;
+} HTTP_RESPONSE_PARSER;
+
+MOCKABLE_FUNCTION(, void, http_response_parser_init, HTTP_RESPONSE_PARSER*, parser);
+MOCKABLE_FUNCTION(, HTTP_RESPONSE_PARSER_RESULT, http_response_parser_parse, HTTP_RESPONSE_PARSER*, parser, const unsigned char*, buffer, size_t, size, size_t*, consumed);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HTTP_RESPONSE_PARSER_H */
@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file httpapi_async.h
+ *	@brief	 Asynchronous variant of ::HTTPAPI_ExecuteRequest.
+ *
+ *	@details Requests are submitted with ::HTTPAPI_ExecuteRequestAsync and
+ *			 driven by calling ::HTTPAPI_DoWork, so that one thread can keep
+ *			 many requests in flight. One request can be pending per
+ *			 HTTP_HANDLE; concurrent requests use one HTTP_HANDLE each.
+ *			 This API is implemented by the curl HTTPAPI adapter, where all
+ *			 the requests are driven by a single curl multi handle. When the
+ *			 @c CURLOPT_HTTP_VERSION option is set to HTTP/2, the requests of
+ *			 all the HTTP_HANDLEs to one host share one connection.
+ */
+
+#ifndef HTTPAPI_ASYNC_H
+#define HTTPAPI_ASYNC_H
+
+#include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+/**
+ * @brief	Called when a request submitted with ::HTTPAPI_ExecuteRequestAsync
+ *			has completed.
+ *
+ * @param	context		The @c onRequestCompleteContext passed to
+ *						::HTTPAPI_ExecuteRequestAsync.
+ * @param	result		@c HTTPAPI_OK if the response was received, the
+ *						same error codes as ::HTTPAPI_ExecuteRequest otherwise.
+ *						@c HTTPAPI_ERROR if the connection was closed before
+ *						the request completed.
+ * @param	statusCode	The status code of the HTTP response.
+ */
+typedef void(*ON_HTTPAPI_REQUEST_COMPLETE)(void* context, HTTPAPI_RESULT result, unsigned int statusCode);
+
+/**
+ * @brief	Starts sending an HTTP request and returns without waiting for
+ *			the response.
+ *
+ *			The arguments have the same meaning as for ::HTTPAPI_ExecuteRequest.
+ *			The request headers are copied before returning, but @p content,
+ *			@p responseHeadersHandle and @p responseContent must stay valid
+ *			until @p onRequestComplete is called. The response headers and
+ *			content are filled in before @p onRequestComplete is called.
+ *
+ * @return	@c HTTPAPI_OK if the request has been submitted, in which case
+ *			@p onRequestComplete is called exactly once from
+ *			::HTTPAPI_DoWork or ::HTTPAPI_CloseConnection; an error code
+ *			otherwise, in which case it is not called.
+ */
+MOCKABLE_FUNCTION(, HTTPAPI_RESULT, HTTPAPI_ExecuteRequestAsync, HTTP_HANDLE, handle, HTTPAPI_REQUEST_TYPE, requestType, const char*, relativePath,
+                                             HTTP_HEADERS_HANDLE, httpHeadersHandle, const unsigned char*, content,
+                                             size_t, contentLength, HTTP_HEADERS_HANDLE, responseHeadersHandle, BUFFER_HANDLE, responseContent,
+                                             ON_HTTPAPI_REQUEST_COMPLETE, onRequestComplete, void*, onRequestCompleteContext);
+
+/**
+ * @brief	Moves all the pending asynchronous requests forward without
+ *			blocking and calls the completion callback of the ones that
+ *			have completed.
+ *
+ *			It must be called from one thread at a time, and not concurrently
+ *			with the other HTTPAPI functions.
+ */
+MOCKABLE_FUNCTION(, void, HTTPAPI_DoWork);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPAPI_ASYNC_H */
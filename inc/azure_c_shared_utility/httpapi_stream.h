@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file httpapi_stream.h
+ *	@brief	 Variant of ::HTTPAPI_ExecuteRequest that streams the request and
+ *			 response content through callbacks.
+ *
+ *	@details ::HTTPAPI_ExecuteRequestStream reads the request content from a
+ *			 callback and passes the response content to another callback as
+ *			 it is received, so that large contents are transferred with a
+ *			 fixed amount of memory instead of being held in one buffer.
+ *			 This API is implemented by the curl and the compact HTTPAPI
+ *			 adapters.
+ */
+
+#ifndef HTTPAPI_STREAM_H
+#define HTTPAPI_STREAM_H
+
+#include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+/**
+ * @brief	Called to get the next bytes of the request content.
+ *
+ * @param	context		The @c onRequestContentReadContext passed to
+ *						::HTTPAPI_ExecuteRequestStream.
+ * @param	buffer		Where the bytes are copied.
+ * @param	size		The size of @p buffer, never more than the bytes
+ *						of the content that have not been read yet.
+ * @param	bytesRead	Set to the number of bytes copied to @p buffer,
+ *						between 1 and @p size.
+ *
+ * @return	0 if bytes have been copied, any other value to abort the request.
+ */
+typedef int(*ON_HTTPAPI_REQUEST_CONTENT_READ)(void* context, unsigned char* buffer, size_t size, size_t* bytesRead);
+
+/**
+ * @brief	Called with the next bytes of the response content.
+ *
+ * @param	context		The @c onResponseContentWriteContext passed to
+ *						::HTTPAPI_ExecuteRequestStream.
+ * @param	buffer		The bytes, only valid until the callback returns.
+ * @param	size		The number of bytes in @p buffer.
+ *
+ * @return	0 if the bytes have been consumed, any other value to abort the
+ *			request.
+ */
+typedef int(*ON_HTTPAPI_RESPONSE_CONTENT_WRITE)(void* context, const unsigned char* buffer, size_t size);
+
+/**
+ * @brief	Sends an HTTP request whose content is read from
+ *			@p onRequestContentRead and passes the content of the response to
+ *			@p onResponseContentWrite.
+ *
+ *			The other arguments have the same meaning as for
+ *			::HTTPAPI_ExecuteRequest. @p contentLength is the total number
+ *			of bytes read from @p onRequestContentRead, which can be @c NULL
+ *			when it is 0. The response content is ignored when
+ *			@p onResponseContentWrite is @c NULL. Both callbacks are called
+ *			before ::HTTPAPI_ExecuteRequestStream returns.
+ *
+ * @return	@c HTTPAPI_OK if the response was received, the same error codes
+ *			as ::HTTPAPI_ExecuteRequest otherwise. @c HTTPAPI_SEND_REQUEST_FAILED
+ *			if @p onRequestContentRead failed and @c HTTPAPI_READ_DATA_FAILED
+ *			if @p onResponseContentWrite failed.
+ */
+MOCKABLE_FUNCTION(, HTTPAPI_RESULT, HTTPAPI_ExecuteRequestStream, HTTP_HANDLE, handle, HTTPAPI_REQUEST_TYPE, requestType, const char*, relativePath,
+                                             HTTP_HEADERS_HANDLE, httpHeadersHandle, size_t, contentLength,
+                                             ON_HTTPAPI_REQUEST_CONTENT_READ, onRequestContentRead, void*, onRequestContentReadContext,
+                                             unsigned int*, statusCode, HTTP_HEADERS_HANDLE, responseHeadersHandle,
+                                             ON_HTTPAPI_RESPONSE_CONTENT_WRITE, onResponseContentWrite, void*, onResponseContentWriteContext);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPAPI_STREAM_H */
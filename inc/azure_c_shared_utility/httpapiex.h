@@ -11,6 +11,8 @@
 *					- Implementation independent
 *					- Retry mechanism
 *					- Persistent options
+*					- Pooled connections, concurrent requests on one handle
+*					  run in parallel
 */
 
 #ifndef HTTPAPIEX_H
@@ -76,6 +78,9 @@ MOCKABLE_FUNCTION(, HTTPAPIEX_HANDLE, HTTPAPIEX_Create, const char*, hostName);
  * 			writes in the out @p parameter statusCode the HTTP status, populates the @p
  * 			responseHeadersHandle with the response headers and copies the response body
  * 			to @p responseContent.
+ * 			The request uses an idle connection of the handle if there is one and
+ * 			gives it back afterwards, so concurrent calls on the same handle run in
+ * 			parallel on different connections.
  *
  * @return	An @c HTTAPIEX_HANDLE suitable for further calls to the module.
  */
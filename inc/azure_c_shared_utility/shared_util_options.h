@@ -31,6 +31,29 @@ extern "C"
     static const char* OPTION_CURL_FRESH_CONNECT = "CURLOPT_FRESH_CONNECT";
     static const char* OPTION_CURL_FORBID_REUSE = "CURLOPT_FORBID_REUSE";
     static const char* OPTION_CURL_VERBOSE = "CURLOPT_VERBOSE";
+    static const char* OPTION_CURL_HTTP_VERSION = "CURLOPT_HTTP_VERSION";
+
+    static const char* OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS = "httpapiex_max_idle_connections";
+    static const char* OPTION_HTTPAPIEX_MIN_IDLE_CONNECTIONS = "httpapiex_min_idle_connections";
+    static const char* OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS = "httpapiex_idle_timeout_ms";
+
+    static const char* OPTION_SOCKETIO_USE_REACTOR = "socketio_use_reactor";
+    static const char* OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE = "socketio_receive_buffer_size";
+    static const char* OPTION_TLS_DECRYPT_BUFFER_SIZE = "tls_decrypt_buffer_size";
+    static const char* OPTION_TLS_SESSION_RESUMPTION = "tls_session_resumption";
+    static const char* OPTION_TLS_KTLS = "tls_ktls";
+
+    static const char* OPTION_WS_PERMESSAGE_DEFLATE = "ws_permessage_deflate";
+    static const char* OPTION_WS_DEFLATE_CLIENT_MAX_WINDOW_BITS = "ws_deflate_client_max_window_bits";
+    static const char* OPTION_WS_DEFLATE_SERVER_MAX_WINDOW_BITS = "ws_deflate_server_max_window_bits";
+    static const char* OPTION_WS_DEFLATE_CLIENT_NO_CONTEXT_TAKEOVER = "ws_deflate_client_no_context_takeover";
+    static const char* OPTION_WS_DEFLATE_SERVER_NO_CONTEXT_TAKEOVER = "ws_deflate_server_no_context_takeover";
+    static const char* OPTION_WS_DEFLATE_MEM_LEVEL = "ws_deflate_mem_level";
+    static const char* OPTION_WS_DEFLATE_MAX_MESSAGE_SIZE = "ws_deflate_max_message_size";
+    static const char* OPTION_WS_COMPRESS_MESSAGES = "ws_compress_messages";
+    static const char* OPTION_WS_SEND_COALESCING_SIZE = "ws_send_coalescing_size";
+    static const char* OPTION_WS_PING_INTERVAL_MS = "ws_ping_interval_ms";
+    static const char* OPTION_WS_PONG_TIMEOUT_MS = "ws_pong_timeout_ms";
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,10 @@ MOCKABLE_FUNCTION(, int, socketio_send, CONCRETE_IO_HANDLE, socket_io, const voi
 MOCKABLE_FUNCTION(, void, socketio_dowork, CONCRETE_IO_HANDLE, socket_io);
 MOCKABLE_FUNCTION(, int, socketio_setoption, CONCRETE_IO_HANDLE, socket_io, const char*, optionName, const void*, value);
 
+/* hand the connected socket to another layer (e.g. kTLS in tlsio_openssl) and take it back; only implemented by socketio_berkeley */
+MOCKABLE_FUNCTION(, int, socketio_lend_socket, CONCRETE_IO_HANDLE, socket_io, int*, lent_socket);
+MOCKABLE_FUNCTION(, int, socketio_reclaim_socket, CONCRETE_IO_HANDLE, socket_io);
+
 MOCKABLE_FUNCTION(, const IO_INTERFACE_DESCRIPTION*, socketio_get_interface_description);
 
 #ifdef __cplusplus
@@ -52,12 +52,14 @@ DEFINE_ENUM(WS_OPEN_RESULT, WS_OPEN_RESULT_VALUES);
     WS_ERROR_BAD_FRAME_RECEIVED, \
     WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST, \
     WS_ERROR_UNDERLYING_IO_ERROR, \
-    WS_ERROR_CANNOT_CLOSE_UNDERLYING_IO
+    WS_ERROR_CANNOT_CLOSE_UNDERLYING_IO, \
+    WS_ERROR_PONG_TIMEOUT
 
 DEFINE_ENUM(WS_ERROR, WS_ERROR_VALUES);
 
-#define WS_FRAME_TYPE_TEXT      0x01
-#define WS_FRAME_TYPE_BINARY    0x02
+#define WS_FRAME_TYPE_CONTINUATION  0x00
+#define WS_FRAME_TYPE_TEXT          0x01
+#define WS_FRAME_TYPE_BINARY        0x02
 
 /* Codes_SRS_UWS_CLIENT_01_324: [ 1000 indicates a normal closure, meaning that the purpose for which the connection was established has been fulfilled. ]*/
 /* Codes_SRS_UWS_CLIENT_01_325: [ 1001 indicates that an endpoint is "going away", such as a server going down or a browser having navigated away from a page. ]*/
@@ -88,6 +90,7 @@ DEFINE_ENUM(WS_ERROR, WS_ERROR_VALUES);
 #define CLOSE_RESERVED_1015                 1015
 
 typedef void(*ON_WS_FRAME_RECEIVED)(void* context, unsigned char frame_type, const unsigned char* buffer, size_t size);
+typedef void(*ON_WS_FRAGMENT_RECEIVED)(void* context, unsigned char frame_type, const unsigned char* buffer, size_t size, bool is_final);
 typedef void(*ON_WS_SEND_FRAME_COMPLETE)(void* context, WS_SEND_FRAME_RESULT ws_send_frame_result);
 typedef void(*ON_WS_OPEN_COMPLETE)(void* context, WS_OPEN_RESULT ws_open_result);
 typedef void(*ON_WS_CLOSE_COMPLETE)(void* context);
@@ -102,6 +105,7 @@ typedef struct WS_PROTOCOL_TAG
 MOCKABLE_FUNCTION(, UWS_CLIENT_HANDLE, uws_client_create, const char*, hostname, unsigned int, port, const char*, resource_name, bool, use_ssl, const WS_PROTOCOL*, protocols, size_t, protocol_count);
 MOCKABLE_FUNCTION(, UWS_CLIENT_HANDLE, uws_client_create_with_io, const IO_INTERFACE_DESCRIPTION*, io_interface, void*, io_create_parameters, const char*, hostname, unsigned int, port, const char*, resource_name, const WS_PROTOCOL*, protocols, size_t, protocol_count)
 MOCKABLE_FUNCTION(, void, uws_client_destroy, UWS_CLIENT_HANDLE, uws_client);
+MOCKABLE_FUNCTION(, int, uws_client_set_on_fragment_received, UWS_CLIENT_HANDLE, uws_client, ON_WS_FRAGMENT_RECEIVED, on_ws_fragment_received, void*, on_ws_fragment_received_context);
 MOCKABLE_FUNCTION(, int, uws_client_open_async, UWS_CLIENT_HANDLE, uws_client, ON_WS_OPEN_COMPLETE, on_ws_open_complete, void*, on_ws_open_complete_context, ON_WS_FRAME_RECEIVED, on_ws_frame_received, void*, on_ws_frame_received_context, ON_WS_PEER_CLOSED, on_ws_peer_closed, void*, on_ws_peer_closed_context, ON_WS_ERROR, on_ws_error, void*, on_ws_error_context);
 MOCKABLE_FUNCTION(, int, uws_client_close_async, UWS_CLIENT_HANDLE, uws_client, ON_WS_CLOSE_COMPLETE, on_ws_close_complete, void*, on_ws_close_complete_context);
 MOCKABLE_FUNCTION(, int, uws_client_close_handshake_async, UWS_CLIENT_HANDLE, uws_client, uint16_t, close_code, const char*, close_reason, ON_WS_CLOSE_COMPLETE, on_ws_close_complete, void*, on_ws_close_complete_context);
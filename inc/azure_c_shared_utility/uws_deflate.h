@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef UWS_DEFLATE_H
+#define UWS_DEFLATE_H
+
+#ifdef __cplusplus
+#include <cstdbool>
+#include <cstddef>
+extern "C" {
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+typedef struct UWS_DEFLATE_INSTANCE_TAG* UWS_DEFLATE_HANDLE;
+
+/* Parameters offered for the permessage-deflate extension (RFC 7692) and the limits applied to one connection */
+typedef struct UWS_DEFLATE_CONFIG_TAG
+{
+    /* Window used to compress the messages sent by the client, 9 to 15 */
+    int client_max_window_bits;
+    /* Window the server is asked to compress with, 9 to 15. Decompression uses a window of the same size */
+    int server_max_window_bits;
+    bool client_no_context_takeover;
+    bool server_no_context_takeover;
+    /* zlib memory level of the compressor, 1 to 9 */
+    int mem_level;
+    /* Largest decompressed message accepted, 0 for no limit */
+    size_t max_message_size;
+} UWS_DEFLATE_CONFIG;
+
+typedef void(*ON_UWS_DEFLATE_OUTPUT)(void* context, const unsigned char* buffer, size_t size);
+
+MOCKABLE_FUNCTION(, bool, uws_deflate_is_supported);
+MOCKABLE_FUNCTION(, char*, uws_deflate_create_offer, const UWS_DEFLATE_CONFIG*, config);
+MOCKABLE_FUNCTION(, UWS_DEFLATE_HANDLE, uws_deflate_create, const UWS_DEFLATE_CONFIG*, config, const char*, extension_response);
+MOCKABLE_FUNCTION(, void, uws_deflate_destroy, UWS_DEFLATE_HANDLE, uws_deflate);
+MOCKABLE_FUNCTION(, int, uws_deflate_compress, UWS_DEFLATE_HANDLE, uws_deflate, const unsigned char*, buffer, size_t, size, bool, is_final, const unsigned char**, compressed, size_t*, compressed_size);
+MOCKABLE_FUNCTION(, void, uws_deflate_reset_compressor, UWS_DEFLATE_HANDLE, uws_deflate);
+MOCKABLE_FUNCTION(, int, uws_deflate_decompress, UWS_DEFLATE_HANDLE, uws_deflate, const unsigned char*, buffer, size_t, size, bool, is_final, ON_UWS_DEFLATE_OUTPUT, on_output, void*, on_output_context);
+MOCKABLE_FUNCTION(, bool, uws_deflate_is_message_too_large, UWS_DEFLATE_HANDLE, uws_deflate);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* UWS_DEFLATE_H */
@@ -70,6 +70,7 @@ MOCKABLE_FUNCTION(, int, xio_send, XIO_HANDLE, xio, const void*, buffer, size_t,
 MOCKABLE_FUNCTION(, void, xio_dowork, XIO_HANDLE, xio);
 MOCKABLE_FUNCTION(, int, xio_setoption, XIO_HANDLE, xio, const char*, optionName, const void*, value);
 MOCKABLE_FUNCTION(, OPTIONHANDLER_HANDLE, xio_retrieveoptions, XIO_HANDLE, xio);
+MOCKABLE_FUNCTION(, CONCRETE_IO_HANDLE, xio_get_concrete_handle, XIO_HANDLE, xio, const IO_INTERFACE_DESCRIPTION*, io_interface_description);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Measures how fast uws_frame_encoder_encode builds masked frames, next to unmasked frames of the
+same size (which only copy the payload) and to a byte at a time reference masking loop. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/uws_frame_encoder.h"
+#include "azure_c_shared_utility/buffer_.h"
+
+#define PAYLOAD_SIZE (1024 * 1024)
+#define DEFAULT_ITERATIONS 1000
+
+static unsigned char reference_output[PAYLOAD_SIZE];
+
+/* clock is used rather than tickcounter, which only has a one second resolution on some platforms */
+static void print_rate(const char* name, size_t iterations, clock_t elapsed)
+{
+    double megabytes = (double)iterations * PAYLOAD_SIZE / (1024.0 * 1024.0);
+    double seconds = (double)elapsed / CLOCKS_PER_SEC;
+
+    if (seconds <= 0.0)
+    {
+        (void)printf("%-24s too fast to measure, use more iterations\r\n", name);
+    }
+    else
+    {
+        (void)printf("%-24s %8.1f MB/s (%.3f s)\r\n", name, megabytes / seconds, seconds);
+    }
+}
+
+static int run_encode(const unsigned char* payload, bool is_masked, size_t iterations, clock_t* elapsed)
+{
+    int result = 0;
+    clock_t start = clock();
+    size_t i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        BUFFER_HANDLE frame = uws_frame_encoder_encode(WS_BINARY_FRAME, payload, PAYLOAD_SIZE, is_masked, true, 0);
+        if (frame == NULL)
+        {
+            (void)printf("Encoding failed\r\n");
+            result = __FAILURE__;
+            break;
+        }
+
+        BUFFER_delete(frame);
+    }
+
+    *elapsed = clock() - start;
+
+    return result;
+}
+
+static int check_masking(const unsigned char* payload)
+{
+    int result;
+    BUFFER_HANDLE frame = uws_frame_encoder_encode(WS_BINARY_FRAME, payload, PAYLOAD_SIZE, true, true, 0);
+
+    if (frame == NULL)
+    {
+        (void)printf("Encoding failed\r\n");
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* 2 header bytes, 8 bytes of 64 bit length, 4 bytes of masking key */
+        const unsigned char* masking_key = BUFFER_u_char(frame) + 10;
+        const unsigned char* masked_payload = masking_key + 4;
+        size_t i;
+
+        for (i = 0; i < PAYLOAD_SIZE; i++)
+        {
+            reference_output[i] = payload[i] ^ masking_key[i % 4];
+        }
+
+        if (memcmp(reference_output, masked_payload, PAYLOAD_SIZE) != 0)
+        {
+            (void)printf("Masked payload does not match the reference masking\r\n");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+
+        BUFFER_delete(frame);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    size_t iterations = (argc > 1) ? (size_t)atoi(argv[1]) : DEFAULT_ITERATIONS;
+    unsigned char* payload = (unsigned char*)malloc(PAYLOAD_SIZE);
+
+    if (payload == NULL)
+    {
+        (void)printf("Cannot allocate the payload\r\n");
+        result = __FAILURE__;
+    }
+    else
+    {
+        clock_t elapsed;
+        size_t i;
+
+        for (i = 0; i < PAYLOAD_SIZE; i++)
+        {
+            payload[i] = (unsigned char)(i * 31 + 7);
+        }
+
+        if (check_masking(payload) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else if (run_encode(payload, false, iterations, &elapsed) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            print_rate("encode unmasked", iterations, elapsed);
+
+            if (run_encode(payload, true, iterations, &elapsed) != 0)
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                clock_t start;
+                const unsigned char masking_key[4] = { 0x12, 0x34, 0x56, 0x78 };
+                size_t j;
+
+                print_rate("encode masked", iterations, elapsed);
+
+                start = clock();
+                for (j = 0; j < iterations; j++)
+                {
+                    for (i = 0; i < PAYLOAD_SIZE; i++)
+                    {
+                        reference_output[i] = payload[i] ^ masking_key[i % 4];
+                    }
+                }
+
+                print_rate("byte at a time masking", iterations, clock() - start);
+                result = 0;
+            }
+        }
+    }
+
+    free(payload);
+
+    return result;
+}
@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <string.h>
+#include "azure_c_shared_utility/http_response_parser.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+typedef enum HTTP_RESPONSE_PARSER_STATE_TAG
+{
+    HTTP_RESPONSE_PARSER_STATE_HTTP_PREFIX,
+    HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION_START,
+    HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION,
+    HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION_START,
+    HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION,
+    HTTP_RESPONSE_PARSER_STATE_STATUS_CODE_START,
+    HTTP_RESPONSE_PARSER_STATE_STATUS_CODE,
+    HTTP_RESPONSE_PARSER_STATE_REASON_PHRASE,
+    HTTP_RESPONSE_PARSER_STATE_STATUS_LINE_LF,
+    HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_START,
+    HTTP_RESPONSE_PARSER_STATE_HEADER_LINE,
+    HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_LF,
+    HTTP_RESPONSE_PARSER_STATE_END_LF,
+    HTTP_RESPONSE_PARSER_STATE_COMPLETE,
+    HTTP_RESPONSE_PARSER_STATE_ERROR
+} HTTP_RESPONSE_PARSER_STATE;
+
+#define HTTP_STATUS_CODE_DIGITS 3
+
+static const char http_prefix[] = "HTTP/";
+
+static int is_digit(unsigned char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+/* Moves the parser to its next state for one byte of the response */
+static HTTP_RESPONSE_PARSER_STATE parse_byte(HTTP_RESPONSE_PARSER* parser, HTTP_RESPONSE_PARSER_STATE state, unsigned char c)
+{
+    switch (state)
+    {
+    default:
+        state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_HTTP_PREFIX:
+        if (c != (unsigned char)http_prefix[parser->match_index])
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        else
+        {
+            parser->match_index++;
+            if (parser->match_index == sizeof(http_prefix) - 1)
+            {
+                state = HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION_START;
+            }
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION_START:
+        state = is_digit(c) ? HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION : HTTP_RESPONSE_PARSER_STATE_ERROR;
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_MAJOR_VERSION:
+        if (c == '.')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION_START;
+        }
+        else if (!is_digit(c))
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION_START:
+        state = is_digit(c) ? HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION : HTTP_RESPONSE_PARSER_STATE_ERROR;
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_MINOR_VERSION:
+        if (c == ' ')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_STATUS_CODE_START;
+        }
+        else if (!is_digit(c))
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_STATUS_CODE_START:
+        if (is_digit(c))
+        {
+            parser->status_code = c - '0';
+            parser->match_index = 1;
+            state = HTTP_RESPONSE_PARSER_STATE_STATUS_CODE;
+        }
+        else if (c != ' ')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_STATUS_CODE:
+        if (is_digit(c) && (parser->match_index < HTTP_STATUS_CODE_DIGITS))
+        {
+            parser->status_code = (parser->status_code * 10) + (c - '0');
+            parser->match_index++;
+        }
+        else if (parser->match_index != HTTP_STATUS_CODE_DIGITS)
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        else if (c == ' ')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_REASON_PHRASE;
+        }
+        else if (c == '\r')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_STATUS_LINE_LF;
+        }
+        else
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_ERROR;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_REASON_PHRASE:
+        if (c == '\r')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_STATUS_LINE_LF;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_STATUS_LINE_LF:
+    case HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_LF:
+        state = (c == '\n') ? HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_START : HTTP_RESPONSE_PARSER_STATE_ERROR;
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_START:
+        state = (c == '\r') ? HTTP_RESPONSE_PARSER_STATE_END_LF : HTTP_RESPONSE_PARSER_STATE_HEADER_LINE;
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_HEADER_LINE:
+        if (c == '\r')
+        {
+            state = HTTP_RESPONSE_PARSER_STATE_HEADER_LINE_LF;
+        }
+        break;
+
+    case HTTP_RESPONSE_PARSER_STATE_END_LF:
+        state = (c == '\n') ? HTTP_RESPONSE_PARSER_STATE_COMPLETE : HTTP_RESPONSE_PARSER_STATE_ERROR;
+        break;
+    }
+
+    return state;
+}
+
+void http_response_parser_init(HTTP_RESPONSE_PARSER* parser)
+{
+    if (parser == NULL)
+    {
+        /* Codes_SRS_HTTP_RESPONSE_PARSER_01_001: [ If `parser` is NULL, `http_response_parser_init` shall do nothing. ]*/
+        LogError("NULL parser");
+    }
+    else
+    {
+        /* Codes_SRS_HTTP_RESPONSE_PARSER_01_002: [ `http_response_parser_init` shall set `parser` to expect the first byte of a status line. ]*/
+        parser->state = HTTP_RESPONSE_PARSER_STATE_HTTP_PREFIX;
+        parser->match_index = 0;
+        parser->status_code = 0;
+        parser->response_length = 0;
+    }
+}
+
+HTTP_RESPONSE_PARSER_RESULT http_response_parser_parse(HTTP_RESPONSE_PARSER* parser, const unsigned char* buffer, size_t size, size_t* consumed)
+{
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    if ((parser == NULL) ||
+        ((buffer == NULL) && (size > 0)) ||
+        (consumed == NULL))
+    {
+        /* Codes_SRS_HTTP_RESPONSE_PARSER_01_003: [ If `parser` or `consumed` is NULL, or `buffer` is NULL while `size` is not 0, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+        LogError("Bad arguments: parser = %p, buffer = %p, size = %lu, consumed = %p",
+            parser, buffer, (unsigned long)size, consumed);
+        result = HTTP_RESPONSE_PARSER_ERROR;
+    }
+    else
+    {
+        size_t pos = 0;
+        HTTP_RESPONSE_PARSER_STATE state = (HTTP_RESPONSE_PARSER_STATE)parser->state;
+
+        /* Codes_SRS_HTTP_RESPONSE_PARSER_01_004: [ `http_response_parser_parse` shall parse the `size` bytes of `buffer` as the continuation of the bytes passed to the previous calls, without looking at those again. ]*/
+        while ((pos < size) &&
+            (state != HTTP_RESPONSE_PARSER_STATE_COMPLETE) &&
+            (state != HTTP_RESPONSE_PARSER_STATE_ERROR))
+        {
+            if ((state == HTTP_RESPONSE_PARSER_STATE_HEADER_LINE) ||
+                (state == HTTP_RESPONSE_PARSER_STATE_REASON_PHRASE))
+            {
+                /* The content of the header lines is not needed, skip straight to the end of the line */
+                const unsigned char* line_end = (const unsigned char*)memchr(buffer + pos, '\r', size - pos);
+                if (line_end == NULL)
+                {
+                    pos = size;
+                    break;
+                }
+
+                pos = line_end - buffer;
+            }
+
+            state = parse_byte(parser, state, buffer[pos]);
+            pos++;
+        }
+
+        parser->state = state;
+
+        if (state == HTTP_RESPONSE_PARSER_STATE_ERROR)
+        {
+            /* Codes_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+            /* Codes_SRS_HTTP_RESPONSE_PARSER_01_006: [ Once it failed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_ERROR` until `http_response_parser_init` is called. ]*/
+            LogError("Cannot decode HTTP response");
+            result = HTTP_RESPONSE_PARSER_ERROR;
+        }
+        else
+        {
+            /* Codes_SRS_HTTP_RESPONSE_PARSER_01_007: [ `consumed` shall be set to the number of bytes of `buffer` that belong to the status line and headers. ]*/
+            *consumed = pos;
+            parser->response_length += pos;
+
+            if (state == HTTP_RESPONSE_PARSER_STATE_COMPLETE)
+            {
+                /* Codes_SRS_HTTP_RESPONSE_PARSER_01_008: [ When the empty line ending the headers has been parsed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_COMPLETE`, leaving the bytes after it unconsumed. ]*/
+                /* Codes_SRS_HTTP_RESPONSE_PARSER_01_009: [ When the response is complete, `status_code` shall hold the status code and `response_length` the number of bytes of the status line and headers. ]*/
+                result = HTTP_RESPONSE_PARSER_COMPLETE;
+            }
+            else
+            {
+                /* Codes_SRS_HTTP_RESPONSE_PARSER_01_010: [ Otherwise `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_INCOMPLETE`. ]*/
+                result = HTTP_RESPONSE_PARSER_INCOMPLETE;
+            }
+        }
+    }
+
+    return result;
+}
@@ -2,6 +2,7 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <string.h>
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/httpapiex.h"
 #include "azure_c_shared_utility/optimize_size.h"
@@ -9,6 +10,12 @@
 #include "azure_c_shared_utility/strings.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
 #include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+
+#define HTTPAPIEX_DEFAULT_MAX_IDLE_CONNECTIONS 4
+#define HTTPAPIEX_DEFAULT_MIN_IDLE_CONNECTIONS 1
 
 typedef struct HTTPAPIEX_SAVED_OPTION_TAG
 {
@@ -16,12 +23,26 @@ typedef struct HTTPAPIEX_SAVED_OPTION_TAG
     const void* value;
 }HTTPAPIEX_SAVED_OPTION;
 
+typedef struct HTTPAPIEX_IDLE_CONNECTION_TAG
+{
+    HTTP_HANDLE httpHandle;
+    tickcounter_ms_t lastUsedTime;
+    size_t savedOptionsVersion; /*the version of the saved options the connection has been given*/
+}HTTPAPIEX_IDLE_CONNECTION;
+
 typedef struct HTTPAPIEX_HANDLE_DATA_TAG
 {
     STRING_HANDLE hostName;
-    int k;
-    HTTP_HANDLE httpHandle;
     VECTOR_HANDLE savedOptions;
+    size_t savedOptionsVersion; /*changes every time an option is saved, a connection that was checked out at that time is not pooled again*/
+    LOCK_HANDLE lock; /*guards the saved options, the idle connections and the HTTPAPI_Init reference*/
+    bool isHTTPAPIInitialized;
+    HTTPAPIEX_IDLE_CONNECTION* idleConnections; /*the least recently used connection comes first*/
+    size_t idleConnectionCount;
+    size_t maxIdleConnections;
+    size_t minIdleConnections;
+    size_t idleTimeout;
+    TICK_COUNTER_HANDLE tickCounter;
 }HTTPAPIEX_HANDLE_DATA;
 
 DEFINE_ENUM_STRINGS(HTTPAPIEX_RESULT, HTTPAPIEX_RESULT_VALUES);
@@ -68,9 +89,41 @@ HTTPAPIEX_HANDLE HTTPAPIEX_Create(const char* hostName)
                 }
                 else
                 {
-                    handleData->k = -1;
-                    handleData->httpHandle = NULL;
-                    result = handleData;
+                    /*Codes_SRS_HTTPAPIEX_01_001: [HTTPAPIEX_Create shall create a lock by calling Lock_Init, the lock guards the saved options and the idle connections.]*/
+                    handleData->lock = Lock_Init();
+                    if (handleData->lock == NULL)
+                    {
+                        LogError("unable to Lock_Init");
+                        VECTOR_destroy(handleData->savedOptions);
+                        STRING_delete(handleData->hostName);
+                        free(handleData);
+                        result = NULL;
+                    }
+                    else
+                    {
+                        /*Codes_SRS_HTTPAPIEX_01_002: [HTTPAPIEX_Create shall allocate room for the default maximum of 4 idle connections.]*/
+                        handleData->idleConnections = (HTTPAPIEX_IDLE_CONNECTION*)malloc(HTTPAPIEX_DEFAULT_MAX_IDLE_CONNECTIONS * sizeof(HTTPAPIEX_IDLE_CONNECTION));
+                        if (handleData->idleConnections == NULL)
+                        {
+                            LogError("malloc failed.");
+                            (void)Lock_Deinit(handleData->lock);
+                            VECTOR_destroy(handleData->savedOptions);
+                            STRING_delete(handleData->hostName);
+                            free(handleData);
+                            result = NULL;
+                        }
+                        else
+                        {
+                            handleData->isHTTPAPIInitialized = false;
+                            handleData->savedOptionsVersion = 0;
+                            handleData->idleConnectionCount = 0;
+                            handleData->maxIdleConnections = HTTPAPIEX_DEFAULT_MAX_IDLE_CONNECTIONS;
+                            handleData->minIdleConnections = HTTPAPIEX_DEFAULT_MIN_IDLE_CONNECTIONS;
+                            handleData->idleTimeout = 0;
+                            handleData->tickCounter = NULL;
+                            result = handleData;
+                        }
+                    }
                 }
             }
         }
@@ -191,6 +244,198 @@ static int buildBufferIfNotExist(BUFFER_HANDLE originalRequestContent, bool* isO
 
 static unsigned int dummyStatusCode;
 
+/*Codes_SRS_HTTPAPIEX_01_005: [The handle shall hold a single HTTPAPI_Init reference, taken with the lock held by the first request that needs a new connection and released by HTTPAPIEX_Destroy.]*/
+static int initHTTPAPI(HTTPAPIEX_HANDLE_DATA* handleData)
+{
+    int result;
+
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (handleData->isHTTPAPIInitialized)
+        {
+            result = 0;
+        }
+        else if (HTTPAPI_Init() != HTTPAPI_OK)
+        {
+            LogError("unable to HTTPAPI_Init");
+            result = __FAILURE__;
+        }
+        else
+        {
+            handleData->isHTTPAPIInitialized = true;
+            result = 0;
+        }
+
+        (void)Unlock(handleData->lock);
+    }
+
+    return result;
+}
+
+/*takes the idle connection at index out of the idle connections, must be called with the lock held*/
+static HTTP_HANDLE removeIdleConnection(HTTPAPIEX_HANDLE_DATA* handleData, size_t index)
+{
+    HTTP_HANDLE result = handleData->idleConnections[index].httpHandle;
+
+    handleData->idleConnectionCount--;
+    (void)memmove(handleData->idleConnections + index, handleData->idleConnections + index + 1, (handleData->idleConnectionCount - index) * sizeof(HTTPAPIEX_IDLE_CONNECTION));
+
+    return result;
+}
+
+/*takes out of the idle connections one that shall not be used anymore, or returns NULL if there is none, must be called with the lock held*/
+static HTTP_HANDLE removeUnusableConnection(HTTPAPIEX_HANDLE_DATA* handleData)
+{
+    HTTP_HANDLE result = NULL;
+    size_t i;
+    tickcounter_ms_t now;
+
+    /*Codes_SRS_HTTPAPIEX_01_017: [If HTTPAPI_SetOption fails for an idle connection, that connection shall be closed instead of being checked out again.]*/
+    for (i = 0; i < handleData->idleConnectionCount; i++)
+    {
+        if (handleData->idleConnections[i].savedOptionsVersion != handleData->savedOptionsVersion)
+        {
+            result = removeIdleConnection(handleData, i);
+            break;
+        }
+    }
+
+    if (result != NULL)
+    {
+        /*a connection that misses an option has been found*/
+    }
+    else if (handleData->idleConnectionCount > handleData->maxIdleConnections)
+    {
+        result = removeIdleConnection(handleData, 0);
+    }
+    /*Codes_SRS_HTTPAPIEX_01_008: [When the idle timeout is not 0, before checking out a connection HTTPAPIEX_ExecuteRequest shall close the idle connections that have not been used for longer than the idle timeout, keeping at least the minimum number of idle connections.]*/
+    else if ((handleData->idleTimeout > 0) &&
+        (handleData->idleConnectionCount > handleData->minIdleConnections))
+    {
+        if (tickcounter_get_current_ms(handleData->tickCounter, &now) != 0)
+        {
+            LogError("unable to tickcounter_get_current_ms");
+        }
+        else if (now - handleData->idleConnections[0].lastUsedTime > handleData->idleTimeout)
+        {
+            result = removeIdleConnection(handleData, 0);
+        }
+        else
+        {
+            /*the least recently used connection has not expired, neither have the others*/
+        }
+    }
+    else
+    {
+        /*all the idle connections can be used*/
+    }
+
+    return result;
+}
+
+/*Codes_SRS_HTTPAPIEX_01_018: [Idle connections shall be taken out of the idle connections with the lock held and closed after the lock has been released.]*/
+static void closeUnusableConnections(HTTPAPIEX_HANDLE_DATA* handleData)
+{
+    HTTP_HANDLE httpHandle;
+
+    do
+    {
+        if (Lock(handleData->lock) != LOCK_OK)
+        {
+            LogError("unable to Lock");
+            httpHandle = NULL;
+        }
+        else
+        {
+            httpHandle = removeUnusableConnection(handleData);
+            (void)Unlock(handleData->lock);
+        }
+
+        if (httpHandle != NULL)
+        {
+            HTTPAPI_CloseConnection(httpHandle);
+        }
+    } while (httpHandle != NULL);
+}
+
+/*returns the most recently used idle connection, or NULL if a new connection has to be created*/
+static HTTP_HANDLE checkOutConnection(HTTPAPIEX_HANDLE_DATA* handleData, size_t* savedOptionsVersion)
+{
+    HTTP_HANDLE result = NULL;
+    HTTP_HANDLE unusableHandle;
+
+    do
+    {
+        if (Lock(handleData->lock) != LOCK_OK)
+        {
+            LogError("unable to Lock");
+            unusableHandle = NULL;
+        }
+        else
+        {
+            unusableHandle = removeUnusableConnection(handleData);
+            if ((unusableHandle == NULL) &&
+                (handleData->idleConnectionCount > 0))
+            {
+                handleData->idleConnectionCount--;
+                result = handleData->idleConnections[handleData->idleConnectionCount].httpHandle;
+                *savedOptionsVersion = handleData->savedOptionsVersion;
+            }
+
+            (void)Unlock(handleData->lock);
+        }
+
+        if (unusableHandle != NULL)
+        {
+            HTTPAPI_CloseConnection(unusableHandle);
+        }
+    } while (unusableHandle != NULL);
+
+    return result;
+}
+
+/*puts a connection that has just completed a request back with the idle connections*/
+static void checkInConnection(HTTPAPIEX_HANDLE_DATA* handleData, HTTP_HANDLE httpHandle, size_t savedOptionsVersion)
+{
+    bool isPooled = false;
+
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+    }
+    else
+    {
+        /*Codes_SRS_HTTPAPIEX_01_007: [If the maximum number of idle connections has been reached, or an option has been set while the connection was checked out, the connection shall be closed instead.]*/
+        if ((savedOptionsVersion == handleData->savedOptionsVersion) &&
+            (handleData->idleConnectionCount < handleData->maxIdleConnections))
+        {
+            HTTPAPIEX_IDLE_CONNECTION* idleConnection = &handleData->idleConnections[handleData->idleConnectionCount];
+            idleConnection->httpHandle = httpHandle;
+            idleConnection->savedOptionsVersion = savedOptionsVersion;
+            if ((handleData->tickCounter == NULL) ||
+                (tickcounter_get_current_ms(handleData->tickCounter, &idleConnection->lastUsedTime) != 0))
+            {
+                idleConnection->lastUsedTime = 0;
+            }
+
+            handleData->idleConnectionCount++;
+            isPooled = true;
+        }
+
+        (void)Unlock(handleData->lock);
+    }
+
+    if (!isPooled)
+    {
+        HTTPAPI_CloseConnection(httpHandle);
+    }
+}
+
 static int buildAllRequests(HTTPAPIEX_HANDLE_DATA* handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath,
     HTTP_HEADERS_HANDLE requestHttpHeadersHandle, BUFFER_HANDLE requestContent, unsigned int* statusCode,
     HTTP_HEADERS_HANDLE responseHttpHeadersHandle, BUFFER_HANDLE responseContent,
@@ -345,32 +590,35 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
                 /*Codes_SRS_HTTPAPIEX_02_026: [A step shall be retried at most once.]*/
                 /*Codes_SRS_HTTPAPIEX_02_027: [If a step has been retried then all subsequent steps shall be retried too.]*/
                 bool st[3] = { false, false, false }; /*the three levels of possible failure in resilient send: HTTAPI_Init, HTTPAPI_CreateConnection, HTTPAPI_ExecuteRequest*/
-                if (handleData->k == -1)
-                {
-                    handleData->k = 0;
-                }
+                size_t savedOptionsVersion = 0;
+                int k;
+
+                /*Codes_SRS_HTTPAPIEX_01_003: [Before the sequence in SRS_HTTPAPIEX_02_023, HTTPAPIEX_ExecuteRequest shall check out the most recently used idle connection of the handle and start the sequence at step 3 with it.]*/
+                /*Codes_SRS_HTTPAPIEX_01_004: [If there is no idle connection, the sequence shall start at step 1 with a new connection.]*/
+                HTTP_HANDLE httpHandle = checkOutConnection(handleData, &savedOptionsVersion);
+                k = (httpHandle == NULL) ? 0 : 2;
 
                 do
                 {
                     bool goOn;
 
-                    if (handleData->k > 2)
+                    if (k > 2)
                     {
                         /* error */
                         break;
                     }
 
-                    if (st[handleData->k] == true) /*already been tried*/
+                    if (st[k] == true) /*already been tried*/
                     {
                         goOn = false;
                     }
                     else
                     {
-                        switch (handleData->k)
+                        switch (k)
                         {
                         case 0:
                         {
-                            if (HTTPAPI_Init() != HTTPAPI_OK)
+                            if (initHTTPAPI(handleData) != 0)
                             {
                                 goOn = false;
                             }
@@ -382,8 +630,16 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
                         }
                         case 1:
                         {
-                            if ((handleData->httpHandle = HTTPAPI_CreateConnection(STRING_c_str(handleData->hostName))) == NULL)
+                            if ((httpHandle = HTTPAPI_CreateConnection(STRING_c_str(handleData->hostName))) == NULL)
+                            {
+                                goOn = false;
+                            }
+                            /*Codes_SRS_HTTPAPIEX_01_009: [The saved options and the idle connections shall only be accessed with the lock held.]*/
+                            else if (Lock(handleData->lock) != LOCK_OK)
                             {
+                                LogError("unable to Lock");
+                                HTTPAPI_CloseConnection(httpHandle);
+                                httpHandle = NULL;
                                 goOn = false;
                             }
                             else
@@ -395,11 +651,13 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
                                     /*Codes_SRS_HTTPAPIEX_02_035: [HTTPAPIEX_ExecuteRequest shall pass all the saved options (see HTTPAPIEX_SetOption) to the newly create HTTPAPI_HANDLE in step 2 by calling HTTPAPI_SetOption.]*/
                                     /*Codes_SRS_HTTPAPIEX_02_036: [If setting the option fails, then the failure shall be ignored.] */
                                     HTTPAPIEX_SAVED_OPTION* option = (HTTPAPIEX_SAVED_OPTION*)VECTOR_element(handleData->savedOptions, i);
-                                    if (HTTPAPI_SetOption(handleData->httpHandle, option->optionName, option->value) != HTTPAPI_OK)
+                                    if (HTTPAPI_SetOption(httpHandle, option->optionName, option->value) != HTTPAPI_OK)
                                     {
                                         LogError("HTTPAPI_SetOption failed when called for option %s", option->optionName);
                                     }
                                 }
+                                savedOptionsVersion = handleData->savedOptionsVersion;
+                                (void)Unlock(handleData->lock);
                                 goOn = true;
                             }
                             break;
@@ -408,7 +666,7 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
                         {
                             size_t length = BUFFER_length(toBeUsedRequestContent);
                             unsigned char* buffer = BUFFER_u_char(toBeUsedRequestContent);
-                            if (HTTPAPI_ExecuteRequest(handleData->httpHandle, requestType, toBeUsedRelativePath, toBeUsedRequestHttpHeadersHandle, buffer, length, toBeUsedStatusCode, toBeUsedResponseHttpHeadersHandle, toBeUsedResponseContent) != HTTPAPI_OK)
+                            if (HTTPAPI_ExecuteRequest(httpHandle, requestType, toBeUsedRelativePath, toBeUsedRequestHttpHeadersHandle, buffer, length, toBeUsedStatusCode, toBeUsedResponseHttpHeadersHandle, toBeUsedResponseContent) != HTTPAPI_OK)
                             {
                                 goOn = false;
                             }
@@ -429,34 +687,36 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
 
                     if (goOn)
                     {
-                        if (handleData->k == 2)
+                        if (k == 2)
                         {
+                            /*Codes_SRS_HTTPAPIEX_01_006: [When HTTPAPI_ExecuteRequest succeeds, the connection shall be returned to the idle connections of the handle.]*/
+                            checkInConnection(handleData, httpHandle, savedOptionsVersion);
                             /*Codes_SRS_HTTPAPIEX_02_028: [HTTPAPIEX_ExecuteRequest shall return HTTPAPIEX_OK when a call to HTTPAPI_ExecuteRequest has been completed successfully.]*/
                             result = HTTPAPIEX_OK;
                             goto out;
                         }
                         else
                         {
-                            st[handleData->k] = true;
-                            handleData->k++;
-                            st[handleData->k] = false;
+                            st[k] = true;
+                            k++;
+                            st[k] = false;
                         }
                     }
                     else
                     {
-                        st[handleData->k] = false;
-                        handleData->k--;
-                        switch (handleData->k)
+                        st[k] = false;
+                        k--;
+                        switch (k)
                         {
                         case 0:
                         {
-                            HTTPAPI_Deinit();
+                            /*the HTTPAPI_Init reference belongs to the handle, other requests might be using it*/
                             break;
                         }
                         case 1:
                         {
-                            HTTPAPI_CloseConnection(handleData->httpHandle);
-                            handleData->httpHandle = NULL;
+                            HTTPAPI_CloseConnection(httpHandle);
+                            httpHandle = NULL;
                             break;
                         }
                         case 2:
@@ -469,7 +729,7 @@ HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUE
                         }
                         }
                     }
-                } while (handleData->k >= 0);
+                } while (k >= 0);
                 /*Codes_SRS_HTTPAPIEX_02_029: [Otherwise, HTTAPIEX_ExecuteRequest shall return HTTPAPIEX_RECOVERYFAILED.] */
                 result = HTTPAPIEX_RECOVERYFAILED;
                 LogError("unable to recover sending to a working state");
@@ -506,10 +766,14 @@ void HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
         size_t i;
         size_t vectorSize;
         HTTPAPIEX_HANDLE_DATA* handleData = (HTTPAPIEX_HANDLE_DATA*)handle;
-        
-        if (handleData->k == 2)
+
+        /*Codes_SRS_HTTPAPIEX_01_010: [HTTPAPIEX_Destroy shall close all the idle connections and then release the HTTPAPI_Init reference of the handle.]*/
+        for (i = 0; i < handleData->idleConnectionCount; i++)
+        {
+            HTTPAPI_CloseConnection(handleData->idleConnections[i].httpHandle);
+        }
+        if (handleData->isHTTPAPIInitialized)
         {
-            HTTPAPI_CloseConnection(handleData->httpHandle);
             HTTPAPI_Deinit();
         }
         STRING_delete(handleData->hostName);
@@ -523,6 +787,13 @@ void HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
         }
         VECTOR_destroy(handleData->savedOptions);
 
+        free(handleData->idleConnections);
+        (void)Lock_Deinit(handleData->lock);
+        if (handleData->tickCounter != NULL)
+        {
+            tickcounter_destroy(handleData->tickCounter);
+        }
+
         free(handle);
     }
     else
@@ -579,6 +850,103 @@ static int createOrUpdateOption(HTTPAPIEX_HANDLE_DATA* handleData, const char* o
     return result;
 }
 
+static HTTPAPIEX_RESULT setMaxIdleConnections(HTTPAPIEX_HANDLE_DATA* handleData, size_t maxIdleConnections)
+{
+    HTTPAPIEX_RESULT result;
+    bool isAboveMaxIdleConnections = false;
+
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        result = HTTPAPIEX_ERROR;
+        LOG_HTTAPIEX_ERROR();
+    }
+    else
+    {
+        if (maxIdleConnections > handleData->maxIdleConnections)
+        {
+            HTTPAPIEX_IDLE_CONNECTION* idleConnections = (HTTPAPIEX_IDLE_CONNECTION*)realloc(handleData->idleConnections, maxIdleConnections * sizeof(HTTPAPIEX_IDLE_CONNECTION));
+            if (idleConnections == NULL)
+            {
+                /*Codes_SRS_HTTPAPIEX_01_015: [If making room for more idle connections fails, HTTPAPIEX_SetOption shall return HTTPAPIEX_ERROR.]*/
+                result = HTTPAPIEX_ERROR;
+                LOG_HTTAPIEX_ERROR();
+            }
+            else
+            {
+                handleData->idleConnections = idleConnections;
+                handleData->maxIdleConnections = maxIdleConnections;
+                result = HTTPAPIEX_OK;
+            }
+        }
+        else
+        {
+            /*the room for the idle connections is kept, it is reused if the maximum grows again*/
+            handleData->maxIdleConnections = maxIdleConnections;
+            isAboveMaxIdleConnections = (handleData->idleConnectionCount > maxIdleConnections);
+            result = HTTPAPIEX_OK;
+        }
+
+        (void)Unlock(handleData->lock);
+
+        if (isAboveMaxIdleConnections)
+        {
+            closeUnusableConnections(handleData);
+        }
+    }
+
+    return result;
+}
+
+static HTTPAPIEX_RESULT setMinIdleConnections(HTTPAPIEX_HANDLE_DATA* handleData, size_t minIdleConnections)
+{
+    HTTPAPIEX_RESULT result;
+
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        result = HTTPAPIEX_ERROR;
+        LOG_HTTAPIEX_ERROR();
+    }
+    else
+    {
+        handleData->minIdleConnections = minIdleConnections;
+        (void)Unlock(handleData->lock);
+        result = HTTPAPIEX_OK;
+    }
+
+    return result;
+}
+
+static HTTPAPIEX_RESULT setIdleTimeout(HTTPAPIEX_HANDLE_DATA* handleData, size_t idleTimeout)
+{
+    HTTPAPIEX_RESULT result;
+
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        result = HTTPAPIEX_ERROR;
+        LOG_HTTAPIEX_ERROR();
+    }
+    else
+    {
+        /*Codes_SRS_HTTPAPIEX_01_014: [The first time the idle timeout is set to a value other than 0, a tick counter shall be created by calling tickcounter_create. If that fails, HTTPAPIEX_SetOption shall return HTTPAPIEX_ERROR.]*/
+        if ((idleTimeout > 0) &&
+            (handleData->tickCounter == NULL) &&
+            ((handleData->tickCounter = tickcounter_create()) == NULL))
+        {
+            result = HTTPAPIEX_ERROR;
+            LOG_HTTAPIEX_ERROR();
+        }
+        else
+        {
+            handleData->idleTimeout = idleTimeout;
+            result = HTTPAPIEX_OK;
+        }
+
+        (void)Unlock(handleData->lock);
+    }
+
+    return result;
+}
+
 HTTPAPIEX_RESULT HTTPAPIEX_SetOption(HTTPAPIEX_HANDLE handle, const char* optionName, const void* value)
 {
     HTTPAPIEX_RESULT result;
@@ -594,6 +962,22 @@ HTTPAPIEX_RESULT HTTPAPIEX_SetOption(HTTPAPIEX_HANDLE handle, const char* option
         result = HTTPAPIEX_INVALID_ARG;
         LOG_HTTAPIEX_ERROR();
     }
+    /*Codes_SRS_HTTPAPIEX_02_030: [If parameter optionName is one of the options handled by HTTPAPIEX then it shall be set to value *value.]*/
+    else if (strcmp(OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS, optionName) == 0)
+    {
+        /*Codes_SRS_HTTPAPIEX_01_011: [httpapiex_max_idle_connections shall set the maximum number of idle connections kept by the handle, closing the least recently used idle connections above it.]*/
+        result = setMaxIdleConnections((HTTPAPIEX_HANDLE_DATA*)handle, *(const size_t*)value);
+    }
+    else if (strcmp(OPTION_HTTPAPIEX_MIN_IDLE_CONNECTIONS, optionName) == 0)
+    {
+        /*Codes_SRS_HTTPAPIEX_01_012: [httpapiex_min_idle_connections shall set the number of idle connections that are kept open regardless of the idle timeout.]*/
+        result = setMinIdleConnections((HTTPAPIEX_HANDLE_DATA*)handle, *(const size_t*)value);
+    }
+    else if (strcmp(OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, optionName) == 0)
+    {
+        /*Codes_SRS_HTTPAPIEX_01_013: [httpapiex_idle_timeout_ms shall set the time in milliseconds after which an idle connection is closed, 0 meaning never.]*/
+        result = setIdleTimeout((HTTPAPIEX_HANDLE_DATA*)handle, *(const size_t*)value);
+    }
     else
     {
         const void* savedOption;
@@ -617,38 +1001,60 @@ HTTPAPIEX_RESULT HTTPAPIEX_SetOption(HTTPAPIEX_HANDLE handle, const char* option
         else
         {
             HTTPAPIEX_HANDLE_DATA* handleData = (HTTPAPIEX_HANDLE_DATA*)handle;
-            /*Codes_SRS_HTTPAPIEX_02_039: [If HTTPAPI_CloneOption returns HTTPAPI_OK then HTTPAPIEX_SetOption shall create or update the pair optionName/value.]*/
-            if (createOrUpdateOption(handleData, optionName, savedOption) != 0)
+            bool isAnyConnectionStale = false;
+            if (Lock(handleData->lock) != LOCK_OK)
             {
-                /*Codes_SRS_HTTPAPIEX_02_041: [If creating or updating the pair optionName/value fails then shall return HTTPAPIEX_ERROR.] */
+                free((void*)savedOption);
                 result = HTTPAPIEX_ERROR;
                 LOG_HTTAPIEX_ERROR();
-                
             }
             else
             {
-                /*Codes_SRS_HTTPAPIEX_02_031: [If HTTPAPI_HANDLE exists then HTTPAPIEX_SetOption shall call HTTPAPI_SetOption passing the same optionName and value and shall return a value conforming to the below table:] */
-                if (handleData->httpHandle != NULL)
+                /*Codes_SRS_HTTPAPIEX_02_039: [If HTTPAPI_CloneOption returns HTTPAPI_OK then HTTPAPIEX_SetOption shall create or update the pair optionName/value.]*/
+                if (createOrUpdateOption(handleData, optionName, savedOption) != 0)
                 {
-                    HTTPAPI_RESULT HTTPAPI_result = HTTPAPI_SetOption(handleData->httpHandle, optionName, value);
-                    if (HTTPAPI_result == HTTPAPI_OK)
-                    {
-                        result = HTTPAPIEX_OK;
-                    }
-                    else if (HTTPAPI_result == HTTPAPI_INVALID_ARG)
-                    {
-                        result = HTTPAPIEX_INVALID_ARG;
-                        LOG_HTTAPIEX_ERROR();
-                    }
-                    else
-                    {
-                        result = HTTPAPIEX_ERROR;
-                        LOG_HTTAPIEX_ERROR();
-                    }
+                    /*Codes_SRS_HTTPAPIEX_02_041: [If creating or updating the pair optionName/value fails then shall return HTTPAPIEX_ERROR.] */
+                    result = HTTPAPIEX_ERROR;
+                    LOG_HTTAPIEX_ERROR();
+                
                 }
                 else
                 {
+                    size_t i;
+                    handleData->savedOptionsVersion++;
                     result = HTTPAPIEX_OK;
+
+                    /*Codes_SRS_HTTPAPIEX_02_031: [If HTTPAPI_HANDLE exists then HTTPAPIEX_SetOption shall call HTTPAPI_SetOption passing the same optionName and value and shall return a value conforming to the below table:] */
+                    /*Codes_SRS_HTTPAPIEX_01_016: [HTTPAPIEX_SetOption shall call HTTPAPI_SetOption for every idle connection.]*/
+                    for (i = 0; i < handleData->idleConnectionCount; i++)
+                    {
+                        HTTPAPI_RESULT HTTPAPI_result = HTTPAPI_SetOption(handleData->idleConnections[i].httpHandle, optionName, value);
+                        if (HTTPAPI_result == HTTPAPI_OK)
+                        {
+                            /*keep the result of the other connections*/
+                            handleData->idleConnections[i].savedOptionsVersion = handleData->savedOptionsVersion;
+                        }
+                        else if (HTTPAPI_result == HTTPAPI_INVALID_ARG)
+                        {
+                            result = HTTPAPIEX_INVALID_ARG;
+                            isAnyConnectionStale = true;
+                            LOG_HTTAPIEX_ERROR();
+                        }
+                        else
+                        {
+                            result = HTTPAPIEX_ERROR;
+                            isAnyConnectionStale = true;
+                            LOG_HTTAPIEX_ERROR();
+                        }
+                    }
+                }
+
+                (void)Unlock(handleData->lock);
+
+                /*Codes_SRS_HTTPAPIEX_01_017: [If HTTPAPI_SetOption fails for an idle connection, that connection shall be closed instead of being checked out again.]*/
+                if (isAnyConnectionStale)
+                {
+                    closeUnusableConnections(handleData);
                 }
             }
         }
@@ -15,18 +15,31 @@ typedef struct LIST_ITEM_INSTANCE_TAG
 typedef struct SINGLYLINKEDLIST_INSTANCE_TAG
 {
     LIST_ITEM_INSTANCE* head;
+    LIST_ITEM_INSTANCE* cached_items;
+    size_t cached_item_count;
+    size_t max_cached_items;
 } LIST_INSTANCE;
 
 SINGLYLINKEDLIST_HANDLE singlylinkedlist_create(void)
+{
+    /* Codes_SRS_LIST_01_001: [singlylinkedlist_create shall create a new list and return a non-NULL handle on success.] */
+    /* Codes_SRS_LIST_01_002: [If any error occurs during the list creation, singlylinkedlist_create shall return NULL.] */
+    return singlylinkedlist_create_with_item_cache(0);
+}
+
+SINGLYLINKEDLIST_HANDLE singlylinkedlist_create_with_item_cache(size_t max_cached_items)
 {
     LIST_INSTANCE* result;
 
-    /* Codes_SRS_LIST_01_001: [singlylinkedlist_create shall create a new list and return a non-NULL handle on success.] */
+    /* Codes_SRS_LIST_01_026: [singlylinkedlist_create_with_item_cache shall create a new list and return a non-NULL handle on success.] */
     result = (LIST_INSTANCE*)malloc(sizeof(LIST_INSTANCE));
     if (result != NULL)
     {
-        /* Codes_SRS_LIST_01_002: [If any error occurs during the list creation, singlylinkedlist_create shall return NULL.] */
+        /* Codes_SRS_LIST_01_027: [If any error occurs during the list creation, singlylinkedlist_create_with_item_cache shall return NULL.] */
         result->head = NULL;
+        result->cached_items = NULL;
+        result->cached_item_count = 0;
+        result->max_cached_items = max_cached_items;
     }
 
     return result;
@@ -46,6 +59,14 @@ void singlylinkedlist_destroy(SINGLYLINKEDLIST_HANDLE list)
             free(current_item);
         }
 
+        /* Codes_SRS_LIST_01_030: [singlylinkedlist_destroy shall free all list nodes kept in the item cache.] */
+        while (list_instance->cached_items != NULL)
+        {
+            LIST_ITEM_INSTANCE* current_item = list_instance->cached_items;
+            list_instance->cached_items = (LIST_ITEM_INSTANCE*)current_item->next;
+            free(current_item);
+        }
+
         /* Codes_SRS_LIST_01_003: [singlylinkedlist_destroy shall free all resources associated with the list identified by the handle argument.] */
         free(list_instance);
     }
@@ -64,7 +85,18 @@ LIST_ITEM_HANDLE singlylinkedlist_add(SINGLYLINKEDLIST_HANDLE list, const void*
     else
     {
         LIST_INSTANCE* list_instance = (LIST_INSTANCE*)list;
-        result = (LIST_ITEM_INSTANCE*)malloc(sizeof(LIST_ITEM_INSTANCE));
+
+        if (list_instance->cached_items != NULL)
+        {
+            /* Codes_SRS_LIST_01_028: [If the item cache of the list is not empty, singlylinkedlist_add shall reuse a cached list node instead of allocating a new one.] */
+            result = list_instance->cached_items;
+            list_instance->cached_items = (LIST_ITEM_INSTANCE*)result->next;
+            list_instance->cached_item_count--;
+        }
+        else
+        {
+            result = (LIST_ITEM_INSTANCE*)malloc(sizeof(LIST_ITEM_INSTANCE));
+        }
 
         if (result == NULL)
         {
@@ -126,7 +158,18 @@ int singlylinkedlist_remove(SINGLYLINKEDLIST_HANDLE list, LIST_ITEM_HANDLE item)
                     list_instance->head = (LIST_ITEM_INSTANCE*)current_item->next;
                 }
 
-                free(current_item);
+                if (list_instance->cached_item_count < list_instance->max_cached_items)
+                {
+                    /* Codes_SRS_LIST_01_029: [If the item cache holds less than max_cached_items nodes, singlylinkedlist_remove shall keep the removed list node in the cache instead of freeing it.] */
+                    current_item->item = NULL;
+                    current_item->next = list_instance->cached_items;
+                    list_instance->cached_items = current_item;
+                    list_instance->cached_item_count++;
+                }
+                else
+                {
+                    free(current_item);
+                }
 
                 break;
             }
@@ -9,7 +9,9 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <limits.h>
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/tlsio.h"
 #include "azure_c_shared_utility/tlsio_openssl.h"
 #include "azure_c_shared_utility/socketio.h"
@@ -19,6 +21,17 @@
 #include "azure_c_shared_utility/x509_openssl.h"
 #include "azure_c_shared_utility/shared_util_options.h"
 
+// default decrypt buffer, big enough for the plaintext of a full TLS record
+#define TLSIO_DECRYPT_BUFFER_SIZE   16384
+
+// number of host:port sessions kept for resumption, the least recently stored one is dropped first
+#define TLSIO_SESSION_CACHE_MAX_ENTRIES 64
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+// OpenSSL can hand the record layer of a socket BIO to the kernel
+#define TLSIO_OPENSSL_KTLS
+#endif
+
 typedef enum TLSIO_STATE_TAG
 {
     TLSIO_STATE_NOT_OPEN,
@@ -31,6 +44,49 @@ typedef enum TLSIO_STATE_TAG
 
 typedef int(*TLS_CERTIFICATE_VALIDATION_CALLBACK)(X509_STORE_CTX*, void*);
 
+/* an SSL_CTX shared by every instance opened with the same TLS version, certificates, credentials and validation callback */
+typedef struct SSL_CONTEXT_CACHE_ENTRY_TAG
+{
+    SSL_CTX* ssl_context;
+    size_t ref_count;
+    bool is_cached;
+    int tls_version;
+    char* certificate;
+    char* x509certificate;
+    char* x509privatekey;
+    char* x509_ecc_cert;
+    char* x509_ecc_aliaskey;
+    TLS_CERTIFICATE_VALIDATION_CALLBACK tls_validation_callback;
+    void* tls_validation_callback_data;
+    struct SSL_CONTEXT_CACHE_ENTRY_TAG* next;
+} SSL_CONTEXT_CACHE_ENTRY;
+
+/* the last session negotiated with hostname:port through one shared SSL_CTX; the context is part of the key so a session is never resumed under other trusted certificates, validation callback or client identity, and the entry holds a reference on it so a reconnect after the last close still finds both */
+typedef struct TLS_SESSION_CACHE_ENTRY_TAG
+{
+    struct SSL_CONTEXT_CACHE_ENTRY_TAG* ssl_context_entry;
+    char* hostname;
+    int port;
+    SSL_SESSION* session;
+    struct TLS_SESSION_CACHE_ENTRY_TAG* next;
+} TLS_SESSION_CACHE_ENTRY;
+
+/* a tlsio_openssl_send whose records are still queued in the underlying io */
+typedef struct PENDING_TLS_SEND_TAG
+{
+    struct TLS_IO_INSTANCE_TAG* tls_io_instance;
+    LIST_ITEM_HANDLE list_item;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+    size_t pending_records;
+    bool all_records_written;
+    IO_SEND_RESULT send_result;
+    /* plaintext SSL_write could not take yet, only used while the socket is lent to OpenSSL */
+    unsigned char* bytes;
+    size_t size;
+    size_t consumed;
+} PENDING_TLS_SEND;
+
 typedef struct TLS_IO_INSTANCE_TAG
 {
     XIO_HANDLE underlying_io;
@@ -44,6 +100,7 @@ typedef struct TLS_IO_INSTANCE_TAG
     void* on_io_error_context;
     SSL* ssl;
     SSL_CTX* ssl_context;
+    SSL_CONTEXT_CACHE_ENTRY* ssl_context_entry;
     BIO* in_bio;
     BIO* out_bio;
     TLSIO_STATE tlsio_state;
@@ -55,6 +112,21 @@ typedef struct TLS_IO_INSTANCE_TAG
     int tls_version;
     TLS_CERTIFICATE_VALIDATION_CALLBACK tls_validation_callback;
     void* tls_validation_callback_data;
+    char* hostname;
+    int port;
+    int session_resumption;
+    /* decrypted bytes are gathered here and handed up in one on_bytes_received call */
+    unsigned char* decrypt_buffer;
+    size_t decrypt_buffer_allocated;
+    size_t decrypt_buffer_size;
+    /* records written by OpenSSL go straight to underlying_io through out_bio */
+    SINGLYLINKEDLIST_HANDLE pending_sends;
+    PENDING_TLS_SEND* current_send;
+    bool in_record_write;
+    bool underlying_io_error_pending;
+    /* with kTLS the socket is lent by socketio and OpenSSL reads and writes it through a socket BIO */
+    int use_ktls;
+    bool socket_lent;
 } TLS_IO_INSTANCE;
 
 struct CRYPTO_dynlock_value 
@@ -62,6 +134,21 @@ struct CRYPTO_dynlock_value
     LOCK_HANDLE lock; 
 };
 
+/* created by tlsio_openssl_init; without it every instance gets a private SSL_CTX */
+static LOCK_HANDLE ssl_context_cache_lock = NULL;
+static SSL_CONTEXT_CACHE_ENTRY* ssl_context_cache = NULL;
+/* also protected by ssl_context_cache_lock, most recently stored first */
+static TLS_SESSION_CACHE_ENTRY* tls_session_cache = NULL;
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+#define BIO_get_data(bio) ((bio)->ptr)
+#define BIO_set_data(bio, data) ((bio)->ptr = (data))
+#define BIO_set_init(bio, value) ((bio)->init = (value))
+#endif
+
+/* write BIO handing every record to the underlying io, created by tlsio_openssl_init */
+static BIO_METHOD* tlsio_bio_method = NULL;
+
 /*this function will clone an option given by name and value*/
 static void* tlsio_openssl_CloneOption(const char* name, const void* value)
 {
@@ -135,6 +222,35 @@ static void* tlsio_openssl_CloneOption(const char* name, const void* value)
                 /*return as is*/
             }
         }
+        else if (strcmp(name, OPTION_TLS_DECRYPT_BUFFER_SIZE) == 0)
+        {
+            size_t* value_copy = (size_t*)malloc(sizeof(size_t));
+            if (value_copy == NULL)
+            {
+                LogError("unable to allocate tls_decrypt_buffer_size value");
+            }
+            else
+            {
+                *value_copy = *(const size_t*)value;
+            }
+
+            result = value_copy;
+        }
+        else if ((strcmp(name, OPTION_TLS_SESSION_RESUMPTION) == 0) ||
+            (strcmp(name, OPTION_TLS_KTLS) == 0))
+        {
+            int* value_copy = (int*)malloc(sizeof(int));
+            if (value_copy == NULL)
+            {
+                LogError("unable to allocate %s value", name);
+            }
+            else
+            {
+                *value_copy = *(const int*)value;
+            }
+
+            result = value_copy;
+        }
         else if (
             (strcmp(name, "tls_version") == 0) ||
             (strcmp(name, "tls_validation_callback") == 0) ||
@@ -169,7 +285,10 @@ static void tlsio_openssl_DestroyOption(const char* name, const void* value)
             (strcmp(name, SU_OPTION_X509_CERT) == 0) ||
             (strcmp(name, SU_OPTION_X509_PRIVATE_KEY) == 0) ||
             (strcmp(name, OPTION_X509_ECC_CERT) == 0) ||
-            (strcmp(name, OPTION_X509_ECC_KEY) == 0)
+            (strcmp(name, OPTION_X509_ECC_KEY) == 0) ||
+            (strcmp(name, OPTION_TLS_DECRYPT_BUFFER_SIZE) == 0) ||
+            (strcmp(name, OPTION_TLS_SESSION_RESUMPTION) == 0) ||
+            (strcmp(name, OPTION_TLS_KTLS) == 0)
             )
         {
             free((void*)value);
@@ -254,14 +373,41 @@ static OPTIONHANDLER_HANDLE tlsio_openssl_retrieveoptions(CONCRETE_IO_HANDLE han
                 OptionHandler_Destroy(result);
                 result = NULL;
             }
-            else if (tls_io_instance->tls_version != 0)
+            else if (
+                (tls_io_instance->decrypt_buffer_size != TLSIO_DECRYPT_BUFFER_SIZE) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_DECRYPT_BUFFER_SIZE, &tls_io_instance->decrypt_buffer_size) != 0)
+                )
             {
-                if (OptionHandler_AddOption(result, "tls_version", (void*)(intptr_t)tls_io_instance->tls_version) != 0)
-                {
-                    LogError("unable to save tls_version option");
-                    OptionHandler_Destroy(result);
-                    result = NULL;
-                }
+                LogError("unable to save tls_decrypt_buffer_size option");
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->session_resumption != 0) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_SESSION_RESUMPTION, &tls_io_instance->session_resumption) != 0)
+                )
+            {
+                LogError("unable to save tls_session_resumption option");
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->use_ktls != 0) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_KTLS, &tls_io_instance->use_ktls) != 0)
+                )
+            {
+                LogError("unable to save tls_ktls option");
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_version != 0) &&
+                (OptionHandler_AddOption(result, "tls_version", (void*)(intptr_t)tls_io_instance->tls_version) != 0)
+                )
+            {
+                LogError("unable to save tls_version option");
+                OptionHandler_Destroy(result);
+                result = NULL;
             }
             else if (tls_io_instance->tls_validation_callback != NULL)
             {
@@ -276,8 +422,10 @@ static OPTIONHANDLER_HANDLE tlsio_openssl_retrieveoptions(CONCRETE_IO_HANDLE han
                     OptionHandler_Destroy(result);
                     result = NULL;
                 }
-
-                if (OptionHandler_AddOption(result, "tls_validation_callback_data", (const char*)tls_io_instance->tls_validation_callback_data) != 0)
+                else if (
+                    (tls_io_instance->tls_validation_callback_data != NULL) &&
+                    (OptionHandler_AddOption(result, "tls_validation_callback_data", (const char*)tls_io_instance->tls_validation_callback_data) != 0)
+                    )
                 {
                     LogError("unable to save tls_validation_callback_data option");
                     OptionHandler_Destroy(result);
@@ -510,51 +658,222 @@ static void indicate_open_complete(TLS_IO_INSTANCE* tls_io_instance, IO_OPEN_RES
     }
 }
 
-static int write_outgoing_bytes(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+static void complete_pending_send(PENDING_TLS_SEND* pending_send)
+{
+    (void)singlylinkedlist_remove(pending_send->tls_io_instance->pending_sends, pending_send->list_item);
+
+    if (pending_send->on_send_complete != NULL)
+    {
+        pending_send->on_send_complete(pending_send->callback_context, pending_send->send_result);
+    }
+
+    free(pending_send->bytes);
+    free(pending_send);
+}
+
+static void on_record_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    PENDING_TLS_SEND* pending_send = (PENDING_TLS_SEND*)context;
+
+    /* the first failed record decides the result */
+    if (pending_send->send_result == IO_SEND_OK)
+    {
+        pending_send->send_result = send_result;
+    }
+
+    pending_send->pending_records--;
+    if ((pending_send->pending_records == 0) &&
+        pending_send->all_records_written)
+    {
+        complete_pending_send(pending_send);
+    }
+}
+
+static PENDING_TLS_SEND* create_pending_send(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    PENDING_TLS_SEND* result = (PENDING_TLS_SEND*)malloc(sizeof(PENDING_TLS_SEND));
+    if (result == NULL)
+    {
+        LogError("Failed allocating PENDING_TLS_SEND.");
+    }
+    else
+    {
+        result->tls_io_instance = tls_io_instance;
+        result->on_send_complete = on_send_complete;
+        result->callback_context = callback_context;
+        result->pending_records = 0;
+        result->all_records_written = false;
+        result->send_result = IO_SEND_OK;
+        result->bytes = NULL;
+        result->size = 0;
+        result->consumed = 0;
+
+        result->list_item = singlylinkedlist_add(tls_io_instance->pending_sends, result);
+        if (result->list_item == NULL)
+        {
+            LogError("Failed adding the pending send to the list.");
+            free(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+static void finish_pending_send(PENDING_TLS_SEND* pending_send)
+{
+    pending_send->all_records_written = true;
+    if (pending_send->pending_records == 0)
+    {
+        complete_pending_send(pending_send);
+    }
+}
+
+static int tlsio_bio_write(BIO* bio, const char* data, int length)
 {
     int result;
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)BIO_get_data(bio);
 
-    size_t pending = BIO_ctrl_pending(tls_io_instance->out_bio);
+    BIO_clear_retry_flags(bio);
 
-    if (pending == 0)
+    if ((tls_io_instance == NULL) || (length <= 0))
     {
         result = 0;
     }
     else
     {
-        unsigned char* bytes_to_send = malloc(pending);
-        if (bytes_to_send == NULL)
+        /* the record is sent from OpenSSL's own buffer, the underlying io only copies what it cannot send right away */
+        PENDING_TLS_SEND* pending_send = tls_io_instance->current_send;
+
+        if (pending_send != NULL)
         {
-            LogError("NULL bytes_to_send.");
-            result = __FAILURE__;
+            pending_send->pending_records++;
         }
-        else
+
+        tls_io_instance->in_record_write = true;
+        if (xio_send(tls_io_instance->underlying_io, data, (size_t)length, (pending_send == NULL) ? NULL : on_record_send_complete, pending_send) != 0)
         {
-            if (BIO_read(tls_io_instance->out_bio, bytes_to_send, (int)pending) != pending)
-            {
-                log_ERR_get_error("BIO_read not in pending state.");
-                result = __FAILURE__;
-            }
-            else
+            if (pending_send != NULL)
             {
-                if (xio_send(tls_io_instance->underlying_io, bytes_to_send, pending, on_send_complete, callback_context) != 0)
-                {
-                    LogError("Error in xio_send.");
-                    result = __FAILURE__;
-                }
-                else
-                {
-                    result = 0;
-                }
+                pending_send->pending_records--;
             }
 
-            free(bytes_to_send);
+            LogError("Error in xio_send.");
+            result = -1;
+        }
+        else
+        {
+            result = length;
+        }
+        tls_io_instance->in_record_write = false;
+    }
+
+    return result;
+}
+
+static long tlsio_bio_ctrl(BIO* bio, int cmd, long num, void* ptr)
+{
+    long result;
+
+    (void)bio;
+    (void)num;
+    (void)ptr;
+
+    /* nothing is ever buffered, so a flush always succeeds and every other control is unsupported */
+    if (cmd == BIO_CTRL_FLUSH)
+    {
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int tlsio_bio_create(BIO* bio)
+{
+    BIO_set_init(bio, 1);
+    BIO_set_data(bio, NULL);
+    return 1;
+}
+
+static int tlsio_bio_destroy(BIO* bio)
+{
+    /* the instance set as data is not owned by the BIO */
+    return (bio == NULL) ? 0 : 1;
+}
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+static BIO_METHOD tlsio_bio_method_instance =
+{
+    BIO_TYPE_SOURCE_SINK,
+    "tlsio_openssl",
+    tlsio_bio_write,
+    NULL,
+    NULL,
+    NULL,
+    tlsio_bio_ctrl,
+    tlsio_bio_create,
+    tlsio_bio_destroy,
+    NULL
+};
+#endif
+
+static int create_bio_method(void)
+{
+    int result;
+
+    if (tlsio_bio_method != NULL)
+    {
+        result = 0;
+    }
+    else
+    {
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+        tlsio_bio_method = &tlsio_bio_method_instance;
+        result = 0;
+#else
+        tlsio_bio_method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "tlsio_openssl");
+        if (tlsio_bio_method == NULL)
+        {
+            log_ERR_get_error("Failed BIO_meth_new.");
+            result = __FAILURE__;
+        }
+        else if ((BIO_meth_set_write(tlsio_bio_method, tlsio_bio_write) != 1) ||
+            (BIO_meth_set_ctrl(tlsio_bio_method, tlsio_bio_ctrl) != 1) ||
+            (BIO_meth_set_create(tlsio_bio_method, tlsio_bio_create) != 1) ||
+            (BIO_meth_set_destroy(tlsio_bio_method, tlsio_bio_destroy) != 1))
+        {
+            log_ERR_get_error("Failed setting up the tlsio BIO method.");
+            BIO_meth_free(tlsio_bio_method);
+            tlsio_bio_method = NULL;
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
         }
+#endif
     }
 
     return result;
 }
 
+static void destroy_bio_method(void)
+{
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    if (tlsio_bio_method != NULL)
+    {
+        BIO_meth_free(tlsio_bio_method);
+    }
+#endif
+    tlsio_bio_method = NULL;
+}
+
+static int finish_ktls_handshake(TLS_IO_INSTANCE* tls_io_instance);
+
 static int send_handshake_bytes(TLS_IO_INSTANCE* tls_io_instance)
 {
     int result;
@@ -566,40 +885,39 @@ static int send_handshake_bytes(TLS_IO_INSTANCE* tls_io_instance)
         return result;
     }
 
+    /* the handshake records are sent by out_bio as OpenSSL writes them */
+    int handshake_result = SSL_is_init_finished(tls_io_instance->ssl) ? 1 : SSL_do_handshake(tls_io_instance->ssl);
+    int handshake_error = (handshake_result <= 0) ? SSL_get_error(tls_io_instance->ssl, handshake_result) : SSL_ERROR_NONE;
+
     if (SSL_is_init_finished(tls_io_instance->ssl))
     {
-        tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-        indicate_open_complete(tls_io_instance, IO_OPEN_OK);
-        result = 0;
-    }
-    else
-    {
-        SSL_do_handshake(tls_io_instance->ssl);
-        if (SSL_is_init_finished(tls_io_instance->ssl))
+        if (finish_ktls_handshake(tls_io_instance) != 0)
         {
-            tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-            indicate_open_complete(tls_io_instance, IO_OPEN_OK);
-            result = 0;
+            LogError("Failed switching from the lent socket back to the memory BIOs.");
+            result = __FAILURE__;
         }
         else
         {
-            if (write_outgoing_bytes(tls_io_instance, NULL, NULL) != 0)
-            {
-                LogError("Error in write_outgoing_bytes.");
-                result = __FAILURE__;
-            }
-            else
-            {
-                if (SSL_is_init_finished(tls_io_instance->ssl))
-                {
-                    tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-                    indicate_open_complete(tls_io_instance, IO_OPEN_OK);
-                }
-
-                result = 0;
-            }
+            tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
+            indicate_open_complete(tls_io_instance, IO_OPEN_OK);
+            result = 0;
         }
     }
+    else if (handshake_error == SSL_ERROR_SYSCALL)
+    {
+        LogError("Error sending handshake bytes.");
+        result = __FAILURE__;
+    }
+    else if (tls_io_instance->socket_lent && (handshake_error == SSL_ERROR_SSL))
+    {
+        /* nothing else reads the lent socket, so a failed handshake has to be reported here */
+        log_ERR_get_error("Error in SSL_do_handshake.");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
 
     return result;
 }
@@ -632,6 +950,8 @@ static void on_underlying_io_close_complete(void* context)
     }
 }
 
+static void lend_socket_to_openssl(TLS_IO_INSTANCE* tls_io_instance);
+
 static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_result)
 {
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
@@ -642,6 +962,11 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
         {
             tls_io_instance->tlsio_state = TLSIO_STATE_IN_HANDSHAKE;
 
+            if (tls_io_instance->use_ktls != 0)
+            {
+                lend_socket_to_openssl(tls_io_instance);
+            }
+
             if (send_handshake_bytes(tls_io_instance) != 0)
             {
                 if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
@@ -665,7 +990,12 @@ static void on_underlying_io_error(void* context)
 {
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
 
-    switch (tls_io_instance->tlsio_state)
+    if (tls_io_instance->in_record_write)
+    {
+        /* the SSL object cannot be released under OpenSSL's feet, so the error waits for the next dowork */
+        tls_io_instance->underlying_io_error_pending = true;
+    }
+    else switch (tls_io_instance->tlsio_state)
     {
         default:
             break;
@@ -685,21 +1015,52 @@ static void on_underlying_io_error(void* context)
 static int decode_ssl_received_bytes(TLS_IO_INSTANCE* tls_io_instance)
 {
     int result = 0;
-    unsigned char buffer[64];
-
     int rcv_bytes = 1;
 
-    while (rcv_bytes > 0)
+    /* the size only changes here, never while a callback holds the buffer */
+    if (tls_io_instance->decrypt_buffer_allocated != tls_io_instance->decrypt_buffer_size)
     {
-        if (tls_io_instance->ssl == NULL)
+        unsigned char* new_buffer = (unsigned char*)malloc(tls_io_instance->decrypt_buffer_size);
+        if (new_buffer == NULL)
         {
-            LogError("SSL channel closed in decode_ssl_received_bytes.");
+            LogError("Failed allocating decrypt buffer.");
             result = __FAILURE__;
             return result;
         }
 
-        rcv_bytes = SSL_read(tls_io_instance->ssl, buffer, sizeof(buffer));
-        if (rcv_bytes > 0)
+        free(tls_io_instance->decrypt_buffer);
+        tls_io_instance->decrypt_buffer = new_buffer;
+        tls_io_instance->decrypt_buffer_allocated = tls_io_instance->decrypt_buffer_size;
+    }
+
+    int read_error = SSL_ERROR_NONE;
+
+    while (rcv_bytes > 0)
+    {
+        size_t decrypted = 0;
+
+        /* fill the buffer with as many records as are available before calling up */
+        do
+        {
+            if (tls_io_instance->ssl == NULL)
+            {
+                LogError("SSL channel closed in decode_ssl_received_bytes.");
+                result = __FAILURE__;
+                return result;
+            }
+
+            rcv_bytes = SSL_read(tls_io_instance->ssl, tls_io_instance->decrypt_buffer + decrypted, (int)(tls_io_instance->decrypt_buffer_allocated - decrypted));
+            if (rcv_bytes > 0)
+            {
+                decrypted += rcv_bytes;
+            }
+            else if (tls_io_instance->socket_lent)
+            {
+                read_error = SSL_get_error(tls_io_instance->ssl, rcv_bytes);
+            }
+        } while ((rcv_bytes > 0) && (decrypted < tls_io_instance->decrypt_buffer_allocated));
+
+        if (decrypted > 0)
         {
             if (tls_io_instance->on_bytes_received == NULL)
             {
@@ -707,11 +1068,20 @@ static int decode_ssl_received_bytes(TLS_IO_INSTANCE* tls_io_instance)
             }
             else
             {
-                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, buffer, rcv_bytes);
+                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, tls_io_instance->decrypt_buffer, decrypted);
             }
         }
     }
 
+    /* on a lent socket the end of the stream and read errors only show up here */
+    if ((read_error != SSL_ERROR_NONE) &&
+        (read_error != SSL_ERROR_WANT_READ) &&
+        (read_error != SSL_ERROR_WANT_WRITE))
+    {
+        LogError("The TLS connection was closed or failed, SSL error %d.", read_error);
+        result = __FAILURE__;
+    }
+
     return result;
 }
 
@@ -757,6 +1127,8 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
     }
 }
 
+static void release_ssl_context(SSL_CONTEXT_CACHE_ENTRY* entry);
+
 static void close_openssl_instance(TLS_IO_INSTANCE* tls_io_instance)
 {
     if (tls_io_instance != NULL)
@@ -766,21 +1138,24 @@ static void close_openssl_instance(TLS_IO_INSTANCE* tls_io_instance)
             SSL_free(tls_io_instance->ssl);
             tls_io_instance->ssl = NULL;
         }
-        if (tls_io_instance->ssl_context != NULL)
+        /* the socket goes back with the underlying io's close */
+        tls_io_instance->socket_lent = false;
+        if (tls_io_instance->ssl_context_entry != NULL)
         {
-            SSL_CTX_free(tls_io_instance->ssl_context);
+            release_ssl_context(tls_io_instance->ssl_context_entry);
+            tls_io_instance->ssl_context_entry = NULL;
             tls_io_instance->ssl_context = NULL;
         }
     }
 }
 
-static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char* certValue)
+static int add_certificate_to_store(SSL_CTX* ssl_context, const char* certValue)
 {
     int result = 0;
 
     if (certValue != NULL)
     {
-        X509_STORE* cert_store = SSL_CTX_get_cert_store(tls_io_instance->ssl_context);
+        X509_STORE* cert_store = SSL_CTX_get_cert_store(ssl_context);
         if (cert_store == NULL)
         {
             log_ERR_get_error("failure in SSL_CTX_get_cert_store.");
@@ -850,9 +1225,11 @@ static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char
     return result;
 }
 
-static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
+static int on_new_session(SSL* ssl, SSL_SESSION* session);
+
+static SSL_CTX* create_ssl_context(TLS_IO_INSTANCE* tlsInstance)
 {
-    int result;
+    SSL_CTX* result;
 
     const SSL_METHOD* method = TLSv1_method();
 
@@ -865,111 +1242,638 @@ static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
         method = TLSv1_1_method();
     }
 
-    tlsInstance->ssl_context = SSL_CTX_new(method);
-    if (tlsInstance->ssl_context == NULL)
+    result = SSL_CTX_new(method);
+    if (result == NULL)
     {
         log_ERR_get_error("Failed allocating OpenSSL context.");
-        result = __FAILURE__;
     }
-    else if (add_certificate_to_store(tlsInstance, tlsInstance->certificate) != 0)
+    else if (add_certificate_to_store(result, tlsInstance->certificate) != 0)
     {
-        SSL_CTX_free(tlsInstance->ssl_context);
-        tlsInstance->ssl_context = NULL;
+        SSL_CTX_free(result);
+        result = NULL;
         log_ERR_get_error("unable to add_certificate_to_store.");
-        result = __FAILURE__;
     }
     /*x509 authentication can only be build before underlying connection is realized*/
     else if(
             (tlsInstance->x509certificate != NULL) &&
             (tlsInstance->x509privatekey != NULL) &&
-            (x509_openssl_add_credentials(tlsInstance->ssl_context, tlsInstance->x509certificate, tlsInstance->x509privatekey) != 0)
+            (x509_openssl_add_credentials(result, tlsInstance->x509certificate, tlsInstance->x509privatekey) != 0)
         )
     {
-        SSL_CTX_free(tlsInstance->ssl_context);
-        tlsInstance->ssl_context = NULL;
+        SSL_CTX_free(result);
+        result = NULL;
         log_ERR_get_error("unable to use x509 authentication");
-        result = __FAILURE__;
     }
     else if (
         (tlsInstance->x509_ecc_cert != NULL) && 
         (tlsInstance->x509_ecc_aliaskey != NULL) && 
-        (x509_openssl_add_ecc_credentials(tlsInstance->ssl_context, tlsInstance->x509_ecc_cert, tlsInstance->x509_ecc_aliaskey) != 0)
+        (x509_openssl_add_ecc_credentials(result, tlsInstance->x509_ecc_cert, tlsInstance->x509_ecc_aliaskey) != 0)
         )
     {
-        SSL_CTX_free(tlsInstance->ssl_context);
-        tlsInstance->ssl_context = NULL;
+        SSL_CTX_free(result);
+        result = NULL;
         LogError("unable to use x509 authentication");
-        result = __FAILURE__;
     }
     else
     {
-        SSL_CTX_set_cert_verify_callback(tlsInstance->ssl_context, tlsInstance->tls_validation_callback, tlsInstance->tls_validation_callback_data);
+        SSL_CTX_set_cert_verify_callback(result, tlsInstance->tls_validation_callback, tlsInstance->tls_validation_callback_data);
+        SSL_CTX_set_verify(result, SSL_VERIFY_PEER, NULL);
+
+        /* sessions are kept per host:port by on_new_session, not in the context's own cache */
+        (void)SSL_CTX_set_session_cache_mode(result, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(result, on_new_session);
 
-        tlsInstance->in_bio = BIO_new(BIO_s_mem());
-        if (tlsInstance->in_bio == NULL)
+        // Specifies that the default locations for which CA certificates are loaded should be used.
+        if (SSL_CTX_set_default_verify_paths(result) != 1)
         {
-            SSL_CTX_free(tlsInstance->ssl_context);
-            tlsInstance->ssl_context = NULL;
-            log_ERR_get_error("Failed BIO_new for in BIO.");
-            result = __FAILURE__;
+            // This is only a warning to the user. They can still specify the certificate via SetOption.
+            LogInfo("WARNING: Unable to specify the default location for CA certificates on this platform.");
         }
-        else
-        {
-            tlsInstance->out_bio = BIO_new(BIO_s_mem());
-            if (tlsInstance->out_bio == NULL)
-            {
-                (void)BIO_free(tlsInstance->in_bio);
-                SSL_CTX_free(tlsInstance->ssl_context);
-                tlsInstance->ssl_context = NULL;
-                log_ERR_get_error("Failed BIO_new for out BIO.");
-                result = __FAILURE__;
-            }
-            else
-            {
-                if ((BIO_set_mem_eof_return(tlsInstance->in_bio, -1) <= 0) ||
-                    (BIO_set_mem_eof_return(tlsInstance->out_bio, -1) <= 0))
-                {
-                    (void)BIO_free(tlsInstance->in_bio);
-                    (void)BIO_free(tlsInstance->out_bio);
-                    SSL_CTX_free(tlsInstance->ssl_context);
-                    tlsInstance->ssl_context = NULL;
-                    LogError("Failed BIO_set_mem_eof_return.");
-                    result = __FAILURE__;
-                }
-                else
-                {
-                    SSL_CTX_set_verify(tlsInstance->ssl_context, SSL_VERIFY_PEER, NULL);
+    }
 
-                    // Specifies that the default locations for which CA certificates are loaded should be used.
-                    if (SSL_CTX_set_default_verify_paths(tlsInstance->ssl_context) != 1)
-                    {
-                        // This is only a warning to the user. They can still specify the certificate via SetOption.
-                        LogInfo("WARNING: Unable to specify the default location for CA certificates on this platform.");
-                    }
+    return result;
+}
 
-                    tlsInstance->ssl = SSL_new(tlsInstance->ssl_context);
-                    if (tlsInstance->ssl == NULL)
-                    {
-                        (void)BIO_free(tlsInstance->in_bio);
-                        (void)BIO_free(tlsInstance->out_bio);
-                        SSL_CTX_free(tlsInstance->ssl_context);
-                        tlsInstance->ssl_context = NULL;
-                        log_ERR_get_error("Failed creating OpenSSL instance.");
-                        result = __FAILURE__;
-                    }
-                    else
-                    {
-                        SSL_set_bio(tlsInstance->ssl, tlsInstance->in_bio, tlsInstance->out_bio);
-                        SSL_set_connect_state(tlsInstance->ssl);
-                        result = 0;
-                    }
-                }
+static bool are_options_equal(const char* left, const char* right)
+{
+    return (left == NULL) ? (right == NULL) : ((right != NULL) && (strcmp(left, right) == 0));
+}
+
+static int copy_option(char** destination, const char* source)
+{
+    int result;
+
+    if (source == NULL)
+    {
+        *destination = NULL;
+        result = 0;
+    }
+    else
+    {
+        result = mallocAndStrcpy_s(destination, source);
+    }
+
+    return result;
+}
+
+static void free_ssl_context_entry(SSL_CONTEXT_CACHE_ENTRY* entry)
+{
+    if (entry->ssl_context != NULL)
+    {
+        SSL_CTX_free(entry->ssl_context);
+    }
+
+    free(entry->certificate);
+    free(entry->x509certificate);
+    free(entry->x509privatekey);
+    free(entry->x509_ecc_cert);
+    free(entry->x509_ecc_aliaskey);
+    free(entry);
+}
+
+/* call with ssl_context_cache_lock held when the entry is cached */
+static void drop_ssl_context_reference(SSL_CONTEXT_CACHE_ENTRY* entry)
+{
+    entry->ref_count--;
+    if (entry->ref_count == 0)
+    {
+        if (entry->is_cached)
+        {
+            SSL_CONTEXT_CACHE_ENTRY** current = &ssl_context_cache;
+            while ((*current != NULL) && (*current != entry))
+            {
+                current = &(*current)->next;
+            }
+
+            if (*current != NULL)
+            {
+                *current = entry->next;
+            }
+        }
+
+        free_ssl_context_entry(entry);
+    }
+}
+
+/* call with ssl_context_cache_lock held */
+static void free_tls_session_entry(TLS_SESSION_CACHE_ENTRY* entry)
+{
+    SSL_SESSION_free(entry->session);
+    drop_ssl_context_reference(entry->ssl_context_entry);
+    free(entry->hostname);
+    free(entry);
+}
+
+static SSL_CONTEXT_CACHE_ENTRY* find_ssl_context(TLS_IO_INSTANCE* tlsInstance)
+{
+    SSL_CONTEXT_CACHE_ENTRY* entry = ssl_context_cache;
+
+    while ((entry != NULL) &&
+        ((entry->tls_version != tlsInstance->tls_version) ||
+        (entry->tls_validation_callback != tlsInstance->tls_validation_callback) ||
+        (entry->tls_validation_callback_data != tlsInstance->tls_validation_callback_data) ||
+        !are_options_equal(entry->certificate, tlsInstance->certificate) ||
+        !are_options_equal(entry->x509certificate, tlsInstance->x509certificate) ||
+        !are_options_equal(entry->x509privatekey, tlsInstance->x509privatekey) ||
+        !are_options_equal(entry->x509_ecc_cert, tlsInstance->x509_ecc_cert) ||
+        !are_options_equal(entry->x509_ecc_aliaskey, tlsInstance->x509_ecc_aliaskey)))
+    {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+/* returns a referenced context built from the instance's options, shared with every instance opened with the same ones */
+static SSL_CONTEXT_CACHE_ENTRY* acquire_ssl_context(TLS_IO_INSTANCE* tlsInstance)
+{
+    SSL_CONTEXT_CACHE_ENTRY* result;
+    bool is_locked = (ssl_context_cache_lock != NULL) && (Lock(ssl_context_cache_lock) == LOCK_OK);
+
+    if (is_locked && ((result = find_ssl_context(tlsInstance)) != NULL))
+    {
+        result->ref_count++;
+    }
+    else if ((result = (SSL_CONTEXT_CACHE_ENTRY*)malloc(sizeof(SSL_CONTEXT_CACHE_ENTRY))) == NULL)
+    {
+        LogError("Failed allocating SSL context cache entry.");
+    }
+    else
+    {
+        result->ref_count = 1;
+        result->is_cached = false;
+        result->tls_version = tlsInstance->tls_version;
+        result->tls_validation_callback = tlsInstance->tls_validation_callback;
+        result->tls_validation_callback_data = tlsInstance->tls_validation_callback_data;
+        result->next = NULL;
+        result->x509certificate = NULL;
+        result->x509privatekey = NULL;
+        result->x509_ecc_cert = NULL;
+        result->x509_ecc_aliaskey = NULL;
+
+        if ((copy_option(&result->certificate, tlsInstance->certificate) != 0) ||
+            (copy_option(&result->x509certificate, tlsInstance->x509certificate) != 0) ||
+            (copy_option(&result->x509privatekey, tlsInstance->x509privatekey) != 0) ||
+            (copy_option(&result->x509_ecc_cert, tlsInstance->x509_ecc_cert) != 0) ||
+            (copy_option(&result->x509_ecc_aliaskey, tlsInstance->x509_ecc_aliaskey) != 0))
+        {
+            LogError("Failed copying SSL context options.");
+            result->ssl_context = NULL;
+            free_ssl_context_entry(result);
+            result = NULL;
+        }
+        else if ((result->ssl_context = create_ssl_context(tlsInstance)) == NULL)
+        {
+            free_ssl_context_entry(result);
+            result = NULL;
+        }
+        else if (is_locked)
+        {
+            result->is_cached = true;
+            result->next = ssl_context_cache;
+            ssl_context_cache = result;
+        }
+    }
+
+    if (is_locked)
+    {
+        (void)Unlock(ssl_context_cache_lock);
+    }
+
+    return result;
+}
+
+static void release_ssl_context(SSL_CONTEXT_CACHE_ENTRY* entry)
+{
+    bool is_locked = entry->is_cached && (Lock(ssl_context_cache_lock) == LOCK_OK);
+
+    /* a context with cached sessions is only freed once the last of them is evicted */
+    drop_ssl_context_reference(entry);
+
+    if (is_locked)
+    {
+        (void)Unlock(ssl_context_cache_lock);
+    }
+}
+
+/* call with ssl_context_cache_lock held */
+static TLS_SESSION_CACHE_ENTRY** find_tls_session(TLS_IO_INSTANCE* tlsInstance)
+{
+    TLS_SESSION_CACHE_ENTRY** current = &tls_session_cache;
+
+    while ((*current != NULL) &&
+        (((*current)->ssl_context_entry != tlsInstance->ssl_context_entry) ||
+        (strcmp((*current)->hostname, tlsInstance->hostname) != 0) ||
+        ((*current)->port != tlsInstance->port)))
+    {
+        current = &(*current)->next;
+    }
+
+    return current;
+}
+
+static int on_new_session(SSL* ssl, SSL_SESSION* session)
+{
+    int result = 0;
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)SSL_get_app_data(ssl);
+
+    if ((tls_io_instance != NULL) &&
+        (tls_io_instance->session_resumption != 0) &&
+        (tls_io_instance->hostname != NULL) &&
+        (tls_io_instance->ssl_context_entry != NULL) &&
+        (ssl_context_cache_lock != NULL) &&
+        (Lock(ssl_context_cache_lock) == LOCK_OK))
+    {
+        TLS_SESSION_CACHE_ENTRY** existing = find_tls_session(tls_io_instance);
+        TLS_SESSION_CACHE_ENTRY* entry = *existing;
+
+        if (!tls_io_instance->ssl_context_entry->is_cached)
+        {
+            /* sessions of a private context would outlive it, they are dropped with the shared contexts only */
+            entry = NULL;
+        }
+        else if (entry != NULL)
+        {
+            /* a newer ticket or session replaces the old one */
+            *existing = entry->next;
+            SSL_SESSION_free(entry->session);
+        }
+        else if ((entry = (TLS_SESSION_CACHE_ENTRY*)malloc(sizeof(TLS_SESSION_CACHE_ENTRY))) == NULL)
+        {
+            LogError("Failed allocating TLS session cache entry.");
+        }
+        else
+        {
+            entry->ssl_context_entry = tls_io_instance->ssl_context_entry;
+            entry->port = tls_io_instance->port;
+            if (mallocAndStrcpy_s(&entry->hostname, tls_io_instance->hostname) != 0)
+            {
+                LogError("Failed copying TLS session cache key.");
+                free(entry);
+                entry = NULL;
+            }
+            else
+            {
+                /* released when the session is evicted */
+                entry->ssl_context_entry->ref_count++;
+            }
+        }
+
+        if (entry != NULL)
+        {
+            size_t count = 1;
+            TLS_SESSION_CACHE_ENTRY* last = entry;
+
+            /* returning 1 hands the session reference over to the cache */
+            entry->session = session;
+            entry->next = tls_session_cache;
+            tls_session_cache = entry;
+            result = 1;
+
+            /* last ends on the newest TLSIO_SESSION_CACHE_MAX_ENTRIES-th entry, everything after it is dropped */
+            while ((last->next != NULL) && (count < TLSIO_SESSION_CACHE_MAX_ENTRIES))
+            {
+                last = last->next;
+                count++;
+            }
+
+            while (last->next != NULL)
+            {
+                TLS_SESSION_CACHE_ENTRY* evicted = last->next;
+                last->next = evicted->next;
+                free_tls_session_entry(evicted);
+            }
+        }
+
+        (void)Unlock(ssl_context_cache_lock);
+    }
+
+    return result;
+}
+
+static void resume_tls_session(TLS_IO_INSTANCE* tlsInstance)
+{
+    if ((tlsInstance->session_resumption != 0) &&
+        (tlsInstance->hostname != NULL) &&
+        (ssl_context_cache_lock != NULL) &&
+        (Lock(ssl_context_cache_lock) == LOCK_OK))
+    {
+        TLS_SESSION_CACHE_ENTRY* entry = *find_tls_session(tlsInstance);
+        if ((entry != NULL) && (SSL_set_session(tlsInstance->ssl, entry->session) != 1))
+        {
+            /* not fatal, the handshake is simply a full one */
+            log_ERR_get_error("Failed setting the cached TLS session.");
+        }
+
+        (void)Unlock(ssl_context_cache_lock);
+    }
+}
+
+/* in_bio is filled from the underlying io's on_bytes_received, out_bio hands records to xio_send */
+static int attach_memory_bios(TLS_IO_INSTANCE* tlsInstance)
+{
+    int result;
+    BIO* in_bio = BIO_new(BIO_s_mem());
+
+    if (in_bio == NULL)
+    {
+        log_ERR_get_error("Failed BIO_new for in BIO.");
+        result = __FAILURE__;
+    }
+    else
+    {
+        BIO* out_bio = (tlsio_bio_method == NULL) ? NULL : BIO_new(tlsio_bio_method);
+        if (out_bio == NULL)
+        {
+            (void)BIO_free(in_bio);
+            log_ERR_get_error("Failed BIO_new for out BIO.");
+            result = __FAILURE__;
+        }
+        else if (BIO_set_mem_eof_return(in_bio, -1) <= 0)
+        {
+            (void)BIO_free(in_bio);
+            (void)BIO_free(out_bio);
+            LogError("Failed BIO_set_mem_eof_return.");
+            result = __FAILURE__;
+        }
+        else
+        {
+            BIO_set_data(out_bio, tlsInstance);
+
+            /* the BIOs set before, if any, are freed by OpenSSL */
+            SSL_set_bio(tlsInstance->ssl, in_bio, out_bio);
+            tlsInstance->in_bio = in_bio;
+            tlsInstance->out_bio = out_bio;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
+{
+    int result;
+
+    tlsInstance->ssl_context_entry = acquire_ssl_context(tlsInstance);
+    if (tlsInstance->ssl_context_entry == NULL)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        tlsInstance->ssl_context = tlsInstance->ssl_context_entry->ssl_context;
+
+        tlsInstance->ssl = SSL_new(tlsInstance->ssl_context);
+        if (tlsInstance->ssl == NULL)
+        {
+            release_ssl_context(tlsInstance->ssl_context_entry);
+            tlsInstance->ssl_context_entry = NULL;
+            tlsInstance->ssl_context = NULL;
+            log_ERR_get_error("Failed creating OpenSSL instance.");
+            result = __FAILURE__;
+        }
+        else if (attach_memory_bios(tlsInstance) != 0)
+        {
+            SSL_free(tlsInstance->ssl);
+            tlsInstance->ssl = NULL;
+            release_ssl_context(tlsInstance->ssl_context_entry);
+            tlsInstance->ssl_context_entry = NULL;
+            tlsInstance->ssl_context = NULL;
+            result = __FAILURE__;
+        }
+        else
+        {
+            SSL_set_connect_state(tlsInstance->ssl);
+            (void)SSL_set_app_data(tlsInstance->ssl, tlsInstance);
+            resume_tls_session(tlsInstance);
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static void lend_socket_to_openssl(TLS_IO_INSTANCE* tls_io_instance)
+{
+#ifdef TLSIO_OPENSSL_KTLS
+    int lent_socket = -1;
+
+    /* only socketio lends its socket, over anything else the memory BIOs are kept */
+    CONCRETE_IO_HANDLE socket_io = xio_get_concrete_handle(tls_io_instance->underlying_io, socketio_get_interface_description());
+    if ((socket_io == NULL) || (socketio_lend_socket(socket_io, &lent_socket) != 0))
+    {
+        LogInfo("The underlying io cannot lend its socket, kTLS is not used.");
+    }
+    else
+    {
+        BIO* socket_bio = BIO_new_socket(lent_socket, BIO_NOCLOSE);
+        if (socket_bio == NULL)
+        {
+            log_ERR_get_error("Failed BIO_new_socket, kTLS is not used.");
+            (void)socketio_reclaim_socket(socket_io);
+        }
+        else
+        {
+            /* the kernel takes over the record layer when the handshake installs the traffic keys */
+            (void)SSL_set_options(tls_io_instance->ssl, SSL_OP_ENABLE_KTLS);
+            (void)SSL_set_mode(tls_io_instance->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+            SSL_set_bio(tls_io_instance->ssl, socket_bio, socket_bio);
+            tls_io_instance->in_bio = NULL;
+            tls_io_instance->out_bio = NULL;
+            tls_io_instance->socket_lent = true;
+        }
+    }
+#else
+    (void)tls_io_instance;
+    LogInfo("OpenSSL was built without kTLS support, kTLS is not used.");
+#endif
+}
+
+/* keeps the socket with OpenSSL only if the kernel took over sending, otherwise returns to the memory BIOs */
+static int finish_ktls_handshake(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+
+    if (!tls_io_instance->socket_lent)
+    {
+        result = 0;
+    }
+#ifdef TLSIO_OPENSSL_KTLS
+    else if (BIO_get_ktls_send(SSL_get_wbio(tls_io_instance->ssl)))
+    {
+        LogInfo("kTLS offload enabled for sending%s.", BIO_get_ktls_recv(SSL_get_rbio(tls_io_instance->ssl)) ? " and receiving" : "");
+        result = 0;
+    }
+#endif
+    else
+    {
+        LogInfo("kTLS is not available for this connection, using the memory BIOs.");
+        (void)SSL_clear_mode(tls_io_instance->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+        if (attach_memory_bios(tls_io_instance) != 0)
+        {
+            result = __FAILURE__;
+        }
+        /* the socket was lent, so the underlying io is socketio */
+        else if (socketio_reclaim_socket(xio_get_concrete_handle(tls_io_instance->underlying_io, socketio_get_interface_description())) != 0)
+        {
+            LogError("Failed reclaiming the socket.");
+            result = __FAILURE__;
+        }
+        else
+        {
+            tls_io_instance->socket_lent = false;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+/* SSL_write on the lent socket until it is full; *written tells how much went out */
+static int write_to_lent_socket(TLS_IO_INSTANCE* tls_io_instance, const unsigned char* buffer, size_t size, size_t* written)
+{
+    int result = 0;
+
+    *written = 0;
+    while ((result == 0) && (*written < size))
+    {
+        size_t to_write = size - *written;
+        int res = SSL_write(tls_io_instance->ssl, buffer + *written, (to_write > INT_MAX) ? INT_MAX : (int)to_write);
+        if (res > 0)
+        {
+            *written += (size_t)res;
+        }
+        else
+        {
+            int error = SSL_get_error(tls_io_instance->ssl, res);
+            if ((error == SSL_ERROR_WANT_WRITE) || (error == SSL_ERROR_WANT_READ))
+            {
+                /* the socket is full, the rest is written by dowork */
+                break;
             }
+
+            log_ERR_get_error("SSL_write error.");
+            result = __FAILURE__;
+        }
+    }
+
+    return result;
+}
+
+static int send_over_lent_socket(TLS_IO_INSTANCE* tls_io_instance, const unsigned char* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+    size_t written = 0;
+
+    /* bytes queued earlier go first */
+    if ((singlylinkedlist_get_head_item(tls_io_instance->pending_sends) == NULL) &&
+        (write_to_lent_socket(tls_io_instance, buffer, size, &written) != 0))
+    {
+        result = __FAILURE__;
+    }
+    else if (written == size)
+    {
+        if (on_send_complete != NULL)
+        {
+            on_send_complete(callback_context, IO_SEND_OK);
+        }
+
+        result = 0;
+    }
+    else
+    {
+        PENDING_TLS_SEND* pending_send = create_pending_send(tls_io_instance, on_send_complete, callback_context);
+        if (pending_send == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else if ((pending_send->bytes = (unsigned char*)malloc(size - written)) == NULL)
+        {
+            LogError("Failed allocating the bytes to send.");
+            pending_send->on_send_complete = NULL;
+            complete_pending_send(pending_send);
+            result = __FAILURE__;
+        }
+        else
+        {
+            (void)memcpy(pending_send->bytes, buffer + written, size - written);
+            pending_send->size = size - written;
+            result = 0;
         }
     }
+
     return result;
 }
 
+static int send_pending_writes(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result = 0;
+    LIST_ITEM_HANDLE first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+
+    while (first_pending_send != NULL)
+    {
+        PENDING_TLS_SEND* pending_send = (PENDING_TLS_SEND*)singlylinkedlist_item_get_value(first_pending_send);
+        size_t written;
+
+        if (write_to_lent_socket(tls_io_instance, pending_send->bytes + pending_send->consumed, pending_send->size - pending_send->consumed, &written) != 0)
+        {
+            result = __FAILURE__;
+            break;
+        }
+
+        pending_send->consumed += written;
+        if (pending_send->consumed < pending_send->size)
+        {
+            break;
+        }
+
+        complete_pending_send(pending_send);
+        first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+    }
+
+    return result;
+}
+
+static void cancel_pending_writes(TLS_IO_INSTANCE* tls_io_instance)
+{
+    LIST_ITEM_HANDLE first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+
+    while (first_pending_send != NULL)
+    {
+        PENDING_TLS_SEND* pending_send = (PENDING_TLS_SEND*)singlylinkedlist_item_get_value(first_pending_send);
+        pending_send->send_result = IO_SEND_CANCELLED;
+        complete_pending_send(pending_send);
+        first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+    }
+}
+
+/* socketio does not touch a lent socket, so the handshake, the reads and the queued writes are driven from here */
+static void dowork_lent_socket(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if (tls_io_instance->tlsio_state == TLSIO_STATE_IN_HANDSHAKE)
+    {
+        if (send_handshake_bytes(tls_io_instance) != 0)
+        {
+            if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+            {
+                tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
+                indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+                LogError("Error in xio_close.");
+            }
+        }
+    }
+    else if (tls_io_instance->tlsio_state == TLSIO_STATE_OPEN)
+    {
+        if ((send_pending_writes(tls_io_instance) != 0) ||
+            (decode_ssl_received_bytes(tls_io_instance) != 0))
+        {
+            tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
+            indicate_error(tls_io_instance);
+        }
+    }
+}
+
 int tlsio_openssl_init(void)
 {
     (void)SSL_library_init();
@@ -985,11 +1889,54 @@ int tlsio_openssl_init(void)
     }
 
     openssl_dynamic_locks_install();
+
+    if (create_bio_method() != 0)
+    {
+        LogError("Failed to create the tlsio BIO method.");
+        return __FAILURE__;
+    }
+
+    if (ssl_context_cache_lock == NULL)
+    {
+        /* instances still work without the cache, they simply do not share contexts */
+        ssl_context_cache_lock = Lock_Init();
+        if (ssl_context_cache_lock == NULL)
+        {
+            LogError("Failed to create the SSL context cache lock.");
+        }
+    }
+
     return 0;
 }
 
 void tlsio_openssl_deinit(void)
 {
+    /* contexts still referenced by open instances are unlinked and freed by their last instance, the others go with the sessions referencing them */
+    if (ssl_context_cache_lock != NULL)
+    {
+        if (Lock(ssl_context_cache_lock) == LOCK_OK)
+        {
+            while (ssl_context_cache != NULL)
+            {
+                ssl_context_cache->is_cached = false;
+                ssl_context_cache = ssl_context_cache->next;
+            }
+
+            while (tls_session_cache != NULL)
+            {
+                TLS_SESSION_CACHE_ENTRY* next = tls_session_cache->next;
+                free_tls_session_entry(tls_session_cache);
+                tls_session_cache = next;
+            }
+
+            (void)Unlock(ssl_context_cache_lock);
+        }
+
+        Lock_Deinit(ssl_context_cache_lock);
+        ssl_context_cache_lock = NULL;
+    }
+
+    destroy_bio_method();
     openssl_dynamic_locks_uninstall();
     openssl_static_locks_uninstall();
 #if (OPENSSL_VERSION_NUMBER >= 0x00907000L) && (OPENSSL_VERSION_NUMBER < 0x20000000L)
@@ -1068,6 +2015,7 @@ CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters)
                 result->on_io_error_context = NULL;
                 result->ssl = NULL;
                 result->ssl_context = NULL;
+                result->ssl_context_entry = NULL;
                 result->tls_validation_callback = NULL;
                 result->tls_validation_callback_data = NULL;
                 result->x509certificate = NULL;
@@ -1076,10 +2024,36 @@ CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters)
                 result->x509_ecc_aliaskey = NULL;
 
                 result->tls_version = 0;
-
-                result->underlying_io = xio_create(underlying_io_interface, io_interface_parameters);
-                if (result->underlying_io == NULL)
+                result->decrypt_buffer = NULL;
+                result->decrypt_buffer_allocated = 0;
+                result->decrypt_buffer_size = TLSIO_DECRYPT_BUFFER_SIZE;
+                result->hostname = NULL;
+                result->port = tls_io_config->port;
+                result->session_resumption = 0;
+                result->current_send = NULL;
+                result->in_record_write = false;
+                result->underlying_io_error_pending = false;
+                result->use_ktls = 0;
+                result->socket_lent = false;
+
+                if ((tls_io_config->hostname != NULL) &&
+                    (mallocAndStrcpy_s(&result->hostname, tls_io_config->hostname) != 0))
+                {
+                    free(result);
+                    result = NULL;
+                    LogError("Failed copying hostname.");
+                }
+                else if ((result->pending_sends = singlylinkedlist_create()) == NULL)
+                {
+                    free(result->hostname);
+                    free(result);
+                    result = NULL;
+                    LogError("Failed creating the pending send list.");
+                }
+                else if ((result->underlying_io = xio_create(underlying_io_interface, io_interface_parameters)) == NULL)
                 {
+                    singlylinkedlist_destroy(result->pending_sends);
+                    free(result->hostname);
                     free(result);
                     result = NULL;
                     LogError("Failed xio_create.");
@@ -1113,12 +2087,27 @@ void tlsio_openssl_destroy(CONCRETE_IO_HANDLE tls_io)
         free((void*)tls_io_instance->x509privatekey);
         free((void*)tls_io_instance->x509_ecc_cert);
         free((void*)tls_io_instance->x509_ecc_aliaskey);
+        free(tls_io_instance->decrypt_buffer);
+        free(tls_io_instance->hostname);
         close_openssl_instance(tls_io_instance);
         if (tls_io_instance->underlying_io != NULL)
         {
             xio_destroy(tls_io_instance->underlying_io);
             tls_io_instance->underlying_io = NULL;
         }
+
+        /* sends whose records were dropped with the underlying io */
+        LIST_ITEM_HANDLE first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+        while (first_pending_send != NULL)
+        {
+            PENDING_TLS_SEND* pending_send = (PENDING_TLS_SEND*)singlylinkedlist_item_get_value(first_pending_send);
+            free(pending_send->bytes);
+            free(pending_send);
+            (void)singlylinkedlist_remove(tls_io_instance->pending_sends, first_pending_send);
+            first_pending_send = singlylinkedlist_get_head_item(tls_io_instance->pending_sends);
+        }
+        singlylinkedlist_destroy(tls_io_instance->pending_sends);
+
         free(tls_io);
     }
 }
@@ -1198,6 +2187,19 @@ int tlsio_openssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_cl
         }
         else
         {
+            if ((tls_io_instance->tlsio_state == TLSIO_STATE_OPEN) &&
+                (tls_io_instance->ssl != NULL))
+            {
+                /* a session that was not shut down is marked as not resumable by OpenSSL, so send close_notify on a clean close */
+                (void)SSL_shutdown(tls_io_instance->ssl);
+            }
+
+            if (tls_io_instance->socket_lent)
+            {
+                /* nothing is left to write them once the socket is closed */
+                cancel_pending_writes(tls_io_instance);
+            }
+
             tls_io_instance->tlsio_state = TLSIO_STATE_CLOSING;
             tls_io_instance->on_io_close_complete = on_io_close_complete;
             tls_io_instance->on_io_close_complete_context = callback_context;
@@ -1246,21 +2248,42 @@ int tlsio_openssl_send(CONCRETE_IO_HANDLE tls_io, const void* buffer, size_t siz
                 return result;
             }
 
-            int res = SSL_write(tls_io_instance->ssl, buffer, (int)size);
-            if (res != (int)size)
+            PENDING_TLS_SEND* pending_send = NULL;
+
+            if (tls_io_instance->socket_lent)
             {
-                log_ERR_get_error("SSL_write error.");
+                result = send_over_lent_socket(tls_io_instance, (const unsigned char*)buffer, size, on_send_complete, callback_context);
+            }
+            else if ((on_send_complete != NULL) &&
+                ((pending_send = create_pending_send(tls_io_instance, on_send_complete, callback_context)) == NULL))
+            {
+                LogError("Failed allocating pending send.");
                 result = __FAILURE__;
             }
             else
             {
-                if (write_outgoing_bytes(tls_io_instance, on_send_complete, callback_context) != 0)
+                /* SSL_write hands every record to the underlying io through out_bio before it returns */
+                tls_io_instance->current_send = pending_send;
+                int res = SSL_write(tls_io_instance->ssl, buffer, (int)size);
+                tls_io_instance->current_send = NULL;
+
+                if (res != (int)size)
                 {
-                    LogError("Error in write_outgoing_bytes.");
+                    log_ERR_get_error("SSL_write error.");
+                    if (pending_send != NULL)
+                    {
+                        /* the failure is reported by the return value, records already queued complete silently */
+                        pending_send->on_send_complete = NULL;
+                        finish_pending_send(pending_send);
+                    }
                     result = __FAILURE__;
                 }
                 else
                 {
+                    if (pending_send != NULL)
+                    {
+                        finish_pending_send(pending_send);
+                    }
                     result = 0;
                 }
             }
@@ -1280,12 +2303,16 @@ void tlsio_openssl_dowork(CONCRETE_IO_HANDLE tls_io)
     {
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
 
-        if ((tls_io_instance->tlsio_state != TLSIO_STATE_CLOSING) &&
-            (tls_io_instance->tlsio_state != TLSIO_STATE_NOT_OPEN) &&
-            (tls_io_instance->tlsio_state != TLSIO_STATE_ERROR))
+        if (tls_io_instance->underlying_io_error_pending)
+        {
+            /* raised while OpenSSL was writing a record, reported here where it is safe to close the instance */
+            tls_io_instance->underlying_io_error_pending = false;
+            on_underlying_io_error(tls_io_instance);
+        }
+
+        if (tls_io_instance->socket_lent)
         {
-            /* this is needed in order to pump out bytes produces by OpenSSL for things like renegotiation */
-            write_outgoing_bytes(tls_io_instance, NULL, NULL);
+            dowork_lent_socket(tls_io_instance);
         }
 
         /* Same behavior as schannel */
@@ -1305,7 +2332,16 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
     {
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
 
-        if (strcmp("TrustedCerts", optionName) == 0)
+        if (((strcmp("TrustedCerts", optionName) == 0) ||
+            (strcmp("tls_validation_callback", optionName) == 0) ||
+            (strcmp("tls_validation_callback_data", optionName) == 0)) &&
+            (tls_io_instance->ssl_context_entry != NULL))
+        {
+            /* the SSL_CTX of the connection may be shared with other instances, so the change could only reach the next open */
+            LogError("%s cannot be set while the tlsio is open", optionName);
+            result = __FAILURE__;
+        }
+        else if (strcmp("TrustedCerts", optionName) == 0)
         {
             const char* cert = (const char*)value;
 
@@ -1327,12 +2363,6 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
                 strcpy(tls_io_instance->certificate, cert);
                 result = 0;
             }
-
-            // If we're previously connected then add the cert to the context
-            if (tls_io_instance->ssl_context != NULL)
-            {
-                result = add_certificate_to_store(tls_io_instance, cert);
-            }
         }
         else if (strcmp(SU_OPTION_X509_CERT, optionName) == 0)
         {
@@ -1434,23 +2464,11 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
             #pragma warning(disable:4055)
             tls_io_instance->tls_validation_callback = (TLS_CERTIFICATE_VALIDATION_CALLBACK)value;
             #pragma warning(pop)
-
-            if (tls_io_instance->ssl_context != NULL)
-            {
-                SSL_CTX_set_cert_verify_callback(tls_io_instance->ssl_context, tls_io_instance->tls_validation_callback, tls_io_instance->tls_validation_callback_data);
-            }
-
             result = 0;
         }
         else if (strcmp("tls_validation_callback_data", optionName) == 0)
         {
             tls_io_instance->tls_validation_callback_data = (void*)value;
-
-            if (tls_io_instance->ssl_context != NULL)
-            {
-                SSL_CTX_set_cert_verify_callback(tls_io_instance->ssl_context, tls_io_instance->tls_validation_callback, tls_io_instance->tls_validation_callback_data);
-            }
-
             result = 0;
         }
         else if (strcmp("tls_version", optionName) == 0)
@@ -1458,6 +2476,33 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
             tls_io_instance->tls_version = (int)(intptr_t)value;
             result = 0;
         }
+        else if (strcmp(OPTION_TLS_SESSION_RESUMPTION, optionName) == 0)
+        {
+            /* used by the next open */
+            tls_io_instance->session_resumption = *(const int*)value;
+            result = 0;
+        }
+        else if (strcmp(OPTION_TLS_KTLS, optionName) == 0)
+        {
+            /* used by the next open, which falls back to the memory BIOs when kTLS cannot be set up */
+            tls_io_instance->use_ktls = *(const int*)value;
+            result = 0;
+        }
+        else if (strcmp(OPTION_TLS_DECRYPT_BUFFER_SIZE, optionName) == 0)
+        {
+            size_t decrypt_buffer_size = *(const size_t*)value;
+            if ((decrypt_buffer_size == 0) || (decrypt_buffer_size > INT_MAX))
+            {
+                LogError("invalid tls_decrypt_buffer_size %lu", (unsigned long)decrypt_buffer_size);
+                result = __FAILURE__;
+            }
+            else
+            {
+                /* applied by the next decode */
+                tls_io_instance->decrypt_buffer_size = decrypt_buffer_size;
+                result = 0;
+            }
+        }
         else
         {
             if (tls_io_instance->underlying_io == NULL)
@@ -23,9 +23,29 @@
 #include "azure_c_shared_utility/gb_rand.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/optionhandler.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+#include "azure_c_shared_utility/uws_deflate.h"
+#include "azure_c_shared_utility/http_response_parser.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 static const char* UWS_CLIENT_OPTIONS = "uWSClientOptions";
 
+/* Frames with a larger payload are masked into a chunk buffer and sent a chunk at a time instead of
+being copied whole into an encoded frame buffer. It matches the largest TLS record. */
+#define UWS_CLIENT_SEND_CHUNK_SIZE 16384
+
+/* Defaults for the permessage-deflate parameters, the largest window and the zlib default memory level */
+#define UWS_CLIENT_DEFAULT_DEFLATE_WINDOW_BITS 15
+#define UWS_CLIENT_DEFAULT_DEFLATE_MEM_LEVEL 8
+/* Bounds the memory a peer can make one connection spend on a decompressed message */
+#define UWS_CLIENT_DEFAULT_DEFLATE_MAX_MESSAGE_SIZE (4 * 1024 * 1024)
+/* A decompressed message buffer grown beyond this size is released once its message has been indicated */
+#define UWS_CLIENT_RETAINED_INFLATED_MESSAGE_SIZE 65536
+
+/* Number of completed pending send structures (and pending send list nodes) kept for reuse, so that
+steady state sending does not allocate bookkeeping memory for each frame */
+#define UWS_CLIENT_PENDING_SEND_CACHE_SIZE 16
+
 /* Requirements not needed as they are optional:
 Codes_SRS_UWS_CLIENT_01_254: [ If an endpoint receives a Ping frame and has not yet sent Pong frame(s) in response to previous Ping frame(s), the endpoint MAY elect to send a Pong frame for only the most recently processed Ping frame. ]
 Codes_SRS_UWS_CLIENT_01_255: [ A Pong frame MAY be sent unsolicited. ]
@@ -73,6 +93,8 @@ typedef struct WS_PENDING_SEND_TAG
     ON_WS_SEND_FRAME_COMPLETE on_ws_send_frame_complete;
     void* context;
     UWS_CLIENT_HANDLE uws_client;
+    size_t coalesced_frame_count;
+    struct WS_PENDING_SEND_TAG* next_cached;
 } WS_PENDING_SEND;
 
 typedef struct UWS_CLIENT_INSTANCE_TAG
@@ -95,9 +117,47 @@ typedef struct UWS_CLIENT_INSTANCE_TAG
     void* on_ws_error_context;
     ON_WS_CLOSE_COMPLETE on_ws_close_complete;
     void* on_ws_close_complete_context;
+    unsigned char* received_bytes_buffer;
+    size_t received_bytes_buffer_size;
     unsigned char* received_bytes;
     size_t received_bytes_count;
+    HTTP_RESPONSE_PARSER upgrade_response_parser;
     UWS_FRAME_DECODER_STATE frame_decoder_state;
+    unsigned char* send_chunk;
+    bool is_sending_chunks;
+    bool is_sending_fragmented_message;
+    ON_WS_FRAGMENT_RECEIVED on_ws_fragment_received;
+    void* on_ws_fragment_received_context;
+    bool is_receiving_fragmented_message;
+    unsigned char fragment_message_type;
+    bool is_fragment_final_frame;
+    size_t fragment_payload_bytes_left;
+    bool is_deflate_enabled;
+    UWS_DEFLATE_CONFIG deflate_config;
+    bool compress_messages;
+    UWS_DEFLATE_HANDLE uws_deflate;
+    bool is_sending_compressed_message;
+    bool is_receiving_compressed_message;
+    unsigned char* inflated_message;
+    size_t inflated_message_size;
+    size_t inflated_message_length;
+    bool is_inflated_message_truncated;
+    WS_PENDING_SEND* cached_pending_sends;
+    size_t cached_pending_send_count;
+    size_t send_coalescing_size;
+    unsigned char* coalesce_buffer;
+    size_t coalesce_buffer_length;
+    size_t coalesced_frame_count;
+    LIST_ITEM_HANDLE coalesced_first_item;
+    size_t pending_sends_drain_count;
+    TICK_COUNTER_HANDLE tick_counter;
+    size_t ping_interval_ms;
+    size_t pong_timeout_ms;
+    bool is_keepalive_started;
+    tickcounter_ms_t last_ping_time;
+    bool is_waiting_for_pong;
+    tickcounter_ms_t unanswered_ping_time;
+    unsigned char ping_frame[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
 } UWS_CLIENT_INSTANCE;
 
 /* Codes_SRS_UWS_CLIENT_01_360: [ Connection confidentiality and integrity is provided by running the WebSocket Protocol over TLS (wss URIs). ]*/
@@ -165,11 +225,12 @@ UWS_CLIENT_HANDLE uws_client_create(const char* hostname, unsigned int port, con
                     }
                     else
                     {
-                        /* Codes_SRS_UWS_CLIENT_01_017: [ `uws_client_create` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create`. ]*/
-                        result->pending_sends = singlylinkedlist_create();
+                        /* Codes_SRS_UWS_CLIENT_01_017: [ `uws_client_create` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create_with_item_cache`. ]*/
+                        /* Codes_SRS_UWS_CLIENT_01_564: [ The pending send IO list shall keep up to 16 removed list nodes for reuse. ]*/
+                        result->pending_sends = singlylinkedlist_create_with_item_cache(UWS_CLIENT_PENDING_SEND_CACHE_SIZE);
                         if (result->pending_sends == NULL)
                         {
-                            /* Codes_SRS_UWS_CLIENT_01_018: [ If `singlylinkedlist_create` fails then `uws_client_create` shall fail and return NULL. ]*/
+                            /* Codes_SRS_UWS_CLIENT_01_018: [ If `singlylinkedlist_create_with_item_cache` fails then `uws_client_create` shall fail and return NULL. ]*/
                             LogError("Could not allocate pending send frames list");
                             free(result->resource_name);
                             free(result->hostname);
@@ -265,8 +326,47 @@ UWS_CLIENT_HANDLE uws_client_create(const char* hostname, unsigned int port, con
                                 result->on_ws_error_context = NULL;
                                 result->on_ws_close_complete = NULL;
                                 result->on_ws_close_complete_context = NULL;
+                                result->received_bytes_buffer = NULL;
+                                result->received_bytes_buffer_size = 0;
                                 result->received_bytes = NULL;
                                 result->received_bytes_count = 0;
+                                result->send_chunk = NULL;
+                                result->is_sending_chunks = false;
+                                result->is_sending_fragmented_message = false;
+                                result->on_ws_fragment_received = NULL;
+                                result->on_ws_fragment_received_context = NULL;
+                                result->is_receiving_fragmented_message = false;
+                                result->fragment_message_type = 0;
+                                result->is_fragment_final_frame = false;
+                                result->fragment_payload_bytes_left = 0;
+                                result->is_deflate_enabled = false;
+                                result->deflate_config.client_max_window_bits = UWS_CLIENT_DEFAULT_DEFLATE_WINDOW_BITS;
+                                result->deflate_config.server_max_window_bits = UWS_CLIENT_DEFAULT_DEFLATE_WINDOW_BITS;
+                                result->deflate_config.client_no_context_takeover = false;
+                                result->deflate_config.server_no_context_takeover = false;
+                                result->deflate_config.mem_level = UWS_CLIENT_DEFAULT_DEFLATE_MEM_LEVEL;
+                                result->deflate_config.max_message_size = UWS_CLIENT_DEFAULT_DEFLATE_MAX_MESSAGE_SIZE;
+                                result->compress_messages = true;
+                                result->uws_deflate = NULL;
+                                result->is_sending_compressed_message = false;
+                                result->is_receiving_compressed_message = false;
+                                result->inflated_message = NULL;
+                                result->inflated_message_size = 0;
+                                result->inflated_message_length = 0;
+                                result->is_inflated_message_truncated = false;
+                                result->cached_pending_sends = NULL;
+                                result->cached_pending_send_count = 0;
+                                result->send_coalescing_size = 0;
+                                result->coalesce_buffer = NULL;
+                                result->coalesce_buffer_length = 0;
+                                result->coalesced_frame_count = 0;
+                                result->coalesced_first_item = NULL;
+                                result->pending_sends_drain_count = 0;
+                                result->tick_counter = NULL;
+                                result->ping_interval_ms = 0;
+                                result->pong_timeout_ms = 0;
+                                result->is_keepalive_started = false;
+                                result->is_waiting_for_pong = false;
 
                                 result->protocol_count = protocol_count;
 
@@ -399,11 +499,12 @@ UWS_CLIENT_HANDLE uws_client_create_with_io(const IO_INTERFACE_DESCRIPTION* io_i
                     }
                     else
                     {
-                        /* Codes_SRS_UWS_CLIENT_01_530: [ `uws_client_create_with_io` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create`. ]*/
-                        result->pending_sends = singlylinkedlist_create();
+                        /* Codes_SRS_UWS_CLIENT_01_530: [ `uws_client_create_with_io` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create_with_item_cache`. ]*/
+                        /* Codes_SRS_UWS_CLIENT_01_564: [ The pending send IO list shall keep up to 16 removed list nodes for reuse. ]*/
+                        result->pending_sends = singlylinkedlist_create_with_item_cache(UWS_CLIENT_PENDING_SEND_CACHE_SIZE);
                         if (result->pending_sends == NULL)
                         {
-                            /* Codes_SRS_UWS_CLIENT_01_531: [ If `singlylinkedlist_create` fails then `uws_client_create_with_io` shall fail and return NULL. ]*/
+                            /* Codes_SRS_UWS_CLIENT_01_531: [ If `singlylinkedlist_create_with_item_cache` fails then `uws_client_create_with_io` shall fail and return NULL. ]*/
                             LogError("Could not allocate pending send frames list");
                             free(result->resource_name);
                             free(result->hostname);
@@ -439,8 +540,47 @@ UWS_CLIENT_HANDLE uws_client_create_with_io(const IO_INTERFACE_DESCRIPTION* io_i
                                 result->on_ws_error_context = NULL;
                                 result->on_ws_close_complete = NULL;
                                 result->on_ws_close_complete_context = NULL;
+                                result->received_bytes_buffer = NULL;
+                                result->received_bytes_buffer_size = 0;
                                 result->received_bytes = NULL;
                                 result->received_bytes_count = 0;
+                                result->send_chunk = NULL;
+                                result->is_sending_chunks = false;
+                                result->is_sending_fragmented_message = false;
+                                result->on_ws_fragment_received = NULL;
+                                result->on_ws_fragment_received_context = NULL;
+                                result->is_receiving_fragmented_message = false;
+                                result->fragment_message_type = 0;
+                                result->is_fragment_final_frame = false;
+                                result->fragment_payload_bytes_left = 0;
+                                result->is_deflate_enabled = false;
+                                result->deflate_config.client_max_window_bits = UWS_CLIENT_DEFAULT_DEFLATE_WINDOW_BITS;
+                                result->deflate_config.server_max_window_bits = UWS_CLIENT_DEFAULT_DEFLATE_WINDOW_BITS;
+                                result->deflate_config.client_no_context_takeover = false;
+                                result->deflate_config.server_no_context_takeover = false;
+                                result->deflate_config.mem_level = UWS_CLIENT_DEFAULT_DEFLATE_MEM_LEVEL;
+                                result->deflate_config.max_message_size = UWS_CLIENT_DEFAULT_DEFLATE_MAX_MESSAGE_SIZE;
+                                result->compress_messages = true;
+                                result->uws_deflate = NULL;
+                                result->is_sending_compressed_message = false;
+                                result->is_receiving_compressed_message = false;
+                                result->inflated_message = NULL;
+                                result->inflated_message_size = 0;
+                                result->inflated_message_length = 0;
+                                result->is_inflated_message_truncated = false;
+                                result->cached_pending_sends = NULL;
+                                result->cached_pending_send_count = 0;
+                                result->send_coalescing_size = 0;
+                                result->coalesce_buffer = NULL;
+                                result->coalesce_buffer_length = 0;
+                                result->coalesced_frame_count = 0;
+                                result->coalesced_first_item = NULL;
+                                result->pending_sends_drain_count = 0;
+                                result->tick_counter = NULL;
+                                result->ping_interval_ms = 0;
+                                result->pong_timeout_ms = 0;
+                                result->is_keepalive_started = false;
+                                result->is_waiting_for_pong = false;
 
                                 result->protocol_count = protocol_count;
 
@@ -519,7 +659,10 @@ void uws_client_destroy(UWS_CLIENT_HANDLE uws_client)
     }
     else
     {
-        free(uws_client->received_bytes);
+        free(uws_client->received_bytes_buffer);
+        free(uws_client->send_chunk);
+        free(uws_client->inflated_message);
+        free(uws_client->coalesce_buffer);
 
         /* Codes_SRS_UWS_CLIENT_01_021: [ `uws_client_destroy` shall perform a close action if the uws instance has already been open. ]*/
         switch (uws_client->uws_state)
@@ -554,6 +697,26 @@ void uws_client_destroy(UWS_CLIENT_HANDLE uws_client)
             uws_client->underlying_io = NULL;
         }
 
+        if (uws_client->uws_deflate != NULL)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_551: [ `uws_client_destroy` shall free the negotiated permessage-deflate state by calling `uws_deflate_destroy`. ]*/
+            uws_deflate_destroy(uws_client->uws_deflate);
+        }
+
+        if (uws_client->tick_counter != NULL)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_589: [ `uws_client_destroy` shall free the tick counter created for the keepalive by calling `tickcounter_destroy`. ]*/
+            tickcounter_destroy(uws_client->tick_counter);
+        }
+
+        /* Codes_SRS_UWS_CLIENT_01_565: [ `uws_client_destroy` shall free the pending send structures kept for reuse. ]*/
+        while (uws_client->cached_pending_sends != NULL)
+        {
+            WS_PENDING_SEND* ws_pending_send = uws_client->cached_pending_sends;
+            uws_client->cached_pending_sends = ws_pending_send->next_cached;
+            free(ws_pending_send);
+        }
+
         /* Codes_SRS_UWS_CLIENT_01_024: [ `uws_client_destroy` shall free the list used to track the pending sends by calling `singlylinkedlist_destroy`. ]*/
         singlylinkedlist_destroy(uws_client->pending_sends);
         free(uws_client->resource_name);
@@ -593,6 +756,240 @@ static void indicate_ws_close_complete(UWS_CLIENT_INSTANCE* uws_client)
     }
 }
 
+static WS_PENDING_SEND* allocate_pending_send(UWS_CLIENT_INSTANCE* uws_client)
+{
+    WS_PENDING_SEND* result;
+
+    if (uws_client->cached_pending_sends != NULL)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_566: [ If a pending send structure kept for reuse is available, `uws_client_send_frame_async` shall use it instead of allocating memory. ]*/
+        result = uws_client->cached_pending_sends;
+        uws_client->cached_pending_sends = result->next_cached;
+        uws_client->cached_pending_send_count--;
+    }
+    else
+    {
+        result = (WS_PENDING_SEND*)malloc(sizeof(WS_PENDING_SEND));
+    }
+
+    return result;
+}
+
+static void release_pending_send(UWS_CLIENT_INSTANCE* uws_client, WS_PENDING_SEND* ws_pending_send)
+{
+    if (uws_client->cached_pending_send_count < UWS_CLIENT_PENDING_SEND_CACHE_SIZE)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_567: [ Up to 16 released pending send structures shall be kept for reuse instead of being freed. ]*/
+        ws_pending_send->next_cached = uws_client->cached_pending_sends;
+        uws_client->cached_pending_sends = ws_pending_send;
+        uws_client->cached_pending_send_count++;
+    }
+    else
+    {
+        free(ws_pending_send);
+    }
+}
+
+static int complete_send_frame(WS_PENDING_SEND* ws_pending_send, LIST_ITEM_HANDLE pending_send_frame_item, WS_SEND_FRAME_RESULT ws_send_frame_result)
+{
+    int result;
+    UWS_CLIENT_INSTANCE* uws_client = ws_pending_send->uws_client;
+
+    /* Codes_SRS_UWS_CLIENT_01_432: [ The indicated sent frame shall be removed from the list by calling `singlylinkedlist_remove`. ]*/
+    if (singlylinkedlist_remove(uws_client->pending_sends, pending_send_frame_item) != 0)
+    {
+        LogError("Failed removing item from list");
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (ws_pending_send->on_ws_send_frame_complete != NULL)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_037: [ When indicating pending send frames as cancelled the callback context passed to the `on_ws_send_frame_complete` callback shall be the context given to `uws_client_send_frame_async`. ]*/
+            ws_pending_send->on_ws_send_frame_complete(ws_pending_send->context, ws_send_frame_result);
+        }
+
+        /* Codes_SRS_UWS_CLIENT_01_434: [ The memory associated with the sent frame shall be freed. ]*/
+        release_pending_send(uws_client, ws_pending_send);
+
+        result = 0;
+    }
+
+    return result;
+}
+
+static WS_SEND_FRAME_RESULT get_ws_send_frame_result(IO_SEND_RESULT send_result)
+{
+    WS_SEND_FRAME_RESULT ws_send_frame_result;
+
+    switch (send_result)
+    {
+    /* Codes_SRS_UWS_CLIENT_01_436: [ When `on_underlying_io_send_complete` is called with any other error code, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_ERROR`. ]*/
+    default:
+    case IO_SEND_ERROR:
+        /* Codes_SRS_UWS_CLIENT_01_390: [ When `on_underlying_io_send_complete` is called with `IO_SEND_ERROR` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_ERROR`. ]*/
+        ws_send_frame_result = WS_SEND_FRAME_ERROR;
+        break;
+
+    case IO_SEND_OK:
+        /* Codes_SRS_UWS_CLIENT_01_389: [ When `on_underlying_io_send_complete` is called with `IO_SEND_OK` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_OK`. ]*/
+        ws_send_frame_result = WS_SEND_FRAME_OK;
+        break;
+
+    case IO_SEND_CANCELLED:
+        /* Codes_SRS_UWS_CLIENT_01_391: [ When `on_underlying_io_send_complete` is called with `IO_SEND_CANCELLED` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_CANCELLED`. ]*/
+        ws_send_frame_result = WS_SEND_FRAME_CANCELLED;
+        break;
+    }
+
+    return ws_send_frame_result;
+}
+
+static void discard_coalesced_frames(UWS_CLIENT_INSTANCE* uws_client)
+{
+    /* The frames stay in the pending sends list, whoever drains the list completes them */
+    uws_client->coalesce_buffer_length = 0;
+    uws_client->coalesced_frame_count = 0;
+    uws_client->coalesced_first_item = NULL;
+    uws_client->pending_sends_drain_count++;
+}
+
+static void complete_coalesced_frames(LIST_ITEM_HANDLE first_item, WS_SEND_FRAME_RESULT ws_send_frame_result)
+{
+    WS_PENDING_SEND* ws_pending_send = (WS_PENDING_SEND*)singlylinkedlist_item_get_value(first_item);
+    UWS_CLIENT_INSTANCE* uws_client = ws_pending_send->uws_client;
+    size_t frame_count = ws_pending_send->coalesced_frame_count;
+    size_t drain_count = uws_client->pending_sends_drain_count;
+    LIST_ITEM_HANDLE current_item = first_item;
+    size_t i;
+
+    /* The frames of one write are queued one after the other, so they are completed in the order they were sent */
+    for (i = 0; i < frame_count; i++)
+    {
+        LIST_ITEM_HANDLE next_item = singlylinkedlist_get_next_item(current_item);
+
+        ws_pending_send = (WS_PENDING_SEND*)singlylinkedlist_item_get_value(current_item);
+        if (complete_send_frame(ws_pending_send, current_item, ws_send_frame_result) != 0)
+        {
+            indicate_ws_error(uws_client, WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST);
+            break;
+        }
+
+        if (uws_client->pending_sends_drain_count != drain_count)
+        {
+            /* A callback closed the instance, which already completed the remaining frames */
+            break;
+        }
+
+        current_item = next_item;
+    }
+}
+
+static void on_underlying_io_coalesced_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    if (context == NULL)
+    {
+        LogError("on_underlying_io_coalesced_send_complete called with NULL context");
+    }
+    else
+    {
+        /* Codes_SRS_UWS_CLIENT_01_572: [ When the write of coalesced frames completes, `on_ws_send_frame_complete` shall be called for each of the frames, in the order they were queued, with the result mapped as for a single frame. ]*/
+        complete_coalesced_frames((LIST_ITEM_HANDLE)context, get_ws_send_frame_result(send_result));
+    }
+}
+
+/* Codes_SRS_UWS_CLIENT_01_570: [ The coalesced frames shall be sent with one `xio_send` call when `uws_client_dowork` is called, when the next frame does not fit in the coalescing buffer, and before any frame that is not coalesced is sent. ]*/
+static void flush_coalesced_frames(UWS_CLIENT_INSTANCE* uws_client)
+{
+    if (uws_client->coalesced_frame_count > 0)
+    {
+        LIST_ITEM_HANDLE first_item = uws_client->coalesced_first_item;
+        WS_PENDING_SEND* ws_pending_send = (WS_PENDING_SEND*)singlylinkedlist_item_get_value(first_item);
+        size_t coalesced_length = uws_client->coalesce_buffer_length;
+
+        ws_pending_send->coalesced_frame_count = uws_client->coalesced_frame_count;
+        uws_client->coalesce_buffer_length = 0;
+        uws_client->coalesced_frame_count = 0;
+        uws_client->coalesced_first_item = NULL;
+
+        if (xio_send(uws_client->underlying_io, uws_client->coalesce_buffer, coalesced_length, on_underlying_io_coalesced_send_complete, first_item) != 0)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_571: [ If sending the coalesced frames fails, `on_ws_send_frame_complete` shall be called with `WS_SEND_FRAME_ERROR` for each of them. ]*/
+            LogError("Could not send the coalesced frames through the underlying IO");
+            complete_coalesced_frames(first_item, WS_SEND_FRAME_ERROR);
+        }
+    }
+}
+
+/* Sends the coalesced frames ahead of a new frame. The send complete callbacks called when that fails may close the uws instance */
+static int flush_coalesced_frames_before_send(UWS_CLIENT_INSTANCE* uws_client)
+{
+    int result;
+
+    flush_coalesced_frames(uws_client);
+
+    if (uws_client->uws_state != UWS_STATE_OPEN)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_594: [ Coalesced frames shall be sent before the new frame is queued, and if a send complete callback called while sending them closes the uws instance, `uws_client_send_frame_async` shall fail and return a non-zero value. ]*/
+        LogError("The uws instance was closed while sending the coalesced frames");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int coalesce_frame(UWS_CLIENT_INSTANCE* uws_client, WS_PENDING_SEND* ws_pending_send, WS_FRAME_TYPE frame_type, const unsigned char* buffer, size_t size, bool is_final, unsigned char reserved)
+{
+    int result;
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    size_t header_length;
+    LIST_ITEM_HANDLE pending_send_list_item;
+
+    if ((uws_client->coalesce_buffer == NULL) &&
+        ((uws_client->coalesce_buffer = (unsigned char*)malloc(uws_client->send_coalescing_size)) == NULL))
+    {
+        LogError("Cannot allocate the coalescing buffer");
+        result = __FAILURE__;
+    }
+    else if (uws_frame_encoder_encode_header(frame_type, size, true, is_final, reserved, header, &header_length) != 0)
+    {
+        LogError("Failed encoding WebSocket frame header");
+        result = __FAILURE__;
+    }
+    else if ((uws_client->coalesce_buffer_length + header_length + size > uws_client->send_coalescing_size) &&
+        (flush_coalesced_frames_before_send(uws_client) != 0))
+    {
+        result = __FAILURE__;
+    }
+    else if ((pending_send_list_item = singlylinkedlist_add(uws_client->pending_sends, ws_pending_send)) == NULL)
+    {
+        LogError("Could not allocate memory for pending frames");
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned char* frame = uws_client->coalesce_buffer + uws_client->coalesce_buffer_length;
+
+        (void)memcpy(frame, header, header_length);
+        (void)uws_frame_encoder_mask(frame + header_length, buffer, size, header + header_length - 4);
+
+        if (uws_client->coalesced_frame_count == 0)
+        {
+            uws_client->coalesced_first_item = pending_send_list_item;
+        }
+
+        uws_client->coalesce_buffer_length += header_length + size;
+        uws_client->coalesced_frame_count++;
+        result = 0;
+    }
+
+    return result;
+}
+
 static int send_close_frame(UWS_CLIENT_INSTANCE* uws_client, unsigned int close_error_code)
 {
     unsigned char* close_frame;
@@ -616,6 +1013,8 @@ static int send_close_frame(UWS_CLIENT_INSTANCE* uws_client, unsigned int close_
         close_frame = BUFFER_u_char(close_frame_buffer);
         close_frame_length = BUFFER_length(close_frame_buffer);
 
+        flush_coalesced_frames(uws_client);
+
         /* Codes_SRS_UWS_CLIENT_01_471: [ The callback `on_underlying_io_close_sent` shall be passed as argument to `xio_send`. ]*/
         if (xio_send(uws_client->underlying_io, close_frame, close_frame_length, NULL, NULL) != 0)
         {
@@ -719,15 +1118,30 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
                         "Sec-WebSocket-Key: %s\r\n"
                         "Sec-WebSocket-Protocol: %s\r\n"
                         "Sec-WebSocket-Version: 13\r\n"
+                        "%s%s%s"
                         "\r\n";
                     const char* base64_nonce_chars = STRING_c_str(base64_nonce);
+                    char* extension_offer = NULL;
+
+                    /* Codes_SRS_UWS_CLIENT_01_544: [ If the `ws_permessage_deflate` option is enabled, the upgrade request shall include a `Sec-WebSocket-Extensions` header with the permessage-deflate offer obtained by calling `uws_deflate_create_offer` with the configured parameters. ]*/
+                    if (uws_client->is_deflate_enabled &&
+                        ((extension_offer = uws_deflate_create_offer(&uws_client->deflate_config)) == NULL))
+                    {
+                        upgrade_request_length = -1;
+                    }
+                    else
+                    {
+                        upgrade_request_length = snprintf(NULL, 0, upgrade_request_format,
+                            uws_client->resource_name,
+                            uws_client->hostname,
+                            uws_client->port,
+                            base64_nonce_chars,
+                            uws_client->protocols[0].protocol,
+                            (extension_offer == NULL) ? "" : "Sec-WebSocket-Extensions: ",
+                            (extension_offer == NULL) ? "" : extension_offer,
+                            (extension_offer == NULL) ? "" : "\r\n");
+                    }
 
-                    upgrade_request_length = snprintf(NULL, 0, upgrade_request_format,
-                        uws_client->resource_name,
-                        uws_client->hostname,
-                        uws_client->port,
-                        base64_nonce_chars,
-                        uws_client->protocols[0].protocol);
                     if (upgrade_request_length < 0)
                     {
                         /* Codes_SRS_UWS_CLIENT_01_408: [ If constructing of the WebSocket upgrade request fails, uws shall report that the open failed by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_CONSTRUCTING_UPGRADE_REQUEST`. ]*/
@@ -750,7 +1164,10 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
                                 uws_client->hostname,
                                 uws_client->port,
                                 base64_nonce_chars,
-                                uws_client->protocols[0].protocol);
+                                uws_client->protocols[0].protocol,
+                                (extension_offer == NULL) ? "" : "Sec-WebSocket-Extensions: ",
+                                (extension_offer == NULL) ? "" : extension_offer,
+                                (extension_offer == NULL) ? "" : "\r\n");
 
                             /* No need to have any send complete here, as we are monitoring the received bytes */
                             /* Codes_SRS_UWS_CLIENT_01_372: [ Once prepared the WebSocket upgrade request shall be sent by calling `xio_send`. ]*/
@@ -771,6 +1188,11 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
                         }
                     }
 
+                    if (extension_offer != NULL)
+                    {
+                        free(extension_offer);
+                    }
+
                     STRING_delete(base64_nonce);
                 }
 
@@ -781,157 +1203,394 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
     }
 }
 
-static void consume_received_bytes(UWS_CLIENT_INSTANCE* uws_client, size_t consumed_bytes)
+/* Codes_SRS_UWS_CLIENT_01_532: [ The received bytes shall be accumulated in a buffer that is only reallocated when the bytes do not fit in it; decoded bytes shall be consumed by advancing a read position rather than by moving the bytes that follow them. ]*/
+static int append_received_bytes(UWS_CLIENT_INSTANCE* uws_client, const unsigned char* buffer, size_t size)
 {
-    if (consumed_bytes < uws_client->received_bytes_count)
+    int result;
+    size_t read_offset = uws_client->received_bytes - uws_client->received_bytes_buffer;
+    /* One extra byte so that the upgrade response can be zero terminated */
+    size_t needed_size = uws_client->received_bytes_count + size + 1;
+
+    if (read_offset + needed_size <= uws_client->received_bytes_buffer_size)
     {
-        (void)memmove(uws_client->received_bytes, uws_client->received_bytes + consumed_bytes, uws_client->received_bytes_count - consumed_bytes);
+        result = 0;
     }
-
-    uws_client->received_bytes_count -= consumed_bytes;
-}
-
-static void on_underlying_io_close_complete(void* context)
-{
-    if (context == NULL)
+    else if (needed_size <= uws_client->received_bytes_buffer_size)
     {
-        /* Codes_SRS_UWS_CLIENT_01_477: [ When `on_underlying_io_close_complete` is called with a NULL context, it shall do nothing. ]*/
-        LogError("NULL context for on_underlying_io_close_complete");
+        /* The bytes fit once the unread ones are moved to the start of the buffer */
+        (void)memmove(uws_client->received_bytes_buffer, uws_client->received_bytes, uws_client->received_bytes_count);
+        uws_client->received_bytes = uws_client->received_bytes_buffer;
+        result = 0;
     }
     else
     {
-        UWS_CLIENT_HANDLE uws_client = (UWS_CLIENT_HANDLE)context;
-        if (uws_client->uws_state == UWS_STATE_CLOSING_UNDERLYING_IO)
+        size_t new_buffer_size = uws_client->received_bytes_buffer_size * 2;
+        unsigned char* new_buffer;
+
+        if (new_buffer_size < needed_size)
         {
-            /* Codes_SRS_UWS_CLIENT_01_475: [ When `on_underlying_io_close_complete` is called while closing the underlying IO a subsequent `uws_client_open_async` shall succeed. ]*/
-            indicate_ws_close_complete(uws_client);
-            uws_client->uws_state = UWS_STATE_CLOSED;
+            new_buffer_size = needed_size;
+        }
+
+        new_buffer = (unsigned char*)realloc(uws_client->received_bytes_buffer, new_buffer_size);
+        if (new_buffer == NULL)
+        {
+            LogError("Cannot grow the received bytes buffer to %lu bytes", (unsigned long)new_buffer_size);
+            result = __FAILURE__;
+        }
+        else
+        {
+            if (read_offset > 0)
+            {
+                (void)memmove(new_buffer, new_buffer + read_offset, uws_client->received_bytes_count);
+            }
+
+            uws_client->received_bytes_buffer = new_buffer;
+            uws_client->received_bytes_buffer_size = new_buffer_size;
+            uws_client->received_bytes = new_buffer;
+            result = 0;
         }
     }
+
+    if (result == 0)
+    {
+        (void)memcpy(uws_client->received_bytes + uws_client->received_bytes_count, buffer, size);
+        uws_client->received_bytes_count += size;
+    }
+
+    return result;
 }
 
-static void on_underlying_io_close_sent(void* context, IO_SEND_RESULT io_send_result)
+static void consume_received_bytes(UWS_CLIENT_INSTANCE* uws_client, size_t consumed_bytes)
 {
-    if (context == NULL)
+    uws_client->received_bytes_count -= consumed_bytes;
+
+    /* Consuming only moves the read position, the buffer is rewound once it has been drained */
+    if (uws_client->received_bytes_count == 0)
     {
-        /* Codes_SRS_UWS_CLIENT_01_489: [ When `on_underlying_io_close_sent` is called with NULL context, it shall do nothing. ] */
-        LogError("NULL context in ");
+        uws_client->received_bytes = uws_client->received_bytes_buffer;
     }
     else
     {
-        UWS_CLIENT_INSTANCE* uws_client = (UWS_CLIENT_HANDLE)context;
-
-        switch (io_send_result)
-        {
-        case IO_SEND_OK:
-        case IO_SEND_CANCELLED:
-            if (uws_client->uws_state == UWS_STATE_CLOSING_SENDING_CLOSE)
-            {
-                uws_client->uws_state = UWS_STATE_CLOSING_UNDERLYING_IO;
+        uws_client->received_bytes += consumed_bytes;
+    }
+}
 
-                /* Codes_SRS_UWS_CLIENT_01_490: [ When `on_underlying_io_close_sent` is called while the uws client is CLOSING, `on_underlying_io_close_sent` shall close the underlying IO by calling `xio_close`. ]*/
-                if (xio_close(uws_client->underlying_io, on_underlying_io_close_complete, uws_client) != 0)
-                {
-                    /* Codes_SRS_UWS_CLIENT_01_496: [ If the close was initiated by the peer no `on_ws_close_complete` shall be called. ]*/
-                    indicate_ws_close_complete(uws_client);
-                }
-            }
+static void on_fragment_inflated(void* context, const unsigned char* buffer, size_t size)
+{
+    UWS_CLIENT_INSTANCE* uws_client = (UWS_CLIENT_INSTANCE*)context;
 
-        case IO_SEND_ERROR:
-            break;
-        }
-    }
+    /* The end of the message is indicated once all of it has been decompressed */
+    uws_client->on_ws_fragment_received(uws_client->on_ws_fragment_received_context, uws_client->fragment_message_type, buffer, size, false);
 }
 
-/*the following function does the same as sscanf(pos2, "%d", &sec)*/
-/*this function only exists because some of platforms do not have sscanf. */
-static int ParseStringToDecimal(const char *src, int* dst)
+static int indicate_fragment_bytes(UWS_CLIENT_INSTANCE* uws_client, const unsigned char* buffer, size_t size, bool is_final)
 {
     int result;
-    char* next;
 
-    (*dst) = strtol(src, &next, 0);
-    if ((src == next) || ((((*dst) == INT_MAX) || ((*dst) == INT_MIN)) && (errno != 0)))
+    if (!uws_client->is_receiving_compressed_message)
+    {
+        uws_client->on_ws_fragment_received(uws_client->on_ws_fragment_received_context, uws_client->fragment_message_type, buffer, size, is_final);
+        result = 0;
+    }
+    /* Codes_SRS_UWS_CLIENT_01_549: [ When `on_ws_fragment_received` is set, the payload of a compressed message shall be decompressed as it arrives by calling `uws_deflate_decompress` and the decompressed bytes shall be indicated with `is_final` set to false, followed by an indication of 0 bytes with `is_final` set to true at the end of the message. ]*/
+    else if (uws_deflate_decompress(uws_client->uws_deflate, buffer, size, is_final, on_fragment_inflated, uws_client) != 0)
     {
+        /* Codes_SRS_UWS_CLIENT_01_550: [ If decompressing a message fails, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_BAD_FRAME_RECEIVED` and a CLOSE frame with code 1002 shall be sent. ]*/
+        /* Codes_SRS_UWS_CLIENT_01_593: [ If the decompressed message is larger than `ws_deflate_max_message_size` or cannot be allocated, the CLOSE frame shall carry code 1009 instead. ]*/
+        LogError("Cannot decompress the received message");
+        indicate_ws_error_and_close(uws_client, WS_ERROR_BAD_FRAME_RECEIVED, uws_deflate_is_message_too_large(uws_client->uws_deflate) ? 1009 : 1002);
         result = __FAILURE__;
     }
     else
     {
+        if (is_final)
+        {
+            uws_client->on_ws_fragment_received(uws_client->on_ws_fragment_received_context, uws_client->fragment_message_type, buffer, 0, true);
+        }
+
         result = 0;
     }
 
     return result;
 }
 
-/*the following function does the same as sscanf(buf, "HTTP/%*d.%*d %d %*[^\r\n]", &ret) */
-/*this function only exists because some of platforms do not have sscanf. This is not a full implementation; it only works with well-defined HTTP response. */
-static int ParseHttpResponse(const char* src, int* dst)
+static int indicate_fragment_payload(UWS_CLIENT_INSTANCE* uws_client)
 {
+    size_t payload_length = uws_client->received_bytes_count;
+    bool is_final;
     int result;
-    static const char HTTPPrefix[] = "HTTP/";
-    bool fail;
-    const char* runPrefix;
 
-    if ((src == NULL) || (dst == NULL))
+    if (payload_length > uws_client->fragment_payload_bytes_left)
     {
-        result = __FAILURE__;
+        payload_length = uws_client->fragment_payload_bytes_left;
+    }
+
+    uws_client->fragment_payload_bytes_left -= payload_length;
+
+    /* Codes_SRS_UWS_CLIENT_01_540: [ `is_final` shall be true only for the last payload bytes of the final frame of a message. ]*/
+    is_final = uws_client->is_fragment_final_frame && (uws_client->fragment_payload_bytes_left == 0);
+
+    /* Codes_SRS_UWS_CLIENT_01_539: [ The `frame_type` passed to `on_ws_fragment_received` shall be the type of the message, `WS_FRAME_TYPE_TEXT` or `WS_FRAME_TYPE_BINARY`, also for the payload of continuation frames. ]*/
+    result = indicate_fragment_bytes(uws_client, uws_client->received_bytes, payload_length, is_final);
+    consume_received_bytes(uws_client, payload_length);
+
+    return result;
+}
+
+static void on_message_inflated(void* context, const unsigned char* buffer, size_t size)
+{
+    UWS_CLIENT_INSTANCE* uws_client = (UWS_CLIENT_INSTANCE*)context;
+
+    if (uws_client->is_inflated_message_truncated)
+    {
+        /* already failed */
     }
     else
     {
-        fail = false;
-        runPrefix = HTTPPrefix;
+        size_t needed_size = uws_client->inflated_message_length + size;
 
-        while ((*runPrefix) != '\0')
+        if (needed_size > uws_client->inflated_message_size)
         {
-            if ((*runPrefix) != (*src))
+            size_t new_size = (uws_client->inflated_message_size * 2 < needed_size) ? needed_size : uws_client->inflated_message_size * 2;
+            unsigned char* new_inflated_message = (unsigned char*)realloc(uws_client->inflated_message, new_size);
+            if (new_inflated_message == NULL)
             {
-                fail = true;
-                break;
+                LogError("Cannot allocate memory for the decompressed message");
+                uws_client->is_inflated_message_truncated = true;
             }
-            src++;
-            runPrefix++;
-        }
-
-        if (!fail)
-        {
-            while ((*src) != '.')
+            else
             {
-                if ((*src) == '\0')
-                {
-                    fail = true;
-                    break;
-                }
-                src++;
+                uws_client->inflated_message = new_inflated_message;
+                uws_client->inflated_message_size = new_size;
             }
         }
 
-        if (!fail)
+        if (!uws_client->is_inflated_message_truncated)
         {
-            while ((*src) != ' ')
-            {
-                if ((*src) == '\0')
+            (void)memcpy(uws_client->inflated_message + uws_client->inflated_message_length, buffer, size);
+            uws_client->inflated_message_length += size;
+        }
+    }
+}
+
+/* Codes_SRS_UWS_CLIENT_01_548: [ When permessage-deflate has been negotiated, the payload of a text or binary frame with the RSV1 bit set shall be decompressed by calling `uws_deflate_decompress` before being indicated through `on_ws_frame_received`. ]*/
+/* Codes_SRS_UWS_CLIENT_01_592: [ When `on_ws_fragment_received` is not set, the frames of a fragmented compressed message shall be decompressed into one buffer and the whole message shall be indicated through `on_ws_frame_received` once its final frame is received. ]*/
+static int indicate_inflated_frame(UWS_CLIENT_INSTANCE* uws_client, unsigned char frame_type, bool is_compressed, bool is_final, const unsigned char* payload, size_t length)
+{
+    int result;
+    bool is_continuation = (frame_type == WS_FRAME_TYPE_CONTINUATION);
+
+    if (is_continuation != uws_client->is_receiving_compressed_message)
+    {
+        LogError("Bad frame: a text or binary frame was received in the middle of a compressed message");
+        uws_client->is_receiving_compressed_message = false;
+        indicate_ws_error_and_close(uws_client, WS_ERROR_BAD_FRAME_RECEIVED, 1002);
+        result = __FAILURE__;
+    }
+    else if (is_continuation && is_compressed)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_552: [ If permessage-deflate has been negotiated and a continuation frame has the RSV1 bit set, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_BAD_FRAME_RECEIVED`. ]*/
+        LogError("Bad frame: RSV1 set on a continuation frame");
+        uws_client->is_receiving_compressed_message = false;
+        indicate_ws_error_and_close(uws_client, WS_ERROR_BAD_FRAME_RECEIVED, 1002);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (!is_continuation)
+        {
+            uws_client->fragment_message_type = frame_type;
+            uws_client->inflated_message_length = 0;
+            uws_client->is_inflated_message_truncated = false;
+        }
+
+        if ((uws_deflate_decompress(uws_client->uws_deflate, payload, length, is_final, on_message_inflated, uws_client) != 0) ||
+            uws_client->is_inflated_message_truncated)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_550: [ If decompressing a message fails, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_BAD_FRAME_RECEIVED` and a CLOSE frame with code 1002 shall be sent. ]*/
+            /* Codes_SRS_UWS_CLIENT_01_593: [ If the decompressed message is larger than `ws_deflate_max_message_size` or cannot be allocated, the CLOSE frame shall carry code 1009 instead. ]*/
+            LogError("Cannot decompress the received message");
+            uws_client->is_receiving_compressed_message = false;
+            indicate_ws_error_and_close(uws_client, WS_ERROR_BAD_FRAME_RECEIVED,
+                (uws_client->is_inflated_message_truncated || uws_deflate_is_message_too_large(uws_client->uws_deflate)) ? 1009 : 1002);
+            result = __FAILURE__;
+        }
+        else
+        {
+            uws_client->is_receiving_compressed_message = !is_final;
+            if (is_final)
+            {
+                uws_client->on_ws_frame_received(uws_client->on_ws_frame_received_context, uws_client->fragment_message_type, uws_client->inflated_message, uws_client->inflated_message_length);
+
+                /* Codes_SRS_UWS_CLIENT_01_595: [ Once a decompressed message larger than 65536 bytes has been indicated, its buffer shall be freed. ]*/
+                if (uws_client->inflated_message_size > UWS_CLIENT_RETAINED_INFLATED_MESSAGE_SIZE)
                 {
-                    fail = true;
-                    break;
+                    free(uws_client->inflated_message);
+                    uws_client->inflated_message = NULL;
+                    uws_client->inflated_message_size = 0;
+                }
+            }
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static void on_underlying_io_close_complete(void* context)
+{
+    if (context == NULL)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_477: [ When `on_underlying_io_close_complete` is called with a NULL context, it shall do nothing. ]*/
+        LogError("NULL context for on_underlying_io_close_complete");
+    }
+    else
+    {
+        UWS_CLIENT_HANDLE uws_client = (UWS_CLIENT_HANDLE)context;
+        if (uws_client->uws_state == UWS_STATE_CLOSING_UNDERLYING_IO)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_475: [ When `on_underlying_io_close_complete` is called while closing the underlying IO a subsequent `uws_client_open_async` shall succeed. ]*/
+            indicate_ws_close_complete(uws_client);
+            uws_client->uws_state = UWS_STATE_CLOSED;
+        }
+    }
+}
+
+static void on_underlying_io_close_sent(void* context, IO_SEND_RESULT io_send_result)
+{
+    if (context == NULL)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_489: [ When `on_underlying_io_close_sent` is called with NULL context, it shall do nothing. ] */
+        LogError("NULL context in ");
+    }
+    else
+    {
+        UWS_CLIENT_INSTANCE* uws_client = (UWS_CLIENT_HANDLE)context;
+
+        switch (io_send_result)
+        {
+        case IO_SEND_OK:
+        case IO_SEND_CANCELLED:
+            if (uws_client->uws_state == UWS_STATE_CLOSING_SENDING_CLOSE)
+            {
+                uws_client->uws_state = UWS_STATE_CLOSING_UNDERLYING_IO;
+
+                /* Codes_SRS_UWS_CLIENT_01_490: [ When `on_underlying_io_close_sent` is called while the uws client is CLOSING, `on_underlying_io_close_sent` shall close the underlying IO by calling `xio_close`. ]*/
+                if (xio_close(uws_client->underlying_io, on_underlying_io_close_complete, uws_client) != 0)
+                {
+                    /* Codes_SRS_UWS_CLIENT_01_496: [ If the close was initiated by the peer no `on_ws_close_complete` shall be called. ]*/
+                    indicate_ws_close_complete(uws_client);
                 }
-                src++;
             }
+
+        case IO_SEND_ERROR:
+            break;
         }
+    }
+}
 
-        if (fail)
+/* Finds the value of the Sec-WebSocket-Extensions header between the status line and `response_end` */
+static int get_extensions_header_value(const char* response, const char* response_end, const char** value, size_t* value_length)
+{
+    static const char header_name[] = "sec-websocket-extensions";
+    const size_t header_name_length = sizeof(header_name) - 1;
+    const char* line = strstr(response, "\r\n");
+    int result = 0;
+
+    *value = NULL;
+    *value_length = 0;
+
+    while ((result == 0) && (line != NULL) && (line < response_end))
+    {
+        const char* line_start = line + 2;
+        const char* line_end = strstr(line_start, "\r\n");
+        size_t i;
+
+        for (i = 0; i < header_name_length; i++)
         {
+            if ((line_start + i >= line_end) ||
+                (tolower((unsigned char)line_start[i]) != header_name[i]))
+            {
+                break;
+            }
+        }
+
+        if ((i == header_name_length) &&
+            (line_start[i] == ':'))
+        {
+            if (*value != NULL)
+            {
+                LogError("More than one Sec-WebSocket-Extensions header in the upgrade response");
+                result = __FAILURE__;
+            }
+            else
+            {
+                const char* value_end = line_end;
+
+                *value = line_start + header_name_length + 1;
+                while ((*value < value_end) && ((**value == ' ') || (**value == '\t')))
+                {
+                    (*value)++;
+                }
+
+                while ((value_end > *value) && ((value_end[-1] == ' ') || (value_end[-1] == '\t')))
+                {
+                    value_end--;
+                }
+
+                *value_length = value_end - *value;
+            }
+        }
+
+        line = line_end;
+    }
+
+    return result;
+}
+
+static int negotiate_deflate(UWS_CLIENT_INSTANCE* uws_client, const char* response, const char* response_end)
+{
+    int result;
+    const char* extensions;
+    size_t extensions_length;
+
+    if (get_extensions_header_value(response, response_end, &extensions, &extensions_length) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else if (extensions == NULL)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_546: [ If the upgrade response has no `Sec-WebSocket-Extensions` header, the connection shall be opened without compression. ]*/
+        result = 0;
+    }
+    else
+    {
+        char* extensions_copy = (char*)malloc(extensions_length + 1);
+        if (extensions_copy == NULL)
+        {
+            LogError("Cannot allocate memory for the extensions header");
             result = __FAILURE__;
         }
         else
         {
-            if (ParseStringToDecimal(src, dst) != 0)
+            (void)memcpy(extensions_copy, extensions, extensions_length);
+            extensions_copy[extensions_length] = '\0';
+
+            /* Codes_SRS_UWS_CLIENT_01_545: [ If the `ws_permessage_deflate` option is enabled and the upgrade response has a `Sec-WebSocket-Extensions` header, its value shall be passed to `uws_deflate_create` together with the configured parameters. ]*/
+            uws_client->uws_deflate = uws_deflate_create(&uws_client->deflate_config, extensions_copy);
+            if (uws_client->uws_deflate == NULL)
             {
+                LogError("Cannot accept the negotiated extensions: %s", extensions_copy);
                 result = __FAILURE__;
             }
             else
             {
                 result = 0;
             }
+
+            free(extensions_copy);
         }
     }
 
@@ -971,8 +1630,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
             case UWS_STATE_WAITING_FOR_UPGRADE_RESPONSE:
             {
                 /* Codes_SRS_UWS_CLIENT_01_378: [ When `on_underlying_io_bytes_received` is called while the uws is OPENING, the received bytes shall be accumulated in order to attempt parsing the WebSocket Upgrade response. ]*/
-                unsigned char* new_received_bytes = (unsigned char*)realloc(uws_client->received_bytes, uws_client->received_bytes_count + size + 1);
-                if (new_received_bytes == NULL)
+                if (append_received_bytes(uws_client, buffer, size) != 0)
                 {
                     /* Codes_SRS_UWS_CLIENT_01_379: [ If allocating memory for accumulating the bytes fails, uws shall report that the open failed by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_NOT_ENOUGH_MEMORY`. ]*/
                     indicate_ws_open_complete_error_and_close(uws_client, WS_OPEN_ERROR_NOT_ENOUGH_MEMORY);
@@ -980,10 +1638,6 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                 }
                 else
                 {
-                    uws_client->received_bytes = new_received_bytes;
-                    (void)memcpy(uws_client->received_bytes + uws_client->received_bytes_count, buffer, size);
-                    uws_client->received_bytes_count += size;
-
                     decode_stream = 1;
                 }
 
@@ -994,8 +1648,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
             case UWS_STATE_CLOSING_WAITING_FOR_CLOSE:
             {
                 /* Codes_SRS_UWS_CLIENT_01_385: [ If the state of the uws instance is OPEN, the received bytes shall be used for decoding WebSocket frames. ]*/
-                unsigned char* new_received_bytes = (unsigned char*)realloc(uws_client->received_bytes, uws_client->received_bytes_count + size + 1);
-                if (new_received_bytes == NULL)
+                if (append_received_bytes(uws_client, buffer, size) != 0)
                 {
                     /* Codes_SRS_UWS_CLIENT_01_418: [ If allocating memory for the bytes accumulated for decoding WebSocket frames fails, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_NOT_ENOUGH_MEMORY`. ]*/
                     LogError("Cannot allocate memory for received data");
@@ -1005,10 +1658,6 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                 }
                 else
                 {
-                    uws_client->received_bytes = new_received_bytes;
-                    (void)memcpy(uws_client->received_bytes + uws_client->received_bytes_count, buffer, size);
-                    uws_client->received_bytes_count += size;
-                
                     decode_stream = 1;
                 }
 
@@ -1033,39 +1682,50 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
 
                 case UWS_STATE_WAITING_FOR_UPGRADE_RESPONSE:
                 {
-                    const char* request_end_ptr;
-
-                    /* Make sure it is zero terminated */
-                    uws_client->received_bytes[uws_client->received_bytes_count] = '\0';
+                    size_t consumed;
 
                     /* Codes_SRS_UWS_CLIENT_01_380: [ If an WebSocket Upgrade request can be parsed from the accumulated bytes, the status shall be read from the WebSocket upgrade response. ]*/
-                    /* Codes_SRS_UWS_CLIENT_01_381: [ If the status is 101, uws shall be considered OPEN and this shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `IO_OPEN_OK`. ]*/
-                    if ((uws_client->received_bytes_count >= 4) &&
-                        ((request_end_ptr = strstr((const char*)uws_client->received_bytes, "\r\n\r\n")) != NULL))
+                    /* Codes_SRS_UWS_CLIENT_01_579: [ Only the newly received bytes shall be passed to `http_response_parser_parse`, which keeps the parsing state of the bytes received before. ]*/
+                    switch (http_response_parser_parse(&uws_client->upgrade_response_parser, buffer, size, &consumed))
+                    {
+                    default:
+                    case HTTP_RESPONSE_PARSER_ERROR:
+                        /* Codes_SRS_UWS_CLIENT_01_383: [ If the WebSocket upgrade request cannot be decoded an error shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE`. ]*/
+                        LogError("Cannot decode HTTP response");
+                        indicate_ws_open_complete_error_and_close(uws_client, WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE);
+                        break;
+
+                    case HTTP_RESPONSE_PARSER_INCOMPLETE:
+                        break;
+
+                    case HTTP_RESPONSE_PARSER_COMPLETE:
                     {
-                        int status_code;
+                        /* The response is at the start of the received bytes, the bytes after it are WebSocket frames */
+                        size_t response_length = uws_client->upgrade_response_parser.response_length;
+                        int status_code = uws_client->upgrade_response_parser.status_code;
 
-                        /* This part should really be done with the HTTPAPI, but that has to be done as a separate step
-                        as the HTTPAPI has to expose somehow the underlying IO and currently this would be a too big of a change. */
+                        /* Make sure it is zero terminated */
+                        uws_client->received_bytes[uws_client->received_bytes_count] = '\0';
 
-                        /* Codes_SRS_UWS_CLIENT_01_382: [ If a negative status is decoded from the WebSocket upgrade request, an error shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_BAD_RESPONSE_STATUS`. ]*/
+                        /* Codes_SRS_UWS_CLIENT_01_381: [ If the status is 101, uws shall be considered OPEN and this shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `IO_OPEN_OK`. ]*/
                         /* Codes_SRS_UWS_CLIENT_01_478: [ A Status-Line with a 101 response code as per RFC 2616 [RFC2616]. ]*/
-                        if (ParseHttpResponse((const char*)uws_client->received_bytes, &status_code) != 0)
-                        {
-                            /* Codes_SRS_UWS_CLIENT_01_383: [ If the WebSocket upgrade request cannot be decoded an error shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE`. ]*/
-                            LogError("Cannot decode HTTP response");
-                            indicate_ws_open_complete_error_and_close(uws_client, WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE);
-                        }
-                        else if (status_code != 101)
+                        if (status_code != 101)
                         {
                             /* Codes_SRS_UWS_CLIENT_01_382: [ If a negative status is decoded from the WebSocket upgrade request, an error shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_BAD_RESPONSE_STATUS`. ]*/
                             LogError("Bad status (%d) received in WebSocket Upgrade response", status_code);
                             indicate_ws_open_complete_error_and_close(uws_client, WS_OPEN_ERROR_BAD_RESPONSE_STATUS);
                         }
+                        else if (uws_client->is_deflate_enabled &&
+                            (negotiate_deflate(uws_client, (const char*)uws_client->received_bytes, (const char*)uws_client->received_bytes + response_length - 4) != 0))
+                        {
+                            /* Codes_SRS_UWS_CLIENT_01_547: [ If the `Sec-WebSocket-Extensions` header cannot be parsed or `uws_deflate_create` fails, uws shall report that the open failed by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE`. ]*/
+                            LogError("Bad Sec-WebSocket-Extensions in WebSocket Upgrade response");
+                            indicate_ws_open_complete_error_and_close(uws_client, WS_OPEN_ERROR_BAD_UPGRADE_RESPONSE);
+                        }
                         else
                         {
                             /* Codes_SRS_UWS_CLIENT_01_384: [ Any extra bytes that are left unconsumed after decoding a succesfull WebSocket upgrade response shall be used for decoding WebSocket frames ]*/
-                            consume_received_bytes(uws_client, request_end_ptr - (char*)uws_client->received_bytes + 4);
+                            consume_received_bytes(uws_client, response_length);
 
                             /* Codes_SRS_UWS_CLIENT_01_381: [ If the status is 101, uws shall be considered OPEN and this shall be indicated by calling the `on_ws_open_complete` callback passed to `uws_client_open_async` with `IO_OPEN_OK`. ]*/
                             uws_client->uws_state = UWS_STATE_OPEN;
@@ -1076,6 +1736,8 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
 
                             decode_stream = 1;
                         }
+                        break;
+                    }
                     }
 
                     break;
@@ -1087,11 +1749,21 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                     size_t needed_bytes = 2;
                     size_t length;
 
+                    if (uws_client->fragment_payload_bytes_left > 0)
+                    {
+                        /* Codes_SRS_UWS_CLIENT_01_538: [ When `on_ws_fragment_received` is set, the payload of text, binary and continuation frames shall be indicated through it as soon as it is received, without waiting for the whole frame, and then consumed from the received bytes. ]*/
+                        if ((uws_client->received_bytes_count > 0) &&
+                            (indicate_fragment_payload(uws_client) == 0))
+                        {
+                            decode_stream = 1;
+                        }
+                    }
                     /* Codes_SRS_UWS_CLIENT_01_277: [ To receive WebSocket data, an endpoint listens on the underlying network connection. ]*/
                     /* Codes_SRS_UWS_CLIENT_01_278: [ Incoming data MUST be parsed as WebSocket frames as defined in Section 5.2. ]*/
-                    if (uws_client->received_bytes_count >= needed_bytes)
+                    else if (uws_client->received_bytes_count >= needed_bytes)
                     {
                         unsigned char has_error = 0;
+                        bool is_length_decoded = false;
 
                         /* Codes_SRS_UWS_CLIENT_01_160: [ Defines whether the "Payload data" is masked. ]*/
                         if ((uws_client->received_bytes[1] & 0x80) != 0)
@@ -1127,6 +1799,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                 else
                                 {
                                     needed_bytes += (size_t)length;
+                                    is_length_decoded = true;
                                 }
                             }
                         }
@@ -1168,6 +1841,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                     else
                                     {
                                         needed_bytes += length;
+                                        is_length_decoded = true;
                                     }
                                 }
                             }
@@ -1175,9 +1849,65 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                         else
                         {
                             needed_bytes += length;
+                            is_length_decoded = true;
                         }
 
                         if ((has_error == 0) &&
+                            is_length_decoded &&
+                            (uws_client->on_ws_fragment_received != NULL) &&
+                            ((uws_client->received_bytes[0] & 0xF) <= (unsigned char)WS_BINARY_FRAME))
+                        {
+                            unsigned char opcode = uws_client->received_bytes[0] & 0xF;
+                            bool is_final_frame = ((uws_client->received_bytes[0] & 0x80) != 0);
+
+                            /* Codes_SRS_UWS_CLIENT_01_541: [ If a continuation frame is received when no fragmented message is being received, or a text or binary frame is received while one is, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_BAD_FRAME_RECEIVED`. ]*/
+                            if ((opcode == (unsigned char)WS_CONTINUATION_FRAME) != uws_client->is_receiving_fragmented_message)
+                            {
+                                LogError("Bad frame: opcode %u does not match the fragmented message state", (unsigned int)opcode);
+                                indicate_ws_error(uws_client, WS_ERROR_BAD_FRAME_RECEIVED);
+                            }
+                            else if ((opcode == (unsigned char)WS_CONTINUATION_FRAME) &&
+                                (uws_client->uws_deflate != NULL) &&
+                                ((uws_client->received_bytes[0] & 0x40) != 0))
+                            {
+                                /* Codes_SRS_UWS_CLIENT_01_552: [ If permessage-deflate has been negotiated and a continuation frame has the RSV1 bit set, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_BAD_FRAME_RECEIVED`. ]*/
+                                LogError("Bad frame: RSV1 set on a continuation frame");
+                                indicate_ws_error_and_close(uws_client, WS_ERROR_BAD_FRAME_RECEIVED, 1002);
+                            }
+                            else
+                            {
+                                int indicate_result = 0;
+
+                                if (opcode != (unsigned char)WS_CONTINUATION_FRAME)
+                                {
+                                    uws_client->fragment_message_type = opcode;
+                                    uws_client->is_receiving_compressed_message = (uws_client->uws_deflate != NULL) && ((uws_client->received_bytes[0] & 0x40) != 0);
+                                }
+
+                                uws_client->is_receiving_fragmented_message = !is_final_frame;
+                                uws_client->is_fragment_final_frame = is_final_frame;
+                                uws_client->fragment_payload_bytes_left = length;
+
+                                /* Only the header is consumed here, the payload is indicated as it arrives */
+                                consume_received_bytes(uws_client, needed_bytes - length);
+
+                                if (length == 0)
+                                {
+                                    /* Codes_SRS_UWS_CLIENT_01_540: [ `is_final` shall be true only for the last payload bytes of the final frame of a message. ]*/
+                                    indicate_result = indicate_fragment_bytes(uws_client, uws_client->received_bytes, 0, is_final_frame);
+                                }
+                                else if (uws_client->received_bytes_count > 0)
+                                {
+                                    indicate_result = indicate_fragment_payload(uws_client);
+                                }
+
+                                if (indicate_result == 0)
+                                {
+                                    decode_stream = 1;
+                                }
+                            }
+                        }
+                        else if ((has_error == 0) &&
                             (uws_client->received_bytes_count >= needed_bytes))
                         {
                             unsigned char opcode = uws_client->received_bytes[0] & 0xF;
@@ -1187,6 +1917,18 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                             default:
                                 break;
 
+                                /* Codes_SRS_UWS_CLIENT_01_152: [ *  %x0 denotes a continuation frame ]*/
+                            case (unsigned char)WS_CONTINUATION_FRAME:
+                                /* Codes_SRS_UWS_CLIENT_01_592: [ When `on_ws_fragment_received` is not set, the frames of a fragmented compressed message shall be decompressed into one buffer and the whole message shall be indicated through `on_ws_frame_received` once its final frame is received. ]*/
+                                if (uws_client->is_receiving_compressed_message)
+                                {
+                                    if (indicate_inflated_frame(uws_client, WS_FRAME_TYPE_CONTINUATION, (uws_client->received_bytes[0] & 0x40) != 0, (uws_client->received_bytes[0] & 0x80) != 0, uws_client->received_bytes + needed_bytes - length, length) == 0)
+                                    {
+                                        decode_stream = 1;
+                                    }
+                                }
+                                break;
+
                                 /* Codes_SRS_UWS_CLIENT_01_153: [ *  %x1 denotes a text frame ]*/
                                 /* Codes_SRS_UWS_CLIENT_01_258: [** Currently defined opcodes for data frames include 0x1 (Text), 0x2 (Binary). ]*/
                             case (unsigned char)WS_TEXT_FRAME:
@@ -1196,8 +1938,19 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                 /* Codes_SRS_UWS_CLIENT_01_280: [ Upon receiving a data frame (Section 5.6), the endpoint MUST note the /type/ of the data as defined by the opcode (frame-opcode) from Section 5.2. ]*/
                                 /* Codes_SRS_UWS_CLIENT_01_281: [ The "Application data" from this frame is defined as the /data/ of the message. ]*/
                                 /* Codes_SRS_UWS_CLIENT_01_282: [ If the frame comprises an unfragmented message (Section 5.4), it is said that _A WebSocket Message Has Been Received_ with type /type/ and data /data/. ]*/
-                                uws_client->on_ws_frame_received(uws_client->on_ws_frame_received_context, WS_FRAME_TYPE_TEXT, uws_client->received_bytes + needed_bytes - length, length);
-                                decode_stream = 1;
+                                if ((uws_client->uws_deflate != NULL) &&
+                                    (((uws_client->received_bytes[0] & 0x40) != 0) || uws_client->is_receiving_compressed_message))
+                                {
+                                    if (indicate_inflated_frame(uws_client, WS_FRAME_TYPE_TEXT, (uws_client->received_bytes[0] & 0x40) != 0, (uws_client->received_bytes[0] & 0x80) != 0, uws_client->received_bytes + needed_bytes - length, length) == 0)
+                                    {
+                                        decode_stream = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    uws_client->on_ws_frame_received(uws_client->on_ws_frame_received_context, WS_FRAME_TYPE_TEXT, uws_client->received_bytes + needed_bytes - length, length);
+                                    decode_stream = 1;
+                                }
                                 break;
 
                                 /* Codes_SRS_UWS_CLIENT_01_154: [ *  %x2 denotes a binary frame ]*/
@@ -1209,8 +1962,19 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                 /* Codes_SRS_UWS_CLIENT_01_280: [ Upon receiving a data frame (Section 5.6), the endpoint MUST note the /type/ of the data as defined by the opcode (frame-opcode) from Section 5.2. ]*/
                                 /* Codes_SRS_UWS_CLIENT_01_281: [ The "Application data" from this frame is defined as the /data/ of the message. ]*/
                                 /* Codes_SRS_UWS_CLIENT_01_282: [ If the frame comprises an unfragmented message (Section 5.4), it is said that _A WebSocket Message Has Been Received_ with type /type/ and data /data/. ]*/
-                                uws_client->on_ws_frame_received(uws_client->on_ws_frame_received_context, WS_FRAME_TYPE_BINARY, uws_client->received_bytes + needed_bytes - length, length);
-                                decode_stream = 1;
+                                if ((uws_client->uws_deflate != NULL) &&
+                                    (((uws_client->received_bytes[0] & 0x40) != 0) || uws_client->is_receiving_compressed_message))
+                                {
+                                    if (indicate_inflated_frame(uws_client, WS_FRAME_TYPE_BINARY, (uws_client->received_bytes[0] & 0x40) != 0, (uws_client->received_bytes[0] & 0x80) != 0, uws_client->received_bytes + needed_bytes - length, length) == 0)
+                                    {
+                                        decode_stream = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    uws_client->on_ws_frame_received(uws_client->on_ws_frame_received_context, WS_FRAME_TYPE_BINARY, uws_client->received_bytes + needed_bytes - length, length);
+                                    decode_stream = 1;
+                                }
                                 break;
 
                                 /* Codes_SRS_UWS_CLIENT_01_156: [ *  %x8 denotes a connection close ]*/
@@ -1315,6 +2079,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                     {
                                         close_frame_bytes = BUFFER_u_char(close_frame_buffer);
                                         close_frame_length = BUFFER_length(close_frame_buffer);
+                                        flush_coalesced_frames(uws_client);
                                         if (xio_send(uws_client->underlying_io, close_frame_bytes, close_frame_length, on_underlying_io_close_sent, uws_client) != 0)
                                         {
                                             LogError("Cannot send the response CLOSE frame");
@@ -1363,6 +2128,7 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                                     /* Codes_SRS_UWS_CLIENT_01_248: [ A Ping frame MAY include "Application data". ]*/
                                     pong_frame = BUFFER_u_char(pong_frame_buffer);
                                     pong_frame_length = BUFFER_length(pong_frame_buffer);
+                                    flush_coalesced_frames(uws_client);
                                     if (xio_send(uws_client->underlying_io, pong_frame, pong_frame_length, NULL, NULL) != 0)
                                     {
                                         LogError("Sending CLOSE frame failed.");
@@ -1375,6 +2141,8 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
                             }
                             /* Codes_SRS_UWS_CLIENT_01_252: [ The Pong frame contains an opcode of 0xA. ]*/
                             case (unsigned char)WS_PONG_FRAME:
+                                /* Codes_SRS_UWS_CLIENT_01_584: [ When a PONG frame is received, the PINGs sent before it shall be considered answered. ]*/
+                                uws_client->is_waiting_for_pong = false;
                                 break;
                             }
 
@@ -1426,6 +2194,33 @@ static void on_underlying_io_error(void* context)
     }
 }
 
+int uws_client_set_on_fragment_received(UWS_CLIENT_HANDLE uws_client, ON_WS_FRAGMENT_RECEIVED on_ws_fragment_received, void* on_ws_fragment_received_context)
+{
+    int result;
+
+    if (uws_client == NULL)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_535: [ If `uws_client` is NULL, `uws_client_set_on_fragment_received` shall fail and return a non-zero value. ]*/
+        LogError("NULL uws handle.");
+        result = __FAILURE__;
+    }
+    else if (uws_client->uws_state != UWS_STATE_CLOSED)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_536: [ If the uws instance is not CLOSED, `uws_client_set_on_fragment_received` shall fail and return a non-zero value. ]*/
+        LogError("Cannot change the fragment received callback while the uws instance is open.");
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* Codes_SRS_UWS_CLIENT_01_537: [ `uws_client_set_on_fragment_received` shall save `on_ws_fragment_received` and `on_ws_fragment_received_context` and return 0. A NULL `on_ws_fragment_received` restores the indication of whole frames through `on_ws_frame_received`. ]*/
+        uws_client->on_ws_fragment_received = on_ws_fragment_received;
+        uws_client->on_ws_fragment_received_context = on_ws_fragment_received_context;
+        result = 0;
+    }
+
+    return result;
+}
+
 int uws_client_open_async(UWS_CLIENT_HANDLE uws_client, ON_WS_OPEN_COMPLETE on_ws_open_complete, void* on_ws_open_complete_context, ON_WS_FRAME_RECEIVED on_ws_frame_received, void* on_ws_frame_received_context, ON_WS_PEER_CLOSED on_ws_peer_closed, void* on_ws_peer_closed_context, ON_WS_ERROR on_ws_error, void* on_ws_error_context)
 {
     int result;
@@ -1455,7 +2250,23 @@ int uws_client_open_async(UWS_CLIENT_HANDLE uws_client, ON_WS_OPEN_COMPLETE on_w
         {
             uws_client->uws_state = UWS_STATE_OPENING_UNDERLYING_IO;
 
+            uws_client->received_bytes = uws_client->received_bytes_buffer;
             uws_client->received_bytes_count = 0;
+            http_response_parser_init(&uws_client->upgrade_response_parser);
+            uws_client->is_keepalive_started = false;
+            uws_client->is_waiting_for_pong = false;
+            uws_client->is_sending_fragmented_message = false;
+            uws_client->is_receiving_fragmented_message = false;
+            uws_client->fragment_payload_bytes_left = 0;
+            uws_client->is_sending_compressed_message = false;
+            uws_client->is_receiving_compressed_message = false;
+
+            /* Compression is negotiated again for every connection */
+            if (uws_client->uws_deflate != NULL)
+            {
+                uws_deflate_destroy(uws_client->uws_deflate);
+                uws_client->uws_deflate = NULL;
+            }
 
             uws_client->on_ws_open_complete = on_ws_open_complete;
             uws_client->on_ws_open_complete_context = on_ws_open_complete_context;
@@ -1488,34 +2299,6 @@ int uws_client_open_async(UWS_CLIENT_HANDLE uws_client, ON_WS_OPEN_COMPLETE on_w
     return result;
 }
 
-static int complete_send_frame(WS_PENDING_SEND* ws_pending_send, LIST_ITEM_HANDLE pending_send_frame_item, WS_SEND_FRAME_RESULT ws_send_frame_result)
-{
-    int result;
-    UWS_CLIENT_INSTANCE* uws_client = ws_pending_send->uws_client;
-
-    /* Codes_SRS_UWS_CLIENT_01_432: [ The indicated sent frame shall be removed from the list by calling `singlylinkedlist_remove`. ]*/
-    if (singlylinkedlist_remove(uws_client->pending_sends, pending_send_frame_item) != 0)
-    {
-        LogError("Failed removing item from list");
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (ws_pending_send->on_ws_send_frame_complete != NULL)
-        {
-            /* Codes_SRS_UWS_CLIENT_01_037: [ When indicating pending send frames as cancelled the callback context passed to the `on_ws_send_frame_complete` callback shall be the context given to `uws_client_send_frame_async`. ]*/
-            ws_pending_send->on_ws_send_frame_complete(ws_pending_send->context, ws_send_frame_result);
-        }
-
-        /* Codes_SRS_UWS_CLIENT_01_434: [ The memory associated with the sent frame shall be freed. ]*/
-        free(ws_pending_send);
-
-        result = 0;
-    }
-
-    return result;
-}
-
 /* Codes_SRS_UWS_CLIENT_01_029: [ `uws_client_close_async` shall close the uws instance connection if an open action is either pending or has completed successfully (if the IO is open). ]*/
 /* Codes_SRS_UWS_CLIENT_01_317: [ Clients SHOULD NOT close the WebSocket connection arbitrarily. ]*/
 int uws_client_close_async(UWS_CLIENT_HANDLE uws_client, ON_WS_CLOSE_COMPLETE on_ws_close_complete, void* on_ws_close_complete_context)
@@ -1562,6 +2345,9 @@ int uws_client_close_async(UWS_CLIENT_HANDLE uws_client, ON_WS_CLOSE_COMPLETE on
                 /* Codes_SRS_UWS_CLIENT_01_034: [ `uws_client_close_async` shall obtain all the pending send frames by repetitively querying for the head of the pending IO list and freeing that head item. ]*/
                 LIST_ITEM_HANDLE first_pending_send;
 
+                /* Codes_SRS_UWS_CLIENT_01_573: [ Coalesced frames that were not sent yet shall be indicated as cancelled together with the other pending send frames. ]*/
+                discard_coalesced_frames(uws_client);
+
                 /* Codes_SRS_UWS_CLIENT_01_035: [ Obtaining the head of the pending send frames list shall be done by calling `singlylinkedlist_get_head_item`. ]*/
                 while ((first_pending_send = singlylinkedlist_get_head_item(uws_client->pending_sends)) != NULL)
                 {
@@ -1626,6 +2412,8 @@ int uws_client_close_handshake_async(UWS_CLIENT_HANDLE uws_client, uint16_t clos
             {
                 LIST_ITEM_HANDLE first_pending_send;
 
+                discard_coalesced_frames(uws_client);
+
                 while ((first_pending_send = singlylinkedlist_get_head_item(uws_client->pending_sends)) != NULL)
                 {
                     WS_PENDING_SEND* ws_pending_send = (WS_PENDING_SEND*)singlylinkedlist_item_get_value(first_pending_send);
@@ -1654,39 +2442,89 @@ static void on_underlying_io_send_complete(void* context, IO_SEND_RESULT send_re
         LIST_ITEM_HANDLE ws_pending_send_list_item = (LIST_ITEM_HANDLE)context;
         WS_PENDING_SEND* ws_pending_send = (WS_PENDING_SEND*)singlylinkedlist_item_get_value(ws_pending_send_list_item);
         UWS_CLIENT_HANDLE uws_client = ws_pending_send->uws_client;
-        WS_SEND_FRAME_RESULT ws_send_frame_result;
+        WS_SEND_FRAME_RESULT ws_send_frame_result = get_ws_send_frame_result(send_result);
 
-        switch (send_result)
+        if (complete_send_frame(ws_pending_send, ws_pending_send_list_item, ws_send_frame_result) != 0)
         {
-        /* Codes_SRS_UWS_CLIENT_01_436: [ When `on_underlying_io_send_complete` is called with any other error code, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_ERROR`. ]*/
-        default:
-        case IO_SEND_ERROR:
-            /* Codes_SRS_UWS_CLIENT_01_390: [ When `on_underlying_io_send_complete` is called with `IO_SEND_ERROR` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_ERROR`. ]*/
-            ws_send_frame_result = WS_SEND_FRAME_ERROR;
-            break;
+            /* Codes_SRS_UWS_CLIENT_01_433: [ If `singlylinkedlist_remove` fails an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST`. ]*/
+            indicate_ws_error(uws_client, WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST);
+        }
+    }
+}
 
-        case IO_SEND_OK:
-            /* Codes_SRS_UWS_CLIENT_01_389: [ When `on_underlying_io_send_complete` is called with `IO_SEND_OK` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_OK`. ]*/
-            ws_send_frame_result = WS_SEND_FRAME_OK;
-            break;
+/* Codes_SRS_UWS_CLIENT_01_533: [ If `size` is larger than 16384 bytes, the frame header shall be obtained by calling `uws_frame_encoder_encode_header` and the frame shall be sent with several `xio_send` calls, each one with at most 16384 bytes of header and payload masked with `uws_frame_encoder_mask`, without encoding the whole frame into a buffer. Only the last `xio_send` shall be given `on_underlying_io_send_complete`. ]*/
+static int send_frame_in_chunks(UWS_CLIENT_INSTANCE* uws_client, LIST_ITEM_HANDLE pending_send_list_item, WS_FRAME_TYPE frame_type, const unsigned char* buffer, size_t size, bool is_final, unsigned char reserved)
+{
+    int result;
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    size_t header_length;
 
-        case IO_SEND_CANCELLED:
-            /* Codes_SRS_UWS_CLIENT_01_391: [ When `on_underlying_io_send_complete` is called with `IO_SEND_CANCELLED` as a result of sending a WebSocket frame to the underlying IO, the send shall be indicated to the uws user by calling `on_ws_send_frame_complete` with `WS_SEND_FRAME_CANCELLED`. ]*/
-            ws_send_frame_result = WS_SEND_FRAME_CANCELLED;
-            break;
-        }
+    if ((uws_client->send_chunk == NULL) &&
+        ((uws_client->send_chunk = (unsigned char*)malloc(UWS_CLIENT_SEND_CHUNK_SIZE)) == NULL))
+    {
+        LogError("Cannot allocate the send chunk buffer");
+        result = __FAILURE__;
+    }
+    else if (uws_frame_encoder_encode_header(frame_type, size, true, is_final, reserved, header, &header_length) != 0)
+    {
+        LogError("Failed encoding WebSocket frame header");
+        result = __FAILURE__;
+    }
+    else
+    {
+        const unsigned char* masking_key = header + header_length - 4;
+        size_t chunk_header_length = header_length;
+        size_t sent_bytes = 0;
 
-        if (complete_send_frame(ws_pending_send, ws_pending_send_list_item, ws_send_frame_result) != 0)
+        (void)memcpy(uws_client->send_chunk, header, header_length);
+
+        uws_client->is_sending_chunks = true;
+        result = 0;
+
+        while (sent_bytes < size)
         {
-            /* Codes_SRS_UWS_CLIENT_01_433: [ If `singlylinkedlist_remove` fails an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST`. ]*/
-            indicate_ws_error(uws_client, WS_ERROR_CANNOT_REMOVE_SENT_ITEM_FROM_LIST);
+            /* Chunks hold a multiple of 4 payload bytes, so each one starts at octet 0 of the masking key */
+            size_t chunk_payload_length = (UWS_CLIENT_SEND_CHUNK_SIZE - chunk_header_length) & ~(size_t)3;
+            bool is_last_chunk;
+
+            if (chunk_payload_length > size - sent_bytes)
+            {
+                chunk_payload_length = size - sent_bytes;
+            }
+
+            (void)uws_frame_encoder_mask(uws_client->send_chunk + chunk_header_length, buffer + sent_bytes, chunk_payload_length, masking_key);
+            is_last_chunk = (sent_bytes + chunk_payload_length == size);
+
+            /* Only the last chunk completes the pending send */
+            if (xio_send(uws_client->underlying_io, uws_client->send_chunk, chunk_header_length + chunk_payload_length,
+                is_last_chunk ? on_underlying_io_send_complete : NULL, is_last_chunk ? pending_send_list_item : NULL) != 0)
+            {
+                LogError("Could not send bytes through the underlying IO");
+                if (sent_bytes > 0)
+                {
+                    /* Part of the frame is already on the wire, nothing else can be sent on this connection */
+                    uws_client->uws_state = UWS_STATE_ERROR;
+                }
+
+                result = __FAILURE__;
+                break;
+            }
+
+            sent_bytes += chunk_payload_length;
+            chunk_header_length = 0;
         }
+
+        uws_client->is_sending_chunks = false;
     }
+
+    return result;
 }
 
 int uws_client_send_frame_async(UWS_CLIENT_HANDLE uws_client, unsigned char frame_type, const unsigned char* buffer, size_t size, bool is_final, ON_WS_SEND_FRAME_COMPLETE on_ws_send_frame_complete, void* on_ws_send_frame_complete_context)
 {
     int result;
+    bool is_compressed = false;
+    unsigned char reserved = 0;
 
     if (uws_client == NULL)
     {
@@ -1709,25 +2547,114 @@ int uws_client_send_frame_async(UWS_CLIENT_HANDLE uws_client, unsigned char fram
         LogError("uws not in OPEN state.");
         result = __FAILURE__;
     }
+    else if (uws_client->is_sending_chunks)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_534: [ If `uws_client_send_frame_async` is called from a callback triggered while a frame is being sent in chunks, it shall fail and return a non-zero value. ]*/
+        LogError("Cannot send a frame while another frame is being sent in chunks.");
+        result = __FAILURE__;
+    }
+    else if (((frame_type == WS_FRAME_TYPE_CONTINUATION) && !uws_client->is_sending_fragmented_message) ||
+        (((frame_type == WS_FRAME_TYPE_TEXT) || (frame_type == WS_FRAME_TYPE_BINARY)) && uws_client->is_sending_fragmented_message))
+    {
+        /* Codes_SRS_UWS_CLIENT_01_543: [ If `frame_type` is `WS_FRAME_TYPE_CONTINUATION` and no fragmented message is being sent, or `frame_type` is `WS_FRAME_TYPE_TEXT` or `WS_FRAME_TYPE_BINARY` while one is being sent, `uws_client_send_frame_async` shall fail and return a non-zero value. ]*/
+        LogError("Frame type %u does not match the fragmented message state.", (unsigned int)frame_type);
+        result = __FAILURE__;
+    }
     else
     {
-        WS_PENDING_SEND* ws_pending_send = (WS_PENDING_SEND*)malloc(sizeof(WS_PENDING_SEND));
-        if (ws_pending_send == NULL)
+        WS_PENDING_SEND* ws_pending_send;
+
+        if (frame_type == WS_FRAME_TYPE_CONTINUATION)
+        {
+            is_compressed = uws_client->is_sending_compressed_message;
+        }
+        else if ((frame_type == WS_FRAME_TYPE_TEXT) || (frame_type == WS_FRAME_TYPE_BINARY))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_554: [ The `ws_compress_messages` option shall only be applied to messages that start after it is set. ]*/
+            is_compressed = (uws_client->uws_deflate != NULL) && uws_client->compress_messages;
+
+            /* Codes_SRS_UWS_CLIENT_01_553: [ The RSV1 bit shall be set only on the first frame of a compressed message. ]*/
+            reserved = is_compressed ? RESERVED_1 : 0;
+        }
+
+        /* Codes_SRS_UWS_CLIENT_01_555: [ When permessage-deflate has been negotiated and the `ws_compress_messages` option is enabled, the payload of text, binary and continuation frames shall be compressed by calling `uws_deflate_compress` and the compressed bytes shall be sent instead of `buffer`. ]*/
+        if (is_compressed &&
+            (uws_deflate_compress(uws_client->uws_deflate, buffer, size, is_final, &buffer, &size) != 0))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_556: [ If `uws_deflate_compress` fails, `uws_client_send_frame_async` shall fail and return a non-zero value. ]*/
+            LogError("Cannot compress the frame payload");
+            result = __FAILURE__;
+        }
+        else if ((ws_pending_send = allocate_pending_send(uws_client)) == NULL)
         {
             /* Codes_SRS_UWS_CLIENT_01_047: [ If allocating memory for the newly queued item fails, `uws_client_send_frame_async` shall fail and return a non-zero value. ]*/
             LogError("Cannot allocate memory for frame to be sent.");
             result = __FAILURE__;
         }
+        else if ((uws_client->send_coalescing_size > 0) &&
+            (size <= uws_client->send_coalescing_size - UWS_FRAME_ENCODER_MAX_HEADER_SIZE))
+        {
+            ws_pending_send->on_ws_send_frame_complete = on_ws_send_frame_complete;
+            ws_pending_send->context = on_ws_send_frame_complete_context;
+            ws_pending_send->uws_client = uws_client;
+
+            /* Codes_SRS_UWS_CLIENT_01_569: [ When `ws_send_coalescing_size` is not 0, frames whose encoded size fits in it shall be encoded with `uws_frame_encoder_encode_header` and `uws_frame_encoder_mask` into a coalescing buffer of that size instead of being sent right away. ]*/
+            if (coalesce_frame(uws_client, ws_pending_send, (WS_FRAME_TYPE)frame_type, buffer, size, is_final, reserved) != 0)
+            {
+                LogError("Could not coalesce the frame");
+                free(ws_pending_send);
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+        else if (size > UWS_CLIENT_SEND_CHUNK_SIZE)
+        {
+            LIST_ITEM_HANDLE new_pending_send_list_item;
+
+            ws_pending_send->on_ws_send_frame_complete = on_ws_send_frame_complete;
+            ws_pending_send->context = on_ws_send_frame_complete_context;
+            ws_pending_send->uws_client = uws_client;
+
+            if (flush_coalesced_frames_before_send(uws_client) != 0)
+            {
+                free(ws_pending_send);
+                result = __FAILURE__;
+            }
+            else if ((new_pending_send_list_item = singlylinkedlist_add(uws_client->pending_sends, ws_pending_send)) == NULL)
+            {
+                LogError("Could not allocate memory for pending frames");
+                free(ws_pending_send);
+                result = __FAILURE__;
+            }
+            else if (send_frame_in_chunks(uws_client, new_pending_send_list_item, (WS_FRAME_TYPE)frame_type, buffer, size, is_final, reserved) != 0)
+            {
+                LogError("Could not send the frame in chunks");
+                (void)singlylinkedlist_remove(uws_client->pending_sends, new_pending_send_list_item);
+                free(ws_pending_send);
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
         else
         {
             BUFFER_HANDLE non_control_frame_buffer;
 
+            if (flush_coalesced_frames_before_send(uws_client) != 0)
+            {
+                free(ws_pending_send);
+                result = __FAILURE__;
+            }
             /* Codes_SRS_UWS_CLIENT_01_425: [ Encoding shall be done by calling `uws_frame_encoder_encode` and passing to it the `buffer` and `size` argument for payload, the `is_final` flag and setting `is_masked` to true. ]*/
             /* Codes_SRS_UWS_CLIENT_01_270: [ An endpoint MUST encapsulate the /data/ in a WebSocket frame as defined in Section 5.2. ]*/
             /* Codes_SRS_UWS_CLIENT_01_272: [ The opcode (frame-opcode) of the first frame containing the data MUST be set to the appropriate value from Section 5.2 for data that is to be interpreted by the recipient as text or binary data. ]*/
             /* Codes_SRS_UWS_CLIENT_01_274: [ If the data is being sent by the client, the frame(s) MUST be masked as defined in Section 5.3. ]*/
-            non_control_frame_buffer = uws_frame_encoder_encode((WS_FRAME_TYPE)frame_type, buffer, size, true, is_final, 0);
-            if (non_control_frame_buffer == NULL)
+            else if ((non_control_frame_buffer = uws_frame_encoder_encode((WS_FRAME_TYPE)frame_type, buffer, size, true, is_final, reserved)) == NULL)
             {
                 /* Codes_SRS_UWS_CLIENT_01_426: [ If `uws_frame_encoder_encode` fails, `uws_client_send_frame_async` shall fail and return a non-zero value. ]*/
                 LogError("Failed encoding WebSocket frame");
@@ -1789,11 +2716,79 @@ int uws_client_send_frame_async(UWS_CLIENT_HANDLE uws_client, unsigned char fram
                 BUFFER_delete(non_control_frame_buffer);
             }
         }
+
+        if ((result == 0) &&
+            ((frame_type == WS_FRAME_TYPE_CONTINUATION) || (frame_type == WS_FRAME_TYPE_TEXT) || (frame_type == WS_FRAME_TYPE_BINARY)))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_542: [ After a text or binary frame is sent with `is_final` set to false, the next fragments of the message shall be sent by calling `uws_client_send_frame_async` with `frame_type` set to `WS_FRAME_TYPE_CONTINUATION`, the last one with `is_final` set to true. ]*/
+            uws_client->is_sending_fragmented_message = !is_final;
+            uws_client->is_sending_compressed_message = is_compressed && !is_final;
+        }
+        else if (is_compressed)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_557: [ If a compressed message fails to be sent, the compression history shall be dropped by calling `uws_deflate_reset_compressor`. ]*/
+            uws_deflate_reset_compressor(uws_client->uws_deflate);
+        }
     }
 
     return result;
 }
 
+static void send_keepalive_ping(UWS_CLIENT_INSTANCE* uws_client)
+{
+    size_t ping_frame_length;
+
+    /* Codes_SRS_UWS_CLIENT_01_582: [ The PING frame shall have no payload and shall be encoded with `uws_frame_encoder_encode_header` into a buffer owned by the uws instance, so that no memory is allocated for each PING. ]*/
+    if (uws_frame_encoder_encode_header(WS_PING_FRAME, 0, true, true, 0, uws_client->ping_frame, &ping_frame_length) != 0)
+    {
+        LogError("Encoding of PING failed.");
+    }
+    else
+    {
+        flush_coalesced_frames(uws_client);
+        if (xio_send(uws_client->underlying_io, uws_client->ping_frame, ping_frame_length, NULL, NULL) != 0)
+        {
+            LogError("Sending PING frame failed.");
+        }
+    }
+}
+
+static void check_keepalive(UWS_CLIENT_INSTANCE* uws_client)
+{
+    tickcounter_ms_t current_ms;
+
+    /* Codes_SRS_UWS_CLIENT_01_580: [ When `ws_ping_interval_ms` is not 0 and the uws instance is OPEN, after calling `xio_dowork`, `uws_client_dowork` shall get the current time by calling `tickcounter_get_current_ms`. ]*/
+    if (tickcounter_get_current_ms(uws_client->tick_counter, &current_ms) != 0)
+    {
+        LogError("tickcounter_get_current_ms failed");
+    }
+    else if (!uws_client->is_keepalive_started)
+    {
+        uws_client->last_ping_time = current_ms;
+        uws_client->is_keepalive_started = true;
+    }
+    else if (uws_client->is_waiting_for_pong &&
+        (uws_client->pong_timeout_ms > 0) &&
+        ((size_t)(current_ms - uws_client->unanswered_ping_time) >= uws_client->pong_timeout_ms))
+    {
+        /* Codes_SRS_UWS_CLIENT_01_583: [ If `ws_pong_timeout_ms` is not 0 and no PONG frame has been received `ws_pong_timeout_ms` after the oldest unanswered PING was sent, an error shall be indicated by calling the `on_ws_error` callback with `WS_ERROR_PONG_TIMEOUT`. ]*/
+        LogError("No PONG received in %lu ms", (unsigned long)uws_client->pong_timeout_ms);
+        indicate_ws_error(uws_client, WS_ERROR_PONG_TIMEOUT);
+    }
+    else if ((size_t)(current_ms - uws_client->last_ping_time) >= uws_client->ping_interval_ms)
+    {
+        /* Codes_SRS_UWS_CLIENT_01_581: [ A PING frame shall be sent when `ws_ping_interval_ms` have elapsed since `uws_client_dowork` first found the uws instance OPEN or since the last PING was sent. ]*/
+        send_keepalive_ping(uws_client);
+        uws_client->last_ping_time = current_ms;
+
+        if (!uws_client->is_waiting_for_pong)
+        {
+            uws_client->is_waiting_for_pong = true;
+            uws_client->unanswered_ping_time = current_ms;
+        }
+    }
+}
+
 void uws_client_dowork(UWS_CLIENT_HANDLE uws_client)
 {
     if (uws_client == NULL)
@@ -1806,8 +2801,17 @@ void uws_client_dowork(UWS_CLIENT_HANDLE uws_client)
         /* Codes_SRS_UWS_CLIENT_01_060: [ If the IO is not yet open, `uws_client_dowork` shall do nothing. ]*/
         if (uws_client->uws_state != UWS_STATE_CLOSED)
         {
+            /* Codes_SRS_UWS_CLIENT_01_578: [ Before calling `xio_dowork`, `uws_client_dowork` shall send the frames coalesced since the last call. ]*/
+            flush_coalesced_frames(uws_client);
+
             /* Codes_SRS_UWS_CLIENT_01_430: [ `uws_client_dowork` shall call `xio_dowork` with the IO handle argument set to the underlying IO created in `uws_client_create`. ]*/
             xio_dowork(uws_client->underlying_io);
+
+            if ((uws_client->uws_state == UWS_STATE_OPEN) &&
+                (uws_client->ping_interval_ms > 0))
+            {
+                check_keepalive(uws_client);
+            }
         }
     }
 }
@@ -1842,6 +2846,126 @@ int uws_client_set_option(UWS_CLIENT_HANDLE uws_client, const char* option_name,
                 result = 0;
             }
         }
+        /* Codes_SRS_UWS_CLIENT_01_558: [ The permessage-deflate options shall be stored by the uws instance and used by the next `uws_client_open_async`, except `ws_compress_messages` which applies to the next message sent. ]*/
+        else if (strcmp(OPTION_WS_PERMESSAGE_DEFLATE, option_name) == 0)
+        {
+            if ((*(const int*)value != 0) && !uws_deflate_is_supported())
+            {
+                /* Codes_SRS_UWS_CLIENT_01_559: [ If `ws_permessage_deflate` is enabled and `uws_deflate_is_supported` returns false, `uws_client_set_option` shall fail and return a non-zero value. ]*/
+                LogError("permessage-deflate is not supported by this build");
+                result = __FAILURE__;
+            }
+            else
+            {
+                uws_client->is_deflate_enabled = (*(const int*)value != 0);
+                result = 0;
+            }
+        }
+        else if ((strcmp(OPTION_WS_DEFLATE_CLIENT_MAX_WINDOW_BITS, option_name) == 0) ||
+            (strcmp(OPTION_WS_DEFLATE_SERVER_MAX_WINDOW_BITS, option_name) == 0))
+        {
+            int window_bits = *(const int*)value;
+            if ((window_bits < 9) || (window_bits > 15))
+            {
+                /* Codes_SRS_UWS_CLIENT_01_560: [ If a window bits option is not between 9 and 15 or `ws_deflate_mem_level` is not between 1 and 9, `uws_client_set_option` shall fail and return a non-zero value. ]*/
+                LogError("Invalid %s: %d", option_name, window_bits);
+                result = __FAILURE__;
+            }
+            else
+            {
+                if (strcmp(OPTION_WS_DEFLATE_CLIENT_MAX_WINDOW_BITS, option_name) == 0)
+                {
+                    uws_client->deflate_config.client_max_window_bits = window_bits;
+                }
+                else
+                {
+                    uws_client->deflate_config.server_max_window_bits = window_bits;
+                }
+
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_WS_DEFLATE_MEM_LEVEL, option_name) == 0)
+        {
+            int mem_level = *(const int*)value;
+            if ((mem_level < 1) || (mem_level > 9))
+            {
+                LogError("Invalid %s: %d", option_name, mem_level);
+                result = __FAILURE__;
+            }
+            else
+            {
+                uws_client->deflate_config.mem_level = mem_level;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_WS_DEFLATE_CLIENT_NO_CONTEXT_TAKEOVER, option_name) == 0)
+        {
+            uws_client->deflate_config.client_no_context_takeover = (*(const int*)value != 0);
+            result = 0;
+        }
+        else if (strcmp(OPTION_WS_DEFLATE_SERVER_NO_CONTEXT_TAKEOVER, option_name) == 0)
+        {
+            uws_client->deflate_config.server_no_context_takeover = (*(const int*)value != 0);
+            result = 0;
+        }
+        else if (strcmp(OPTION_WS_DEFLATE_MAX_MESSAGE_SIZE, option_name) == 0)
+        {
+            uws_client->deflate_config.max_message_size = *(const size_t*)value;
+            result = 0;
+        }
+        else if (strcmp(OPTION_WS_COMPRESS_MESSAGES, option_name) == 0)
+        {
+            uws_client->compress_messages = (*(const int*)value != 0);
+            result = 0;
+        }
+        else if (strcmp(OPTION_WS_SEND_COALESCING_SIZE, option_name) == 0)
+        {
+            size_t send_coalescing_size = *(const size_t*)value;
+            if ((send_coalescing_size != 0) &&
+                ((send_coalescing_size <= UWS_FRAME_ENCODER_MAX_HEADER_SIZE) || (send_coalescing_size > UWS_CLIENT_SEND_CHUNK_SIZE)))
+            {
+                /* Codes_SRS_UWS_CLIENT_01_574: [ If `ws_send_coalescing_size` is not 0 and is not between 15 and 16384, `uws_client_set_option` shall fail and return a non-zero value. ]*/
+                LogError("Invalid %s: %zu", option_name, send_coalescing_size);
+                result = __FAILURE__;
+            }
+            else
+            {
+                /* Codes_SRS_UWS_CLIENT_01_568: [ The `ws_send_coalescing_size` option shall set the largest number of bytes of frames written to the underlying IO with one `xio_send`; 0, the default, sends each frame on its own. ]*/
+                /* Codes_SRS_UWS_CLIENT_01_575: [ Frames already coalesced shall be sent before the new size is applied. ]*/
+                flush_coalesced_frames(uws_client);
+                free(uws_client->coalesce_buffer);
+                uws_client->coalesce_buffer = NULL;
+                uws_client->send_coalescing_size = send_coalescing_size;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_WS_PING_INTERVAL_MS, option_name) == 0)
+        {
+            size_t ping_interval_ms = *(const size_t*)value;
+            if ((ping_interval_ms > 0) &&
+                (uws_client->tick_counter == NULL) &&
+                ((uws_client->tick_counter = tickcounter_create()) == NULL))
+            {
+                /* Codes_SRS_UWS_CLIENT_01_587: [ If `tickcounter_create` fails, `uws_client_set_option` shall fail and return a non-zero value. ]*/
+                LogError("tickcounter_create failed");
+                result = __FAILURE__;
+            }
+            else
+            {
+                /* Codes_SRS_UWS_CLIENT_01_585: [ The `ws_ping_interval_ms` option shall set the interval at which `uws_client_dowork` sends PING frames; 0, the default, sends no PING. ]*/
+                /* Codes_SRS_UWS_CLIENT_01_586: [ The first time `ws_ping_interval_ms` is set to a value other than 0, a tick counter shall be created by calling `tickcounter_create`. ]*/
+                uws_client->ping_interval_ms = ping_interval_ms;
+                uws_client->is_keepalive_started = false;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_WS_PONG_TIMEOUT_MS, option_name) == 0)
+        {
+            /* Codes_SRS_UWS_CLIENT_01_588: [ The `ws_pong_timeout_ms` option shall set how long after a PING a PONG frame has to be received; 0, the default, never fails the connection for a missing PONG. ]*/
+            uws_client->pong_timeout_ms = *(const size_t*)value;
+            result = 0;
+        }
         else
         {
             /* Codes_SRS_UWS_CLIENT_01_441: [ Otherwise all options shall be passed as they are to the underlying IO by calling `xio_setoption`. ]*/
@@ -1862,6 +2986,17 @@ int uws_client_set_option(UWS_CLIENT_HANDLE uws_client, const char* option_name,
     return result;
 }
 
+static bool is_int_deflate_option(const char* name)
+{
+    return (strcmp(name, OPTION_WS_PERMESSAGE_DEFLATE) == 0) ||
+        (strcmp(name, OPTION_WS_DEFLATE_CLIENT_MAX_WINDOW_BITS) == 0) ||
+        (strcmp(name, OPTION_WS_DEFLATE_SERVER_MAX_WINDOW_BITS) == 0) ||
+        (strcmp(name, OPTION_WS_DEFLATE_CLIENT_NO_CONTEXT_TAKEOVER) == 0) ||
+        (strcmp(name, OPTION_WS_DEFLATE_SERVER_NO_CONTEXT_TAKEOVER) == 0) ||
+        (strcmp(name, OPTION_WS_DEFLATE_MEM_LEVEL) == 0) ||
+        (strcmp(name, OPTION_WS_COMPRESS_MESSAGES) == 0);
+}
+
 static void* uws_client_clone_option(const char* name, const void* value)
 {
     void* result;
@@ -1882,6 +3017,40 @@ static void* uws_client_clone_option(const char* name, const void* value)
             /* Codes_SRS_UWS_CLIENT_01_507: [ `uws_client_clone_option` called with `name` being `uWSClientOptions` shall return the same value. ]*/
             result = (void*)value;
         }
+        else if ((strcmp(name, OPTION_WS_DEFLATE_MAX_MESSAGE_SIZE) == 0) ||
+            (strcmp(name, OPTION_WS_SEND_COALESCING_SIZE) == 0) ||
+            (strcmp(name, OPTION_WS_PING_INTERVAL_MS) == 0) ||
+            (strcmp(name, OPTION_WS_PONG_TIMEOUT_MS) == 0))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_577: [ `uws_client_clone_option` called with `ws_send_coalescing_size` shall return a newly allocated copy of the value. ]*/
+            /* Codes_SRS_UWS_CLIENT_01_591: [ `uws_client_clone_option` called with `ws_ping_interval_ms` or `ws_pong_timeout_ms` shall return a newly allocated copy of the value. ]*/
+            size_t* value_copy = (size_t*)malloc(sizeof(size_t));
+            if (value_copy == NULL)
+            {
+                LogError("unable to allocate %s value", name);
+            }
+            else
+            {
+                *value_copy = *(const size_t*)value;
+            }
+
+            result = value_copy;
+        }
+        else if (is_int_deflate_option(name))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_561: [ `uws_client_clone_option` called with a permessage-deflate option name shall return a newly allocated copy of the value. ]*/
+            int* value_copy = (int*)malloc(sizeof(int));
+            if (value_copy == NULL)
+            {
+                LogError("unable to allocate %s value", name);
+            }
+            else
+            {
+                *value_copy = *(const int*)value;
+            }
+
+            result = value_copy;
+        }
         else
         {
             /* Codes_SRS_UWS_CLIENT_01_512: [ `uws_client_clone_option` called with any other option name than `uWSClientOptions` shall return NULL. ]*/
@@ -1910,6 +3079,15 @@ static void uws_client_destroy_option(const char* name, const void* value)
             /* Codes_SRS_UWS_CLIENT_01_508: [ `uws_client_destroy_option` called with the option `name` being `uWSClientOptions` shall destroy the value by calling `OptionHandler_Destroy`. ]*/
             OptionHandler_Destroy((OPTIONHANDLER_HANDLE)value);
         }
+        else if ((strcmp(name, OPTION_WS_DEFLATE_MAX_MESSAGE_SIZE) == 0) ||
+            (strcmp(name, OPTION_WS_SEND_COALESCING_SIZE) == 0) ||
+            (strcmp(name, OPTION_WS_PING_INTERVAL_MS) == 0) ||
+            (strcmp(name, OPTION_WS_PONG_TIMEOUT_MS) == 0) ||
+            is_int_deflate_option(name))
+        {
+            /* Codes_SRS_UWS_CLIENT_01_562: [ `uws_client_destroy_option` called with a permessage-deflate option name shall free the value. ]*/
+            free((void*)value);
+        }
         else
         {
             /* Codes_SRS_UWS_CLIENT_01_513: [ If `uws_client_destroy_option` is called with any other `name` it shall do nothing. ]*/
@@ -1918,6 +3096,35 @@ static void uws_client_destroy_option(const char* name, const void* value)
     }
 }
 
+/* Codes_SRS_UWS_CLIENT_01_563: [ If `ws_permessage_deflate` is enabled, `uws_client_retrieve_options` shall also add the permessage-deflate options to the option handler. ]*/
+static int add_deflate_options(UWS_CLIENT_INSTANCE* uws_client, OPTIONHANDLER_HANDLE option_handler)
+{
+    int result;
+    int permessage_deflate = 1;
+    int client_no_context_takeover = uws_client->deflate_config.client_no_context_takeover ? 1 : 0;
+    int server_no_context_takeover = uws_client->deflate_config.server_no_context_takeover ? 1 : 0;
+    int compress_messages = uws_client->compress_messages ? 1 : 0;
+
+    if ((OptionHandler_AddOption(option_handler, OPTION_WS_PERMESSAGE_DEFLATE, &permessage_deflate) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_CLIENT_MAX_WINDOW_BITS, &uws_client->deflate_config.client_max_window_bits) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_SERVER_MAX_WINDOW_BITS, &uws_client->deflate_config.server_max_window_bits) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_CLIENT_NO_CONTEXT_TAKEOVER, &client_no_context_takeover) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_SERVER_NO_CONTEXT_TAKEOVER, &server_no_context_takeover) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_MEM_LEVEL, &uws_client->deflate_config.mem_level) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_DEFLATE_MAX_MESSAGE_SIZE, &uws_client->deflate_config.max_message_size) != OPTIONHANDLER_OK) ||
+        (OptionHandler_AddOption(option_handler, OPTION_WS_COMPRESS_MESSAGES, &compress_messages) != OPTIONHANDLER_OK))
+    {
+        LogError("unable to save the permessage-deflate options");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
 OPTIONHANDLER_HANDLE uws_client_retrieve_options(UWS_CLIENT_HANDLE uws_client)
 {
     OPTIONHANDLER_HANDLE result;
@@ -1960,6 +3167,30 @@ OPTIONHANDLER_HANDLE uws_client_retrieve_options(UWS_CLIENT_HANDLE uws_client)
                     OptionHandler_Destroy(result);
                     result = NULL;
                 }
+                else if (uws_client->is_deflate_enabled &&
+                    (add_deflate_options(uws_client, result) != 0))
+                {
+                    OptionHandler_Destroy(result);
+                    result = NULL;
+                }
+                /* Codes_SRS_UWS_CLIENT_01_576: [ If `ws_send_coalescing_size` is not 0, `uws_client_retrieve_options` shall also add it to the option handler. ]*/
+                else if ((uws_client->send_coalescing_size > 0) &&
+                    (OptionHandler_AddOption(result, OPTION_WS_SEND_COALESCING_SIZE, &uws_client->send_coalescing_size) != OPTIONHANDLER_OK))
+                {
+                    LogError("unable to save the %s option", OPTION_WS_SEND_COALESCING_SIZE);
+                    OptionHandler_Destroy(result);
+                    result = NULL;
+                }
+                /* Codes_SRS_UWS_CLIENT_01_590: [ If `ws_ping_interval_ms` or `ws_pong_timeout_ms` is not 0, `uws_client_retrieve_options` shall also add it to the option handler. ]*/
+                else if (((uws_client->ping_interval_ms > 0) &&
+                    (OptionHandler_AddOption(result, OPTION_WS_PING_INTERVAL_MS, &uws_client->ping_interval_ms) != OPTIONHANDLER_OK)) ||
+                    ((uws_client->pong_timeout_ms > 0) &&
+                    (OptionHandler_AddOption(result, OPTION_WS_PONG_TIMEOUT_MS, &uws_client->pong_timeout_ms) != OPTIONHANDLER_OK)))
+                {
+                    LogError("unable to save the keepalive options");
+                    OptionHandler_Destroy(result);
+                    result = NULL;
+                }
             }
         }
        
@@ -0,0 +1,691 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <zlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/uws_deflate.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+/* Decompressed bytes are handed out in pieces of at most this size */
+#define UWS_DEFLATE_OUTPUT_CHUNK_SIZE 16384
+/* zlib counts bytes in uInt, larger inputs are fed in several steps */
+#define UWS_DEFLATE_MAX_ZLIB_CHUNK ((size_t)1 << 30)
+/* A compressed buffer grown beyond this size by a large message is released by the next message */
+#define UWS_DEFLATE_RETAINED_BUFFER_SIZE 65536
+
+static const unsigned char deflate_tail[] = { 0x00, 0x00, 0xFF, 0xFF };
+
+typedef struct UWS_DEFLATE_INSTANCE_TAG
+{
+    z_stream deflate_stream;
+    z_stream inflate_stream;
+    bool is_deflate_initialized;
+    bool is_inflate_initialized;
+    int client_window_bits;
+    int server_window_bits;
+    int mem_level;
+    bool client_no_context_takeover;
+    bool server_no_context_takeover;
+    size_t max_message_size;
+    size_t inflated_message_size;
+    bool is_message_too_large;
+    unsigned char* compressed_buffer;
+    size_t compressed_buffer_size;
+    unsigned char* inflate_buffer;
+} UWS_DEFLATE_INSTANCE;
+
+static voidpf uws_deflate_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+    return malloc((size_t)items * size);
+}
+
+static void uws_deflate_zfree(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    free(address);
+}
+
+static bool is_config_valid(const UWS_DEFLATE_CONFIG* config)
+{
+    return (config->client_max_window_bits >= 9) && (config->client_max_window_bits <= 15) &&
+        (config->server_max_window_bits >= 9) && (config->server_max_window_bits <= 15) &&
+        (config->mem_level >= 1) && (config->mem_level <= 9);
+}
+
+static const char* skip_spaces(const char* position)
+{
+    while ((*position == ' ') || (*position == '\t'))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+static size_t get_token_length(const char* position)
+{
+    size_t length = 0;
+
+    while ((position[length] != '\0') && (position[length] != ';') && (position[length] != ',') &&
+        (position[length] != '=') && (position[length] != ' ') && (position[length] != '\t'))
+    {
+        length++;
+    }
+
+    return length;
+}
+
+static bool is_token(const char* position, size_t length, const char* token)
+{
+    size_t i;
+    bool result = (strlen(token) == length);
+
+    for (i = 0; result && (i < length); i++)
+    {
+        result = (tolower((unsigned char)position[i]) == token[i]);
+    }
+
+    return result;
+}
+
+/* Reads a window bits value, plain or quoted, and returns it or -1 if it is not between 8 and 15 */
+static int parse_window_bits(const char** position)
+{
+    int result = 0;
+    bool is_quoted = (**position == '"');
+    size_t digit_count = 0;
+
+    if (is_quoted)
+    {
+        (*position)++;
+    }
+
+    while ((**position >= '0') && (**position <= '9') && (digit_count < 3))
+    {
+        result = (result * 10) + (**position - '0');
+        (*position)++;
+        digit_count++;
+    }
+
+    if (is_quoted)
+    {
+        if (**position == '"')
+        {
+            (*position)++;
+        }
+        else
+        {
+            digit_count = 0;
+        }
+    }
+
+    if ((digit_count == 0) || (result < 8) || (result > 15))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/* Applies the parameters of the server's extension response, following RFC 7692 section 7.1 */
+static int negotiate_parameters(UWS_DEFLATE_INSTANCE* instance, const UWS_DEFLATE_CONFIG* config, const char* extension_response)
+{
+    int result = 0;
+    const char* position = skip_spaces(extension_response);
+    size_t token_length = get_token_length(position);
+    bool has_server_no_context_takeover = false;
+    bool has_client_no_context_takeover = false;
+    int server_window_bits = -1;
+    int client_window_bits = -1;
+
+    if (!is_token(position, token_length, "permessage-deflate"))
+    {
+        LogError("Server accepted an extension that was not offered: %s", extension_response);
+        result = __FAILURE__;
+    }
+    else
+    {
+        position = skip_spaces(position + token_length);
+
+        while ((result == 0) && (*position == ';'))
+        {
+            position = skip_spaces(position + 1);
+            token_length = get_token_length(position);
+
+            if (is_token(position, token_length, "server_no_context_takeover") && !has_server_no_context_takeover)
+            {
+                has_server_no_context_takeover = true;
+                position += token_length;
+            }
+            else if (is_token(position, token_length, "client_no_context_takeover") && !has_client_no_context_takeover)
+            {
+                has_client_no_context_takeover = true;
+                position += token_length;
+            }
+            else if (is_token(position, token_length, "server_max_window_bits") && (server_window_bits == -1))
+            {
+                position = skip_spaces(position + token_length);
+                if (*position != '=')
+                {
+                    server_window_bits = -1;
+                }
+                else
+                {
+                    position = skip_spaces(position + 1);
+                    server_window_bits = parse_window_bits(&position);
+                }
+
+                if ((server_window_bits == -1) ||
+                    (server_window_bits > config->server_max_window_bits))
+                {
+                    LogError("Bad server_max_window_bits in extension response: %s", extension_response);
+                    result = __FAILURE__;
+                }
+            }
+            else if (is_token(position, token_length, "client_max_window_bits") && (client_window_bits == -1))
+            {
+                position = skip_spaces(position + token_length);
+                if (*position != '=')
+                {
+                    client_window_bits = -1;
+                }
+                else
+                {
+                    position = skip_spaces(position + 1);
+                    client_window_bits = parse_window_bits(&position);
+                }
+
+                /* zlib cannot produce raw deflate data with a 256 byte window */
+                if ((client_window_bits == -1) ||
+                    (client_window_bits < 9))
+                {
+                    LogError("Bad client_max_window_bits in extension response: %s", extension_response);
+                    result = __FAILURE__;
+                }
+            }
+            else
+            {
+                LogError("Unexpected or repeated parameter in extension response: %s", extension_response);
+                result = __FAILURE__;
+            }
+
+            position = skip_spaces(position);
+        }
+
+        if (result != 0)
+        {
+            /* already logged */
+        }
+        else if (*position != '\0')
+        {
+            LogError("Cannot parse extension response: %s", extension_response);
+            result = __FAILURE__;
+        }
+        else if ((config->server_no_context_takeover && !has_server_no_context_takeover) ||
+            ((config->server_max_window_bits < 15) && (server_window_bits == -1)))
+        {
+            LogError("Server did not accept the offered server parameters: %s", extension_response);
+            result = __FAILURE__;
+        }
+        else
+        {
+            instance->server_no_context_takeover = has_server_no_context_takeover;
+            instance->client_no_context_takeover = config->client_no_context_takeover || has_client_no_context_takeover;
+            instance->server_window_bits = (server_window_bits == -1) ? 15 : server_window_bits;
+            instance->client_window_bits = ((client_window_bits == -1) || (client_window_bits > config->client_max_window_bits)) ? config->client_max_window_bits : client_window_bits;
+        }
+    }
+
+    return result;
+}
+
+bool uws_deflate_is_supported(void)
+{
+    /* Codes_SRS_UWS_DEFLATE_01_001: [ `uws_deflate_is_supported` shall return true when the module is built with zlib. ]*/
+    return true;
+}
+
+char* uws_deflate_create_offer(const UWS_DEFLATE_CONFIG* config)
+{
+    char* result;
+
+    if (config == NULL)
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_003: [ If `config` is NULL or holds out of range values, `uws_deflate_create_offer` shall fail and return NULL. ]*/
+        LogError("NULL config");
+        result = NULL;
+    }
+    else if (!is_config_valid(config))
+    {
+        LogError("Invalid config: client_max_window_bits=%d, server_max_window_bits=%d, mem_level=%d",
+            config->client_max_window_bits, config->server_max_window_bits, config->mem_level);
+        result = NULL;
+    }
+    else
+    {
+        char client_window_bits[4] = "";
+        char server_window_bits[32] = "";
+        int offer_length;
+
+        /* Codes_SRS_UWS_DEFLATE_01_002: [ `uws_deflate_create_offer` shall return a newly allocated `Sec-WebSocket-Extensions` value offering permessage-deflate with `client_max_window_bits`, and with `server_max_window_bits`, `client_no_context_takeover` and `server_no_context_takeover` when `config` asks for them. ]*/
+        if (config->client_max_window_bits < 15)
+        {
+            (void)snprintf(client_window_bits, sizeof(client_window_bits), "=%d", config->client_max_window_bits);
+        }
+
+        if (config->server_max_window_bits < 15)
+        {
+            (void)snprintf(server_window_bits, sizeof(server_window_bits), "; server_max_window_bits=%d", config->server_max_window_bits);
+        }
+
+        offer_length = snprintf(NULL, 0, "permessage-deflate; client_max_window_bits%s%s%s%s",
+            client_window_bits, server_window_bits,
+            config->client_no_context_takeover ? "; client_no_context_takeover" : "",
+            config->server_no_context_takeover ? "; server_no_context_takeover" : "");
+        if ((offer_length < 0) ||
+            ((result = (char*)malloc((size_t)offer_length + 1)) == NULL))
+        {
+            LogError("Cannot allocate the extension offer");
+            result = NULL;
+        }
+        else
+        {
+            (void)snprintf(result, (size_t)offer_length + 1, "permessage-deflate; client_max_window_bits%s%s%s%s",
+                client_window_bits, server_window_bits,
+                config->client_no_context_takeover ? "; client_no_context_takeover" : "",
+                config->server_no_context_takeover ? "; server_no_context_takeover" : "");
+        }
+    }
+
+    return result;
+}
+
+UWS_DEFLATE_HANDLE uws_deflate_create(const UWS_DEFLATE_CONFIG* config, const char* extension_response)
+{
+    UWS_DEFLATE_INSTANCE* result;
+
+    if ((config == NULL) ||
+        (extension_response == NULL))
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_004: [ If `config` or `extension_response` is NULL, or `config` holds out of range values, `uws_deflate_create` shall fail and return NULL. ]*/
+        LogError("Invalid arguments: config=%p, extension_response=%p", config, extension_response);
+        result = NULL;
+    }
+    else if (!is_config_valid(config))
+    {
+        LogError("Invalid config");
+        result = NULL;
+    }
+    else
+    {
+        result = (UWS_DEFLATE_INSTANCE*)malloc(sizeof(UWS_DEFLATE_INSTANCE));
+        if (result == NULL)
+        {
+            /* Codes_SRS_UWS_DEFLATE_01_005: [ If allocating memory fails, `uws_deflate_create` shall fail and return NULL. ]*/
+            LogError("Cannot allocate memory for the deflate instance");
+        }
+        else
+        {
+            (void)memset(result, 0, sizeof(UWS_DEFLATE_INSTANCE));
+            result->mem_level = config->mem_level;
+            result->max_message_size = config->max_message_size;
+
+            /* Codes_SRS_UWS_DEFLATE_01_006: [ `uws_deflate_create` shall apply the parameters of `extension_response`, the `Sec-WebSocket-Extensions` value returned by the server, as per RFC 7692. ]*/
+            /* Codes_SRS_UWS_DEFLATE_01_007: [ If `extension_response` does not accept permessage-deflate, has unknown, repeated or out of range parameters, or does not accept the offered server parameters, `uws_deflate_create` shall fail and return NULL. ]*/
+            if (negotiate_parameters(result, config, extension_response) != 0)
+            {
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                /* Codes_SRS_UWS_DEFLATE_01_008: [ The zlib streams shall only be allocated when the first message is compressed or decompressed. ]*/
+                result->deflate_stream.zalloc = uws_deflate_zalloc;
+                result->deflate_stream.zfree = uws_deflate_zfree;
+                result->inflate_stream.zalloc = uws_deflate_zalloc;
+                result->inflate_stream.zfree = uws_deflate_zfree;
+            }
+        }
+    }
+
+    return result;
+}
+
+void uws_deflate_destroy(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    if (uws_deflate == NULL)
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_009: [ If `uws_deflate` is NULL, `uws_deflate_destroy` shall do nothing. ]*/
+        LogError("NULL uws_deflate");
+    }
+    else
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_010: [ `uws_deflate_destroy` shall free the zlib streams and all buffers of the instance. ]*/
+        if (uws_deflate->is_deflate_initialized)
+        {
+            (void)deflateEnd(&uws_deflate->deflate_stream);
+        }
+
+        if (uws_deflate->is_inflate_initialized)
+        {
+            (void)inflateEnd(&uws_deflate->inflate_stream);
+        }
+
+        free(uws_deflate->compressed_buffer);
+        free(uws_deflate->inflate_buffer);
+        free(uws_deflate);
+    }
+}
+
+static int grow_compressed_buffer(UWS_DEFLATE_INSTANCE* uws_deflate, size_t needed_size)
+{
+    int result;
+
+    if (needed_size <= uws_deflate->compressed_buffer_size)
+    {
+        result = 0;
+    }
+    else
+    {
+        unsigned char* new_buffer = (unsigned char*)realloc(uws_deflate->compressed_buffer, needed_size);
+        if (new_buffer == NULL)
+        {
+            LogError("Cannot grow the compressed buffer to %lu bytes", (unsigned long)needed_size);
+            result = __FAILURE__;
+        }
+        else
+        {
+            uws_deflate->compressed_buffer = new_buffer;
+            uws_deflate->compressed_buffer_size = needed_size;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int uws_deflate_compress(UWS_DEFLATE_HANDLE uws_deflate, const unsigned char* buffer, size_t size, bool is_final, const unsigned char** compressed, size_t* compressed_size)
+{
+    int result;
+
+    if ((uws_deflate == NULL) ||
+        ((buffer == NULL) && (size > 0)) ||
+        (compressed == NULL) ||
+        (compressed_size == NULL))
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_011: [ If `uws_deflate`, `compressed` or `compressed_size` is NULL, or `buffer` is NULL while `size` is not 0, `uws_deflate_compress` shall fail and return a non-zero value. ]*/
+        LogError("Invalid arguments: uws_deflate=%p, buffer=%p, size=%lu, compressed=%p, compressed_size=%p",
+            uws_deflate, buffer, (unsigned long)size, compressed, compressed_size);
+        result = __FAILURE__;
+    }
+    else if (!uws_deflate->is_deflate_initialized &&
+        (deflateInit2(&uws_deflate->deflate_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -uws_deflate->client_window_bits, uws_deflate->mem_level, Z_DEFAULT_STRATEGY) != Z_OK))
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_012: [ If the compressor cannot be initialized or fails, `uws_deflate_compress` shall fail and return a non-zero value. ]*/
+        LogError("deflateInit2 failed");
+        result = __FAILURE__;
+    }
+    else
+    {
+        z_stream* stream = &uws_deflate->deflate_stream;
+        size_t consumed = 0;
+        size_t used = 0;
+
+        uws_deflate->is_deflate_initialized = true;
+
+        /* Codes_SRS_UWS_DEFLATE_01_028: [ If the buffer returned by the previous call is larger than 65536 bytes, `uws_deflate_compress` shall free it before compressing `buffer`. ]*/
+        if (uws_deflate->compressed_buffer_size > UWS_DEFLATE_RETAINED_BUFFER_SIZE)
+        {
+            free(uws_deflate->compressed_buffer);
+            uws_deflate->compressed_buffer = NULL;
+            uws_deflate->compressed_buffer_size = 0;
+        }
+
+        /* Codes_SRS_UWS_DEFLATE_01_013: [ `uws_deflate_compress` shall compress `buffer` with the negotiated window into a buffer owned by the instance, ending with a sync flush, and return it through `compressed` and `compressed_size`. The buffer stays valid until the next call. ]*/
+        result = grow_compressed_buffer(uws_deflate, (size_t)deflateBound(stream, (uLong)size) + 8);
+
+        while (result == 0)
+        {
+            size_t input_length = size - consumed;
+            int flush;
+
+            if (input_length > UWS_DEFLATE_MAX_ZLIB_CHUNK)
+            {
+                input_length = UWS_DEFLATE_MAX_ZLIB_CHUNK;
+            }
+
+            flush = (consumed + input_length == size) ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+            stream->next_in = (Bytef*)(buffer + consumed);
+            stream->avail_in = (uInt)input_length;
+
+            do
+            {
+                size_t output_length;
+
+                if ((used == uws_deflate->compressed_buffer_size) &&
+                    (grow_compressed_buffer(uws_deflate, uws_deflate->compressed_buffer_size * 2) != 0))
+                {
+                    result = __FAILURE__;
+                    break;
+                }
+
+                output_length = uws_deflate->compressed_buffer_size - used;
+                if (output_length > UWS_DEFLATE_MAX_ZLIB_CHUNK)
+                {
+                    output_length = UWS_DEFLATE_MAX_ZLIB_CHUNK;
+                }
+
+                stream->next_out = uws_deflate->compressed_buffer + used;
+                stream->avail_out = (uInt)output_length;
+
+                if (deflate(stream, flush) == Z_STREAM_ERROR)
+                {
+                    LogError("deflate failed");
+                    result = __FAILURE__;
+                }
+
+                used += output_length - stream->avail_out;
+            } while ((result == 0) && (stream->avail_out == 0));
+
+            consumed += input_length - stream->avail_in;
+            if (flush == Z_SYNC_FLUSH)
+            {
+                break;
+            }
+        }
+
+        if (result == 0)
+        {
+            if (is_final)
+            {
+                /* Codes_SRS_UWS_DEFLATE_01_014: [ When `is_final` is true, the trailing 0x00 0x00 0xFF 0xFF of the sync flush shall be removed, as per RFC 7692 section 7.2.1. ]*/
+                if ((used >= sizeof(deflate_tail)) &&
+                    (memcmp(uws_deflate->compressed_buffer + used - sizeof(deflate_tail), deflate_tail, sizeof(deflate_tail)) == 0))
+                {
+                    used -= sizeof(deflate_tail);
+                }
+
+                /* Codes_SRS_UWS_DEFLATE_01_015: [ When `is_final` is true and client context takeover is disabled, the compressor shall be reset. ]*/
+                if (uws_deflate->client_no_context_takeover)
+                {
+                    (void)deflateReset(stream);
+                }
+            }
+
+            *compressed = uws_deflate->compressed_buffer;
+            *compressed_size = used;
+        }
+        else
+        {
+            /* The compressor state cannot be trusted anymore */
+            (void)deflateReset(stream);
+        }
+    }
+
+    return result;
+}
+
+void uws_deflate_reset_compressor(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    if (uws_deflate == NULL)
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_016: [ If `uws_deflate` is NULL, `uws_deflate_reset_compressor` shall do nothing. ]*/
+        LogError("NULL uws_deflate");
+    }
+    else if (uws_deflate->is_deflate_initialized)
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_017: [ `uws_deflate_reset_compressor` shall drop the compression history, so that the next message does not refer to data that did not reach the peer. ]*/
+        (void)deflateReset(&uws_deflate->deflate_stream);
+    }
+}
+
+static int inflate_bytes(UWS_DEFLATE_INSTANCE* uws_deflate, const unsigned char* buffer, size_t size, ON_UWS_DEFLATE_OUTPUT on_output, void* on_output_context)
+{
+    int result = 0;
+    z_stream* stream = &uws_deflate->inflate_stream;
+    size_t consumed = 0;
+
+    do
+    {
+        size_t input_length = size - consumed;
+
+        if (input_length > UWS_DEFLATE_MAX_ZLIB_CHUNK)
+        {
+            input_length = UWS_DEFLATE_MAX_ZLIB_CHUNK;
+        }
+
+        stream->next_in = (Bytef*)(buffer + consumed);
+        stream->avail_in = (uInt)input_length;
+
+        do
+        {
+            int zlib_result;
+            size_t produced;
+
+            stream->next_out = uws_deflate->inflate_buffer;
+            stream->avail_out = UWS_DEFLATE_OUTPUT_CHUNK_SIZE;
+
+            zlib_result = inflate(stream, Z_SYNC_FLUSH);
+            produced = UWS_DEFLATE_OUTPUT_CHUNK_SIZE - stream->avail_out;
+
+            if ((zlib_result != Z_OK) && (zlib_result != Z_STREAM_END) && (zlib_result != Z_BUF_ERROR))
+            {
+                /* Codes_SRS_UWS_DEFLATE_01_021: [ If the compressed data is corrupt, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+                LogError("inflate failed: %d", zlib_result);
+                result = __FAILURE__;
+            }
+            else if ((uws_deflate->max_message_size > 0) &&
+                (produced > uws_deflate->max_message_size - uws_deflate->inflated_message_size))
+            {
+                /* Codes_SRS_UWS_DEFLATE_01_022: [ If a message decompresses to more than `max_message_size` bytes, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+                LogError("Decompressed message exceeds %lu bytes", (unsigned long)uws_deflate->max_message_size);
+                uws_deflate->is_message_too_large = true;
+                result = __FAILURE__;
+            }
+            else
+            {
+                uws_deflate->inflated_message_size += produced;
+                if (produced > 0)
+                {
+                    /* Codes_SRS_UWS_DEFLATE_01_020: [ The decompressed bytes shall be passed to `on_output` in pieces of at most 16384 bytes. ]*/
+                    on_output(on_output_context, uws_deflate->inflate_buffer, produced);
+                }
+
+                if (zlib_result == Z_STREAM_END)
+                {
+                    /* A final DEFLATE block ends the stream, whatever follows starts a new one */
+                    (void)inflateReset(stream);
+                }
+                else if ((zlib_result == Z_BUF_ERROR) && (produced == 0))
+                {
+                    /* No progress possible, all input has been used */
+                    break;
+                }
+            }
+        } while ((result == 0) && ((stream->avail_in > 0) || (stream->avail_out == 0)));
+
+        consumed += input_length - stream->avail_in;
+    } while ((result == 0) && (consumed < size));
+
+    return result;
+}
+
+int uws_deflate_decompress(UWS_DEFLATE_HANDLE uws_deflate, const unsigned char* buffer, size_t size, bool is_final, ON_UWS_DEFLATE_OUTPUT on_output, void* on_output_context)
+{
+    int result;
+
+    if ((uws_deflate == NULL) ||
+        ((buffer == NULL) && (size > 0)) ||
+        (on_output == NULL))
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_018: [ If `uws_deflate` or `on_output` is NULL, or `buffer` is NULL while `size` is not 0, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+        LogError("Invalid arguments: uws_deflate=%p, buffer=%p, size=%lu, on_output=%p",
+            uws_deflate, buffer, (unsigned long)size, on_output);
+        result = __FAILURE__;
+    }
+    else if ((uws_deflate->inflate_buffer == NULL) &&
+        ((uws_deflate->inflate_buffer = (unsigned char*)malloc(UWS_DEFLATE_OUTPUT_CHUNK_SIZE)) == NULL))
+    {
+        LogError("Cannot allocate the decompression buffer");
+        result = __FAILURE__;
+    }
+    else if (!uws_deflate->is_inflate_initialized &&
+        (inflateInit2(&uws_deflate->inflate_stream, -uws_deflate->server_window_bits) != Z_OK))
+    {
+        LogError("inflateInit2 failed");
+        result = __FAILURE__;
+    }
+    else
+    {
+        uws_deflate->is_inflate_initialized = true;
+        uws_deflate->is_message_too_large = false;
+
+        /* Codes_SRS_UWS_DEFLATE_01_019: [ `uws_deflate_decompress` shall decompress the `size` bytes of `buffer`, which may be any part of a compressed message, with the negotiated window. ]*/
+        result = inflate_bytes(uws_deflate, buffer, size, on_output, on_output_context);
+
+        if ((result == 0) && is_final)
+        {
+            /* Codes_SRS_UWS_DEFLATE_01_023: [ When `is_final` is true, 0x00 0x00 0xFF 0xFF shall be decompressed after `buffer`, as per RFC 7692 section 7.2.2. ]*/
+            result = inflate_bytes(uws_deflate, deflate_tail, sizeof(deflate_tail), on_output, on_output_context);
+        }
+
+        if ((result != 0) || is_final)
+        {
+            uws_deflate->inflated_message_size = 0;
+
+            /* Codes_SRS_UWS_DEFLATE_01_024: [ When `is_final` is true and server context takeover is disabled, the decompressor shall be reset. ]*/
+            if ((result != 0) || uws_deflate->server_no_context_takeover)
+            {
+                (void)inflateReset(&uws_deflate->inflate_stream);
+            }
+        }
+    }
+
+    return result;
+}
+
+bool uws_deflate_is_message_too_large(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    bool result;
+
+    if (uws_deflate == NULL)
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_026: [ If `uws_deflate` is NULL, `uws_deflate_is_message_too_large` shall return false. ]*/
+        LogError("NULL uws_deflate");
+        result = false;
+    }
+    else
+    {
+        /* Codes_SRS_UWS_DEFLATE_01_027: [ `uws_deflate_is_message_too_large` shall return true if the last `uws_deflate_decompress` failed because the message exceeded `max_message_size`, and false otherwise. ]*/
+        result = uws_deflate->is_message_too_large;
+    }
+
+    return result;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/uws_deflate.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+/* Used when the library is built without use_ws_deflate: permessage-deflate is never offered */
+
+bool uws_deflate_is_supported(void)
+{
+    /* Codes_SRS_UWS_DEFLATE_01_025: [ Without zlib `uws_deflate_is_supported` shall return false and all other functions shall fail. ]*/
+    return false;
+}
+
+char* uws_deflate_create_offer(const UWS_DEFLATE_CONFIG* config)
+{
+    (void)config;
+    LogError("permessage-deflate is not supported by this build");
+    return NULL;
+}
+
+UWS_DEFLATE_HANDLE uws_deflate_create(const UWS_DEFLATE_CONFIG* config, const char* extension_response)
+{
+    (void)config;
+    (void)extension_response;
+    LogError("permessage-deflate is not supported by this build");
+    return NULL;
+}
+
+void uws_deflate_destroy(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    (void)uws_deflate;
+}
+
+int uws_deflate_compress(UWS_DEFLATE_HANDLE uws_deflate, const unsigned char* buffer, size_t size, bool is_final, const unsigned char** compressed, size_t* compressed_size)
+{
+    (void)uws_deflate;
+    (void)buffer;
+    (void)size;
+    (void)is_final;
+    (void)compressed;
+    (void)compressed_size;
+    LogError("permessage-deflate is not supported by this build");
+    return __FAILURE__;
+}
+
+void uws_deflate_reset_compressor(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    (void)uws_deflate;
+}
+
+int uws_deflate_decompress(UWS_DEFLATE_HANDLE uws_deflate, const unsigned char* buffer, size_t size, bool is_final, ON_UWS_DEFLATE_OUTPUT on_output, void* on_output_context)
+{
+    (void)uws_deflate;
+    (void)buffer;
+    (void)size;
+    (void)is_final;
+    (void)on_output;
+    (void)on_output_context;
+    LogError("permessage-deflate is not supported by this build");
+    return __FAILURE__;
+}
+
+bool uws_deflate_is_message_too_large(UWS_DEFLATE_HANDLE uws_deflate)
+{
+    (void)uws_deflate;
+    return false;
+}
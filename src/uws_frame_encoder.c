@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <string.h>
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/gb_rand.h"
 #include "azure_c_shared_utility/uws_frame_encoder.h"
@@ -12,6 +13,177 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/uniqueid.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define UWS_FRAME_ENCODER_MASK_SSE2
+#include <emmintrin.h>
+/* AVX2 is not part of the x86 baseline, so it is only used after checking the CPU at runtime */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)) || defined(__clang__))
+#define UWS_FRAME_ENCODER_MASK_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef UWS_FRAME_ENCODER_MASK_AVX2
+__attribute__((target("avx2")))
+static size_t mask_payload_avx2(unsigned char* destination, const unsigned char* source, size_t length, const unsigned char* mask_pattern)
+{
+    size_t i;
+    __m256i mask = _mm256_loadu_si256((const __m256i*)mask_pattern);
+
+    for (i = 0; i + 32 <= length; i += 32)
+    {
+        _mm256_storeu_si256((__m256i*)(destination + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(source + i)), mask));
+    }
+
+    return i;
+}
+#endif
+
+/* XORs source with the 4 byte masking key into destination, a machine word or vector at a time.
+Every block length is a multiple of 4, so octet i is always XORed with octet i modulo 4 of the key. */
+static void mask_payload(unsigned char* destination, const unsigned char* source, size_t length, const unsigned char* masking_key)
+{
+    unsigned char mask_pattern[32];
+    uint64_t mask_word;
+    size_t i = 0;
+    size_t j;
+
+    for (j = 0; j < sizeof(mask_pattern); j++)
+    {
+        mask_pattern[j] = masking_key[j % 4];
+    }
+
+#ifdef UWS_FRAME_ENCODER_MASK_AVX2
+    if ((length >= 32) && __builtin_cpu_supports("avx2"))
+    {
+        i = mask_payload_avx2(destination, source, length, mask_pattern);
+    }
+#endif
+
+#ifdef UWS_FRAME_ENCODER_MASK_SSE2
+    {
+        __m128i mask = _mm_loadu_si128((const __m128i*)mask_pattern);
+
+        for (; i + 16 <= length; i += 16)
+        {
+            _mm_storeu_si128((__m128i*)(destination + i), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(source + i)), mask));
+        }
+    }
+#endif
+
+    /* memcpy keeps the word accesses safe for unaligned payloads and compiles down to plain loads and stores */
+    (void)memcpy(&mask_word, mask_pattern, sizeof(mask_word));
+    for (; i + sizeof(mask_word) <= length; i += sizeof(mask_word))
+    {
+        uint64_t word;
+        (void)memcpy(&word, source + i, sizeof(word));
+        word ^= mask_word;
+        (void)memcpy(destination + i, &word, sizeof(word));
+    }
+
+    for (; i < length; i++)
+    {
+        destination[i] = source[i] ^ masking_key[i % 4];
+    }
+}
+
+static size_t get_frame_header_size(size_t length, bool is_masked)
+{
+    size_t result = 2;
+
+    if (length > 65535)
+    {
+        result += 8;
+    }
+    else if (length > 125)
+    {
+        result += 2;
+    }
+
+    if (is_masked)
+    {
+        result += 4;
+    }
+
+    return result;
+}
+
+static void write_frame_header(unsigned char* buffer, size_t header_bytes, WS_FRAME_TYPE opcode, size_t length, bool is_masked, bool is_final, unsigned char reserved)
+{
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_007: [ *  %x0 denotes a continuation frame ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_008: [ *  %x1 denotes a text frame ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_009: [ *  %x2 denotes a binary frame ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_010: [ *  %x3-7 are reserved for further non-control frames ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_011: [ *  %x8 denotes a connection close ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_012: [ *  %x9 denotes a ping ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_013: [ *  %xA denotes a pong ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_014: [ *  %xB-F are reserved for further control frames ]*/
+    buffer[0] = (unsigned char)opcode;
+
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_002: [ Indicates that this is the final fragment in a message. ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_003: [ The first fragment MAY also be the final fragment. ]*/
+    if (is_final)
+    {
+        buffer[0] |= 0x80;
+    }
+
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_004: [ MUST be 0 unless an extension is negotiated that defines meanings for non-zero values. ]*/
+    buffer[0] |= reserved << 4;
+
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_022: [ Note that in all cases, the minimal number of bytes MUST be used to encode the length, for example, the length of a 124-byte-long string can't be encoded as the sequence 126, 0, 124. ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_018: [ The length of the "Payload data", in bytes: ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_023: [ The payload length is the length of the "Extension data" + the length of the "Application data". ]*/
+    /* Codes_SRS_UWS_FRAME_ENCODER_01_042: [ The payload length, indicated in the framing as frame-payload-length, does NOT include the length of the masking key. ]*/
+    if (length > 65535)
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_020: [ If 127, the following 8 bytes interpreted as a 64-bit unsigned integer (the most significant bit MUST be 0) are the payload length. ]*/
+        buffer[1] = 127;
+
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_021: [ Multibyte length quantities are expressed in network byte order. ]*/
+        buffer[2] = (unsigned char)((uint64_t)length >> 56) & 0xFF;
+        buffer[3] = (unsigned char)((uint64_t)length >> 48) & 0xFF;
+        buffer[4] = (unsigned char)((uint64_t)length >> 40) & 0xFF;
+        buffer[5] = (unsigned char)((uint64_t)length >> 32) & 0xFF;
+        buffer[6] = (unsigned char)((uint64_t)length >> 24) & 0xFF;
+        buffer[7] = (unsigned char)((uint64_t)length >> 16) & 0xFF;
+        buffer[8] = (unsigned char)((uint64_t)length >> 8) & 0xFF;
+        buffer[9] = (unsigned char)(length & 0xFF);
+    }
+    else if (length > 125)
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_019: [ If 126, the following 2 bytes interpreted as a 16-bit unsigned integer are the payload length. ]*/
+        buffer[1] = 126;
+
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_021: [ Multibyte length quantities are expressed in network byte order. ]*/
+        buffer[2] = (unsigned char)(length >> 8);
+        buffer[3] = (unsigned char)(length & 0xFF);
+    }
+    else
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_043: [ if 0-125, that is the payload length. ]*/
+        buffer[1] = (unsigned char)length;
+    }
+
+    if (is_masked)
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_015: [ Defines whether the "Payload data" is masked. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_033: [ A masked frame MUST have the field frame-masked set to 1, as defined in Section 5.2. ]*/
+        buffer[1] |= 0x80;
+
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_053: [ In order to obtain a 32 bit value for masking, `gb_rand` shall be used 4 times (for each byte). ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_016: [ If set to 1, a masking key is present in masking-key, and this is used to unmask the "Payload data" as per Section 5.3. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_026: [ This field is present if the mask bit is set to 1 and is absent if the mask bit is set to 0. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_034: [ The masking key is contained completely within the frame, as defined in Section 5.2 as frame-masking-key. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_036: [ The masking key is a 32-bit value chosen at random by the client. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_037: [ When preparing a masked frame, the client MUST pick a fresh masking key from the set of allowed 32-bit values. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_038: [ The masking key needs to be unpredictable; thus, the masking key MUST be derived from a strong source of entropy, and the masking key for a given frame MUST NOT make it simple for a server/proxy to predict the masking key for a subsequent frame. ]*/
+        buffer[header_bytes - 4] = (unsigned char)gb_rand();
+        buffer[header_bytes - 3] = (unsigned char)gb_rand();
+        buffer[header_bytes - 2] = (unsigned char)gb_rand();
+        buffer[header_bytes - 1] = (unsigned char)gb_rand();
+    }
+}
+
 BUFFER_HANDLE uws_frame_encoder_encode(WS_FRAME_TYPE opcode, const unsigned char* payload, size_t length, bool is_masked, bool is_final, unsigned char reserved)
 {
     BUFFER_HANDLE result;
@@ -37,7 +209,7 @@ BUFFER_HANDLE uws_frame_encoder_encode(WS_FRAME_TYPE opcode, const unsigned char
     }
     else
     {
-        size_t needed_bytes = 2;
+        size_t needed_bytes;
         size_t header_bytes;
 
         /* Codes_SRS_UWS_FRAME_ENCODER_01_044: [ On success `uws_frame_encoder_encode` shall return a non-NULL handle to the result buffer. ]*/
@@ -51,22 +223,8 @@ BUFFER_HANDLE uws_frame_encoder_encode(WS_FRAME_TYPE opcode, const unsigned char
         else
         {
             /* Codes_SRS_UWS_FRAME_ENCODER_01_001: [ `uws_frame_encoder_encode` shall encode the information given in `opcode`, `payload`, `length`, `is_masked`, `is_final` and `reserved` according to the RFC6455 into a new buffer.]*/
-            if (length > 65535)
-            {
-                needed_bytes += 8;
-            }
-            else if (length > 125)
-            {
-                needed_bytes += 2;
-            }
-
-            if (is_masked)
-            {
-                needed_bytes += 4;
-            }
-
-            header_bytes = needed_bytes;
-            needed_bytes += length;
+            header_bytes = get_frame_header_size(length, is_masked);
+            needed_bytes = header_bytes + length;
 
             /* Codes_SRS_UWS_FRAME_ENCODER_01_046: [ The result buffer shall be resized accordingly using `BUFFER_enlarge`. ]*/
             if (BUFFER_enlarge(result, needed_bytes) != 0)
@@ -89,93 +247,17 @@ BUFFER_HANDLE uws_frame_encoder_encode(WS_FRAME_TYPE opcode, const unsigned char
                 }
                 else
                 {
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_007: [ *  %x0 denotes a continuation frame ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_008: [ *  %x1 denotes a text frame ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_009: [ *  %x2 denotes a binary frame ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_010: [ *  %x3-7 are reserved for further non-control frames ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_011: [ *  %x8 denotes a connection close ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_012: [ *  %x9 denotes a ping ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_013: [ *  %xA denotes a pong ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_014: [ *  %xB-F are reserved for further control frames ]*/
-                    buffer[0] = (unsigned char)opcode;
-
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_002: [ Indicates that this is the final fragment in a message. ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_003: [ The first fragment MAY also be the final fragment. ]*/
-                    if (is_final)
-                    {
-                        buffer[0] |= 0x80;
-                    }
-
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_004: [ MUST be 0 unless an extension is negotiated that defines meanings for non-zero values. ]*/
-                    buffer[0] |= reserved << 4;
-
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_022: [ Note that in all cases, the minimal number of bytes MUST be used to encode the length, for example, the length of a 124-byte-long string can't be encoded as the sequence 126, 0, 124. ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_018: [ The length of the "Payload data", in bytes: ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_023: [ The payload length is the length of the "Extension data" + the length of the "Application data". ]*/
-                    /* Codes_SRS_UWS_FRAME_ENCODER_01_042: [ The payload length, indicated in the framing as frame-payload-length, does NOT include the length of the masking key. ]*/
-                    if (length > 65535)
-                    {
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_020: [ If 127, the following 8 bytes interpreted as a 64-bit unsigned integer (the most significant bit MUST be 0) are the payload length. ]*/
-                        buffer[1] = 127;
-
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_021: [ Multibyte length quantities are expressed in network byte order. ]*/
-                        buffer[2] = (unsigned char)((uint64_t)length >> 56) & 0xFF;
-                        buffer[3] = (unsigned char)((uint64_t)length >> 48) & 0xFF;
-                        buffer[4] = (unsigned char)((uint64_t)length >> 40) & 0xFF;
-                        buffer[5] = (unsigned char)((uint64_t)length >> 32) & 0xFF;
-                        buffer[6] = (unsigned char)((uint64_t)length >> 24) & 0xFF;
-                        buffer[7] = (unsigned char)((uint64_t)length >> 16) & 0xFF;
-                        buffer[8] = (unsigned char)((uint64_t)length >> 8) & 0xFF;
-                        buffer[9] = (unsigned char)(length & 0xFF);
-                    }
-                    else if (length > 125)
-                    {
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_019: [ If 126, the following 2 bytes interpreted as a 16-bit unsigned integer are the payload length. ]*/
-                        buffer[1] = 126;
-
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_021: [ Multibyte length quantities are expressed in network byte order. ]*/
-                        buffer[2] = (unsigned char)(length >> 8);
-                        buffer[3] = (unsigned char)(length & 0xFF);
-                    }
-                    else
-                    {
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_043: [ if 0-125, that is the payload length. ]*/
-                        buffer[1] = (unsigned char)length;
-                    }
-
-                    if (is_masked)
-                    {
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_015: [ Defines whether the "Payload data" is masked. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_033: [ A masked frame MUST have the field frame-masked set to 1, as defined in Section 5.2. ]*/
-                        buffer[1] |= 0x80;
-
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_053: [ In order to obtain a 32 bit value for masking, `gb_rand` shall be used 4 times (for each byte). ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_016: [ If set to 1, a masking key is present in masking-key, and this is used to unmask the "Payload data" as per Section 5.3. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_026: [ This field is present if the mask bit is set to 1 and is absent if the mask bit is set to 0. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_034: [ The masking key is contained completely within the frame, as defined in Section 5.2 as frame-masking-key. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_036: [ The masking key is a 32-bit value chosen at random by the client. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_037: [ When preparing a masked frame, the client MUST pick a fresh masking key from the set of allowed 32-bit values. ]*/
-                        /* Codes_SRS_UWS_FRAME_ENCODER_01_038: [ The masking key needs to be unpredictable; thus, the masking key MUST be derived from a strong source of entropy, and the masking key for a given frame MUST NOT make it simple for a server/proxy to predict the masking key for a subsequent frame. ]*/
-                        buffer[header_bytes - 4] = (unsigned char)gb_rand();
-                        buffer[header_bytes - 3] = (unsigned char)gb_rand();
-                        buffer[header_bytes - 2] = (unsigned char)gb_rand();
-                        buffer[header_bytes - 1] = (unsigned char)gb_rand();
-                    }
+                    write_frame_header(buffer, header_bytes, opcode, length, is_masked, is_final, reserved);
 
                     if (length > 0)
                     {
                         if (is_masked)
                         {
-                            size_t i;
-
                             /* Codes_SRS_UWS_FRAME_ENCODER_01_035: [ It is used to mask the "Payload data" defined in the same section as frame-payload-data, which includes "Extension data" and "Application data". ]*/
                             /* Codes_SRS_UWS_FRAME_ENCODER_01_039: [ To convert masked data into unmasked data, or vice versa, the following algorithm is applied. ]*/
                             /* Codes_SRS_UWS_FRAME_ENCODER_01_040: [ The same algorithm applies regardless of the direction of the translation, e.g., the same steps are applied to mask the data as to unmask the data. ]*/
-                            for (i = 0; i < length; i++)
-                            {
-                                /* Codes_SRS_UWS_FRAME_ENCODER_01_041: [ Octet i of the transformed data ("transformed-octet-i") is the XOR of octet i of the original data ("original-octet-i") with octet at index i modulo 4 of the masking key ("masking-key-octet-j"): ]*/
-                                buffer[header_bytes + i] = ((unsigned char*)payload)[i] ^ buffer[header_bytes - 4 + (i % 4)];
-                            }
+                            /* Codes_SRS_UWS_FRAME_ENCODER_01_041: [ Octet i of the transformed data ("transformed-octet-i") is the XOR of octet i of the original data ("original-octet-i") with octet at index i modulo 4 of the masking key ("masking-key-octet-j"): ]*/
+                            mask_payload(buffer + header_bytes, (const unsigned char*)payload, length, buffer + header_bytes - 4);
                         }
                         else
                         {
@@ -189,3 +271,65 @@ BUFFER_HANDLE uws_frame_encoder_encode(WS_FRAME_TYPE opcode, const unsigned char
 
     return result;
 }
+
+int uws_frame_encoder_encode_header(WS_FRAME_TYPE opcode, size_t length, bool is_masked, bool is_final, unsigned char reserved, unsigned char* header, size_t* header_length)
+{
+    int result;
+
+    if ((header == NULL) ||
+        (header_length == NULL))
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_057: [ If `header` or `header_length` is NULL, `reserved` has any bits set except the lowest 3 or `opcode` is greater than 0x0F, `uws_frame_encoder_encode_header` shall fail and return a non-zero value. ]*/
+        LogError("Invalid arguments: header=%p, header_length=%p", header, header_length);
+        result = __FAILURE__;
+    }
+    else if (reserved > 7)
+    {
+        LogError("Bad reserved value: 0x%02x", reserved);
+        result = __FAILURE__;
+    }
+    else if (opcode > 0x0F)
+    {
+        LogError("Invalid opcode: 0x%02x", opcode);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_055: [ `uws_frame_encoder_encode_header` shall write to `header` the frame header that `uws_frame_encoder_encode` would produce for a payload of `length` bytes, including the masking key when `is_masked` is true, and set `header_length` to its size. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_056: [ `header` shall have room for `UWS_FRAME_ENCODER_MAX_HEADER_SIZE` bytes. ]*/
+        *header_length = get_frame_header_size(length, is_masked);
+        write_frame_header(header, *header_length, opcode, length, is_masked, is_final, reserved);
+
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_058: [ On success `uws_frame_encoder_encode_header` shall return 0. ]*/
+        result = 0;
+    }
+
+    return result;
+}
+
+int uws_frame_encoder_mask(unsigned char* destination, const unsigned char* source, size_t length, const unsigned char* masking_key)
+{
+    int result;
+
+    if ((length > 0) &&
+        ((destination == NULL) || (source == NULL) || (masking_key == NULL)))
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_061: [ If `length` is greater than 0 and `destination`, `source` or `masking_key` is NULL, `uws_frame_encoder_mask` shall fail and return a non-zero value. ]*/
+        LogError("Invalid arguments: destination=%p, source=%p, masking_key=%p, length=%u", destination, source, masking_key, (unsigned int)length);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_059: [ `uws_frame_encoder_mask` shall write to `destination` the `length` bytes of `source` masked with the 4 byte `masking_key`, starting with octet 0 of the key. ]*/
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_060: [ `destination` and `source` shall be allowed to be the same buffer, in which case the bytes are masked in place. ]*/
+        if (length > 0)
+        {
+            mask_payload(destination, source, length, masking_key);
+        }
+
+        /* Codes_SRS_UWS_FRAME_ENCODER_01_062: [ On success `uws_frame_encoder_mask` shall return 0. ]*/
+        result = 0;
+    }
+
+    return result;
+}
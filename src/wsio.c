@@ -19,6 +19,10 @@
 
 static const char* WSIO_OPTIONS = "WSIOOptions";
 
+/* Number of completed pending IO structures (and pending IO list nodes) kept for reuse, so that
+steady state sending does not allocate bookkeeping memory for each send */
+#define WSIO_PENDING_IO_CACHE_SIZE 16
+
 typedef enum IO_STATE_TAG
 {
     IO_STATE_NOT_OPEN,
@@ -33,6 +37,7 @@ typedef struct PENDING_IO_TAG
     ON_SEND_COMPLETE on_send_complete;
     void* callback_context;
     void* wsio;
+    struct PENDING_IO_TAG* next_cached;
 } PENDING_IO;
 
 typedef struct WSIO_INSTANCE_TAG
@@ -48,6 +53,8 @@ typedef struct WSIO_INSTANCE_TAG
     IO_STATE io_state;
     SINGLYLINKEDLIST_HANDLE pending_io_list;
     UWS_CLIENT_HANDLE uws;
+    PENDING_IO* cached_pending_ios;
+    size_t cached_pending_io_count;
 } WSIO_INSTANCE;
 
 static void indicate_error(WSIO_INSTANCE* wsio_instance)
@@ -61,6 +68,40 @@ static void indicate_open_complete(WSIO_INSTANCE* ws_io_instance, IO_OPEN_RESULT
     ws_io_instance->on_io_open_complete(ws_io_instance->on_io_open_complete_context, open_result);
 }
 
+static PENDING_IO* allocate_pending_io(WSIO_INSTANCE* wsio_instance)
+{
+    PENDING_IO* result;
+
+    if (wsio_instance->cached_pending_ios != NULL)
+    {
+        /* Codes_SRS_WSIO_01_189: [ If a pending IO structure kept for reuse is available, `wsio_send` shall use it instead of allocating memory. ]*/
+        result = wsio_instance->cached_pending_ios;
+        wsio_instance->cached_pending_ios = result->next_cached;
+        wsio_instance->cached_pending_io_count--;
+    }
+    else
+    {
+        result = (PENDING_IO*)malloc(sizeof(PENDING_IO));
+    }
+
+    return result;
+}
+
+static void release_pending_io(WSIO_INSTANCE* wsio_instance, PENDING_IO* pending_io)
+{
+    if (wsio_instance->cached_pending_io_count < WSIO_PENDING_IO_CACHE_SIZE)
+    {
+        /* Codes_SRS_WSIO_01_190: [ Up to 16 released pending IO structures shall be kept for reuse instead of being freed. ]*/
+        pending_io->next_cached = wsio_instance->cached_pending_ios;
+        wsio_instance->cached_pending_ios = pending_io;
+        wsio_instance->cached_pending_io_count++;
+    }
+    else
+    {
+        free(pending_io);
+    }
+}
+
 static void complete_send_item(LIST_ITEM_HANDLE pending_io_list_item, IO_SEND_RESULT io_send_result)
 {
     PENDING_IO* pending_io = (PENDING_IO*)singlylinkedlist_item_get_value(pending_io_list_item);
@@ -79,7 +120,7 @@ static void complete_send_item(LIST_ITEM_HANDLE pending_io_list_item, IO_SEND_RE
     }
 
     /* Codes_SRS_WSIO_01_144: [ Also the pending IO data shall be freed. ]*/
-    free(pending_io);
+    release_pending_io(wsio_instance, pending_io);
 }
 
 static void on_underlying_ws_send_frame_complete(void* context, WS_SEND_FRAME_RESULT ws_send_frame_result)
@@ -260,11 +301,12 @@ CONCRETE_IO_HANDLE wsio_create(void* io_create_parameters)
             }
             else
             {
-                /* Codes_SRS_WSIO_01_076: [ `wsio_create` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create`. ]*/
-                result->pending_io_list = singlylinkedlist_create();
+                /* Codes_SRS_WSIO_01_076: [ `wsio_create` shall create a pending send IO list that is to be used to queue send packets by calling `singlylinkedlist_create_with_item_cache`. ]*/
+                /* Codes_SRS_WSIO_01_187: [ The pending send IO list shall keep up to 16 removed list nodes for reuse. ]*/
+                result->pending_io_list = singlylinkedlist_create_with_item_cache(WSIO_PENDING_IO_CACHE_SIZE);
                 if (result->pending_io_list == NULL)
                 {
-                    /* Codes_SRS_WSIO_01_077: [ If `singlylinkedlist_create` fails then `wsio_create` shall fail and return NULL. ]*/
+                    /* Codes_SRS_WSIO_01_077: [ If `singlylinkedlist_create_with_item_cache` fails then `wsio_create` shall fail and return NULL. ]*/
                     LogError("Cannot create singly linked list.");
                     uws_client_destroy(result->uws);
                     free(result);
@@ -273,6 +315,8 @@ CONCRETE_IO_HANDLE wsio_create(void* io_create_parameters)
                 else
                 {
                     result->io_state = IO_STATE_NOT_OPEN;
+                    result->cached_pending_ios = NULL;
+                    result->cached_pending_io_count = 0;
                 }
             }
         }
@@ -302,6 +346,15 @@ void wsio_destroy(CONCRETE_IO_HANDLE ws_io)
         uws_client_destroy(wsio_instance->uws);
         /* Codes_SRS_WSIO_01_081: [ `wsio_destroy` shall free the list used to track the pending send IOs by calling `singlylinkedlist_destroy`. ]*/
         singlylinkedlist_destroy(wsio_instance->pending_io_list);
+
+        /* Codes_SRS_WSIO_01_188: [ `wsio_destroy` shall free the pending IO structures kept for reuse. ]*/
+        while (wsio_instance->cached_pending_ios != NULL)
+        {
+            PENDING_IO* pending_io = wsio_instance->cached_pending_ios;
+            wsio_instance->cached_pending_ios = pending_io->next_cached;
+            free(pending_io);
+        }
+
         free(ws_io);
     }
 }
@@ -579,7 +632,7 @@ int wsio_send(CONCRETE_IO_HANDLE ws_io, const void* buffer, size_t size, ON_SEND
         else
         {
             LIST_ITEM_HANDLE new_item;
-            PENDING_IO* pending_socket_io = (PENDING_IO*)malloc(sizeof(PENDING_IO));
+            PENDING_IO* pending_socket_io = allocate_pending_io(wsio_instance);
             if (pending_socket_io == NULL)
             {
                 /* Codes_SRS_WSIO_01_134: [ If allocating memory for the pending IO data fails, `wsio_send` shall fail and return a non-zero value. ]*/
@@ -300,3 +300,32 @@ OPTIONHANDLER_HANDLE xio_retrieveoptions(XIO_HANDLE xio)
     return result;
 }
 
+
+CONCRETE_IO_HANDLE xio_get_concrete_handle(XIO_HANDLE xio, const IO_INTERFACE_DESCRIPTION* io_interface_description)
+{
+    CONCRETE_IO_HANDLE result;
+
+    if ((xio == NULL) || (io_interface_description == NULL))
+    {
+        /* Codes_SRS_XIO_01_028: [ If `xio` or `io_interface_description` is NULL, `xio_get_concrete_handle` shall return NULL. ]*/
+        LogError("Invalid arguments: XIO_HANDLE xio=%p, const IO_INTERFACE_DESCRIPTION* io_interface_description=%p", xio, io_interface_description);
+        result = NULL;
+    }
+    else
+    {
+        XIO_INSTANCE* xio_instance = (XIO_INSTANCE*)xio;
+
+        if (xio_instance->io_interface_description != io_interface_description)
+        {
+            /* Codes_SRS_XIO_01_029: [ If `xio` was not created with `io_interface_description`, `xio_get_concrete_handle` shall return NULL. ]*/
+            result = NULL;
+        }
+        else
+        {
+            /* Codes_SRS_XIO_01_030: [ Otherwise `xio_get_concrete_handle` shall return the handle created by `concrete_io_create` in `xio_create`. ]*/
+            result = xio_instance->concrete_xio_handle;
+        }
+    }
+
+    return result;
+}
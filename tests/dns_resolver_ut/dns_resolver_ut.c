@@ -0,0 +1,450 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+
+#define ENABLE_MOCKS
+
+#include "umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    MOCKABLE_FUNCTION(, void*, gballoc_malloc, size_t, size);
+    MOCKABLE_FUNCTION(, void, gballoc_free, void*, ptr);
+#ifdef __cplusplus
+}
+#endif
+
+#include "umock_c.h"
+
+#define GBALLOC_H
+
+void* real_gballoc_malloc(size_t size);
+void real_gballoc_free(void* ptr);
+
+#define TEST_HOSTNAME       "localhost"
+#define TEST_PORT           8883
+#define LOOKUP_WAIT_SECONDS 10
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static bool malloc_will_fail = false;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* my_gballoc_malloc(size_t size)
+{
+    void* result = NULL;
+    if (malloc_will_fail == false)
+    {
+        result = real_gballoc_malloc(size);
+    }
+
+    return result;
+}
+
+void my_gballoc_free(void* ptr)
+{
+    real_gballoc_free(ptr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static bool wait_for_lookup(DNS_RESOLVER_HANDLE dns)
+{
+    time_t start = time(NULL);
+    bool result;
+
+    while (!(result = dns_resolver_is_lookup_complete(dns)) && (difftime(time(NULL), start) < LOOKUP_WAIT_SECONDS))
+    {
+        struct timespec delay = { 0, 10 * 1000 * 1000 };
+        (void)nanosleep(&delay, NULL);
+    }
+
+    return result;
+}
+
+BEGIN_TEST_SUITE(dns_resolver_ut)
+
+TEST_SUITE_INITIALIZE(a)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(b)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(f)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+    malloc_will_fail = false;
+}
+
+TEST_FUNCTION_CLEANUP(cleans)
+{
+    dns_resolver_clear_cache();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_001: [ If `hostname` is NULL, `dns_resolver_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(dns_resolver_create__NULL_hostname__fails)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE result;
+
+    ///act
+    result = dns_resolver_create(NULL, TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_002: [ If any resource cannot be allocated, `dns_resolver_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(dns_resolver_create__malloc_fails__fails)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE result;
+    malloc_will_fail = true;
+
+    ///act
+    result = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_003: [ `dns_resolver_create` shall queue the lookup of `hostname` and return without waiting for it. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_004: [ A new resolver worker shall be started when no idle worker is available and fewer than `DNS_RESOLVER_MAX_WORKERS` are running. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_020: [ The lookup shall be performed by calling `getaddrinfo` on a resolver worker thread. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_011: [ `dns_resolver_is_lookup_complete` shall return true once the lookup has finished, whether it found addresses or not. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_031: [ `dns_resolver_get_addrInfo` shall return the addresses found by a completed lookup, or NULL if the lookup is not complete or failed. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_041: [ `dns_resolver_destroy` shall release all resources associated with the resolver without waiting for a running lookup. ]*/
+TEST_FUNCTION(dns_resolver_create__lookup_completes__succeeds)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns;
+    struct addrinfo* addrInfo;
+
+    ///act
+    dns = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns);
+    ASSERT_IS_TRUE(wait_for_lookup(dns));
+    addrInfo = dns_resolver_get_addrInfo(dns);
+    ASSERT_IS_NOT_NULL(addrInfo);
+    if (addrInfo->ai_family == AF_INET6)
+    {
+        ASSERT_ARE_EQUAL(int, TEST_PORT, (int)ntohs(((struct sockaddr_in6*)addrInfo->ai_addr)->sin6_port));
+    }
+    else
+    {
+        ASSERT_ARE_EQUAL(int, AF_INET, addrInfo->ai_family);
+        ASSERT_ARE_EQUAL(int, TEST_PORT, (int)ntohs(((struct sockaddr_in*)addrInfo->ai_addr)->sin_port));
+    }
+
+    ///cleanup
+    dns_resolver_destroy(dns);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_004: [ A new resolver worker shall be started when no idle worker is available and fewer than `DNS_RESOLVER_MAX_WORKERS` are running. ]*/
+TEST_FUNCTION(dns_resolver_create__more_lookups_than_workers__all_complete)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns[10];
+    size_t i;
+
+    ///act
+    for (i = 0; i < sizeof(dns) / sizeof(dns[0]); i++)
+    {
+        dns[i] = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+        ASSERT_IS_NOT_NULL(dns[i]);
+    }
+
+    ///assert
+    for (i = 0; i < sizeof(dns) / sizeof(dns[0]); i++)
+    {
+        ASSERT_IS_TRUE(wait_for_lookup(dns[i]));
+        ASSERT_IS_NOT_NULL(dns_resolver_get_addrInfo(dns[i]));
+    }
+
+    ///cleanup
+    for (i = 0; i < sizeof(dns) / sizeof(dns[0]); i++)
+    {
+        dns_resolver_destroy(dns[i]);
+    }
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_021: [ If `getaddrinfo` fails the lookup shall complete without any addresses. ]*/
+TEST_FUNCTION(dns_resolver_create__unknown_host__completes_without_addresses)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns;
+
+    ///act
+    dns = dns_resolver_create("host.invalid", TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns);
+    ASSERT_IS_TRUE(wait_for_lookup(dns));
+    ASSERT_IS_NULL(dns_resolver_get_addrInfo(dns));
+
+    ///cleanup
+    dns_resolver_destroy(dns);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_041: [ `dns_resolver_destroy` shall release all resources associated with the resolver without waiting for a running lookup. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_042: [ If the lookup is still running, the resources shall be released by the resolver worker once `getaddrinfo` returns. ]*/
+TEST_FUNCTION(dns_resolver_destroy__lookup_pending__succeeds)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns;
+    DNS_RESOLVER_HANDLE next;
+
+    dns = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(dns);
+
+    ///act
+    dns_resolver_destroy(dns);
+
+    ///assert
+    next = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(next);
+    ASSERT_IS_TRUE(wait_for_lookup(next));
+
+    ///cleanup
+    dns_resolver_destroy(next);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_050: [ If a lookup of the same `hostname` and `port` is cached or in progress, `dns_resolver_create` shall share it instead of queuing a new one. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_051: [ A successful lookup shall be cached for `DNS_CACHE_TTL_SECONDS`. ]*/
+TEST_FUNCTION(dns_resolver_create__cached_lookup__completes_right_away)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE first;
+    DNS_RESOLVER_HANDLE second;
+
+    first = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(first);
+    ASSERT_IS_TRUE(wait_for_lookup(first));
+
+    ///act
+    second = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(second);
+    ASSERT_IS_TRUE(dns_resolver_is_lookup_complete(second));
+    ASSERT_ARE_EQUAL(void_ptr, dns_resolver_get_addrInfo(first), dns_resolver_get_addrInfo(second));
+
+    ///cleanup
+    dns_resolver_destroy(first);
+    dns_resolver_destroy(second);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_052: [ A failed lookup shall be cached for `DNS_CACHE_NEGATIVE_TTL_SECONDS`. ]*/
+TEST_FUNCTION(dns_resolver_create__cached_failure__completes_right_away)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE first;
+    DNS_RESOLVER_HANDLE second;
+
+    first = dns_resolver_create("host.invalid", TEST_PORT);
+    ASSERT_IS_NOT_NULL(first);
+    ASSERT_IS_TRUE(wait_for_lookup(first));
+
+    ///act
+    second = dns_resolver_create("host.invalid", TEST_PORT);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(second);
+    ASSERT_IS_TRUE(dns_resolver_is_lookup_complete(second));
+    ASSERT_IS_NULL(dns_resolver_get_addrInfo(second));
+
+    ///cleanup
+    dns_resolver_destroy(first);
+    dns_resolver_destroy(second);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_070: [ `dns_resolver_clear_cache` shall drop every cached lookup; lookups still used by a resolver or a worker are freed when released. ]*/
+TEST_FUNCTION(dns_resolver_clear_cache__resolver_keeps_its_addresses)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns;
+
+    dns = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(dns);
+    ASSERT_IS_TRUE(wait_for_lookup(dns));
+
+    ///act
+    dns_resolver_clear_cache();
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrInfo(dns));
+
+    ///cleanup
+    dns_resolver_destroy(dns);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_081: [ If the lookup of `dns` is complete, `dns_resolver_invalidate` shall drop it from the cache; the resolver keeps its addresses until it is destroyed. ]*/
+TEST_FUNCTION(dns_resolver_invalidate__next_create_resolves_again)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE first;
+    DNS_RESOLVER_HANDLE second;
+
+    first = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(first);
+    ASSERT_IS_TRUE(wait_for_lookup(first));
+
+    ///act
+    dns_resolver_invalidate(first);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrInfo(first));
+    second = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(second);
+    ASSERT_IS_TRUE(wait_for_lookup(second));
+    ASSERT_ARE_NOT_EQUAL(void_ptr, dns_resolver_get_addrInfo(first), dns_resolver_get_addrInfo(second));
+
+    ///cleanup
+    dns_resolver_destroy(first);
+    dns_resolver_destroy(second);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_060: [ If `hostname` is NULL, `dns_resolver_add_prewarm_host` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(dns_resolver_add_prewarm_host__NULL_hostname__fails)
+{
+    ///act
+    int result = dns_resolver_add_prewarm_host(NULL, TEST_PORT);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_061: [ If any resource cannot be allocated, `dns_resolver_add_prewarm_host` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(dns_resolver_add_prewarm_host__malloc_fails__fails)
+{
+    ///arrange
+    int result;
+    malloc_will_fail = true;
+
+    ///act
+    result = dns_resolver_add_prewarm_host(TEST_HOSTNAME, TEST_PORT);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_062: [ `dns_resolver_add_prewarm_host` shall remember `hostname` and `port` for `dns_resolver_prewarm` and return 0. ]*/
+/* Tests_SRS_DNS_RESOLVER_30_063: [ `dns_resolver_prewarm` shall queue a lookup into the cache for every host added with `dns_resolver_add_prewarm_host`. ]*/
+TEST_FUNCTION(dns_resolver_prewarm__lookup_lands_in_cache)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns;
+    int result;
+
+    result = dns_resolver_add_prewarm_host(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    ///act
+    dns_resolver_prewarm();
+
+    ///assert
+    dns = dns_resolver_create(TEST_HOSTNAME, TEST_PORT);
+    ASSERT_IS_NOT_NULL(dns);
+    ASSERT_IS_TRUE(wait_for_lookup(dns));
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrInfo(dns));
+
+    ///cleanup
+    dns_resolver_destroy(dns);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_010: [ If `dns` is NULL, `dns_resolver_is_lookup_complete` shall return false. ]*/
+TEST_FUNCTION(dns_resolver_is_lookup_complete__NULL__returns_false)
+{
+    ///act
+    bool result = dns_resolver_is_lookup_complete(NULL);
+
+    ///assert
+    ASSERT_IS_FALSE(result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_030: [ If `dns` is NULL, `dns_resolver_get_addrInfo` shall return NULL. ]*/
+TEST_FUNCTION(dns_resolver_get_addrInfo__NULL__returns_NULL)
+{
+    ///act
+    struct addrinfo* result = dns_resolver_get_addrInfo(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_040: [ If `dns` is NULL, `dns_resolver_destroy` shall do nothing. ]*/
+TEST_FUNCTION(dns_resolver_destroy__NULL__does_nothing)
+{
+    ///act
+    dns_resolver_destroy(NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_DNS_RESOLVER_30_080: [ If `dns` is NULL, `dns_resolver_invalidate` shall do nothing. ]*/
+TEST_FUNCTION(dns_resolver_invalidate__NULL__does_nothing)
+{
+    ///act
+    dns_resolver_invalidate(NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+END_TEST_SUITE(dns_resolver_ut)
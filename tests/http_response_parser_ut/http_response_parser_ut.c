@@ -0,0 +1,334 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/http_response_parser.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static HTTP_RESPONSE_PARSER_RESULT parse_string(HTTP_RESPONSE_PARSER* parser, const char* response, size_t* consumed)
+{
+    return http_response_parser_parse(parser, (const unsigned char*)response, strlen(response), consumed);
+}
+
+BEGIN_TEST_SUITE(http_response_parser_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* http_response_parser_init */
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_001: [ If `parser` is NULL, `http_response_parser_init` shall do nothing. ]*/
+TEST_FUNCTION(http_response_parser_init_with_NULL_parser_does_nothing)
+{
+    // arrange
+
+    // act
+    http_response_parser_init(NULL);
+
+    // assert
+    // no explicit assert, no crash expected
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_002: [ `http_response_parser_init` shall set `parser` to expect the first byte of a status line. ]*/
+TEST_FUNCTION(http_response_parser_init_resets_a_failed_parser)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+    (void)parse_string(&parser, "X", &consumed);
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 101 Switching Protocols\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_COMPLETE, (int)result);
+    ASSERT_ARE_EQUAL(int, 101, parser.status_code);
+}
+
+/* http_response_parser_parse */
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_003: [ If `parser` or `consumed` is NULL, or `buffer` is NULL while `size` is not 0, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_NULL_parser_fails)
+{
+    // arrange
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    // act
+    result = http_response_parser_parse(NULL, (const unsigned char*)"H", 1, &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_003: [ If `parser` or `consumed` is NULL, or `buffer` is NULL while `size` is not 0, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_NULL_buffer_and_non_zero_size_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = http_response_parser_parse(&parser, NULL, 1, &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_003: [ If `parser` or `consumed` is NULL, or `buffer` is NULL while `size` is not 0, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_NULL_consumed_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = http_response_parser_parse(&parser, (const unsigned char*)"H", 1, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_008: [ When the empty line ending the headers has been parsed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_COMPLETE`, leaving the bytes after it unconsumed. ]*/
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_009: [ When the response is complete, `status_code` shall hold the status code and `response_length` the number of bytes of the status line and headers. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_a_complete_response_succeeds)
+{
+    // arrange
+    static const char response[] = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n";
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, response, &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_COMPLETE, (int)result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(response) - 1, consumed);
+    ASSERT_ARE_EQUAL(size_t, sizeof(response) - 1, parser.response_length);
+    ASSERT_ARE_EQUAL(int, 101, parser.status_code);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_007: [ `consumed` shall be set to the number of bytes of `buffer` that belong to the status line and headers. ]*/
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_008: [ When the empty line ending the headers has been parsed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_COMPLETE`, leaving the bytes after it unconsumed. ]*/
+TEST_FUNCTION(http_response_parser_parse_leaves_the_bytes_after_the_headers_unconsumed)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 200\r\n\r\nABC", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_COMPLETE, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 16, consumed);
+    ASSERT_ARE_EQUAL(int, 200, parser.status_code);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_004: [ `http_response_parser_parse` shall parse the `size` bytes of `buffer` as the continuation of the bytes passed to the previous calls, without looking at those again. ]*/
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_010: [ Otherwise `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_INCOMPLETE`. ]*/
+TEST_FUNCTION(http_response_parser_parse_one_byte_at_a_time_succeeds)
+{
+    // arrange
+    static const char response[] = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n";
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    size_t i;
+    HTTP_RESPONSE_PARSER_RESULT result = HTTP_RESPONSE_PARSER_ERROR;
+
+    http_response_parser_init(&parser);
+
+    // act
+    for (i = 0; i < sizeof(response) - 1; i++)
+    {
+        result = http_response_parser_parse(&parser, (const unsigned char*)response + i, 1, &consumed);
+        if (i < sizeof(response) - 2)
+        {
+            ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_INCOMPLETE, (int)result);
+        }
+
+        ASSERT_ARE_EQUAL(size_t, 1, consumed);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_COMPLETE, (int)result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(response) - 1, parser.response_length);
+    ASSERT_ARE_EQUAL(int, 403, parser.status_code);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_008: [ When the empty line ending the headers has been parsed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_COMPLETE`, leaving the bytes after it unconsumed. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_more_spaces_succeeds)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1  101  Switching Protocols\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_COMPLETE, (int)result);
+    ASSERT_ARE_EQUAL(int, 101, parser.status_code);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_a_bad_prefix_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HYTP/1.1 200\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_without_minor_version_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_without_status_code_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 \r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_a_4_digit_status_code_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 1010\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_005: [ If the bytes are not an HTTP/1.x status line with a 3 digit status code followed by CRLF terminated header lines, `http_response_parser_parse` shall fail and return `HTTP_RESPONSE_PARSER_ERROR`. ]*/
+TEST_FUNCTION(http_response_parser_parse_with_CR_not_followed_by_LF_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 101\r\nUpgrade: websocket\rX", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+/* Tests_SRS_HTTP_RESPONSE_PARSER_01_006: [ Once it failed, `http_response_parser_parse` shall return `HTTP_RESPONSE_PARSER_ERROR` until `http_response_parser_init` is called. ]*/
+TEST_FUNCTION(http_response_parser_parse_after_a_failure_fails)
+{
+    // arrange
+    HTTP_RESPONSE_PARSER parser;
+    size_t consumed;
+    HTTP_RESPONSE_PARSER_RESULT result;
+
+    http_response_parser_init(&parser);
+    (void)parse_string(&parser, "X", &consumed);
+
+    // act
+    result = parse_string(&parser, "HTTP/1.1 101\r\n\r\n", &consumed);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)HTTP_RESPONSE_PARSER_ERROR, (int)result);
+}
+
+END_TEST_SUITE(http_response_parser_ut)
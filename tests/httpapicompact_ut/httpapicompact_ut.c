@@ -87,6 +87,7 @@ void my_gballoc_free(void* ptr)
 #include "azure_c_shared_utility/buffer_.h"
 #undef ENABLE_MOCKS
 #include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/httpapi_stream.h"
 #include "azure_c_shared_utility/shared_util_options.h"
 
 static bool current_xioCreate_must_fail = false;
@@ -441,6 +442,36 @@ HTTP_HEADERS_RESULT my_HTTPHeaders_GetHeader(HTTP_HEADERS_HANDLE handle, size_t
     return result;
 }
 
+static size_t onRequestContentRead_position;
+static int onRequestContentRead_shallReturn;
+static int test_onRequestContentRead(void* context, unsigned char* buffer, size_t size, size_t* bytesRead)
+{
+    (void)context;
+    if (onRequestContentRead_shallReturn == 0)
+    {
+        (void)memcpy(buffer, TEST_EXECUTE_REQUEST_CONTENT + onRequestContentRead_position, size);
+        onRequestContentRead_position += size;
+        *bytesRead = size;
+    }
+    return onRequestContentRead_shallReturn;
+}
+
+static char onResponseContentWrite_content[64];
+static size_t onResponseContentWrite_size;
+static int onResponseContentWrite_shallReturn;
+static int test_onResponseContentWrite(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    if ((onResponseContentWrite_shallReturn == 0) &&
+        (onResponseContentWrite_size + size < sizeof(onResponseContentWrite_content)))
+    {
+        (void)memcpy(onResponseContentWrite_content + onResponseContentWrite_size, buffer, size);
+        onResponseContentWrite_size += size;
+        onResponseContentWrite_content[onResponseContentWrite_size] = '\0';
+    }
+    return onResponseContentWrite_shallReturn;
+}
+
 static const IO_INTERFACE_DESCRIPTION default_tlsio = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 const IO_INTERFACE_DESCRIPTION* my_platform_get_default_tlsio(void)
 {
@@ -762,6 +793,12 @@ TEST_FUNCTION_INITIALIZE(f)
     xio_close_shallReturn = 0;
     DoworkJobsCloseSuccess = true;
     call_on_io_close_complete_in_xio_close = true;
+
+    onRequestContentRead_position = 0;
+    onRequestContentRead_shallReturn = 0;
+    onResponseContentWrite_content[0] = '\0';
+    onResponseContentWrite_size = 0;
+    onResponseContentWrite_shallReturn = 0;
 }
 
 TEST_FUNCTION_CLEANUP(cleans)
@@ -4149,4 +4186,201 @@ TEST_FUNCTION(HTTPAPI_ExecuteRequest__Execute_request_with_truncated_header_fail
     HTTPAPI_Deinit();
 }
 
+/* HTTPAPI_ExecuteRequestStream */
+
+/*Tests_SRS_HTTPAPI_COMPACT_01_002: [ If onRequestContentRead is NULL and contentLength is not 0, the HTTPAPI_ExecuteRequestStream shall return HTTPAPI_INVALID_ARG. ]*/
+TEST_FUNCTION(HTTPAPI_ExecuteRequestStream__NULL_onRequestContentRead_with_content_failed)
+{
+    /// arrange
+    unsigned int statusCode;
+    HTTPAPI_RESULT result;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    HTTP_HANDLE httpHandle = createHttpConnection();
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+
+    /// act
+    result = HTTPAPI_ExecuteRequestStream(
+        httpHandle,
+        HTTPAPI_REQUEST_POST,
+        TEST_EXECUTE_REQUEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        TEST_EXECUTE_REQUEST_CONTENT_LENGTH,
+        NULL,
+        NULL,
+        &statusCode,
+        responseHttpHeaders,
+        test_onResponseContentWrite,
+        NULL);
+
+    /// assert
+    ASSERT_ARE_EQUAL(int, HTTPAPI_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 4, currentmalloc_call);
+
+    /// cleanup
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders); /* currentmalloc_call -= 2 */
+    HTTPAPI_CloseConnection(httpHandle);	/* currentmalloc_call -= 2 */
+    HTTPAPI_Deinit();
+}
+
+/*Tests_SRS_HTTPAPI_COMPACT_01_001: [ The HTTPAPI_ExecuteRequestStream shall execute the request the same way as HTTPAPI_ExecuteRequest, reading the content from onRequestContentRead and passing the response content to onResponseContentWrite. ]*/
+/*Tests_SRS_HTTPAPI_COMPACT_01_003: [ The HTTPAPI_ExecuteRequestStream shall send the content in pieces of at most 1024 bytes read from onRequestContentRead, never asking for more than what is left of the contentLength bytes. ]*/
+/*Tests_SRS_HTTPAPI_COMPACT_01_005: [ The HTTPAPI_ExecuteRequestStream shall pass the response content to onResponseContentWrite in pieces of at most 1024 bytes as it is received. ]*/
+TEST_FUNCTION(HTTPAPI_ExecuteRequestStream__request_with_content_succeed)
+{
+    /// arrange
+    unsigned int statusCode;
+    HTTPAPI_RESULT result;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    HTTP_HANDLE httpHandle = createHttpConnection();
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+
+    setHttpCertificate(httpHandle);
+    DoworkJobsReceivedBuffer = TEST_RECEIVED_ANSWER;
+    DoworkJobsReceivedBuffer_size[0] = strlen((const char*)DoworkJobsReceivedBuffer);
+    DoworkJobsReceivedBuffer_counter = 0;
+    DoworkJobs = (const xio_dowork_job*)doworkjob_o_rce;
+    DoworkJobsOpenResult = DoworkJobsOpenResult_ReceiveHead;
+    DoworkJobsSendResult = DoworkJobsSendResult_ReceiveHead;
+
+    setupAllCallBeforeOpenHTTPsequence(requestHttpHeaders, 1, false);
+    setupAllCallBeforeSendHTTPsequenceWithSuccess(requestHttpHeaders);
+    setupAllCallBeforeReceiveHTTPsequenceWithSuccess();
+
+    HTTPHeaders_GetHeader_shallReturn = HTTP_HEADERS_OK;
+    xio_send_transmited_buffer_target = 7;
+
+    /// act
+    result = HTTPAPI_ExecuteRequestStream(
+        httpHandle,
+        HTTPAPI_REQUEST_POST,
+        TEST_EXECUTE_REQUEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        TEST_EXECUTE_REQUEST_CONTENT_LENGTH,
+        test_onRequestContentRead,
+        NULL,
+        &statusCode,
+        responseHttpHeaders,
+        test_onResponseContentWrite,
+        NULL);
+
+    /// assert
+    ASSERT_ARE_EQUAL(int, HTTPAPI_OK, result);
+    ASSERT_ARE_EQUAL(int, 433, statusCode);
+    ASSERT_ARE_EQUAL(size_t, TEST_EXECUTE_REQUEST_CONTENT_LENGTH, onRequestContentRead_position);
+    ASSERT_ARE_EQUAL(char_ptr, (const char*)TEST_EXECUTE_REQUEST_CONTENT, xio_send_transmited_buffer);
+    ASSERT_ARE_EQUAL(char_ptr, "0123456789", onResponseContentWrite_content);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 5, currentmalloc_call);
+
+    /// cleanup
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders); /* currentmalloc_call -= 2 */
+    HTTPAPI_CloseConnection(httpHandle);	/* currentmalloc_call -= 3 */
+    HTTPAPI_Deinit();
+}
+
+/*Tests_SRS_HTTPAPI_COMPACT_01_006: [ If onResponseContentWrite fails, the HTTPAPI_ExecuteRequestStream shall return HTTPAPI_READ_DATA_FAILED. ]*/
+TEST_FUNCTION(HTTPAPI_ExecuteRequestStream__onResponseContentWrite_failed)
+{
+    /// arrange
+    unsigned int statusCode;
+    HTTPAPI_RESULT result;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    HTTP_HANDLE httpHandle = createHttpConnection();
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+
+    setHttpCertificate(httpHandle);
+    DoworkJobsReceivedBuffer = TEST_RECEIVED_ANSWER;
+    DoworkJobsReceivedBuffer_size[0] = strlen((const char*)DoworkJobsReceivedBuffer);
+    DoworkJobsReceivedBuffer_counter = 0;
+    DoworkJobs = (const xio_dowork_job*)doworkjob_o_rce;
+    DoworkJobsOpenResult = DoworkJobsOpenResult_ReceiveHead;
+    DoworkJobsSendResult = DoworkJobsSendResult_ReceiveHead;
+
+    setupAllCallBeforeOpenHTTPsequence(requestHttpHeaders, 1, false);
+    setupAllCallBeforeSendHTTPsequenceWithSuccess(requestHttpHeaders);
+    setupAllCallBeforeReceiveHTTPsequenceWithSuccess();
+
+    HTTPHeaders_GetHeader_shallReturn = HTTP_HEADERS_OK;
+    onResponseContentWrite_shallReturn = __LINE__;
+
+    /// act
+    result = HTTPAPI_ExecuteRequestStream(
+        httpHandle,
+        HTTPAPI_REQUEST_POST,
+        TEST_EXECUTE_REQUEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        TEST_EXECUTE_REQUEST_CONTENT_LENGTH,
+        test_onRequestContentRead,
+        NULL,
+        &statusCode,
+        responseHttpHeaders,
+        test_onResponseContentWrite,
+        NULL);
+
+    /// assert
+    ASSERT_ARE_EQUAL(int, HTTPAPI_READ_DATA_FAILED, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 5, currentmalloc_call);
+
+    /// cleanup
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders); /* currentmalloc_call -= 2 */
+    HTTPAPI_CloseConnection(httpHandle);	/* currentmalloc_call -= 3 */
+    HTTPAPI_Deinit();
+}
+
+/*Tests_SRS_HTTPAPI_COMPACT_01_007: [ If onResponseContentWrite is NULL, the HTTPAPI_ExecuteRequestStream shall ignore any content in the response. ]*/
+TEST_FUNCTION(HTTPAPI_ExecuteRequestStream__NULL_onResponseContentWrite_succeed)
+{
+    /// arrange
+    unsigned int statusCode;
+    HTTPAPI_RESULT result;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    HTTP_HANDLE httpHandle = createHttpConnection();
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+
+    setHttpCertificate(httpHandle);
+    DoworkJobsReceivedBuffer = TEST_RECEIVED_ANSWER;
+    DoworkJobsReceivedBuffer_size[0] = strlen((const char*)DoworkJobsReceivedBuffer);
+    DoworkJobsReceivedBuffer_counter = 0;
+    DoworkJobs = (const xio_dowork_job*)doworkjob_o_rce;
+    DoworkJobsOpenResult = DoworkJobsOpenResult_ReceiveHead;
+    DoworkJobsSendResult = DoworkJobsSendResult_ReceiveHead;
+
+    setupAllCallBeforeOpenHTTPsequence(requestHttpHeaders, 1, false);
+    setupAllCallBeforeSendHTTPsequenceWithSuccess(requestHttpHeaders);
+    setupAllCallBeforeReceiveHTTPsequenceWithSuccess();
+
+    HTTPHeaders_GetHeader_shallReturn = HTTP_HEADERS_OK;
+
+    /// act
+    result = HTTPAPI_ExecuteRequestStream(
+        httpHandle,
+        HTTPAPI_REQUEST_POST,
+        TEST_EXECUTE_REQUEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        TEST_EXECUTE_REQUEST_CONTENT_LENGTH,
+        test_onRequestContentRead,
+        NULL,
+        &statusCode,
+        responseHttpHeaders,
+        NULL,
+        NULL);
+
+    /// assert
+    ASSERT_ARE_EQUAL(int, HTTPAPI_OK, result);
+    ASSERT_ARE_EQUAL(int, 433, statusCode);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 5, currentmalloc_call);
+
+    /// cleanup
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders); /* currentmalloc_call -= 2 */
+    HTTPAPI_CloseConnection(httpHandle);	/* currentmalloc_call -= 3 */
+    HTTPAPI_Deinit();
+}
+
 END_TEST_SUITE(httpapicompact_ut)
@@ -77,6 +77,8 @@ void my_gballoc_free(void* ptr)
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/httpheaders.h"
 #include "azure_c_shared_utility/httpapi.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 static size_t currentHTTPAPI_SaveOption_call;
 static size_t whenShallHTTPAPI_SaveOption_fail;
@@ -270,6 +272,7 @@ extern "C"
 #undef ENABLE_MOCKS
 
 #include "azure_c_shared_utility/httpapiex.h"
+#include "azure_c_shared_utility/shared_util_options.h"
 
 TEST_DEFINE_ENUM_TYPE(HTTPAPI_RESULT, HTTPAPI_RESULT_VALUES);
 IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTPAPI_RESULT, HTTPAPI_RESULT_VALUES);
@@ -279,6 +282,8 @@ TEST_DEFINE_ENUM_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT_VALUES);
 IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT_VALUES);
 TEST_DEFINE_ENUM_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE_VALUES);
 IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE_VALUES);
+TEST_DEFINE_ENUM_TYPE(LOCK_RESULT, LOCK_RESULT_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(LOCK_RESULT, LOCK_RESULT_VALUES);
 
 #define TEST_HOSTNAME "aaa"
 #define TEST_RELATIVE_PATH "nothing/to/see/here/devices"
@@ -291,6 +296,10 @@ IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE_VALUES);
 #define TEST_BUFFER_RESP_BODY   (BUFFER_HANDLE) 0x49
 unsigned char* TEST_BUFFER = (unsigned char*)"333333";
 #define TEST_BUFFER_SIZE 6
+#define TEST_LOCK_HANDLE (LOCK_HANDLE)0x4A
+#define TEST_TICK_COUNTER_HANDLE (TICK_COUNTER_HANDLE)0x4B
+
+static tickcounter_ms_t test_current_ms;
 
 static TEST_MUTEX_HANDLE g_testByTest;
 static TEST_MUTEX_HANDLE g_dllByDll;
@@ -333,16 +342,61 @@ static void setupAllCallBeforeHTTPsequence(void)
         .IgnoreArgument(1);
 }
 
+/*checking a connection out of the idle connections and back in both take the lock*/
+static void setupCheckOutConnectionCalls(void)
+{
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
+static void setupCheckInConnectionCalls(void)
+{
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
+/*a new connection gets the saved options with the lock held, there are none saved in the regular sequences*/
+static void setupPassSavedOptionsCalls(void)
+{
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
+/*an idle connection that cannot be used anymore is taken out with the lock held and closed after it is released*/
+static void setupCloseUnusableConnectionCalls(void)
+{
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)); /*there is no other one*/
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
+/*the handle takes its HTTPAPI_Init reference with the lock held, only the first request calls HTTPAPI_Init*/
+static void setupInitHTTPAPICalls(bool isFirstRequest)
+{
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    if (isFirstRequest)
+    {
+        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    }
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
 static void setupAllCallForHTTPsequence(const char* relativePath, HTTP_HEADERS_HANDLE requestHttpHeaders, BUFFER_HANDLE requestHttpBody, HTTP_HEADERS_HANDLE responseHttpHeaders, BUFFER_HANDLE responseHttpBody)
 {
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
+    setupInitHTTPAPICalls(true);
 
     /*this is getting the hostname for the HTTAPI_connect call)*/
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(requestHttpBody))
         .SetReturn(TEST_BUFFER_SIZE);
@@ -367,6 +421,8 @@ static void setupAllCallForHTTPsequence(const char* relativePath, HTTP_HEADERS_H
         .IgnoreArgument(1)
         .IgnoreArgument(7)
         ;
+
+    setupCheckInConnectionCalls();
 }
 
 /*every time HttpApi_Execute request is executed several things will be auto-aupdated by the code*/
@@ -385,6 +441,8 @@ static void prepareHTTPAPIEX_ExecuteRequest(unsigned int *asGivenByHttpApi, HTTP
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*this is the connection of the previous request*/
+
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1).SetReturn(TEST_BUFFER_SIZE);
     STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
@@ -406,6 +464,18 @@ static void prepareHTTPAPIEX_ExecuteRequest(unsigned int *asGivenByHttpApi, HTTP
         .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
         .CopyOutArgumentBuffer(7, asGivenByHttpApi, sizeof(*asGivenByHttpApi))
         .SetReturn(resultToBeUsed);
+
+    if (resultToBeUsed == HTTPAPI_OK)
+    {
+        setupCheckInConnectionCalls();
+    }
+}
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = test_current_ms;
+    return 0;
 }
 
 DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
@@ -436,6 +506,10 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_TYPE(HTTPAPIEX_RESULT, HTTPAPIEX_RESULT);
     REGISTER_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT);
     REGISTER_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE);
+    REGISTER_TYPE(LOCK_RESULT, LOCK_RESULT);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(tickcounter_ms_t*, void*);
     REGISTER_UMOCK_ALIAS_TYPE(VECTOR_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(const VECTOR_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(PREDICATE_FUNCTION, void*);
@@ -478,6 +552,12 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_HOOK(VECTOR_size, real_VECTOR_size);
     REGISTER_GLOBAL_MOCK_HOOK(mallocAndStrcpy_s, real_mallocAndStrcpy_s);
     REGISTER_GLOBAL_MOCK_HOOK(size_tToString, real_size_tToString);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Deinit, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, TEST_TICK_COUNTER_HANDLE);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
 }
 
 TEST_SUITE_CLEANUP(TestClassCleanup)
@@ -511,6 +591,7 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     whenShallBUFFER_size_fail = 0;
     
     HTTPAPI_Init_calls = 0;
+    test_current_ms = 0;
 
     currentHTTPAPI_CreateConnection_call = 0;
     for(size_t i=0;i<N_MAX_FAILS;i++) whenShallHTTPAPI_CreateConnection_fail[i] = 0;
@@ -541,6 +622,8 @@ TEST_FUNCTION(HTTPAPIEX_Create_with_NULL_name_fails)
 
 /*Tests_SRS_HTTPAPIEX_02_002: [Parameter hostName shall be saved.] */
 /*Tests_SRS_HTTPAPIEX_02_004: [Otherwise, HTTPAPIEX_Create shall return a HTTAPIEX_HANDLE suitable for further calls to the module.]*/
+/*Tests_SRS_HTTPAPIEX_01_001: [HTTPAPIEX_Create shall create a lock by calling Lock_Init, the lock guards the saved options and the idle connections.]*/
+/*Tests_SRS_HTTPAPIEX_01_002: [HTTPAPIEX_Create shall allocate room for the default maximum of 4 idle connections.]*/
 TEST_FUNCTION(HTTPAPIEX_Create_succeeds)
 {
     /// arrange
@@ -551,6 +634,10 @@ TEST_FUNCTION(HTTPAPIEX_Create_succeeds)
     STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is the room for the idle connections*/
+        .IgnoreArgument(1);
+
     /// act
     HTTPAPIEX_HANDLE result = HTTPAPIEX_Create(TEST_HOSTNAME);
 
@@ -563,6 +650,7 @@ TEST_FUNCTION(HTTPAPIEX_Create_succeeds)
 }
 
 /*Tests_SRS_HTTPAPIEX_02_042: [HTTPAPIEX_Destroy shall free all the resources used by HTTAPIEX_HANDLE.] */
+/*Tests_SRS_HTTPAPIEX_01_005: [The handle shall hold a single HTTPAPI_Init reference, taken with the lock held by the first request that needs a new connection and released by HTTPAPIEX_Destroy.]*/
 TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_1) /*this is destroy after created*/
 {
     /// arrange
@@ -578,6 +666,10 @@ TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_1) /*this is destroy after creat
     STRICT_EXPECTED_CALL(VECTOR_destroy(IGNORED_PTR_ARG)) /*these are the options vector*/
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the room for the idle connections*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+
     STRICT_EXPECTED_CALL(gballoc_free(handle)); /*this is handle data*/
 
     /// act
@@ -613,6 +705,10 @@ TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_2) /*this is destroy after setti
     STRICT_EXPECTED_CALL(VECTOR_destroy(IGNORED_PTR_ARG)) /*these are the options vector*/
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the room for the idle connections*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+
     STRICT_EXPECTED_CALL(gballoc_free(handle)); /*this is handle data*/
 
     /// act
@@ -623,6 +719,8 @@ TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_2) /*this is destroy after setti
 }
 
 /*Tests_SRS_HTTPAPIEX_02_042: [HTTPAPIEX_Destroy shall free all the resources used by HTTAPIEX_HANDLE.] */
+/*Tests_SRS_HTTPAPIEX_01_005: [The handle shall hold a single HTTPAPI_Init reference, taken with the lock held by the first request that needs a new connection and released by HTTPAPIEX_Destroy.]*/
+/*Tests_SRS_HTTPAPIEX_01_010: [HTTPAPIEX_Destroy shall close all the idle connections and then release the HTTPAPI_Init reference of the handle.]*/
 TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_3) /*this is destroy after having a sequence build*/
 {
     /// arrange
@@ -652,6 +750,10 @@ TEST_FUNCTION(HTTPAPIEX_Destroy_frees_resources_3) /*this is destroy after havin
     STRICT_EXPECTED_CALL(VECTOR_destroy(IGNORED_PTR_ARG)) /*these are the options vector*/
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the room for the idle connections*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+
     STRICT_EXPECTED_CALL(gballoc_free(httpapiexhandle)); /*this is the handle*/
 
     /// act
@@ -735,6 +837,73 @@ TEST_FUNCTION(HTTPAPIEX_Create_fails_when_VECTOR_create_fails)
     ///destroy
 }
 
+/*Tests_SRS_HTTPAPIEX_02_005: [If creating the handle fails for any reason, then HTTAPIEX_Create shall return NULL.] */
+TEST_FUNCTION(HTTPAPIEX_Create_fails_when_Lock_Init_fails)
+{
+    /// arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(0))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
+
+    STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(Lock_Init())
+        .SetReturn(NULL);
+
+    STRICT_EXPECTED_CALL(VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    /// act
+    HTTPAPIEX_HANDLE result = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    /// assert
+    ASSERT_ARE_EQUAL(void_ptr, NULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+}
+
+/*Tests_SRS_HTTPAPIEX_02_005: [If creating the handle fails for any reason, then HTTAPIEX_Create shall return NULL.] */
+TEST_FUNCTION(HTTPAPIEX_Create_fails_when_allocating_the_idle_connections_fails)
+{
+    /// arrange
+    whenShallmalloc_fail = currentmalloc_call + 2;
+    STRICT_EXPECTED_CALL(gballoc_malloc(0))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
+
+    STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(gballoc_malloc(0))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    /// act
+    HTTPAPIEX_HANDLE result = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    /// assert
+    ASSERT_ARE_EQUAL(void_ptr, NULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+}
+
 /*Tests_SRS_HTTPAPIEX_02_006: [If parameter handle is NULL then HTTPAPIEX_ExecuteRequest shall fail and return HTTPAPIEX_INVALID_ARG.]*/
 TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_handle_fails)
 {
@@ -859,13 +1028,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_request_headers_and_NULL_reques
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", "0"))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1).SetReturn(0);
@@ -888,6 +1058,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_request_headers_and_NULL_reques
         .IgnoreArgument(7)
         ;
 
+    setupCheckInConnectionCalls();
+
     STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
@@ -1058,13 +1230,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_request_headers_and_NULL_re
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", "0"))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1).SetReturn(0);
@@ -1087,6 +1260,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_request_headers_and_NULL_re
         .IgnoreArgument(7)
         ;
 
+    setupCheckInConnectionCalls();
+
     STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -1240,13 +1415,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_request_headers_and_non_NUL
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1270,6 +1446,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_request_headers_and_non_NUL
         .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -1383,13 +1561,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_statusCode_succeeds)
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1413,6 +1592,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_statusCode_succeeds)
         .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, NULL, responseHttpHeaders, responseHttpBody);
 
@@ -1452,13 +1633,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_statusCode_returns_that_cod
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1483,6 +1665,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_statusCode_returns_that_cod
         .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -1627,13 +1811,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_response_headers_suceeds)
     /*Because it is creating fake response headers*/
     STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1659,6 +1844,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_response_headers_suceeds)
         .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
         ;
 
+    setupCheckInConnectionCalls();
+
     STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -1744,13 +1931,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_response_headers_suceeds)
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1).SetReturn(TEST_BUFFER_SIZE);
@@ -1774,6 +1962,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_response_headers_suceeds)
         .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -1815,13 +2005,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_response_body_suceeds)
 
     STRICT_EXPECTED_CALL(BUFFER_new()); /*because it makes a fake response buffer*/
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1).SetReturn(TEST_BUFFER_SIZE);
@@ -1847,6 +2038,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_NULL_response_body_suceeds)
         .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
         ;
 
+    setupCheckInConnectionCalls();
+
     STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -1930,13 +2123,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_response_body_suceeds)
     STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Length", TOSTRING(TEST_BUFFER_SIZE)))
         .IgnoreArgument(1);
 
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
     /*this is getting the buffer content and buffer length to pass to httpapi_executerequest*/
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupInitHTTPAPICalls(true);
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-        .IgnoreArgument(1);
+    setupPassSavedOptionsCalls();
 
     STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1961,6 +2155,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_response_body_suceeds)
         .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -1980,6 +2176,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_with_non_NULL_response_body_suceeds)
 /*Tests_SRS_HTTPAPIEX_02_026: [A step shall be retried at most once.]*/
 /*Tests_SRS_HTTPAPIEX_02_027: [If a step has been retried then all subsequent steps shall be retried too.]*/
 /*Tests_SRS_HTTPAPIEX_02_028: [HTTPAPIEX_ExecuteRequest shall return HTTPAPIEX_OK when a call to HTTPAPI_ExecuteRequest has been completed successfully.]*/
+/*Tests_SRS_HTTPAPIEX_01_003: [Before the sequence in SRS_HTTPAPIEX_02_023, HTTPAPIEX_ExecuteRequest shall check out the most recently used idle connection of the handle and start the sequence at step 3 with it.]*/
+/*Tests_SRS_HTTPAPIEX_01_006: [When HTTPAPI_ExecuteRequest succeeds, the connection shall be returned to the idle connections of the handle.]*/
 TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S1) /*refer to httpapiex_retry_mechanism.vsdx*/
 {
     /// arrange
@@ -2034,8 +2232,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S2) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2061,6 +2258,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S2) /*refer to httpapiex_retry_m
             .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
             .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
             ;
+
+        setupCheckInConnectionCalls();
     }
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
@@ -2099,8 +2298,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S3) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
     }
 
     {
@@ -2131,17 +2329,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S3) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init())
-            .SetReturn(HTTPAPI_OK);
+        setupInitHTTPAPICalls(false);
     }
 
     {
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
     }
 
     {
@@ -2166,6 +2361,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S3) /*refer to httpapiex_retry_m
             .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
             .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
             ;
+
+        setupCheckInConnectionCalls();
     }
 
     /// act
@@ -2209,17 +2406,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S4) /*refer to httpapiex_retry_m
     }
 
     {
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init())
-            .SetReturn(HTTPAPI_OK);
+        setupInitHTTPAPICalls(false);
     }
 
     {
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
     }
 
     {
@@ -2244,6 +2438,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_S4) /*refer to httpapiex_retry_m
             .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
             .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi))
             ;
+
+        setupCheckInConnectionCalls();
     }
 
     /// act
@@ -2289,9 +2485,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F1) /*refer to httpapiex_retry_m
     }
 
     {
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        whenShallHTTPAPI_Init_fail[0] = currentHTTPAPI_Init_call + 1;
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)) /*the HTTPAPI_Init reference of the handle cannot be checked*/
+            .SetReturn(LOCK_ERROR);
     }
 
     /// act
@@ -2335,8 +2530,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F2) /*refer to httpapiex_retry_m
     }
 
     {
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        setupInitHTTPAPICalls(false);
     }
 
     {
@@ -2347,11 +2541,6 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F2) /*refer to httpapiex_retry_m
 
     }
 
-    /*this is post final fail - sequence is reset to a clean start*/
-    {        
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-    }
-
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -2393,16 +2582,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F3) /*refer to httpapiex_retry_m
     }
 
     {
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        setupInitHTTPAPICalls(false);
     }
 
     {
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2435,7 +2622,6 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F3) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
     }
 
     /// act
@@ -2475,8 +2661,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F4) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2508,10 +2693,8 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F4) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-
-        whenShallHTTPAPI_Init_fail[0] = currentHTTPAPI_Init_call + 1;
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)) /*the HTTPAPI_Init reference of the handle cannot be checked*/
+            .SetReturn(LOCK_ERROR);
     }
 
     /// act
@@ -2551,8 +2734,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F5) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2584,8 +2766,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F5) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1); 
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        setupInitHTTPAPICalls(false);
     }
 
     {
@@ -2595,10 +2776,6 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F5) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
     }
 
-    {
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-    }
-
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -2636,8 +2813,7 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F6) /*refer to httpapiex_retry_m
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2669,16 +2845,14 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F6) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
-        STRICT_EXPECTED_CALL(HTTPAPI_Init());
+        setupInitHTTPAPICalls(false);
     }
 
     {
         STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
-            .IgnoreArgument(1);
+        setupPassSavedOptionsCalls();
 
     }
 
@@ -2710,7 +2884,6 @@ TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_TestCase_F6) /*refer to httpapiex_retry_m
     {
         STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPI_Deinit());
     }
 
     /// act
@@ -2785,6 +2958,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_without_httpapi_handle_succeeds)
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption", "333", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption")); /*this is looking for optionName*/
 
@@ -2795,6 +2969,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_without_httpapi_handle_succeeds)
         .IgnoreArgument(1)
         .IgnoreArgument(2);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption", "333");
 
@@ -2815,6 +2991,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_without_httpapi_handle_can_save_2_o
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption1", (void*)"3", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption1")); /*this is looking for the option to device between update / create*/
 
@@ -2825,7 +3002,10 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_without_httpapi_handle_can_save_2_o
         .IgnoreArgument(1)
         .IgnoreArgument(2);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption2", (void*)"33", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption2")); /*this is looking for the option to device between update / create*/
 
@@ -2836,6 +3016,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_without_httpapi_handle_can_save_2_o
         .IgnoreArgument(1)
         .IgnoreArgument(2);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result1 = HTTPAPIEX_SetOption(httpapiexhandle, "someOption1", (void*)"3");
     HTTPAPIEX_RESULT result2 = HTTPAPIEX_SetOption(httpapiexhandle, "someOption2", (void*)"33");
@@ -2866,13 +3048,16 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_succeeds)
     umock_c_reset_all_calls();
 
     setupAllCallBeforeHTTPsequence();
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
+    setupInitHTTPAPICalls(true);
 
     /*this is getting the hostname for the HTTAPI_connect call)*/
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/
         .IgnoreArgument(1);
 
     STRICT_EXPECTED_CALL(VECTOR_element(IGNORED_PTR_ARG, 0))
@@ -2887,6 +3072,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_succeeds)
         .IgnoreArgument(1)
         .IgnoreArgument(3);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     STRICT_EXPECTED_CALL(BUFFER_length(requestHttpBody))
         .SetReturn(TEST_BUFFER_SIZE);
     size_t requestHttpBodyLength = TEST_BUFFER_SIZE;
@@ -2911,6 +3098,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_succeeds)
         .IgnoreArgument(7)
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -2940,13 +3129,16 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_ignores_errors
     umock_c_reset_all_calls();
 
     setupAllCallBeforeHTTPsequence();
-    STRICT_EXPECTED_CALL(HTTPAPI_Init());
+    setupCheckOutConnectionCalls(); /*there is no idle connection yet*/
+
+    setupInitHTTPAPICalls(true);
 
     /*this is getting the hostname for the HTTAPI_connect call)*/
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
-    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/ /*there are none saved in the regular sequences*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_size(IGNORED_PTR_ARG)) /*this is passing the options*/
         .IgnoreArgument(1);
 
     STRICT_EXPECTED_CALL(VECTOR_element(IGNORED_PTR_ARG, 0))
@@ -2963,6 +3155,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_ignores_errors
         .IgnoreArgument(3)
         .SetReturn(HTTPAPI_ERROR);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     STRICT_EXPECTED_CALL(BUFFER_length(requestHttpBody))
         .SetReturn(TEST_BUFFER_SIZE);
     size_t requestHttpBodyLength = TEST_BUFFER_SIZE;
@@ -2987,6 +3181,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_httpapi_ignores_errors
         .IgnoreArgument(7)
         ;
 
+    setupCheckInConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
 
@@ -3007,6 +3203,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_fails_when_VECTOR_push_back_fails)
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption2", (void*)"33", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption2")); /*this is looking for the option to device between update / create*/
 
@@ -3023,6 +3220,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_fails_when_VECTOR_push_back_fails)
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is freeing the clone created by HTTPAPI_CloneOption*/
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption2", (void*)"33");
 
@@ -3042,6 +3241,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_fails_when_gballoc_fails_1)
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption2", (void*)"33", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption2")); /*this is looking for the option to device between update / create*/
 
@@ -3051,6 +3251,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_fails_when_gballoc_fails_1)
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is freeing the clone created by HTTPAPI_CloneOption*/
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption2", (void*)"33");
 
@@ -3126,6 +3328,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption", "3", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption")); /*this is looking for the option to device between update / create*/
 
@@ -3138,6 +3341,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
 
     EXPECTED_CALL(HTTPAPI_SetOption(IGNORED_PTR_ARG, "someOption", "3"));
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption", "3");
 
@@ -3151,6 +3356,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
 }
 
 /*Tests_SRS_HTTPAPIEX_02_031: [If HTTPAPI_HANDLE exists then HTTPAPIEX_SetOption shall call HTTPAPI_SetOption passing the same optionName and value and shall return a value conforming to the below table:] */
+/*Tests_SRS_HTTPAPIEX_01_017: [If HTTPAPI_SetOption fails for an idle connection, that connection shall be closed instead of being checked out again.]*/
+/*Tests_SRS_HTTPAPIEX_01_018: [Idle connections shall be taken out of the idle connections with the lock held and closed after the lock has been released.]*/
 TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handle_fails_1)
 {
     /// arrange
@@ -3169,6 +3376,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption", "3", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption")); /*this is looking for the option to device between update / create*/
 
@@ -3182,6 +3390,9 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
     EXPECTED_CALL(HTTPAPI_SetOption(IGNORED_PTR_ARG, "someOption", "3"))
         .SetReturn(HTTPAPI_INVALID_ARG);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    setupCloseUnusableConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption", "3");
 
@@ -3195,6 +3406,8 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
 }
 
 /*Tests_SRS_HTTPAPIEX_02_031: [If HTTPAPI_HANDLE exists then HTTPAPIEX_SetOption shall call HTTPAPI_SetOption passing the same optionName and value and shall return a value conforming to the below table:] */
+/*Tests_SRS_HTTPAPIEX_01_017: [If HTTPAPI_SetOption fails for an idle connection, that connection shall be closed instead of being checked out again.]*/
+/*Tests_SRS_HTTPAPIEX_01_018: [Idle connections shall be taken out of the idle connections with the lock held and closed after the lock has been released.]*/
 TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handle_fails_2)
 {
     /// arrange
@@ -3213,6 +3426,7 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption("someOption", "3", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, "someOption")); /*this is looking for the option to device between update / create*/
 
@@ -3226,6 +3440,9 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_passes_saved_options_to_existing_httpapi_handl
     EXPECTED_CALL(HTTPAPI_SetOption(IGNORED_PTR_ARG, "someOption", "3"))
         .SetReturn(HTTPAPI_ALLOC_FAILED);
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    setupCloseUnusableConnectionCalls();
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption", "3");
     
@@ -3249,11 +3466,14 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_on_update_option_value_succeeds)
     umock_c_reset_all_calls();
 
     EXPECTED_CALL(HTTPAPI_CloneOption(OPTION_NAME, "4", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
 
     EXPECTED_CALL(VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, OPTION_NAME)); /*this is looking for the option to device between update / create*/
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*this is free-ing the previos value*/
 
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
     /// act
     HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_NAME, "4");
 
@@ -3265,6 +3485,473 @@ TEST_FUNCTION(HTTPAPIEX_SetOption_happy_path_on_update_option_value_succeeds)
     HTTPAPIEX_Destroy(httpapiexhandle);
 }
 
+/*Tests_SRS_HTTPAPIEX_01_007: [If the maximum number of idle connections has been reached, or an option has been set while the connection was checked out, the connection shall be closed instead.]*/
+/*Tests_SRS_HTTPAPIEX_01_005: [The handle shall hold a single HTTPAPI_Init reference, taken with the lock held by the first request that needs a new connection and released by HTTPAPIEX_Destroy.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_closes_the_connection_when_the_idle_connections_are_full)
+{
+    /// arrange
+    size_t maxIdleConnections = 0;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS, &maxIdleConnections);
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+    setupAllCallForHTTPsequence(TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, responseHttpHeaders, responseHttpBody);
+    STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_008: [When the idle timeout is not 0, before checking out a connection HTTPAPIEX_ExecuteRequest shall close the idle connections that have not been used for longer than the idle timeout, keeping at least the minimum number of idle connections.]*/
+/*Tests_SRS_HTTPAPIEX_01_012: [httpapiex_min_idle_connections shall set the number of idle connections that are kept open regardless of the idle timeout.]*/
+/*Tests_SRS_HTTPAPIEX_01_013: [httpapiex_idle_timeout_ms shall set the time in milliseconds after which an idle connection is closed, 0 meaning never.]*/
+/*Tests_SRS_HTTPAPIEX_01_018: [Idle connections shall be taken out of the idle connections with the lock held and closed after the lock has been released.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_closes_the_idle_connection_after_the_idle_timeout)
+{
+    /// arrange
+    size_t minIdleConnections = 0;
+    size_t idleTimeout = 1000;
+    unsigned int asGivenByHttpApi = 23;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MIN_IDLE_CONNECTIONS, &minIdleConnections);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+    (void)HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+    test_current_ms = 1001;
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG)) /*this is the expired connection*/
+        .IgnoreArgument(1);
+    setupCheckOutConnectionCalls(); /*there is no idle connection left*/
+
+    setupInitHTTPAPICalls(false);
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
+    setupPassSavedOptionsCalls();
+
+    STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPAPI_ExecuteRequest(
+        IGNORED_PTR_ARG,
+        HTTPAPI_REQUEST_PATCH,
+        TEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        IGNORED_PTR_ARG,
+        TEST_BUFFER_SIZE,
+        IGNORED_PTR_ARG,
+        responseHttpHeaders,
+        responseHttpBody))
+        .IgnoreArgument(1)
+        .IgnoreArgument(5)
+        .IgnoreArgument(7)
+        .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
+        .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi));
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG)) /*this is stamping the connection that goes back idle*/
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(int, 23, (int)httpStatusCode);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_008: [When the idle timeout is not 0, before checking out a connection HTTPAPIEX_ExecuteRequest shall close the idle connections that have not been used for longer than the idle timeout, keeping at least the minimum number of idle connections.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_reuses_the_idle_connection_before_the_idle_timeout)
+{
+    /// arrange
+    size_t minIdleConnections = 0;
+    size_t idleTimeout = 1000;
+    unsigned int asGivenByHttpApi = 23;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MIN_IDLE_CONNECTIONS, &minIdleConnections);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+    (void)HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+    test_current_ms = 1000;
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPAPI_ExecuteRequest(
+        IGNORED_PTR_ARG,
+        HTTPAPI_REQUEST_PATCH,
+        TEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        IGNORED_PTR_ARG,
+        TEST_BUFFER_SIZE,
+        IGNORED_PTR_ARG,
+        responseHttpHeaders,
+        responseHttpBody))
+        .IgnoreArgument(1)
+        .IgnoreArgument(5)
+        .IgnoreArgument(7)
+        .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
+        .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi));
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_012: [httpapiex_min_idle_connections shall set the number of idle connections that are kept open regardless of the idle timeout.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_keeps_the_minimum_idle_connections_after_the_idle_timeout)
+{
+    /// arrange
+    size_t idleTimeout = 1000;
+    unsigned int asGivenByHttpApi = 23;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    (void)HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+    (void)HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+    test_current_ms = 5000;
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+
+    setupCheckOutConnectionCalls(); /*the only idle connection is kept by the default minimum of 1*/
+
+    STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPAPI_ExecuteRequest(
+        IGNORED_PTR_ARG,
+        HTTPAPI_REQUEST_PATCH,
+        TEST_RELATIVE_PATH,
+        requestHttpHeaders,
+        IGNORED_PTR_ARG,
+        TEST_BUFFER_SIZE,
+        IGNORED_PTR_ARG,
+        responseHttpHeaders,
+        responseHttpBody))
+        .IgnoreArgument(1)
+        .IgnoreArgument(5)
+        .IgnoreArgument(7)
+        .ValidateArgumentBuffer(5, TEST_BUFFER, TEST_BUFFER_SIZE)
+        .CopyOutArgumentBuffer(7, &asGivenByHttpApi, sizeof(asGivenByHttpApi));
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_009: [The saved options and the idle connections shall only be accessed with the lock held.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_fails_when_Lock_fails)
+{
+    /// arrange
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)) /*no idle connection can be checked out*/
+        .SetReturn(LOCK_ERROR);
+
+    setupInitHTTPAPICalls(true);
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPAPI_CreateConnection(TEST_HOSTNAME));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)) /*the saved options cannot be passed*/
+        .SetReturn(LOCK_ERROR);
+    STRICT_EXPECTED_CALL(HTTPAPI_CloseConnection(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_RECOVERYFAILED, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_005: [The handle shall hold a single HTTPAPI_Init reference, taken with the lock held by the first request that needs a new connection and released by HTTPAPIEX_Destroy.]*/
+TEST_FUNCTION(HTTPAPIEX_ExecuteRequest_calls_HTTPAPI_Init_again_after_it_failed)
+{
+    /// arrange
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    whenShallHTTPAPI_Init_fail[0] = currentHTTPAPI_Init_call + 1;
+    (void)HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+    umock_c_reset_all_calls();
+
+    setupAllCallBeforeHTTPsequence();
+    setupAllCallForHTTPsequence(TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, responseHttpHeaders, responseHttpBody);
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_011: [httpapiex_max_idle_connections shall set the maximum number of idle connections kept by the handle, closing the least recently used idle connections above it.]*/
+/*Tests_SRS_HTTPAPIEX_01_018: [Idle connections shall be taken out of the idle connections with the lock held and closed after the lock has been released.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_max_idle_connections_closes_the_idle_connections_above_it)
+{
+    /// arrange
+    size_t maxIdleConnections = 0;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+
+    unsigned int httpStatusCode;
+    HTTP_HEADERS_HANDLE requestHttpHeaders;
+    BUFFER_HANDLE requestHttpBody = TEST_BUFFER_REQ_BODY;
+    HTTP_HEADERS_HANDLE responseHttpHeaders;
+    BUFFER_HANDLE responseHttpBody = TEST_BUFFER_RESP_BODY;
+    createHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    (void)HTTPAPIEX_ExecuteRequest(httpapiexhandle, HTTPAPI_REQUEST_PATCH, TEST_RELATIVE_PATH, requestHttpHeaders, requestHttpBody, &httpStatusCode, responseHttpHeaders, responseHttpBody);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    setupCloseUnusableConnectionCalls();
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS, &maxIdleConnections);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    destroyHttpObjects(&requestHttpHeaders, &responseHttpHeaders);
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_011: [httpapiex_max_idle_connections shall set the maximum number of idle connections kept by the handle, closing the least recently used idle connections above it.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_max_idle_connections_makes_room_for_more_idle_connections)
+{
+    /// arrange
+    size_t maxIdleConnections = 8;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS, &maxIdleConnections);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_015: [If making room for more idle connections fails, HTTPAPIEX_SetOption shall return HTTPAPIEX_ERROR.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_max_idle_connections_fails_when_gballoc_realloc_fails)
+{
+    /// arrange
+    size_t maxIdleConnections = 8;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    whenShallrealloc_fail = currentrealloc_call + 1;
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_MAX_IDLE_CONNECTIONS, &maxIdleConnections);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_014: [The first time the idle timeout is set to a value other than 0, a tick counter shall be created by calling tickcounter_create. If that fails, HTTPAPIEX_SetOption shall return HTTPAPIEX_ERROR.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_idle_timeout_creates_a_tick_counter)
+{
+    /// arrange
+    size_t idleTimeout = 1000;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)); /*the second time the tick counter is already there*/
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result1 = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+    HTTPAPIEX_RESULT result2 = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result1);
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_014: [The first time the idle timeout is set to a value other than 0, a tick counter shall be created by calling tickcounter_create. If that fails, HTTPAPIEX_SetOption shall return HTTPAPIEX_ERROR.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_idle_timeout_fails_when_tickcounter_create_fails)
+{
+    /// arrange
+    size_t idleTimeout = 1000;
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_create())
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, OPTION_HTTPAPIEX_IDLE_TIMEOUT_MS, &idleTimeout);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
+/*Tests_SRS_HTTPAPIEX_01_009: [The saved options and the idle connections shall only be accessed with the lock held.]*/
+TEST_FUNCTION(HTTPAPIEX_SetOption_fails_when_Lock_fails)
+{
+    /// arrange
+    HTTPAPIEX_HANDLE httpapiexhandle = HTTPAPIEX_Create(TEST_HOSTNAME);
+    umock_c_reset_all_calls();
+
+    EXPECTED_CALL(HTTPAPI_CloneOption("someOption", "3", IGNORED_PTR_ARG));  /*this asks lower HTTPAPI to create a clone of the option*/
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE))
+        .SetReturn(LOCK_ERROR);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is freeing the clone created by HTTPAPI_CloneOption*/
+        .IgnoreArgument(1);
+
+    /// act
+    HTTPAPIEX_RESULT result = HTTPAPIEX_SetOption(httpapiexhandle, "someOption", "3");
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///destroy
+    HTTPAPIEX_Destroy(httpapiexhandle);
+}
+
 /*Tests_SRS_HTTPAPIEX_02_043: [If parameter handle is NULL then HTTPAPIEX_Destroy shall take no action.] */
 TEST_FUNCTION(HTTPAPIEX_Destroy_with_NULL_argument_does_nothing)
 {
@@ -151,6 +151,40 @@ TEST_FUNCTION(when_underlying_malloc_fails_singlylinkedlist_create_fails)
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
+/* singlylinkedlist_create_with_item_cache */
+
+/* Tests_SRS_LIST_01_026: [singlylinkedlist_create_with_item_cache shall create a new list and return a non-NULL handle on success.] */
+TEST_FUNCTION(when_underlying_calls_succeed_singlylinkedlist_create_with_item_cache_succeeds)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    SINGLYLINKEDLIST_HANDLE result = singlylinkedlist_create_with_item_cache(2);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    singlylinkedlist_destroy(result);
+}
+
+/* Tests_SRS_LIST_01_027: [If any error occurs during the list creation, singlylinkedlist_create_with_item_cache shall return NULL.] */
+TEST_FUNCTION(when_underlying_malloc_fails_singlylinkedlist_create_with_item_cache_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn((void*)NULL);
+
+    // act
+    SINGLYLINKEDLIST_HANDLE result = singlylinkedlist_create_with_item_cache(2);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* singlylinkedlist_destroy */
 
 /* Tests_SRS_LIST_01_003: [singlylinkedlist_destroy shall free all resources associated with the list identified by the handle argument.] */
@@ -793,4 +827,95 @@ TEST_FUNCTION(singlylinkedlist_remove_second_of_2_items_succeeds)
 	singlylinkedlist_destroy(list);
 }
 
+/* Tests_SRS_LIST_01_029: [If the item cache holds less than max_cached_items nodes, singlylinkedlist_remove shall keep the removed list node in the cache instead of freeing it.] */
+TEST_FUNCTION(singlylinkedlist_remove_keeps_the_node_in_the_item_cache)
+{
+	// arrange
+	int x1 = 0x42;
+	SINGLYLINKEDLIST_HANDLE list = singlylinkedlist_create_with_item_cache(1);
+	LIST_ITEM_HANDLE item = singlylinkedlist_add(list, &x1);
+	umock_c_reset_all_calls();
+
+	// act
+	int result = singlylinkedlist_remove(list, item);
+
+	// assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_IS_NULL(singlylinkedlist_get_head_item(list));
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+	// cleanup
+	singlylinkedlist_destroy(list);
+}
+
+/* Tests_SRS_LIST_01_029: [If the item cache holds less than max_cached_items nodes, singlylinkedlist_remove shall keep the removed list node in the cache instead of freeing it.] */
+TEST_FUNCTION(singlylinkedlist_remove_frees_the_node_when_the_item_cache_is_full)
+{
+	// arrange
+	int x1 = 0x42;
+	int x2 = 0x43;
+	SINGLYLINKEDLIST_HANDLE list = singlylinkedlist_create_with_item_cache(1);
+	LIST_ITEM_HANDLE item1 = singlylinkedlist_add(list, &x1);
+	LIST_ITEM_HANDLE item2 = singlylinkedlist_add(list, &x2);
+	(void)singlylinkedlist_remove(list, item1);
+	umock_c_reset_all_calls();
+
+	EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+	// act
+	int result = singlylinkedlist_remove(list, item2);
+
+	// assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+	// cleanup
+	singlylinkedlist_destroy(list);
+}
+
+/* Tests_SRS_LIST_01_028: [If the item cache of the list is not empty, singlylinkedlist_add shall reuse a cached list node instead of allocating a new one.] */
+TEST_FUNCTION(singlylinkedlist_add_reuses_a_cached_node)
+{
+	// arrange
+	int x1 = 0x42;
+	int x2 = 0x43;
+	SINGLYLINKEDLIST_HANDLE list = singlylinkedlist_create_with_item_cache(1);
+	LIST_ITEM_HANDLE item1 = singlylinkedlist_add(list, &x1);
+	(void)singlylinkedlist_remove(list, item1);
+	umock_c_reset_all_calls();
+
+	// act
+	LIST_ITEM_HANDLE item2 = singlylinkedlist_add(list, &x2);
+
+	// assert
+	ASSERT_IS_NOT_NULL(item2);
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, x2, *(const int*)singlylinkedlist_item_get_value(item2));
+	ASSERT_IS_TRUE(item2 == singlylinkedlist_get_head_item(list));
+	ASSERT_IS_NULL(singlylinkedlist_get_next_item(item2));
+
+	// cleanup
+	singlylinkedlist_destroy(list);
+}
+
+/* Tests_SRS_LIST_01_030: [singlylinkedlist_destroy shall free all list nodes kept in the item cache.] */
+TEST_FUNCTION(singlylinkedlist_destroy_frees_the_cached_nodes)
+{
+	// arrange
+	int x1 = 0x42;
+	SINGLYLINKEDLIST_HANDLE list = singlylinkedlist_create_with_item_cache(1);
+	LIST_ITEM_HANDLE item1 = singlylinkedlist_add(list, &x1);
+	(void)singlylinkedlist_remove(list, item1);
+	umock_c_reset_all_calls();
+
+	EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+	EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+	// act
+	singlylinkedlist_destroy(list);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 END_TEST_SUITE(singlylinkedlist_unittests)
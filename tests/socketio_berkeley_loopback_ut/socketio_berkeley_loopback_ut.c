@@ -0,0 +1,938 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/socketio.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+
+/* socketio_berkeley runs over real loopback sockets here. The lock and the resolver are replaced by the fakes below,
+   so a test can fail a lock taken by its own thread and choose the addresses handed to the connect race. */
+
+#define TEST_HOSTNAME       "test.host"
+#define WAIT_MILLISECONDS   5000
+
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/* fake lock, a pthread mutex that fails on demand for the test thread only */
+static pthread_mutex_t fake_lock_guard = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t test_thread;
+static bool lock_init_will_fail;
+static size_t test_thread_lock_failures;
+static size_t other_thread_lock_count;
+
+LOCK_HANDLE Lock_Init(void)
+{
+    pthread_mutex_t* result;
+
+    (void)pthread_mutex_lock(&fake_lock_guard);
+    result = lock_init_will_fail ? NULL : (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    (void)pthread_mutex_unlock(&fake_lock_guard);
+
+    if (result != NULL)
+    {
+        (void)pthread_mutex_init(result, NULL);
+    }
+
+    return (LOCK_HANDLE)result;
+}
+
+LOCK_RESULT Lock(LOCK_HANDLE handle)
+{
+    bool will_fail = false;
+
+    (void)pthread_mutex_lock(&fake_lock_guard);
+    if (pthread_equal(pthread_self(), test_thread))
+    {
+        if (test_thread_lock_failures > 0)
+        {
+            test_thread_lock_failures--;
+            will_fail = true;
+        }
+    }
+    else
+    {
+        other_thread_lock_count++;
+    }
+    (void)pthread_mutex_unlock(&fake_lock_guard);
+
+    return (will_fail || (pthread_mutex_lock((pthread_mutex_t*)handle) != 0)) ? LOCK_ERROR : LOCK_OK;
+}
+
+LOCK_RESULT Unlock(LOCK_HANDLE handle)
+{
+    return (pthread_mutex_unlock((pthread_mutex_t*)handle) != 0) ? LOCK_ERROR : LOCK_OK;
+}
+
+LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
+{
+    (void)pthread_mutex_destroy((pthread_mutex_t*)handle);
+    free(handle);
+    return LOCK_OK;
+}
+
+static size_t get_other_thread_lock_count(void)
+{
+    size_t result;
+
+    (void)pthread_mutex_lock(&fake_lock_guard);
+    result = other_thread_lock_count;
+    (void)pthread_mutex_unlock(&fake_lock_guard);
+
+    return result;
+}
+
+/* fake resolver, the lookup completes when the test says so and returns the addresses the test added */
+#define MAX_TEST_ADDRESSES  4
+
+static struct addrinfo test_addresses[MAX_TEST_ADDRESSES];
+static struct sockaddr_storage test_socket_addresses[MAX_TEST_ADDRESSES];
+static size_t test_address_count;
+static bool lookup_complete;
+static size_t resolver_count;
+static size_t invalidate_count;
+
+static void add_test_address(int family, int port)
+{
+    struct addrinfo* address = &test_addresses[test_address_count];
+    struct sockaddr_storage* socket_address = &test_socket_addresses[test_address_count];
+
+    (void)memset(address, 0, sizeof(struct addrinfo));
+    (void)memset(socket_address, 0, sizeof(struct sockaddr_storage));
+
+    if (family == AF_INET)
+    {
+        struct sockaddr_in* in = (struct sockaddr_in*)socket_address;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)port);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address->ai_addrlen = sizeof(struct sockaddr_in);
+    }
+    else
+    {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)socket_address;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons((uint16_t)port);
+        in6->sin6_addr = in6addr_loopback;
+        address->ai_addrlen = sizeof(struct sockaddr_in6);
+    }
+
+    address->ai_family = family;
+    address->ai_socktype = SOCK_STREAM;
+    address->ai_addr = (struct sockaddr*)socket_address;
+    if (test_address_count > 0)
+    {
+        test_addresses[test_address_count - 1].ai_next = address;
+    }
+
+    test_address_count++;
+}
+
+DNS_RESOLVER_HANDLE dns_resolver_create(const char* hostname, int port)
+{
+    (void)hostname;
+    (void)port;
+    resolver_count++;
+    return (DNS_RESOLVER_HANDLE)&test_addresses;
+}
+
+bool dns_resolver_is_lookup_complete(DNS_RESOLVER_HANDLE dns)
+{
+    (void)dns;
+    return lookup_complete;
+}
+
+struct addrinfo* dns_resolver_get_addrInfo(DNS_RESOLVER_HANDLE dns)
+{
+    (void)dns;
+    return (test_address_count == 0) ? NULL : &test_addresses[0];
+}
+
+void dns_resolver_destroy(DNS_RESOLVER_HANDLE dns)
+{
+    (void)dns;
+    resolver_count--;
+}
+
+void dns_resolver_invalidate(DNS_RESOLVER_HANDLE dns)
+{
+    (void)dns;
+    invalidate_count++;
+}
+
+/* callbacks */
+static size_t open_complete_count;
+static IO_OPEN_RESULT open_result;
+static size_t close_complete_count;
+static size_t io_error_count;
+static size_t bytes_received_count;
+static unsigned char received_bytes[64];
+static size_t received_size;
+
+static void test_on_io_open_complete(void* context, IO_OPEN_RESULT result)
+{
+    (void)context;
+    open_complete_count++;
+    open_result = result;
+}
+
+static void test_on_io_close_complete(void* context)
+{
+    (void)context;
+    close_complete_count++;
+}
+
+static void test_on_io_error(void* context)
+{
+    (void)context;
+    io_error_count++;
+}
+
+static void test_on_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    bytes_received_count++;
+    if (received_size + size <= sizeof(received_bytes))
+    {
+        (void)memcpy(received_bytes + received_size, buffer, size);
+        received_size += size;
+    }
+}
+
+/* loopback helpers */
+static int create_listener(int family, int backlog, int* port)
+{
+    struct sockaddr_storage socket_address;
+    socklen_t socket_address_length;
+    int result = socket(family, SOCK_STREAM, 0);
+    ASSERT_IS_TRUE(result >= 0);
+
+    (void)memset(&socket_address, 0, sizeof(socket_address));
+    if (family == AF_INET)
+    {
+        struct sockaddr_in* in = (struct sockaddr_in*)&socket_address;
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socket_address_length = sizeof(struct sockaddr_in);
+    }
+    else
+    {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)&socket_address;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_addr = in6addr_loopback;
+        socket_address_length = sizeof(struct sockaddr_in6);
+    }
+
+    ASSERT_ARE_EQUAL(int, 0, bind(result, (struct sockaddr*)&socket_address, socket_address_length));
+    ASSERT_ARE_EQUAL(int, 0, listen(result, backlog));
+    ASSERT_ARE_EQUAL(int, 0, getsockname(result, (struct sockaddr*)&socket_address, &socket_address_length));
+    *port = ntohs((family == AF_INET) ? ((struct sockaddr_in*)&socket_address)->sin_port : ((struct sockaddr_in6*)&socket_address)->sin6_port);
+
+    return result;
+}
+
+static bool has_pending_connection(int listener)
+{
+    struct pollfd listener_poll;
+    listener_poll.fd = listener;
+    listener_poll.events = POLLIN;
+    listener_poll.revents = 0;
+    return poll(&listener_poll, 1, 0) > 0;
+}
+
+/* a listener whose accept queue is already full, so connects to it stay in progress */
+static int create_full_listener(int family, int* port, int* queued_client)
+{
+    struct sockaddr_storage socket_address;
+    socklen_t socket_address_length = sizeof(socket_address);
+    int result = create_listener(family, 0, port);
+
+    ASSERT_ARE_EQUAL(int, 0, getsockname(result, (struct sockaddr*)&socket_address, &socket_address_length));
+    *queued_client = socket(family, SOCK_STREAM, 0);
+    ASSERT_IS_TRUE(*queued_client >= 0);
+    ASSERT_ARE_EQUAL(int, 0, connect(*queued_client, (struct sockaddr*)&socket_address, socket_address_length));
+
+    return result;
+}
+
+/* a port on which nothing listens */
+static int get_closed_port(int family)
+{
+    int result;
+    int listener = create_listener(family, 1, &result);
+    (void)close(listener);
+    return result;
+}
+
+static long get_elapsed_milliseconds(const struct timespec* start)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)((now.tv_sec - start->tv_sec) * 1000) + (long)((now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+static CONCRETE_IO_HANDLE open_to_test_addresses(void)
+{
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 443, NULL };
+    CONCRETE_IO_HANDLE result;
+
+    lookup_complete = true;
+    result = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(result, test_on_io_open_complete, NULL, test_on_bytes_received, NULL, test_on_io_error, NULL));
+
+    return result;
+}
+
+static void sleep_a_bit(void)
+{
+    struct timespec delay = { 0, 5 * 1000 * 1000 };
+    (void)nanosleep(&delay, NULL);
+}
+
+static void dowork_until(CONCRETE_IO_HANDLE socket_io, const size_t* counter, size_t expected)
+{
+    int waited;
+    for (waited = 0; (waited < WAIT_MILLISECONDS) && (*counter < expected); waited += 5)
+    {
+        socketio_dowork(socket_io);
+        sleep_a_bit();
+    }
+}
+
+static size_t count_open_descriptors(void)
+{
+    size_t result = 0;
+    DIR* descriptors = opendir("/proc/self/fd");
+    ASSERT_IS_NOT_NULL(descriptors);
+
+    while (readdir(descriptors) != NULL)
+    {
+        result++;
+    }
+
+    (void)closedir(descriptors);
+    return result;
+}
+
+/* opens a socketio over the fake resolver to a 127.0.0.1 listener and returns the accepted server side */
+static CONCRETE_IO_HANDLE open_to_listener(int listener, int port, int use_reactor, int* server)
+{
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 0, NULL };
+    CONCRETE_IO_HANDLE result;
+
+    config.port = port;
+    add_test_address(AF_INET, port);
+    lookup_complete = true;
+
+    result = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(result, OPTION_SOCKETIO_USE_REACTOR, &use_reactor));
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(result, test_on_io_open_complete, NULL, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    dowork_until(result, &open_complete_count, 1);
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+
+    *server = accept(listener, NULL, NULL);
+    ASSERT_IS_TRUE(*server >= 0);
+
+    return result;
+}
+
+static void assert_bytes_flow(CONCRETE_IO_HANDLE socket_io, int server)
+{
+    char server_buffer[8];
+    size_t received_before = received_size;
+    size_t expected_received = received_size + 5;
+
+    ASSERT_ARE_EQUAL(int, 5, (int)send(server, "hello", 5, 0));
+    dowork_until(socket_io, &received_size, expected_received);
+    ASSERT_ARE_EQUAL(size_t, expected_received, received_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(received_bytes + received_before, "hello", 5));
+
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(socket_io, "ping", 4, NULL, NULL));
+    socketio_dowork(socket_io);
+    ASSERT_ARE_EQUAL(int, 4, (int)recv(server, server_buffer, sizeof(server_buffer), 0));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(server_buffer, "ping", 4));
+}
+
+BEGIN_TEST_SUITE(socketio_berkeley_loopback_ut)
+
+TEST_SUITE_INITIALIZE(a)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    test_thread = pthread_self();
+}
+
+TEST_SUITE_CLEANUP(b)
+{
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(f)
+{
+    lock_init_will_fail = false;
+    test_thread_lock_failures = 0;
+    test_address_count = 0;
+    lookup_complete = false;
+    resolver_count = 0;
+    invalidate_count = 0;
+    open_complete_count = 0;
+    open_result = IO_OPEN_ERROR;
+    close_complete_count = 0;
+    io_error_count = 0;
+    bytes_received_count = 0;
+    received_size = 0;
+}
+
+TEST_FUNCTION_CLEANUP(cleans)
+{
+}
+
+/* reactor */
+
+TEST_FUNCTION(socketio_with_the_reactor_sends_and_receives_bytes)
+{
+    // arrange
+    int port;
+    int server;
+    int listener = create_listener(AF_INET, 1, &port);
+    size_t reactor_locks_before = get_other_thread_lock_count();
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+
+    // act
+    assert_bytes_flow(socket_io, server);
+
+    // assert
+    ASSERT_IS_TRUE(get_other_thread_lock_count() > reactor_locks_before);
+    ASSERT_ARE_EQUAL(size_t, 0, io_error_count);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+TEST_FUNCTION(when_the_reactor_cannot_be_created_socketio_keeps_polling_its_socket)
+{
+    // arrange
+    int port;
+    int server;
+    int use_reactor = 1;
+    int listener = create_listener(AF_INET, 1, &port);
+    size_t descriptors_before = count_open_descriptors();
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 0, &server);
+    lock_init_will_fail = true;
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(socket_io, OPTION_SOCKETIO_USE_REACTOR, &use_reactor));
+
+    // assert
+    /* only the connected and the accepted sockets are new, no epoll or event descriptor was left behind */
+    ASSERT_ARE_EQUAL(size_t, descriptors_before + 2, count_open_descriptors());
+    assert_bytes_flow(socket_io, server);
+    ASSERT_ARE_EQUAL(size_t, 0, io_error_count);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+TEST_FUNCTION(when_unregistering_cannot_lock_the_reactor_the_last_close_still_destroys_the_reactor)
+{
+    // arrange
+    int port;
+    int server;
+    int listener = create_listener(AF_INET, 2, &port);
+    size_t descriptors_before = count_open_descriptors();
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+    assert_bytes_flow(socket_io, server);
+    test_thread_lock_failures = 1;
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, test_thread_lock_failures);
+    ASSERT_ARE_EQUAL(size_t, 1, close_complete_count);
+    /* the socket, the reactor's epoll and event descriptors are all closed, only the accepted socket is left */
+    ASSERT_ARE_EQUAL(size_t, descriptors_before + 1, count_open_descriptors());
+
+    // cleanup
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+TEST_FUNCTION(after_the_reactor_was_destroyed_the_next_instance_gets_a_new_one)
+{
+    // arrange
+    int port;
+    int server;
+    int second_server;
+    int listener = create_listener(AF_INET, 2, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+    CONCRETE_IO_HANDLE second_socket_io;
+    size_t reactor_locks_before;
+    test_thread_lock_failures = 1;
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    test_address_count = 0;
+    open_complete_count = 0;
+    reactor_locks_before = get_other_thread_lock_count();
+
+    // act
+    second_socket_io = open_to_listener(listener, port, 1, &second_server);
+
+    // assert
+    assert_bytes_flow(second_socket_io, second_server);
+    ASSERT_IS_TRUE(get_other_thread_lock_count() > reactor_locks_before);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(second_socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(second_socket_io);
+    (void)close(server);
+    (void)close(second_server);
+    (void)close(listener);
+}
+
+/* asynchronous open */
+
+TEST_FUNCTION(socketio_open_returns_before_the_lookup_completes)
+{
+    // arrange
+    int port;
+    int listener = create_listener(AF_INET, 1, &port);
+    int server;
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 0, NULL };
+    CONCRETE_IO_HANDLE socket_io;
+    config.port = port;
+    add_test_address(AF_INET, port);
+    socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(socket_io, test_on_io_open_complete, NULL, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    socketio_dowork(socket_io);
+    socketio_dowork(socket_io);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, open_complete_count);
+    ASSERT_IS_FALSE(has_pending_connection(listener));
+    lookup_complete = true;
+    dowork_until(socket_io, &open_complete_count, 1);
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+    server = accept(listener, NULL, NULL);
+    ASSERT_IS_TRUE(server >= 0);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    ASSERT_ARE_EQUAL(size_t, 0, resolver_count);
+    (void)close(server);
+    (void)close(listener);
+}
+
+TEST_FUNCTION(socketio_close_while_the_lookup_is_running_cancels_the_open)
+{
+    // arrange
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 443, NULL };
+    CONCRETE_IO_HANDLE socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(socket_io, test_on_io_open_complete, NULL, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    socketio_dowork(socket_io);
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_CANCELLED, (int)open_result);
+    ASSERT_ARE_EQUAL(size_t, 1, close_complete_count);
+    ASSERT_ARE_EQUAL(size_t, 0, resolver_count);
+
+    // cleanup
+    socketio_destroy(socket_io);
+}
+
+TEST_FUNCTION(socketio_close_while_connecting_cancels_the_open)
+{
+    // arrange
+    int port;
+    int queued_client;
+    int listener = create_full_listener(AF_INET, &port, &queued_client);
+    size_t descriptors_before = count_open_descriptors();
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 0, NULL };
+    CONCRETE_IO_HANDLE socket_io;
+    config.port = port;
+    add_test_address(AF_INET, port);
+    lookup_complete = true;
+    socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(socket_io, test_on_io_open_complete, NULL, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    socketio_dowork(socket_io);
+    socketio_dowork(socket_io);
+    ASSERT_ARE_EQUAL(size_t, 0, open_complete_count);
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_CANCELLED, (int)open_result);
+    ASSERT_ARE_EQUAL(size_t, 1, close_complete_count);
+    ASSERT_ARE_EQUAL(size_t, 0, resolver_count);
+    /* the connect in progress was abandoned along with its socket */
+    ASSERT_ARE_EQUAL(size_t, descriptors_before, count_open_descriptors());
+
+    // cleanup
+    socketio_destroy(socket_io);
+    (void)close(queued_client);
+    (void)close(listener);
+}
+
+/* receive buffer */
+
+TEST_FUNCTION(socketio_receives_in_chunks_of_the_receive_buffer_size)
+{
+    // arrange
+    int port;
+    int server;
+    size_t receive_buffer_size = 1;
+    int listener = create_listener(AF_INET, 1, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 0, &server);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(socket_io, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE, &receive_buffer_size));
+    ASSERT_ARE_EQUAL(int, 3, (int)send(server, "abc", 3, 0));
+
+    // act
+    dowork_until(socket_io, &received_size, 3);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 3, received_size);
+    ASSERT_ARE_EQUAL(size_t, 3, bytes_received_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(received_bytes, "abc", 3));
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+TEST_FUNCTION(socketio_setoption_with_a_receive_buffer_size_of_0_fails)
+{
+    // arrange
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 443, NULL };
+    size_t receive_buffer_size = 0;
+    CONCRETE_IO_HANDLE socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+
+    // act
+    int result = socketio_setoption(socket_io, OPTION_SOCKETIO_RECEIVE_BUFFER_SIZE, &receive_buffer_size);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    socketio_destroy(socket_io);
+}
+
+/* Happy Eyeballs */
+
+TEST_FUNCTION(socketio_tries_the_address_families_in_turn)
+{
+    // arrange
+    int first_port;
+    int second_port;
+    int ipv4_listener = create_listener(AF_INET, 1, &first_port);
+    int ipv6_listener = create_listener(AF_INET6, 1, &second_port);
+    int server;
+    CONCRETE_IO_HANDLE socket_io;
+    add_test_address(AF_INET6, get_closed_port(AF_INET6));
+    add_test_address(AF_INET6, second_port);
+    add_test_address(AF_INET, first_port);
+
+    // act
+    socket_io = open_to_test_addresses();
+    dowork_until(socket_io, &open_complete_count, 1);
+
+    // assert
+    /* the refused IPv6 address is followed by the IPv4 one, not by the next IPv6 one */
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+    ASSERT_IS_TRUE(has_pending_connection(ipv4_listener));
+    ASSERT_IS_FALSE(has_pending_connection(ipv6_listener));
+    server = accept(ipv4_listener, NULL, NULL);
+    ASSERT_IS_TRUE(server >= 0);
+    assert_bytes_flow(socket_io, server);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(ipv6_listener);
+    (void)close(ipv4_listener);
+}
+
+TEST_FUNCTION(socketio_starts_the_next_address_after_the_connection_attempt_delay)
+{
+    // arrange
+    int ipv6_port;
+    int ipv4_port;
+    int queued_client;
+    int ipv6_listener = create_full_listener(AF_INET6, &ipv6_port, &queued_client);
+    int ipv4_listener = create_listener(AF_INET, 1, &ipv4_port);
+    int server;
+    int i;
+    struct timespec start;
+    CONCRETE_IO_HANDLE socket_io;
+    add_test_address(AF_INET6, ipv6_port);
+    add_test_address(AF_INET, ipv4_port);
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // act
+    socket_io = open_to_test_addresses();
+    for (i = 0; i < 10; i++)
+    {
+        socketio_dowork(socket_io);
+        sleep_a_bit();
+    }
+
+    // assert
+    /* the IPv6 connect is still in progress and the IPv4 one has not started yet */
+    ASSERT_ARE_EQUAL(size_t, 0, open_complete_count);
+    ASSERT_IS_FALSE(has_pending_connection(ipv4_listener));
+    dowork_until(socket_io, &open_complete_count, 1);
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+    ASSERT_IS_TRUE(get_elapsed_milliseconds(&start) >= 250);
+    server = accept(ipv4_listener, NULL, NULL);
+    ASSERT_IS_TRUE(server >= 0);
+    assert_bytes_flow(socket_io, server);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(ipv4_listener);
+    (void)close(queued_client);
+    (void)close(ipv6_listener);
+}
+
+TEST_FUNCTION(when_every_address_fails_socketio_reports_the_error_and_invalidates_the_lookup)
+{
+    // arrange
+    CONCRETE_IO_HANDLE socket_io;
+    add_test_address(AF_INET6, get_closed_port(AF_INET6));
+    add_test_address(AF_INET, get_closed_port(AF_INET));
+
+    // act
+    socket_io = open_to_test_addresses();
+    dowork_until(socket_io, &open_complete_count, 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, open_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_ERROR, (int)open_result);
+    ASSERT_ARE_EQUAL(size_t, 1, invalidate_count);
+
+    // cleanup
+    socketio_destroy(socket_io);
+    ASSERT_ARE_EQUAL(size_t, 0, resolver_count);
+}
+
+/* socketio_lend_socket */
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_001: [ If `socket_io` or `lent_socket` is NULL, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_lend_socket_with_NULL_socket_io_fails)
+{
+    // arrange
+    int lent_socket;
+
+    // act
+    int result = socketio_lend_socket(NULL, &lent_socket);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_001: [ If `socket_io` or `lent_socket` is NULL, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_lend_socket_with_NULL_lent_socket_fails)
+{
+    // arrange
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 443, NULL };
+    CONCRETE_IO_HANDLE socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+
+    // act
+    int result = socketio_lend_socket(socket_io, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    socketio_destroy(socket_io);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_002: [ If the instance is not open, its socket is already lent or sends are still queued, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_lend_socket_when_not_open_fails)
+{
+    // arrange
+    int lent_socket;
+    SOCKETIO_CONFIG config = { TEST_HOSTNAME, 443, NULL };
+    CONCRETE_IO_HANDLE socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(socket_io);
+
+    // act
+    int result = socketio_lend_socket(socket_io, &lent_socket);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    socketio_destroy(socket_io);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_002: [ If the instance is not open, its socket is already lent or sends are still queued, `socketio_lend_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_lend_socket_when_already_lent_fails)
+{
+    // arrange
+    int port;
+    int server;
+    int lent_socket;
+    int listener = create_listener(AF_INET, 1, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+    ASSERT_ARE_EQUAL(int, 0, socketio_lend_socket(socket_io, &lent_socket));
+
+    // act
+    int result = socketio_lend_socket(socket_io, &lent_socket);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_003: [ Otherwise `socketio_lend_socket` shall remove the socket from the reactor, stop reading and writing it from `socketio_dowork` and `socketio_send`, store it in `lent_socket` and return 0. ]*/
+TEST_FUNCTION(socketio_lend_socket_hands_out_the_connected_socket)
+{
+    // arrange
+    int port;
+    int server;
+    int lent_socket = -1;
+    int i;
+    char buffer[8];
+    int listener = create_listener(AF_INET, 1, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+
+    // act
+    int result = socketio_lend_socket(socket_io, &lent_socket);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_NOT_EQUAL(int, 0, socketio_send(socket_io, "ping", 4, NULL, NULL));
+    ASSERT_ARE_EQUAL(int, 5, (int)send(server, "hello", 5, 0));
+    for (i = 0; i < 10; i++)
+    {
+        socketio_dowork(socket_io);
+        sleep_a_bit();
+    }
+    ASSERT_ARE_EQUAL(size_t, 0, bytes_received_count);
+    /* the bytes are still there for the borrower */
+    ASSERT_ARE_EQUAL(int, 5, (int)recv(lent_socket, buffer, sizeof(buffer), 0));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(buffer, "hello", 5));
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+/* socketio_reclaim_socket */
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_004: [ If `socket_io` is NULL, `socketio_reclaim_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_reclaim_socket_with_NULL_socket_io_fails)
+{
+    // arrange
+
+    // act
+    int result = socketio_reclaim_socket(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_005: [ If the socket is not lent, `socketio_reclaim_socket` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_reclaim_socket_when_not_lent_fails)
+{
+    // arrange
+    int port;
+    int server;
+    int listener = create_listener(AF_INET, 1, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+
+    // act
+    int result = socketio_reclaim_socket(socket_io);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+/* Tests_SRS_SOCKETIO_BERKELEY_01_006: [ Otherwise `socketio_reclaim_socket` shall let `socketio_dowork` and `socketio_send` use the socket again, register it with the reactor again when the reactor is used, and return 0. ]*/
+TEST_FUNCTION(socketio_reclaim_socket_lets_socketio_use_the_socket_again)
+{
+    // arrange
+    int port;
+    int server;
+    int lent_socket;
+    int listener = create_listener(AF_INET, 1, &port);
+    CONCRETE_IO_HANDLE socket_io = open_to_listener(listener, port, 1, &server);
+    ASSERT_ARE_EQUAL(int, 0, socketio_lend_socket(socket_io, &lent_socket));
+
+    // act
+    int result = socketio_reclaim_socket(socket_io);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    assert_bytes_flow(socket_io, server);
+    ASSERT_ARE_EQUAL(size_t, 0, io_error_count);
+
+    // cleanup
+    ASSERT_ARE_EQUAL(int, 0, socketio_close(socket_io, test_on_io_close_complete, NULL));
+    socketio_destroy(socket_io);
+    (void)close(server);
+    (void)close(listener);
+}
+
+END_TEST_SUITE(socketio_berkeley_loopback_ut)
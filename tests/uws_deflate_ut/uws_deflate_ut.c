@@ -0,0 +1,576 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cstdbool>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#endif
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#define ENABLE_MOCKS
+
+#include "azure_c_shared_utility/gballoc.h"
+
+#undef ENABLE_MOCKS
+
+#include "azure_c_shared_utility/uws_deflate.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/* Messages are compressed by one instance and decompressed by another, standing in for the server */
+static unsigned char inflated[65536];
+static size_t inflated_length;
+static size_t largest_output;
+
+static void test_on_output(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    ASSERT_IS_TRUE(inflated_length + size <= sizeof(inflated));
+    (void)memcpy(inflated + inflated_length, buffer, size);
+    inflated_length += size;
+    if (size > largest_output)
+    {
+        largest_output = size;
+    }
+}
+
+static UWS_DEFLATE_CONFIG default_config(void)
+{
+    UWS_DEFLATE_CONFIG config;
+    config.client_max_window_bits = 15;
+    config.server_max_window_bits = 15;
+    config.client_no_context_takeover = false;
+    config.server_no_context_takeover = false;
+    config.mem_level = 8;
+    config.max_message_size = 0;
+    return config;
+}
+
+static void fill_telemetry(unsigned char* buffer, size_t size)
+{
+    static const char record[] = "{\"deviceId\":\"dev1\",\"temperature\":21.5,\"humidity\":40},";
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        buffer[i] = (unsigned char)record[i % (sizeof(record) - 1)];
+    }
+}
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+BEGIN_TEST_SUITE(uws_deflate_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+
+    umock_c_reset_all_calls();
+    inflated_length = 0;
+    largest_output = 0;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* uws_deflate_create_offer */
+
+/* Tests_SRS_UWS_DEFLATE_01_003: [ If `config` is NULL or holds out of range values, `uws_deflate_create_offer` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_offer_with_NULL_config_fails)
+{
+    // arrange
+    char* result;
+
+    // act
+    result = uws_deflate_create_offer(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_003: [ If `config` is NULL or holds out of range values, `uws_deflate_create_offer` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_offer_with_8_window_bits_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    char* result;
+    config.client_max_window_bits = 8;
+
+    // act
+    result = uws_deflate_create_offer(&config);
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_002: [ `uws_deflate_create_offer` shall return a newly allocated `Sec-WebSocket-Extensions` value offering permessage-deflate with `client_max_window_bits`, and with `server_max_window_bits`, `client_no_context_takeover` and `server_no_context_takeover` when `config` asks for them. ]*/
+TEST_FUNCTION(uws_deflate_create_offer_with_default_config_offers_permessage_deflate)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    char* result;
+
+    // act
+    result = uws_deflate_create_offer(&config);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, "permessage-deflate; client_max_window_bits", result);
+
+    // cleanup
+    free(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_002: [ `uws_deflate_create_offer` shall return a newly allocated `Sec-WebSocket-Extensions` value offering permessage-deflate with `client_max_window_bits`, and with `server_max_window_bits`, `client_no_context_takeover` and `server_no_context_takeover` when `config` asks for them. ]*/
+TEST_FUNCTION(uws_deflate_create_offer_with_all_parameters_offers_them)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    char* result;
+    config.client_max_window_bits = 10;
+    config.server_max_window_bits = 11;
+    config.client_no_context_takeover = true;
+    config.server_no_context_takeover = true;
+
+    // act
+    result = uws_deflate_create_offer(&config);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, "permessage-deflate; client_max_window_bits=10; server_max_window_bits=11; client_no_context_takeover; server_no_context_takeover", result);
+
+    // cleanup
+    free(result);
+}
+
+/* uws_deflate_create */
+
+/* Tests_SRS_UWS_DEFLATE_01_004: [ If `config` or `extension_response` is NULL, or `config` holds out of range values, `uws_deflate_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_with_NULL_extension_response_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+
+    // act
+    result = uws_deflate_create(&config, NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_006: [ `uws_deflate_create` shall apply the parameters of `extension_response`, the `Sec-WebSocket-Extensions` value returned by the server, as per RFC 7692. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_008: [ The zlib streams shall only be allocated when the first message is compressed or decompressed. ]*/
+TEST_FUNCTION(uws_deflate_create_with_accepted_parameters_succeeds)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+
+    umock_c_reset_all_calls();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    result = uws_deflate_create(&config, "permessage-deflate; client_max_window_bits=\"12\"; Server_No_Context_Takeover");
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    uws_deflate_destroy(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_007: [ If `extension_response` does not accept permessage-deflate, has unknown, repeated or out of range parameters, or does not accept the offered server parameters, `uws_deflate_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_with_an_unknown_parameter_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+
+    // act
+    result = uws_deflate_create(&config, "permessage-deflate; unknown_parameter");
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_007: [ If `extension_response` does not accept permessage-deflate, has unknown, repeated or out of range parameters, or does not accept the offered server parameters, `uws_deflate_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_with_a_repeated_parameter_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+
+    // act
+    result = uws_deflate_create(&config, "permessage-deflate; server_no_context_takeover; server_no_context_takeover");
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_007: [ If `extension_response` does not accept permessage-deflate, has unknown, repeated or out of range parameters, or does not accept the offered server parameters, `uws_deflate_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_when_the_server_ignores_server_no_context_takeover_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+    config.server_no_context_takeover = true;
+
+    // act
+    result = uws_deflate_create(&config, "permessage-deflate");
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_007: [ If `extension_response` does not accept permessage-deflate, has unknown, repeated or out of range parameters, or does not accept the offered server parameters, `uws_deflate_create` shall fail and return NULL. ]*/
+TEST_FUNCTION(uws_deflate_create_with_another_extension_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE result;
+
+    // act
+    result = uws_deflate_create(&config, "x-webkit-deflate-frame");
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* uws_deflate_compress */
+
+/* Tests_SRS_UWS_DEFLATE_01_011: [ If `uws_deflate`, `compressed` or `compressed_size` is NULL, or `buffer` is NULL while `size` is not 0, `uws_deflate_compress` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_deflate_compress_with_NULL_handle_fails)
+{
+    // arrange
+    const unsigned char* compressed;
+    size_t compressed_size;
+    int result;
+
+    // act
+    result = uws_deflate_compress(NULL, (const unsigned char*)"a", 1, true, &compressed, &compressed_size);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_013: [ `uws_deflate_compress` shall compress `buffer` with the negotiated window into a buffer owned by the instance, ending with a sync flush, and return it through `compressed` and `compressed_size`. The buffer stays valid until the next call. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_014: [ When `is_final` is true, the trailing 0x00 0x00 0xFF 0xFF of the sync flush shall be removed, as per RFC 7692 section 7.2.1. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_019: [ `uws_deflate_decompress` shall decompress the `size` bytes of `buffer`, which may be any part of a compressed message, with the negotiated window. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_023: [ When `is_final` is true, 0x00 0x00 0xFF 0xFF shall be decompressed after `buffer`, as per RFC 7692 section 7.2.2. ]*/
+TEST_FUNCTION(a_compressed_message_decompresses_to_the_original_bytes)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    UWS_DEFLATE_HANDLE server = uws_deflate_create(&config, "permessage-deflate");
+    unsigned char message[8192];
+    const unsigned char* compressed;
+    size_t compressed_size;
+    int result;
+
+    fill_telemetry(message, sizeof(message));
+
+    // act
+    result = uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(compressed_size < sizeof(message) / 8);
+    ASSERT_IS_FALSE((compressed_size >= 4) && (memcmp(compressed + compressed_size - 4, "\x00\x00\xFF\xFF", 4) == 0));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL));
+    ASSERT_ARE_EQUAL(size_t, sizeof(message), inflated_length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(message, inflated, sizeof(message)));
+
+    // cleanup
+    uws_deflate_destroy(client);
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_019: [ `uws_deflate_decompress` shall decompress the `size` bytes of `buffer`, which may be any part of a compressed message, with the negotiated window. ]*/
+TEST_FUNCTION(a_message_compressed_in_fragments_with_context_takeover_decompresses_to_the_original_bytes)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    UWS_DEFLATE_HANDLE server = uws_deflate_create(&config, "permessage-deflate");
+    unsigned char message[4096];
+    const unsigned char* compressed;
+    size_t compressed_size;
+    size_t i;
+
+    fill_telemetry(message, sizeof(message));
+
+    // act
+    for (i = 0; i < 2; i++)
+    {
+        inflated_length = 0;
+        ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, 1000, false, &compressed, &compressed_size));
+        ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, false, test_on_output, NULL));
+        ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message + 1000, sizeof(message) - 1000, true, &compressed, &compressed_size));
+        ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL));
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, sizeof(message), inflated_length);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(message, inflated, sizeof(message)));
+    }
+
+    // cleanup
+    uws_deflate_destroy(client);
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_015: [ When `is_final` is true and client context takeover is disabled, the compressor shall be reset. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_024: [ When `is_final` is true and server context takeover is disabled, the decompressor shall be reset. ]*/
+TEST_FUNCTION(without_context_takeover_each_message_decompresses_with_a_fresh_decompressor)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client;
+    UWS_DEFLATE_HANDLE server;
+    unsigned char message[2048];
+    const unsigned char* compressed;
+    size_t compressed_size;
+
+    config.client_no_context_takeover = true;
+    config.server_no_context_takeover = true;
+    client = uws_deflate_create(&config, "permessage-deflate; client_no_context_takeover; server_no_context_takeover");
+    server = uws_deflate_create(&config, "permessage-deflate; server_no_context_takeover");
+    fill_telemetry(message, sizeof(message));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL));
+    inflated_length = 0;
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL));
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(message), inflated_length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(message, inflated, sizeof(message)));
+
+    // cleanup
+    uws_deflate_destroy(client);
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_028: [ If the buffer returned by the previous call is larger than 65536 bytes, `uws_deflate_compress` shall free it before compressing `buffer`. ]*/
+TEST_FUNCTION(uws_deflate_compress_after_a_large_message_frees_the_large_buffer)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    static unsigned char message[100000];
+    const unsigned char* compressed;
+    size_t compressed_size;
+    int result;
+
+    fill_telemetry(message, sizeof(message));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG));
+
+    // act
+    result = uws_deflate_compress(client, message, 100, true, &compressed, &compressed_size);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    uws_deflate_destroy(client);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_028: [ If the buffer returned by the previous call is larger than 65536 bytes, `uws_deflate_compress` shall free it before compressing `buffer`. ]*/
+TEST_FUNCTION(uws_deflate_compress_after_a_small_message_reuses_the_buffer)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    unsigned char message[1024];
+    const unsigned char* compressed;
+    size_t compressed_size;
+    int result;
+
+    fill_telemetry(message, sizeof(message));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+    umock_c_reset_all_calls();
+
+    // act
+    result = uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    uws_deflate_destroy(client);
+}
+
+/* uws_deflate_decompress */
+
+/* Tests_SRS_UWS_DEFLATE_01_020: [ The decompressed bytes shall be passed to `on_output` in pieces of at most 16384 bytes. ]*/
+TEST_FUNCTION(uws_deflate_decompress_hands_out_at_most_16384_bytes_at_a_time)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    UWS_DEFLATE_HANDLE server = uws_deflate_create(&config, "permessage-deflate");
+    static unsigned char message[60000];
+    const unsigned char* compressed;
+    size_t compressed_size;
+
+    fill_telemetry(message, sizeof(message));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+
+    // act
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL));
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(message), inflated_length);
+    ASSERT_ARE_EQUAL(size_t, 16384, largest_output);
+
+    // cleanup
+    uws_deflate_destroy(client);
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_022: [ If a message decompresses to more than `max_message_size` bytes, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_027: [ `uws_deflate_is_message_too_large` shall return true if the last `uws_deflate_decompress` failed because the message exceeded `max_message_size`, and false otherwise. ]*/
+TEST_FUNCTION(uws_deflate_decompress_of_a_message_larger_than_max_message_size_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE client = uws_deflate_create(&config, "permessage-deflate");
+    UWS_DEFLATE_HANDLE server;
+    unsigned char message[4096];
+    const unsigned char* compressed;
+    size_t compressed_size;
+    int result;
+
+    config.max_message_size = sizeof(message) - 1;
+    server = uws_deflate_create(&config, "permessage-deflate");
+    fill_telemetry(message, sizeof(message));
+    ASSERT_ARE_EQUAL(int, 0, uws_deflate_compress(client, message, sizeof(message), true, &compressed, &compressed_size));
+
+    // act
+    result = uws_deflate_decompress(server, compressed, compressed_size, true, test_on_output, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(uws_deflate_is_message_too_large(server));
+
+    // cleanup
+    uws_deflate_destroy(client);
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_021: [ If the compressed data is corrupt, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+/* Tests_SRS_UWS_DEFLATE_01_027: [ `uws_deflate_is_message_too_large` shall return true if the last `uws_deflate_decompress` failed because the message exceeded `max_message_size`, and false otherwise. ]*/
+TEST_FUNCTION(uws_deflate_decompress_of_corrupt_data_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE server = uws_deflate_create(&config, "permessage-deflate");
+    const unsigned char corrupt[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    int result;
+
+    // act
+    result = uws_deflate_decompress(server, corrupt, sizeof(corrupt), true, test_on_output, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(uws_deflate_is_message_too_large(server));
+
+    // cleanup
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_018: [ If `uws_deflate` or `on_output` is NULL, or `buffer` is NULL while `size` is not 0, `uws_deflate_decompress` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_deflate_decompress_with_NULL_on_output_fails)
+{
+    // arrange
+    UWS_DEFLATE_CONFIG config = default_config();
+    UWS_DEFLATE_HANDLE server = uws_deflate_create(&config, "permessage-deflate");
+    int result;
+
+    // act
+    result = uws_deflate_decompress(server, (const unsigned char*)"a", 1, true, NULL, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    uws_deflate_destroy(server);
+}
+
+/* Tests_SRS_UWS_DEFLATE_01_026: [ If `uws_deflate` is NULL, `uws_deflate_is_message_too_large` shall return false. ]*/
+TEST_FUNCTION(uws_deflate_is_message_too_large_with_NULL_returns_false)
+{
+    // act
+    bool result = uws_deflate_is_message_too_large(NULL);
+
+    // assert
+    ASSERT_IS_FALSE(result);
+}
+
+END_TEST_SUITE(uws_deflate_ut)
@@ -1421,4 +1421,194 @@ TEST_FUNCTION(uws_frame_encoder_encode_masks_a_8_byte_frame_with_different_mask_
     real_BUFFER_delete(result);
 }
 
+/* Tests_SRS_UWS_FRAME_ENCODER_01_035: [ It is used to mask the "Payload data" defined in the same section as frame-payload-data, which includes "Extension data" and "Application data". ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_039: [ To convert masked data into unmasked data, or vice versa, the following algorithm is applied. ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_040: [ The same algorithm applies regardless of the direction of the translation, e.g., the same steps are applied to mask the data as to unmask the data. ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_041: [ Octet i of the transformed data ("transformed-octet-i") is the XOR of octet i of the original data ("original-octet-i") with octet at index i modulo 4 of the masking key ("masking-key-octet-j"): ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_masks_a_125_byte_frame_from_an_unaligned_payload)
+{
+    // arrange
+    BUFFER_HANDLE result;
+    BUFFER_HANDLE newly_created_buffer;
+    unsigned char payload_storage[125 + 1];
+    unsigned char* payload = payload_storage + 1;
+    unsigned char expected_bytes[6 + 125] = { 0x82, 0xFD, 0x00, 0xFF, 0xAA, 0x42 };
+    size_t i;
+
+    for (i = 0; i < 125; i++)
+    {
+        payload[i] = (unsigned char)(i * 7 + 3);
+        expected_bytes[6 + i] = payload[i] ^ expected_bytes[2 + (i % 4)];
+    }
+
+    STRICT_EXPECTED_CALL(BUFFER_new())
+        .CaptureReturn(&newly_created_buffer);
+    STRICT_EXPECTED_CALL(BUFFER_enlarge(IGNORED_PTR_ARG, sizeof(expected_bytes)))
+        .ValidateArgumentValue_handle(&newly_created_buffer);
+    STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+        .ValidateArgumentValue_handle(&newly_created_buffer);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x00);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0xFF);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0xAA);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x42);
+
+    // act
+    result = uws_frame_encoder_encode(WS_BINARY_FRAME, payload, 125, true, true, 0);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), real_BUFFER_length(result));
+    ASSERT_ARE_EQUAL_WITH_MSG(int, 0, memcmp(expected_bytes, real_BUFFER_u_char(result), real_BUFFER_length(result)), "Memory compare failed");
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    real_BUFFER_delete(result);
+}
+
+/* uws_frame_encoder_encode_header */
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_057: [ If `header` or `header_length` is NULL, `reserved` has any bits set except the lowest 3 or `opcode` is greater than 0x0F, `uws_frame_encoder_encode_header` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_header_with_NULL_header_fails)
+{
+    // arrange
+    size_t header_length;
+    int result;
+
+    // act
+    result = uws_frame_encoder_encode_header(WS_BINARY_FRAME, 1, true, true, 0, NULL, &header_length);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_057: [ If `header` or `header_length` is NULL, `reserved` has any bits set except the lowest 3 or `opcode` is greater than 0x0F, `uws_frame_encoder_encode_header` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_header_with_NULL_header_length_fails)
+{
+    // arrange
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    int result;
+
+    // act
+    result = uws_frame_encoder_encode_header(WS_BINARY_FRAME, 1, true, true, 0, header, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_057: [ If `header` or `header_length` is NULL, `reserved` has any bits set except the lowest 3 or `opcode` is greater than 0x0F, `uws_frame_encoder_encode_header` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_header_with_reserved_8_fails)
+{
+    // arrange
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    size_t header_length;
+    int result;
+
+    // act
+    result = uws_frame_encoder_encode_header(WS_BINARY_FRAME, 1, true, true, 8, header, &header_length);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_055: [ `uws_frame_encoder_encode_header` shall write to `header` the frame header that `uws_frame_encoder_encode` would produce for a payload of `length` bytes, including the masking key when `is_masked` is true, and set `header_length` to its size. ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_058: [ On success `uws_frame_encoder_encode_header` shall return 0. ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_header_for_a_65536_byte_masked_frame_succeeds)
+{
+    // arrange
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    unsigned char expected_header[] = { 0x82, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04 };
+    size_t header_length;
+    int result;
+
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x01);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x02);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x03);
+    STRICT_EXPECTED_CALL(gb_rand())
+        .SetReturn(0x04);
+
+    // act
+    result = uws_frame_encoder_encode_header(WS_BINARY_FRAME, 65536, true, true, 0, header, &header_length);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_header), header_length);
+    stringify_bytes(expected_header, sizeof(expected_header), expected_encoded_str, sizeof(expected_encoded_str));
+    stringify_bytes(header, header_length, actual_encoded_str, sizeof(actual_encoded_str));
+    ASSERT_ARE_EQUAL(char_ptr, expected_encoded_str, actual_encoded_str);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_055: [ `uws_frame_encoder_encode_header` shall write to `header` the frame header that `uws_frame_encoder_encode` would produce for a payload of `length` bytes, including the masking key when `is_masked` is true, and set `header_length` to its size. ]*/
+TEST_FUNCTION(uws_frame_encoder_encode_header_for_a_126_byte_unmasked_frame_succeeds)
+{
+    // arrange
+    unsigned char header[UWS_FRAME_ENCODER_MAX_HEADER_SIZE];
+    unsigned char expected_header[] = { 0x01, 0x7E, 0x00, 0x7E };
+    size_t header_length;
+    int result;
+
+    // act
+    result = uws_frame_encoder_encode_header(WS_TEXT_FRAME, 126, false, false, 0, header, &header_length);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_header), header_length);
+    stringify_bytes(expected_header, sizeof(expected_header), expected_encoded_str, sizeof(expected_encoded_str));
+    stringify_bytes(header, header_length, actual_encoded_str, sizeof(actual_encoded_str));
+    ASSERT_ARE_EQUAL(char_ptr, expected_encoded_str, actual_encoded_str);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* uws_frame_encoder_mask */
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_061: [ If `length` is greater than 0 and `destination`, `source` or `masking_key` is NULL, `uws_frame_encoder_mask` shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(uws_frame_encoder_mask_with_NULL_masking_key_fails)
+{
+    // arrange
+    unsigned char bytes[] = { 0x42 };
+    int result;
+
+    // act
+    result = uws_frame_encoder_mask(bytes, bytes, sizeof(bytes), NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_UWS_FRAME_ENCODER_01_059: [ `uws_frame_encoder_mask` shall write to `destination` the `length` bytes of `source` masked with the 4 byte `masking_key`, starting with octet 0 of the key. ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_060: [ `destination` and `source` shall be allowed to be the same buffer, in which case the bytes are masked in place. ]*/
+/* Tests_SRS_UWS_FRAME_ENCODER_01_062: [ On success `uws_frame_encoder_mask` shall return 0. ]*/
+TEST_FUNCTION(uws_frame_encoder_mask_masks_in_place)
+{
+    // arrange
+    unsigned char masking_key[] = { 0x00, 0xFF, 0xAA, 0x42 };
+    unsigned char bytes[67];
+    unsigned char expected_bytes[67];
+    size_t i;
+    int result;
+
+    for (i = 0; i < sizeof(bytes); i++)
+    {
+        bytes[i] = (unsigned char)(i * 5 + 1);
+        expected_bytes[i] = bytes[i] ^ masking_key[i % 4];
+    }
+
+    // act
+    result = uws_frame_encoder_mask(bytes, bytes, sizeof(bytes), masking_key);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL_WITH_MSG(int, 0, memcmp(expected_bytes, bytes, sizeof(bytes)), "Memory compare failed");
+}
+
 END_TEST_SUITE(uws_frame_encoder_ut)
@@ -971,5 +971,76 @@ TEST_FUNCTION(xio_retrieveoptions_unhappypaths)
     umock_c_negative_tests_deinit();
 }
 
+/* Tests_SRS_XIO_01_028: [ If `xio` or `io_interface_description` is NULL, `xio_get_concrete_handle` shall return NULL. ]*/
+TEST_FUNCTION(xio_get_concrete_handle_with_NULL_xio_returns_NULL)
+{
+    // arrange
+    CONCRETE_IO_HANDLE result;
+
+    // act
+    result = xio_get_concrete_handle(NULL, &test_io_description);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_XIO_01_028: [ If `xio` or `io_interface_description` is NULL, `xio_get_concrete_handle` shall return NULL. ]*/
+TEST_FUNCTION(xio_get_concrete_handle_with_NULL_io_interface_description_returns_NULL)
+{
+    // arrange
+    CONCRETE_IO_HANDLE result;
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = xio_get_concrete_handle(handle, NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_029: [ If `xio` was not created with `io_interface_description`, `xio_get_concrete_handle` shall return NULL. ]*/
+TEST_FUNCTION(xio_get_concrete_handle_with_another_io_interface_description_returns_NULL)
+{
+    // arrange
+    CONCRETE_IO_HANDLE result;
+    IO_INTERFACE_DESCRIPTION other_io_description = test_io_description;
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = xio_get_concrete_handle(handle, &other_io_description);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_030: [ Otherwise `xio_get_concrete_handle` shall return the handle created by `concrete_io_create` in `xio_create`. ]*/
+TEST_FUNCTION(xio_get_concrete_handle_returns_the_concrete_handle)
+{
+    // arrange
+    CONCRETE_IO_HANDLE result;
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = xio_get_concrete_handle(handle, &test_io_description);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CONCRETE_IO_HANDLE, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
 
 END_TEST_SUITE(xio_unittests)